@@ -0,0 +1,1274 @@
+#include <ev.h>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <condition_variable>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <mutex>
+#include <vector>
+#include <SDL_mixer.h>
+#include <spdlog/spdlog.h>
+#include "utils/trace.hpp"
+#include "eq.hpp"
+#include "mix.hpp"
+#include "__init__.hpp"
+
+/**
+ * @brief Frames decoded at a time, without lock held.
+ */
+#define AUDIO_DECODE_SLICE 4096
+
+/**
+ * @brief Decoders kept by decode thread, for the track fading in and the one fading out.
+ */
+#define AUDIO_READERS 2
+
+/**
+ * @brief Crossfade gains are exact every this many frames, and linear in between.
+ */
+#define AUDIO_FADE_BLOCK 256
+
+/**
+ * @brief Stream position that is never reached.
+ */
+#define AUDIO_POS_NONE UINT64_MAX
+
+/**
+ * @brief Mono samples kept by output tap, a power of two.
+ */
+#define AUDIO_TAP_FRAMES 16384
+
+typedef enum audio_segment_type
+{
+    AUDIO_SEGMENT_PLAY,   /**< Started by play or seek. */
+    AUDIO_SEGMENT_SPLICE, /**< Queued track spliced or faded in. */
+    AUDIO_SEGMENT_END,    /**< End of stream. */
+} audio_segment_type_t;
+
+/**
+ * @brief Frames in stream from one track.
+ */
+typedef struct audio_segment
+{
+    audio_segment_type_t       type;   /**< Segment type. */
+    uint64_t                   start;  /**< Stream position where it begins. */
+    soundsphere::AudioTrackPtr track;  /**< Track, nullptr for #AUDIO_SEGMENT_END. */
+    uint64_t                   offset; /**< Track frame at #audio_segment::start. */
+} audio_segment_t;
+
+typedef std::deque<audio_segment_t> AudioSegmentQueue;
+
+/**
+ * @brief Decoder of a track, only used by decode thread.
+ */
+typedef struct audio_reader
+{
+    audio_reader();
+
+    soundsphere::AudioTrackPtr    track; /**< Track, or nullptr if unused. */
+    soundsphere::audio_decoder_t *dec;   /**< Decoder of #audio_reader::track, nullptr if it failed. */
+    uint64_t                      pos;   /**< Next frame of #audio_reader::dec. */
+} audio_reader_t;
+
+/**
+ * @brief Frames decoded by decode thread without lock.
+ */
+typedef struct audio_slice
+{
+    audio_slice();
+
+    uint64_t                   gen;      /**< #audio_ctx::gen when planned. */
+    int                        channels; /**< Device channels when planned. */
+    soundsphere::AudioTrackPtr in;       /**< Track fading in, or playing. */
+    uint64_t                   in_pos;   /**< First frame of #audio_slice::in. */
+    uint64_t                   frames;   /**< Frames wanted of #audio_slice::in. */
+    uint64_t                   in_got;   /**< Frames decoded of #audio_slice::in. */
+    soundsphere::AudioTrackPtr out;      /**< Track fading out, or nullptr. */
+    uint64_t                   out_pos;  /**< First frame of #audio_slice::out. */
+    uint64_t                   out_want; /**< Frames wanted of #audio_slice::out. */
+    uint64_t                   out_got;  /**< Frames decoded of #audio_slice::out. */
+    soundsphere::AudioTrackPtr next;     /**< Track queued, its decoder is kept. */
+} audio_slice_t;
+
+typedef struct audio_ctx
+{
+    audio_ctx();
+
+    soundsphere::audio_notify_fn notify;        /**< Notify callback. */
+    int                          read_ahead_ms; /**< Decoded audio to buffer ahead of output. */
+
+    /*
+     * Device format, only changed by #soundsphere::audio_reopen() with
+     * callbacks stopped and lock held.
+     */
+
+    int             freq;     /**< Device sample rate. */
+    SDL_AudioFormat format;   /**< Device sample format. */
+    int             channels; /**< Device channels. */
+    size_t          frame;    /**< Bytes per frame. */
+
+    /*
+     * Single producer single consumer ring of decoded frames. Stream position
+     * only increases, and maps to ring by modulo.
+     */
+
+    uint8_t *ring;        /**< Ring buffer. */
+    uint64_t ring_frames; /**< Capacity in frames. */
+
+    std::atomic<uint64_t> write_pos; /**< Frames written by decode thread. */
+    std::atomic<uint64_t> read_pos;  /**< Frames consumed by audio callback. */
+    std::atomic<uint64_t> flush_at;  /**< Stream position audio callback skips to. */
+    std::atomic<uint64_t> flush_seq; /**< Increased after #audio_ctx::flush_at is set. */
+    std::atomic<uint64_t> boundary;  /**< Notify when output reaches here. */
+    std::atomic<uint64_t> eos_at;    /**< End of stream, running out before it is an underrun. */
+    std::atomic<uint64_t> underruns; /**< Times output ran out of frames. */
+    std::atomic<bool>     paused;    /**< Is paused. */
+    std::atomic<int>      volume;    /**< Volume, in range of [0, SDL_MIX_MAXVOLUME]. */
+    std::atomic<int>      crossfade; /**< Crossfade duration, in milliseconds. */
+    std::atomic<int>      replaygain; /**< #soundsphere::audio_replaygain_t. */
+    std::atomic<float>    preamp;     /**< ReplayGain pre-amplification, in dB. */
+
+    /**
+     * @brief Last seen #audio_ctx::flush_seq, only used by audio callback.
+     */
+    uint64_t flush_seen;
+
+    /**
+     * @brief Time to wait when buffer is full.
+     */
+    std::chrono::milliseconds full_wait;
+
+    /**
+     * @brief Crossfade kernel, or nullptr if output format is not supported.
+     */
+    soundsphere::audio_mix_ramp_s16_fn mix;
+
+    /**
+     * @brief #AUDIO_FADE_BLOCK frames of silence, to fade in after a track that ends early.
+     */
+    uint8_t *silence;
+
+    /**
+     * @brief Equalizer of output, only used if output format is supported.
+     */
+    soundsphere::audio_eq_t *eq;
+
+    /*
+     * Output tap, a ring of what was sent to device, downmixed to mono. Unlike
+     * the decode ring it is overwritten without waiting for readers, so
+     * readers check #audio_ctx::tap_claim afterwards like a seqlock.
+     */
+
+    std::atomic<float>   *tap;       /**< #AUDIO_TAP_FRAMES samples. */
+    std::atomic<uint64_t> tap_claim; /**< Samples before it may be being overwritten. */
+    std::atomic<uint64_t> tap_pos;   /**< Samples written. */
+    std::atomic<int>      tap_freq;  /**< Sample rate of tap, or 0 if output format is not supported. */
+
+    ev_os_thread_t thread;
+
+    /**
+     * @brief Protects fields below. Never taken by audio callback.
+     */
+    std::mutex              mutex;
+    std::condition_variable cond;
+    bool                    looping;
+
+    uint64_t                   gen;       /**< Increased when stream is flushed or format changes. */
+    soundsphere::AudioTrackPtr cur;       /**< Track being decoded. */
+    uint64_t                   cur_pos;   /**< Next frame of #audio_ctx::cur. */
+    uint64_t                   cur_end;   /**< Length of #audio_ctx::cur, #AUDIO_POS_NONE until known. */
+    soundsphere::AudioTrackPtr next;      /**< Track to splice after #audio_ctx::cur. */
+    bool                       next_fade; /**< Crossfade into #audio_ctx::next. */
+    AudioSegmentQueue          segments;  /**< Segments not fully heard, the first one is being heard. */
+    uint64_t                   advances;  /**< Times output entered a spliced track. */
+
+    /*
+     * Crossfade in progress, #audio_ctx::cur is the track fading in.
+     */
+
+    soundsphere::AudioTrackPtr fade_out;     /**< Track fading out, or nullptr if not fading. */
+    uint64_t                   fade_out_pos; /**< Next frame of #audio_ctx::fade_out. */
+    uint64_t                   fade_out_end; /**< Length of #audio_ctx::fade_out, #AUDIO_POS_NONE until known. */
+    uint64_t                   fade_len;     /**< Fade duration, in frames. */
+    uint64_t                   fade_done;    /**< Frames faded so far. */
+
+    /*
+     * Decoding, only used by decode thread.
+     */
+
+    audio_reader_t readers[AUDIO_READERS]; /**< Decoders of tracks being read, used without lock. */
+
+    /**
+     * @brief A slice with gain and crossfade applied, used with lock held.
+     */
+    std::vector<int16_t> stage_mix;
+} audio_ctx_t;
+
+static audio_ctx_t *s_audio = nullptr;
+
+audio_reader::audio_reader()
+{
+    dec = nullptr;
+    pos = 0;
+}
+
+audio_slice::audio_slice()
+{
+    gen = 0;
+    channels = 0;
+    in_pos = 0;
+    frames = 0;
+    in_got = 0;
+    out_pos = 0;
+    out_want = 0;
+    out_got = 0;
+}
+
+audio_ctx::audio_ctx()
+{
+    notify = nullptr;
+    read_ahead_ms = 0;
+    freq = 0;
+    format = 0;
+    channels = 0;
+    frame = 0;
+    ring = nullptr;
+    ring_frames = 0;
+    write_pos.store(0);
+    read_pos.store(0);
+    flush_at.store(0);
+    flush_seq.store(0);
+    boundary.store(AUDIO_POS_NONE);
+    eos_at.store(0);
+    underruns.store(0);
+    paused.store(false);
+    volume.store(SDL_MIX_MAXVOLUME);
+    crossfade.store(0);
+    replaygain.store(soundsphere::AUDIO_REPLAYGAIN_OFF);
+    preamp.store(0.0f);
+    flush_seen = 0;
+    full_wait = std::chrono::milliseconds(1);
+    mix = nullptr;
+    silence = nullptr;
+    eq = nullptr;
+    tap = nullptr;
+    tap_claim.store(0);
+    tap_pos.store(0);
+    tap_freq.store(0);
+    looping = true;
+    gen = 0;
+    cur_pos = 0;
+    cur_end = AUDIO_POS_NONE;
+    next_fade = false;
+    advances = 0;
+    fade_out_pos = 0;
+    fade_out_end = AUDIO_POS_NONE;
+    fade_len = 0;
+    fade_done = 0;
+}
+
+soundsphere::audio_status::audio_status()
+{
+    advances = 0;
+    paused = false;
+    position = 0.0;
+}
+
+soundsphere::audio_spec::audio_spec()
+{
+    freq = 0;
+    channels = 0;
+    bits = 0;
+}
+
+/**
+ * @brief Runs in SDL audio thread, \p stream is silence on entry. Lock free.
+ */
+static void _audio_mix(void *udata, Uint8 *stream, int len)
+{
+    (void)udata;
+
+    uint64_t read = s_audio->read_pos.load(std::memory_order_relaxed);
+    uint64_t seq = s_audio->flush_seq.load(std::memory_order_acquire);
+    if (seq != s_audio->flush_seen)
+    {
+        s_audio->flush_seen = seq;
+        read = s_audio->flush_at.load(std::memory_order_relaxed);
+        s_audio->read_pos.store(read, std::memory_order_release);
+    }
+
+    if (s_audio->paused.load(std::memory_order_relaxed))
+    {
+        return;
+    }
+
+    uint64_t write = s_audio->write_pos.load(std::memory_order_acquire);
+    uint64_t want = (uint64_t)len / s_audio->frame;
+    uint64_t frames = write - read < want ? write - read : want;
+    int      volume = s_audio->volume.load(std::memory_order_relaxed);
+
+    uint64_t off = read % s_audio->ring_frames;
+    uint64_t first = frames < s_audio->ring_frames - off ? frames : s_audio->ring_frames - off;
+    SDL_MixAudioFormat(stream, s_audio->ring + off * s_audio->frame, s_audio->format,
+                       (Uint32)(first * s_audio->frame), volume);
+    SDL_MixAudioFormat(stream + first * s_audio->frame, s_audio->ring, s_audio->format,
+                       (Uint32)((frames - first) * s_audio->frame), volume);
+
+    if (frames < want && read + frames < s_audio->eos_at.load(std::memory_order_relaxed))
+    {
+        s_audio->underruns.fetch_add(1, std::memory_order_relaxed);
+    }
+    s_audio->read_pos.store(read + frames, std::memory_order_release);
+
+    uint64_t boundary = s_audio->boundary.load(std::memory_order_relaxed);
+    if (read < boundary && read + frames >= boundary && s_audio->notify != nullptr)
+    {
+        s_audio->notify();
+    }
+}
+
+/**
+ * @brief Runs in SDL audio thread after output is mixed, equalizes it and copies it into tap. Lock free.
+ * The gap between two trace marks shows when the device was starved.
+ */
+static void _audio_postmix(void *udata, Uint8 *stream, int len)
+{
+    (void)udata;
+    TRACE_THREAD_NAME("audio");
+    TRACE_INSTANT("audio_callback");
+
+    if (s_audio->mix == nullptr)
+    {
+        return;
+    }
+
+    /* Tap shows what is heard, so equalize first. */
+    soundsphere::audio_eq_process(*s_audio->eq, (int16_t *)stream, (size_t)len / s_audio->frame);
+
+    const int16_t *src = (const int16_t *)stream;
+    const int      channels = s_audio->channels;
+    const float    scale = 1.0f / (32768.0f * (float)channels);
+    uint64_t       frames = (uint64_t)len / s_audio->frame;
+    uint64_t       pos = s_audio->tap_pos.load(std::memory_order_relaxed);
+
+    /* Readers seeing any sample below must also see the claim. */
+    s_audio->tap_claim.store(pos + frames, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    for (uint64_t i = 0; i < frames; i++)
+    {
+        int sum = 0;
+        for (int c = 0; c < channels; c++)
+        {
+            sum += src[c];
+        }
+        src += channels;
+        s_audio->tap[(pos + i) & (AUDIO_TAP_FRAMES - 1)].store((float)sum * scale, std::memory_order_relaxed);
+    }
+    s_audio->tap_pos.store(pos + frames, std::memory_order_release);
+}
+
+/**
+ * @brief Notify at the next segment boundary ahead of output. Must be called with lock held.
+ */
+static void _audio_rearm(void)
+{
+    uint64_t read = s_audio->read_pos.load(std::memory_order_acquire);
+    uint64_t boundary = AUDIO_POS_NONE;
+    for (AudioSegmentQueue::iterator it = s_audio->segments.begin(); it != s_audio->segments.end(); it++)
+    {
+        if (it->type != AUDIO_SEGMENT_PLAY && it->start > read)
+        {
+            boundary = it->start;
+            break;
+        }
+    }
+    s_audio->boundary.store(boundary, std::memory_order_relaxed);
+
+    /* Output may have passed it in the meantime. */
+    if (boundary != AUDIO_POS_NONE && s_audio->read_pos.load(std::memory_order_acquire) >= boundary &&
+        s_audio->notify != nullptr)
+    {
+        s_audio->notify();
+    }
+}
+
+/**
+ * @brief Drop segments already heard. Must be called with lock held.
+ */
+static void _audio_sync(void)
+{
+    uint64_t read = s_audio->read_pos.load(std::memory_order_acquire);
+    while (s_audio->segments.size() >= 2 && s_audio->segments[1].start <= read)
+    {
+        s_audio->advances += s_audio->segments[1].type == AUDIO_SEGMENT_SPLICE ? 1 : 0;
+        s_audio->segments.pop_front();
+    }
+    _audio_rearm();
+}
+
+/**
+ * @brief Discard everything not yet heard. Must be called with lock held.
+ * @return Stream position where new frames begin.
+ */
+static uint64_t _audio_flush(void)
+{
+    uint64_t pos = s_audio->write_pos.load(std::memory_order_relaxed);
+    s_audio->flush_at.store(pos, std::memory_order_relaxed);
+    s_audio->flush_seq.fetch_add(1, std::memory_order_release);
+
+    s_audio->segments.clear();
+    s_audio->boundary.store(AUDIO_POS_NONE, std::memory_order_relaxed);
+    s_audio->gen++;
+    return pos;
+}
+
+/**
+ * @brief Decode \p track from \p pos. Must be called with lock held.
+ * @param[in] track     Track, or nullptr to stop decoding.
+ * @param[in] pos       Frame to start at.
+ */
+static void _audio_set_cur(const soundsphere::AudioTrackPtr &track, uint64_t pos)
+{
+    s_audio->cur = track;
+    s_audio->cur_pos = pos;
+    s_audio->cur_end = track.get() != nullptr ? track->frames : AUDIO_POS_NONE;
+}
+
+/**
+ * @brief Length of \p track as far as known, #AUDIO_POS_NONE if not. Must be called with lock held.
+ */
+static uint64_t _audio_track_end(const soundsphere::AudioTrackPtr &track)
+{
+    if (track == s_audio->cur)
+    {
+        return s_audio->cur_end;
+    }
+    if (track == s_audio->fade_out)
+    {
+        return s_audio->fade_out_end;
+    }
+    return track->frames;
+}
+
+/**
+ * @brief Crossfade duration from a track with \p out_frames left into \p in.
+ * Must be called with lock held.
+ */
+static uint64_t _audio_fade_frames(uint64_t out_frames, const soundsphere::audio_track_t *in)
+{
+    if (s_audio->mix == nullptr)
+    {
+        return 0;
+    }
+
+    uint64_t frames = (uint64_t)s_audio->crossfade.load(std::memory_order_relaxed) * s_audio->freq / 1000;
+    uint64_t in_frames = in->frames / 2;
+    frames = frames < in_frames ? frames : in_frames;
+    return frames < out_frames ? frames : out_frames;
+}
+
+/**
+ * @brief Fade \p out from \p pos out under #audio_ctx::cur. Must be called with lock held.
+ * @param[in] end   Length of \p out as far as known.
+ */
+static void _audio_fade_begin(soundsphere::AudioTrackPtr out, uint64_t pos, uint64_t end, uint64_t frames)
+{
+    s_audio->fade_out = frames > 0 ? out : soundsphere::AudioTrackPtr();
+    s_audio->fade_out_pos = pos;
+    s_audio->fade_out_end = end;
+    s_audio->fade_len = frames;
+    s_audio->fade_done = 0;
+}
+
+/**
+ * @brief Playback gain of \p track, limited so its true peak does not clip.
+ */
+static float _audio_track_gain(const soundsphere::audio_track_t *track)
+{
+    int mode = s_audio->replaygain.load(std::memory_order_relaxed);
+    if (mode == soundsphere::AUDIO_REPLAYGAIN_OFF || !track->has_loudness)
+    {
+        return 1.0f;
+    }
+
+    const soundsphere::audio_loudness_t &loudness =
+        mode == soundsphere::AUDIO_REPLAYGAIN_ALBUM ? track->album_loudness : track->loudness;
+    double db = AUDIO_LOUDNESS_REFERENCE - loudness.integrated + s_audio->preamp.load(std::memory_order_relaxed);
+    double gain = std::pow(10.0, db / 20.0);
+    if (loudness.true_peak > 0.0 && gain * loudness.true_peak > 1.0)
+    {
+        gain = 1.0 / loudness.true_peak;
+    }
+    return (float)gain;
+}
+
+static void _audio_reader_close(audio_reader_t &rd)
+{
+    soundsphere::audio_decoder_close(rd.dec);
+    rd.dec = nullptr;
+    rd.track.reset();
+    rd.pos = 0;
+}
+
+/**
+ * @brief Whether \p rd is where \p slice reads either track.
+ */
+static bool _audio_reader_busy(const audio_reader_t &rd, const audio_slice_t &slice)
+{
+    if (rd.track.get() == nullptr)
+    {
+        return false;
+    }
+    return (rd.track == slice.in && rd.pos == slice.in_pos) || (rd.track == slice.out && rd.pos == slice.out_pos);
+}
+
+/**
+ * @brief Move \p rd to \p pos, dropping its decoder if that fails. The seek
+ * index of the track is bound first once it is built.
+ */
+static void _audio_reader_seek(audio_reader_t &rd, uint64_t pos)
+{
+    if (rd.dec != nullptr)
+    {
+        soundsphere::audio_decoder_bind_index(rd.dec, std::atomic_load(&rd.track->seek_index));
+    }
+    if (rd.dec != nullptr && !soundsphere::audio_decoder_seek(rd.dec, pos))
+    {
+        spdlog::error("seek {} failed", rd.track->music->path);
+        soundsphere::audio_decoder_close(rd.dec);
+        rd.dec = nullptr;
+    }
+    rd.pos = pos;
+}
+
+/**
+ * @brief Decoder of \p track at \p pos. One already there is used, then one
+ * of the same track, so a track is only opened when it starts. Called in
+ * decode thread without lock.
+ */
+static audio_reader_t *_audio_reader_get(const soundsphere::AudioTrackPtr &track, uint64_t pos,
+                                         const audio_slice_t &slice)
+{
+    audio_reader_t *same = nullptr;
+    audio_reader_t *idle = nullptr;
+    for (size_t i = 0; i < AUDIO_READERS; i++)
+    {
+        audio_reader_t &rd = s_audio->readers[i];
+        if (rd.track == track && rd.pos == pos)
+        {
+            return &rd;
+        }
+        if (_audio_reader_busy(rd, slice))
+        {
+            continue;
+        }
+        if (rd.track == track)
+        {
+            same = same != nullptr ? same : &rd;
+        }
+        else if (idle == nullptr || rd.track.get() == nullptr)
+        {
+            idle = &rd;
+        }
+    }
+
+    if (same != nullptr)
+    {
+        _audio_reader_seek(*same, pos);
+        return same;
+    }
+
+    /*
+     * The decoder opened while loading is at frame 0. Only decode thread
+     * touches it once the track is handed to audio output.
+     */
+    audio_reader_t *rd = idle != nullptr ? idle : &s_audio->readers[0];
+    _audio_reader_close(*rd);
+    rd->track = track;
+    rd->dec = track->decoder;
+    track->decoder = nullptr;
+    if (rd->dec == nullptr)
+    {
+        rd->dec = soundsphere::audio_decoder_open(track->music->path, track->music->info.format, track->freq,
+                                                  track->channels);
+    }
+    if (pos != 0)
+    {
+        _audio_reader_seek(*rd, pos);
+    }
+    return rd;
+}
+
+/**
+ * @brief Close decoders of tracks other than \p keep. Called in decode thread without lock.
+ * @param[in] keep  Tracks still decoded, #AUDIO_READERS + 1 of them.
+ */
+static void _audio_reader_trim(const soundsphere::AudioTrackPtr *keep)
+{
+    for (size_t i = 0; i < AUDIO_READERS; i++)
+    {
+        audio_reader_t &rd = s_audio->readers[i];
+        if (rd.track.get() == nullptr)
+        {
+            continue;
+        }
+
+        bool used = false;
+        for (size_t j = 0; j < AUDIO_READERS + 1; j++)
+        {
+            used = used || rd.track == keep[j];
+        }
+        if (!used)
+        {
+            _audio_reader_close(rd);
+        }
+    }
+}
+
+/**
+ * @brief Decode \p frames frames of \p track from \p pos into \p pcm.
+ * Called in decode thread without lock.
+ * @return Frames decoded, less than \p frames at the end of track or on error.
+ */
+static uint64_t _audio_read(const soundsphere::AudioTrackPtr &track, uint64_t pos, int16_t *pcm, uint64_t frames,
+                            const audio_slice_t &slice)
+{
+    audio_reader_t *rd = _audio_reader_get(track, pos, slice);
+    uint64_t        ret = rd->dec != nullptr ? soundsphere::audio_decoder_read(rd->dec, pcm, (size_t)frames) : 0;
+    rd->pos += ret;
+    return ret;
+}
+
+/**
+ * @brief Apply gain to \p frames frames of #audio_ctx::cur in \p in, mixed
+ * with \p out_frames frames of #audio_ctx::fade_out in \p out if fading.
+ * ReplayGain is applied here, so a change is heard after frames already in
+ * ring. Must be called with lock held.
+ * @return Rendered frames, \p in itself if nothing is applied.
+ */
+static const int16_t *_audio_render(const int16_t *in, const int16_t *out, uint64_t out_frames, uint64_t frames)
+{
+    if (s_audio->mix == nullptr)
+    {
+        return in;
+    }
+
+    const int   channels = s_audio->channels;
+    const float gain_in = _audio_track_gain(s_audio->cur.get());
+    int16_t    *dst = s_audio->stage_mix.data();
+    if (s_audio->fade_out.get() == nullptr)
+    {
+        if (gain_in == 1.0f)
+        {
+            return in;
+        }
+        s_audio->mix(dst, in, in, (size_t)frames, channels, gain_in, 0.0f, 0.0f, 0.0f);
+        return dst;
+    }
+
+    const float  gain_out = _audio_track_gain(s_audio->fade_out.get());
+    const double half_pi = 1.57079632679489661923;
+    int16_t     *pos = dst;
+    while (frames > 0)
+    {
+        /* Fading out track ended early, fade in over silence. */
+        uint64_t       n = frames < AUDIO_FADE_BLOCK ? frames : AUDIO_FADE_BLOCK;
+        const int16_t *src = (const int16_t *)s_audio->silence;
+        if (out_frames > 0)
+        {
+            n = n < out_frames ? n : out_frames;
+            src = out;
+            out += n * channels;
+            out_frames -= n;
+        }
+
+        /* Equal power: gains of both tracks are cos and sin of the same angle. */
+        double a0 = half_pi * (double)s_audio->fade_done / (double)s_audio->fade_len;
+        double a1 = half_pi * (double)(s_audio->fade_done + n) / (double)s_audio->fade_len;
+        float  go0 = gain_out * (float)std::cos(a0), go1 = gain_out * (float)std::cos(a1);
+        float  gi0 = gain_in * (float)std::sin(a0), gi1 = gain_in * (float)std::sin(a1);
+        s_audio->mix(pos, src, in, (size_t)n, channels, go0, (go1 - go0) / (float)n, gi0, (gi1 - gi0) / (float)n);
+
+        pos += n * channels;
+        in += n * channels;
+        frames -= n;
+        s_audio->fade_done += n;
+    }
+
+    if (s_audio->fade_done >= s_audio->fade_len)
+    {
+        s_audio->fade_out.reset();
+    }
+    return dst;
+}
+
+/**
+ * @brief Plan next slice of at most \p space frames. Must be called with lock held.
+ * @return false if state changed instead, plan again then.
+ */
+static bool _audio_decode_plan(uint64_t space, audio_slice_t &slice)
+{
+    uint64_t frames = s_audio->cur_end - s_audio->cur_pos;
+    frames = frames < space ? frames : space;
+    frames = frames < AUDIO_DECODE_SLICE ? frames : AUDIO_DECODE_SLICE;
+
+    if (s_audio->fade_out.get() != nullptr)
+    {
+        uint64_t left = s_audio->fade_len - s_audio->fade_done;
+        frames = frames < left ? frames : left;
+    }
+    else if (s_audio->next.get() != nullptr && s_audio->next_fade)
+    {
+        /*
+         * Start crossfade when current track is about to end, output enters
+         * next track there. A track of unknown length is spliced instead.
+         */
+        uint64_t left = s_audio->cur_end - s_audio->cur_pos;
+        uint64_t fade = _audio_fade_frames(s_audio->cur_end / 2, s_audio->next.get());
+        if (left > 0 && left <= fade)
+        {
+            audio_segment_t segment;
+            segment.type = AUDIO_SEGMENT_SPLICE;
+            segment.start = s_audio->write_pos.load(std::memory_order_relaxed);
+            segment.track = s_audio->next;
+            segment.offset = 0;
+            s_audio->segments.push_back(segment);
+
+            _audio_fade_begin(s_audio->cur, s_audio->cur_pos, s_audio->cur_end, left);
+            _audio_set_cur(s_audio->next, 0);
+            s_audio->next.reset();
+            _audio_rearm();
+            return false;
+        }
+        frames = frames < left - fade ? frames : left - fade;
+    }
+
+    slice.gen = s_audio->gen;
+    slice.channels = s_audio->channels;
+    slice.in = s_audio->cur;
+    slice.in_pos = s_audio->cur_pos;
+    slice.frames = frames;
+    slice.in_got = 0;
+    slice.out = s_audio->fade_out;
+    slice.out_pos = s_audio->fade_out_pos;
+    slice.out_want = 0;
+    slice.out_got = 0;
+    slice.next = s_audio->next;
+    if (slice.out.get() != nullptr)
+    {
+        uint64_t want = s_audio->fade_out_end - s_audio->fade_out_pos;
+        slice.out_want = want < frames ? want : frames;
+    }
+    return true;
+}
+
+/**
+ * @brief Decode \p slice into \p in and \p out. Called in decode thread
+ * without lock, so output and control are not held up by file I/O.
+ */
+static void _audio_decode_read(audio_slice_t &slice, std::vector<int16_t> &in, std::vector<int16_t> &out)
+{
+    soundsphere::AudioTrackPtr keep[AUDIO_READERS + 1] = { slice.in, slice.out, slice.next };
+    _audio_reader_trim(keep);
+
+    in.resize((size_t)slice.frames * slice.channels);
+    out.resize((size_t)slice.out_want * slice.channels);
+    if (slice.frames > 0)
+    {
+        slice.in_got = _audio_read(slice.in, slice.in_pos, in.data(), slice.frames, slice);
+    }
+    if (slice.out_want > 0)
+    {
+        slice.out_got = _audio_read(slice.out, slice.out_pos, out.data(), slice.out_want, slice);
+    }
+}
+
+/**
+ * @brief Put decoded \p slice into ring. Must be called with lock held, and
+ * nothing changed since it was planned.
+ */
+static void _audio_decode_commit(const audio_slice_t &slice, const std::vector<int16_t> &in,
+                                 const std::vector<int16_t> &out)
+{
+    uint64_t write = s_audio->write_pos.load(std::memory_order_relaxed);
+
+    /* Ends short if the track is shorter than known, it ends here then. */
+    uint64_t frames = slice.in_got;
+    s_audio->cur_pos += frames;
+    if (frames < slice.frames)
+    {
+        s_audio->cur_end = s_audio->cur_pos;
+    }
+
+    uint64_t out_frames = 0;
+    if (s_audio->fade_out.get() != nullptr && frames > 0)
+    {
+        s_audio->fade_out_pos += slice.out_got;
+        if (slice.out_got < slice.out_want)
+        {
+            s_audio->fade_out_end = s_audio->fade_out_pos;
+        }
+        out_frames = slice.out_got < frames ? slice.out_got : frames;
+    }
+
+    const uint8_t *pcm = (const uint8_t *)_audio_render(in.data(), out.data(), out_frames, frames);
+    uint64_t       off = write % s_audio->ring_frames;
+    uint64_t       first = frames < s_audio->ring_frames - off ? frames : s_audio->ring_frames - off;
+    memcpy(s_audio->ring + off * s_audio->frame, pcm, first * s_audio->frame);
+    memcpy(s_audio->ring, pcm + first * s_audio->frame, (frames - first) * s_audio->frame);
+
+    write += frames;
+    s_audio->write_pos.store(write, std::memory_order_release);
+    if (s_audio->cur_pos < s_audio->cur_end)
+    {
+        return;
+    }
+
+    /* Continue with next track right after the last frame, so there is no gap. */
+    audio_segment_t segment;
+    segment.start = write;
+    segment.offset = 0;
+    s_audio->fade_out.reset();
+    if (s_audio->next.get() != nullptr)
+    {
+        segment.type = AUDIO_SEGMENT_SPLICE;
+        segment.track = s_audio->next;
+        _audio_set_cur(s_audio->next, 0);
+        s_audio->next.reset();
+    }
+    else
+    {
+        segment.type = AUDIO_SEGMENT_END;
+        _audio_set_cur(soundsphere::AudioTrackPtr(), 0);
+        s_audio->eos_at.store(write, std::memory_order_relaxed);
+    }
+    s_audio->segments.push_back(segment);
+    _audio_rearm();
+}
+
+/**
+ * @brief Decode thread. A slice is planned with lock held, decoded without
+ * it, and put into ring with lock held again unless stream was flushed
+ * meanwhile. Otherwise it is dropped, and readers are moved by the next plan.
+ * A track queued meanwhile takes effect from the next slice, so a crossfade
+ * into it may be a slice shorter.
+ */
+static void _audio_decode_thread(void *arg)
+{
+    (void)arg;
+    TRACE_THREAD_NAME("decode");
+    SDL_SetThreadPriority(SDL_THREAD_PRIORITY_HIGH);
+
+    std::vector<int16_t> in;
+    std::vector<int16_t> out;
+    audio_slice_t        slice;
+
+    std::unique_lock<std::mutex> lock(s_audio->mutex);
+    while (s_audio->looping)
+    {
+        if (s_audio->cur.get() == nullptr)
+        {
+            /* Close files of tracks no longer played before sleeping. */
+            soundsphere::AudioTrackPtr keep[AUDIO_READERS + 1] = { s_audio->next };
+            lock.unlock();
+            _audio_reader_trim(keep);
+            lock.lock();
+            if (s_audio->looping && s_audio->cur.get() == nullptr)
+            {
+                s_audio->cond.wait(lock);
+            }
+            continue;
+        }
+
+        /* Buffer is full, wait for output to consume it. */
+        uint64_t used = s_audio->write_pos.load(std::memory_order_relaxed) -
+                        s_audio->read_pos.load(std::memory_order_acquire);
+        if (used >= s_audio->ring_frames)
+        {
+            bool flushing = s_audio->flush_at.load(std::memory_order_relaxed) >
+                            s_audio->read_pos.load(std::memory_order_acquire);
+            s_audio->cond.wait_for(lock, flushing ? std::chrono::milliseconds(1) : s_audio->full_wait);
+            continue;
+        }
+
+        if (!_audio_decode_plan(s_audio->ring_frames - used, slice))
+        {
+            continue;
+        }
+
+        lock.unlock();
+        _audio_decode_read(slice, in, out);
+        lock.lock();
+
+        if (slice.gen == s_audio->gen)
+        {
+            _audio_decode_commit(slice, in, out);
+        }
+        slice = audio_slice_t();
+    }
+    lock.unlock();
+
+    for (size_t i = 0; i < AUDIO_READERS; i++)
+    {
+        _audio_reader_close(s_audio->readers[i]);
+    }
+}
+
+/**
+ * @brief Allocate buffers for device format, and start stream over from position 0.
+ * Callbacks must not be running, and lock must be held if decode thread is running.
+ */
+static void _audio_setup(void)
+{
+    int    freq = 0;
+    Uint16 format = 0;
+    int    channels = 0;
+    Mix_QuerySpec(&freq, &format, &channels);
+    s_audio->freq = freq;
+    s_audio->format = format;
+    s_audio->channels = channels;
+    s_audio->frame = SDL_AUDIO_BITSIZE(format) / 8 * channels;
+
+    delete[] s_audio->ring;
+    s_audio->ring_frames = (uint64_t)freq * (uint64_t)s_audio->read_ahead_ms / 1000;
+    s_audio->ring = new uint8_t[s_audio->ring_frames * s_audio->frame];
+    s_audio->write_pos.store(0, std::memory_order_relaxed);
+    s_audio->read_pos.store(0, std::memory_order_relaxed);
+    s_audio->flush_at.store(0, std::memory_order_relaxed);
+    s_audio->flush_seen = s_audio->flush_seq.load(std::memory_order_relaxed);
+    s_audio->boundary.store(AUDIO_POS_NONE, std::memory_order_relaxed);
+    s_audio->eos_at.store(0, std::memory_order_relaxed);
+
+    delete[] s_audio->silence;
+    s_audio->silence = nullptr;
+    s_audio->mix = nullptr;
+    if (format == AUDIO_S16SYS)
+    {
+        s_audio->mix = soundsphere::audio_mix_ramp_s16();
+        s_audio->silence = new uint8_t[AUDIO_FADE_BLOCK * s_audio->frame];
+        memset(s_audio->silence, 0, AUDIO_FADE_BLOCK * s_audio->frame);
+    }
+
+    if (s_audio->eq == nullptr)
+    {
+        s_audio->eq = new soundsphere::audio_eq_t(freq, channels);
+    }
+    else
+    {
+        soundsphere::audio_eq_reset(*s_audio->eq, freq, channels);
+    }
+
+    /* Old samples are at another rate. */
+    if (s_audio->tap == nullptr)
+    {
+        s_audio->tap = new std::atomic<float>[AUDIO_TAP_FRAMES];
+    }
+    for (size_t i = 0; i < AUDIO_TAP_FRAMES; i++)
+    {
+        s_audio->tap[i].store(0.0f, std::memory_order_relaxed);
+    }
+    s_audio->tap_freq.store(format == AUDIO_S16SYS ? freq : 0, std::memory_order_release);
+
+    /* Tracks are decoded to S16, and only played in that format. */
+    s_audio->stage_mix.resize((size_t)AUDIO_DECODE_SLICE * channels);
+    s_audio->gen++;
+}
+
+void soundsphere::audio_init(audio_notify_fn fn, int read_ahead_ms)
+{
+    s_audio = new audio_ctx_t;
+    s_audio->notify = fn;
+    s_audio->read_ahead_ms = read_ahead_ms < 50 ? 50 : read_ahead_ms;
+    s_audio->full_wait = std::chrono::milliseconds(s_audio->read_ahead_ms / 4);
+    _audio_setup();
+
+    ev_thread_init(&s_audio->thread, nullptr, _audio_decode_thread, nullptr);
+    Mix_HookMusic(_audio_mix, nullptr);
+    Mix_SetPostMix(_audio_postmix, nullptr);
+}
+
+void soundsphere::audio_exit(void)
+{
+    {
+        std::unique_lock<std::mutex> lock(s_audio->mutex);
+        s_audio->looping = false;
+    }
+    s_audio->cond.notify_all();
+    ev_thread_exit(&s_audio->thread, EV_INFINITE_TIMEOUT);
+
+    /* Callback is not running after it returns. */
+    Mix_HookMusic(nullptr, nullptr);
+    Mix_SetPostMix(nullptr, nullptr);
+
+    delete[] s_audio->ring;
+    delete[] s_audio->silence;
+    delete s_audio->eq;
+    delete[] s_audio->tap;
+    delete s_audio;
+    s_audio = nullptr;
+}
+
+bool soundsphere::audio_reopen(int freq, int channels, int buffer_frames)
+{
+    audio_stop();
+
+    /* Callback is not running after it returns, and decode thread has nothing to do. */
+    Mix_HookMusic(nullptr, nullptr);
+    Mix_SetPostMix(nullptr, nullptr);
+    Mix_CloseAudio();
+
+    bool ret = Mix_OpenAudio(freq, s_audio->format, channels, buffer_frames) == 0;
+    if (!ret)
+    {
+        spdlog::error("open audio at {} Hz {} channels failed: {}", freq, channels, Mix_GetError());
+        if (Mix_OpenAudio(s_audio->freq, s_audio->format, s_audio->channels, buffer_frames) != 0)
+        {
+            spdlog::critical("Mix_OpenAudio failed.");
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    {
+        std::unique_lock<std::mutex> lock(s_audio->mutex);
+        _audio_setup();
+    }
+    Mix_HookMusic(_audio_mix, nullptr);
+    Mix_SetPostMix(_audio_postmix, nullptr);
+
+    return ret;
+}
+
+soundsphere::audio_spec_t soundsphere::audio_spec(void)
+{
+    audio_spec_t spec;
+    spec.freq = s_audio->freq;
+    spec.channels = s_audio->channels;
+    spec.bits = SDL_AUDIO_BITSIZE(s_audio->format);
+    return spec;
+}
+
+/**
+ * @brief Whether \p track is decoded in device format. Must be called with lock held.
+ */
+static bool _audio_track_fits(const soundsphere::AudioTrackPtr &track)
+{
+    return track.get() == nullptr || (s_audio->format == AUDIO_S16SYS && track->freq == s_audio->freq &&
+                                      track->channels == s_audio->channels);
+}
+
+void soundsphere::audio_play(AudioTrackPtr track, bool crossfade)
+{
+    {
+        std::unique_lock<std::mutex> lock(s_audio->mutex);
+        _audio_sync();
+        if (!_audio_track_fits(track))
+        {
+            track.reset();
+        }
+
+        /* Where output is now, the few frames played before flush takes effect are repeated. */
+        AudioTrackPtr heard;
+        uint64_t      heard_pos = 0;
+        uint64_t      heard_end = 0;
+        if (crossfade && track.get() != nullptr && !s_audio->segments.empty() &&
+            s_audio->segments.front().track.get() != nullptr && !s_audio->paused.load(std::memory_order_relaxed))
+        {
+            const audio_segment_t &segment = s_audio->segments.front();
+            uint64_t               read = s_audio->read_pos.load(std::memory_order_acquire);
+            heard = segment.track;
+            heard_end = _audio_track_end(heard);
+            heard_pos = segment.offset + (read > segment.start ? read - segment.start : 0);
+            heard_pos = heard_pos < heard_end ? heard_pos : heard_end;
+        }
+
+        uint64_t pos = _audio_flush();
+        _audio_set_cur(track, 0);
+        s_audio->next.reset();
+        s_audio->fade_out.reset();
+        if (heard.get() != nullptr)
+        {
+            _audio_fade_begin(heard, heard_pos, heard_end, _audio_fade_frames(heard_end - heard_pos, track.get()));
+        }
+        s_audio->eos_at.store(track.get() != nullptr ? AUDIO_POS_NONE : pos, std::memory_order_relaxed);
+        s_audio->paused.store(false, std::memory_order_relaxed);
+
+        if (track.get() != nullptr)
+        {
+            audio_segment_t segment;
+            segment.type = AUDIO_SEGMENT_PLAY;
+            segment.start = pos;
+            segment.track = track;
+            segment.offset = 0;
+            s_audio->segments.push_back(segment);
+        }
+    }
+    s_audio->cond.notify_one();
+}
+
+void soundsphere::audio_queue(AudioTrackPtr track, bool crossfade)
+{
+    {
+        std::unique_lock<std::mutex> lock(s_audio->mutex);
+        _audio_sync();
+        if (!_audio_track_fits(track))
+        {
+            track.reset();
+        }
+        s_audio->next = track;
+        s_audio->next_fade = crossfade;
+
+        /* Queued late, but output has not reached the end yet. */
+        if (track.get() != nullptr && s_audio->cur.get() == nullptr && s_audio->segments.size() >= 2 &&
+            s_audio->segments.back().type == AUDIO_SEGMENT_END)
+        {
+            audio_segment_t &segment = s_audio->segments.back();
+            segment.type = AUDIO_SEGMENT_SPLICE;
+            segment.track = track;
+            segment.offset = 0;
+            _audio_set_cur(track, 0);
+            s_audio->next.reset();
+            s_audio->eos_at.store(AUDIO_POS_NONE, std::memory_order_relaxed);
+        }
+    }
+    s_audio->cond.notify_one();
+}
+
+void soundsphere::audio_stop(void)
+{
+    audio_play(AudioTrackPtr(), false);
+}
+
+void soundsphere::audio_pause(bool pause)
+{
+    s_audio->paused.store(pause, std::memory_order_relaxed);
+}
+
+void soundsphere::audio_seek(double position)
+{
+    {
+        std::unique_lock<std::mutex> lock(s_audio->mutex);
+        _audio_sync();
+        if (s_audio->segments.empty() || s_audio->segments.front().track.get() == nullptr)
+        {
+            return;
+        }
+
+        /* Decode thread may be in the track after. */
+        AudioTrackPtr heard = s_audio->segments.front().track;
+        uint64_t      end = _audio_track_end(heard);
+        if (heard != s_audio->cur)
+        {
+            s_audio->next = s_audio->cur;
+        }
+
+        uint64_t offset = position > 0.0 ? (uint64_t)(position * s_audio->freq) : 0;
+        offset = offset < end ? offset : end;
+        _audio_set_cur(heard, offset);
+        s_audio->cur_end = end;
+
+        audio_segment_t segment;
+        segment.type = AUDIO_SEGMENT_PLAY;
+        segment.start = _audio_flush();
+        segment.track = heard;
+        segment.offset = offset;
+        s_audio->segments.push_back(segment);
+        s_audio->fade_out.reset();
+        s_audio->eos_at.store(AUDIO_POS_NONE, std::memory_order_relaxed);
+    }
+    s_audio->cond.notify_one();
+}
+
+soundsphere::audio_status_t soundsphere::audio_poll(void)
+{
+    audio_status_t status;
+
+    std::unique_lock<std::mutex> lock(s_audio->mutex);
+    _audio_sync();
+
+    status.advances = s_audio->advances;
+    status.paused = s_audio->paused.load(std::memory_order_relaxed);
+    if (s_audio->segments.empty())
+    {
+        return status;
+    }
+
+    const audio_segment_t &segment = s_audio->segments.front();
+    status.track = segment.track;
+    status.queued = s_audio->segments.size() >= 2 ? s_audio->segments[1].track : s_audio->next;
+    if (segment.track.get() != nullptr)
+    {
+        uint64_t read = s_audio->read_pos.load(std::memory_order_acquire);
+        uint64_t frame = segment.offset + (read > segment.start ? read - segment.start : 0);
+        status.position = (double)frame / (double)s_audio->freq;
+    }
+
+    return status;
+}
+
+void soundsphere::audio_set_volume(int volume)
+{
+    s_audio->volume.store((int)(((float)volume / 100.0f) * SDL_MIX_MAXVOLUME), std::memory_order_relaxed);
+}
+
+void soundsphere::audio_set_crossfade(int ms)
+{
+    s_audio->crossfade.store(ms > 0 ? ms : 0, std::memory_order_relaxed);
+}
+
+void soundsphere::audio_set_replaygain(audio_replaygain_t mode, double preamp_db)
+{
+    s_audio->preamp.store((float)preamp_db, std::memory_order_relaxed);
+    s_audio->replaygain.store(mode, std::memory_order_relaxed);
+}
+
+void soundsphere::audio_set_eq(bool enabled, const audio_eq_params_t &params)
+{
+    if (s_audio->eq != nullptr)
+    {
+        audio_eq_set(*s_audio->eq, enabled, params);
+    }
+}
+
+int soundsphere::audio_tap_read(float *dst, size_t count)
+{
+    int      freq = s_audio->tap_freq.load(std::memory_order_acquire);
+    uint64_t pos = s_audio->tap_pos.load(std::memory_order_acquire);
+    if (freq == 0 || count > AUDIO_TAP_FRAMES || pos < count)
+    {
+        return 0;
+    }
+
+    uint64_t beg = pos - count;
+    for (size_t i = 0; i < count; i++)
+    {
+        dst[i] = s_audio->tap[(beg + i) & (AUDIO_TAP_FRAMES - 1)].load(std::memory_order_relaxed);
+    }
+
+    /* Overwritten while copying, or device reopened. */
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if (s_audio->tap_claim.load(std::memory_order_relaxed) > beg + AUDIO_TAP_FRAMES ||
+        s_audio->tap_freq.load(std::memory_order_relaxed) != freq)
+    {
+        return 0;
+    }
+
+    return freq;
+}
+
+soundsphere::audio_stats_t soundsphere::audio_stats(void)
+{
+    audio_stats_t stats;
+
+    /* Device format may be changing. */
+    std::unique_lock<std::mutex> lock(s_audio->mutex);
+    uint64_t                     read = s_audio->read_pos.load(std::memory_order_acquire);
+    uint64_t                     write = s_audio->write_pos.load(std::memory_order_acquire);
+
+    stats.buffered = write > read ? (double)(write - read) / (double)s_audio->freq : 0.0;
+    stats.capacity = (double)s_audio->ring_frames / (double)s_audio->freq;
+    stats.underruns = s_audio->underruns.load(std::memory_order_relaxed);
+    return stats;
+}
@@ -0,0 +1,195 @@
+#ifndef SOUND_SPHERE_AUDIO_INIT_HPP
+#define SOUND_SPHERE_AUDIO_INIT_HPP
+
+#include "eq.hpp"
+#include "track.hpp"
+
+namespace soundsphere
+{
+
+/**
+ * @brief ReplayGain mode.
+ */
+typedef enum audio_replaygain
+{
+    AUDIO_REPLAYGAIN_OFF,   /**< No gain. */
+    AUDIO_REPLAYGAIN_TRACK, /**< Normalize each track. */
+    AUDIO_REPLAYGAIN_ALBUM, /**< Normalize each album, keeping level differences within album. */
+} audio_replaygain_t;
+
+/**
+ * @brief Called in SDL audio thread when output enters a spliced track, or
+ * reaches the end of stream. Must not block.
+ */
+typedef void (*audio_notify_fn)(void);
+
+/**
+ * @brief Output state.
+ */
+typedef struct audio_status
+{
+    audio_status();
+
+    AudioTrackPtr track;    /**< Track being heard. */
+    AudioTrackPtr queued;   /**< Track to splice after #audio_status::track. */
+    uint64_t      advances; /**< Times output entered a spliced track. */
+    bool          paused;   /**< Is paused. */
+    double        position; /**< Position in #audio_status::track, in seconds. */
+} audio_status_t;
+
+/**
+ * @brief Device format.
+ */
+typedef struct audio_spec
+{
+    audio_spec();
+
+    int freq;     /**< Sample rate. */
+    int channels; /**< Channels. */
+    int bits;     /**< Bits per sample. */
+} audio_spec_t;
+
+/**
+ * @brief Output buffer statistics.
+ */
+typedef struct audio_stats
+{
+    double   buffered;  /**< Decoded audio waiting for output, in seconds. */
+    double   capacity;  /**< Size of buffer, in seconds. */
+    uint64_t underruns; /**< Times output ran out of decoded audio. */
+} audio_stats_t;
+
+/**
+ * @brief Take over music output of SDL_mixer and start decode thread.
+ * Must be called after Mix_OpenAudio().
+ * @param[in] fn            Notify callback.
+ * @param[in] read_ahead_ms Decoded audio to buffer ahead of output, in milliseconds.
+ */
+void audio_init(audio_notify_fn fn, int read_ahead_ms);
+
+/**
+ * @brief Stop decode thread and output, and release tracks.
+ */
+void audio_exit(void);
+
+/*
+ * Functions below must be called from one thread.
+ */
+
+/**
+ * @brief Reopen device at another sample rate and channels, in the same sample
+ * format. Output is stopped and all tracks are dropped.
+ *
+ * The device may pick a format close to it, see audio_spec(). If it fails to
+ * open at all, it is opened again in the format before.
+ *
+ * @param[in] freq          Sample rate.
+ * @param[in] channels      Channels.
+ * @param[in] buffer_frames Output buffer of device, in frames.
+ * @return true if opened as asked, false if opened in the format before.
+ */
+bool audio_reopen(int freq, int channels, int buffer_frames);
+
+/**
+ * @brief Get device format. Tracks must be loaded in it after the last
+ * audio_reopen(), and only 16-bit output plays them.
+ * @return Device format.
+ */
+audio_spec_t audio_spec(void);
+
+/**
+ * @brief Play \p track from beginning, and drop queued track.
+ * @param[in] track     Track, dropped if not decoded in device format.
+ * @param[in] crossfade Fade out the track being heard under \p track.
+ */
+void audio_play(AudioTrackPtr track, bool crossfade);
+
+/**
+ * @brief Splice \p track right after the end of current track.
+ *
+ * A track already decoded into buffer is played even if the queue changes,
+ * so the queue takes effect after it.
+ *
+ * @param[in] track     Track, or nullptr to stop at the end of current track.
+ *                      Dropped if not decoded in device format.
+ * @param[in] crossfade Crossfade into \p track instead of splicing it.
+ */
+void audio_queue(AudioTrackPtr track, bool crossfade);
+
+/**
+ * @brief Stop output and drop all tracks.
+ */
+void audio_stop(void);
+
+/**
+ * @brief Pause or resume output.
+ * @param[in] pause Pause.
+ */
+void audio_pause(bool pause);
+
+/**
+ * @brief Seek in the track being heard.
+ * @param[in] position  Position, in seconds.
+ */
+void audio_seek(double position);
+
+/**
+ * @brief Get output state.
+ * @note MT-Safe.
+ * @return Output state.
+ */
+audio_status_t audio_poll(void);
+
+/**
+ * @brief Set volume.
+ * @note MT-Safe.
+ * @param[in] volume    Volume, in range of [0, 100].
+ */
+void audio_set_volume(int volume);
+
+/**
+ * @brief Set crossfade duration. Crossfade is shortened for short tracks, and
+ * only available for 16-bit output.
+ * @note MT-Safe.
+ * @param[in] ms    Duration in milliseconds, 0 to disable.
+ */
+void audio_set_crossfade(int ms);
+
+/**
+ * @brief Set ReplayGain mode. Tracks are normalized to
+ * #AUDIO_LOUDNESS_REFERENCE if scanned, or played as is.
+ * @note MT-Safe.
+ * @param[in] mode      Mode.
+ * @param[in] preamp_db Extra gain in dB, still limited by true peak.
+ */
+void audio_set_replaygain(audio_replaygain_t mode, double preamp_db);
+
+/**
+ * @brief Set output equalizer. Changes are smoothed, and off fades to flat.
+ * Only 16-bit output is equalized.
+ * @note Only call it from one thread, the UI thread.
+ * @param[in] enabled   Whether equalizer is on.
+ * @param[in] params    Parameters.
+ */
+void audio_set_eq(bool enabled, const audio_eq_params_t &params);
+
+/**
+ * @brief Read the latest output sent to device, downmixed to mono.
+ * Only 16-bit output is tapped.
+ * @note MT-Safe.
+ * @param[out] dst  Samples in [-1, 1].
+ * @param[in] count Number of samples, up to a few hundred milliseconds.
+ * @return Sample rate, or 0 if not enough output yet, or being overwritten.
+ */
+int audio_tap_read(float *dst, size_t count);
+
+/**
+ * @brief Get output buffer statistics.
+ * @note MT-Safe.
+ * @return Statistics.
+ */
+audio_stats_t audio_stats(void);
+
+} // namespace soundsphere
+
+#endif
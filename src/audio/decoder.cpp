@@ -0,0 +1,858 @@
+#include <ev.h>
+#include <algorithm>
+#include <cstring>
+#include <vector>
+#include <SDL.h>
+#include <spdlog/spdlog.h>
+#include "utils/string.hpp"
+#include "decoder.hpp"
+#include "resample.hpp"
+
+/*
+ * SDL_mixer may be linked statically with its own copy of dr_libs, so the
+ * implementation is private to this file.
+ */
+#define DR_FLAC_IMPLEMENTATION
+#define DRFLAC_API static
+#define DR_MP3_IMPLEMENTATION
+#define DRMP3_API static
+#if defined(_MSC_VER)
+#pragma warning(push, 0)
+#endif
+#include <dr_flac.h>
+#include <dr_mp3.h>
+#if defined(_MSC_VER)
+#pragma warning(pop)
+#endif
+
+/**
+ * @brief Delay of MP3 decoder synthesis filterbank, in samples.
+ */
+#define AUDIO_MP3_DECODER_DELAY 529
+
+/**
+ * @brief Bytes to search for the first frame after ID3v2 tag.
+ */
+#define AUDIO_MP3_PROBE_SIZE 4096
+
+/**
+ * @brief Frames of file decoded at a time when output is converted.
+ */
+#define AUDIO_DECODER_BLOCK 4096
+
+/**
+ * @brief Seconds of file between two seek points.
+ */
+#define AUDIO_SEEK_INTERVAL 1
+
+/**
+ * @brief Most seek points of MP3, spread over longer files.
+ */
+#define AUDIO_SEEK_POINTS_MAX 8192
+
+/**
+ * @brief Bytes of FLAC file read at a time to find frame headers.
+ */
+#define AUDIO_SEEK_SCAN_BLOCK 65536
+
+/**
+ * @brief Longest FLAC frame header, with CRC.
+ */
+#define AUDIO_FLAC_HEADER_MAX 16
+
+struct soundsphere::audio_decoder
+{
+    audio_decoder();
+    ~audio_decoder();
+
+    drflac *flac; /**< FLAC file, or nullptr. */
+    drmp3  *mp3;  /**< MP3 file, or nullptr. */
+
+    int      src_freq;     /**< Sample rate of file. */
+    int      src_channels; /**< Channels of file. */
+    uint64_t src_skip;     /**< Frames of file before frame 0. */
+    uint64_t src_frames;   /**< Frames of file from frame 0, or #AUDIO_FRAMES_UNKNOWN. */
+    uint64_t src_pos;      /**< Frames of file decoded from frame 0. */
+
+    int      freq;     /**< Output sample rate. */
+    int      channels; /**< Output channels. */
+    uint64_t frames;   /**< Output frames, or #AUDIO_FRAMES_UNKNOWN. */
+
+    /*
+     * Conversion, only used if output differs from file.
+     */
+
+    SDL_AudioCVT       cvt;       /**< Converts channels, if #audio_decoder::remix. */
+    bool               remix;     /**< Whether channels are converted. */
+    audio_resampler_t *resampler; /**< Converts sample rate, or nullptr. */
+    bool               eof;       /**< File is read up and resampler is flushed. */
+
+    std::vector<int16_t> src;     /**< Block of file. */
+    std::vector<uint8_t> mixed;   /**< Block in output channels, with room for conversion. */
+    std::vector<int16_t> out;     /**< Converted output. */
+    size_t               out_pos; /**< Frames of #audio_decoder::out already read. */
+    size_t               out_len; /**< Frames in #audio_decoder::out. */
+
+    /*
+     * Seek index bound to the file, dr_libs keep pointers to them.
+     */
+
+    bool                          indexed;     /**< Whether a seek index is bound. */
+    std::vector<drmp3_seek_point> mp3_points;  /**< Seek table of #audio_decoder::mp3. */
+    std::vector<drflac_seekpoint> flac_points; /**< Seek table of #audio_decoder::flac. */
+};
+
+soundsphere::audio_mp3_info::audio_mp3_info()
+{
+    samplerate = 0;
+    frame_samples = 0;
+    samples = 0;
+    enc_delay = 0;
+    enc_padding = 0;
+}
+
+soundsphere::audio_seek_index::audio_seek_index()
+{
+    type = MUSIC_NONE;
+}
+
+soundsphere::audio_decoder::audio_decoder()
+{
+    flac = nullptr;
+    mp3 = nullptr;
+    src_freq = 0;
+    src_channels = 0;
+    src_skip = 0;
+    src_frames = AUDIO_FRAMES_UNKNOWN;
+    src_pos = 0;
+    freq = 0;
+    channels = 0;
+    frames = AUDIO_FRAMES_UNKNOWN;
+    memset(&cvt, 0, sizeof(cvt));
+    remix = false;
+    resampler = nullptr;
+    eof = false;
+    out_pos = 0;
+    out_len = 0;
+    indexed = false;
+}
+
+soundsphere::audio_decoder::~audio_decoder()
+{
+    if (flac != nullptr)
+    {
+        drflac_close(flac);
+    }
+    if (mp3 != nullptr)
+    {
+        drmp3_uninit(mp3);
+        delete mp3;
+    }
+    delete resampler;
+}
+
+static uint32_t _audio_read_be32(const uint8_t *p)
+{
+    return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) | ((uint32_t)p[2] << 8) | (uint32_t)p[3];
+}
+
+/**
+ * @brief Size of ID3v2 tag at the beginning of file.
+ */
+static int64_t _audio_mp3_id3v2_size(ev_file_t *file)
+{
+    uint8_t hdr[10];
+    if (ev_file_pread(file, nullptr, hdr, sizeof(hdr), 0, nullptr) != (ssize_t)sizeof(hdr))
+    {
+        return 0;
+    }
+    if (memcmp(hdr, "ID3", 3) != 0)
+    {
+        return 0;
+    }
+
+    /* Syncsafe integer, plus header and optional footer. */
+    int64_t size = ((int64_t)(hdr[6] & 0x7f) << 21) | ((int64_t)(hdr[7] & 0x7f) << 14) |
+                   ((int64_t)(hdr[8] & 0x7f) << 7) | (int64_t)(hdr[9] & 0x7f);
+    return size + 10 + ((hdr[5] & 0x10) ? 10 : 0);
+}
+
+/**
+ * @brief Parse the first frame, which is the LAME/Xing header if the file has one.
+ */
+static bool _audio_mp3_parse_info(const uint8_t *buf, size_t size, soundsphere::audio_mp3_info_t &info)
+{
+    static const int samplerates[4][3] = {
+        { 11025, 12000, 8000  }, /* MPEG 2.5 */
+        { 0,     0,     0     }, /* Reserved */
+        { 22050, 24000, 16000 }, /* MPEG 2 */
+        { 44100, 48000, 32000 }, /* MPEG 1 */
+    };
+
+    size_t pos = 0;
+    for (; pos + 4 <= size; pos++)
+    {
+        const uint8_t *h = buf + pos;
+        /* Frame sync, not reserved version, layer III, valid bitrate and sample rate. */
+        if (h[0] == 0xff && (h[1] & 0xe0) == 0xe0 && ((h[1] >> 3) & 0x03) != 1 && ((h[1] >> 1) & 0x03) == 1 &&
+            (h[2] >> 4) != 0x0f && ((h[2] >> 2) & 0x03) != 3)
+        {
+            break;
+        }
+    }
+    if (pos + 4 > size)
+    {
+        return false;
+    }
+
+    const uint8_t *h = buf + pos;
+    int            version = (h[1] >> 3) & 0x03;
+    bool           mpeg1 = version == 3;
+    bool           mono = ((h[3] >> 6) & 0x03) == 3;
+    size_t         side_info = mpeg1 ? (mono ? 17 : 32) : (mono ? 9 : 17);
+
+    size_t off = pos + 4 + side_info;
+    if (off + 8 > size || (memcmp(buf + off, "Xing", 4) != 0 && memcmp(buf + off, "Info", 4) != 0))
+    {
+        return false;
+    }
+
+    uint32_t flags = _audio_read_be32(buf + off + 4);
+    if ((flags & 0x01) == 0)
+    {
+        /* No frame count. */
+        return false;
+    }
+
+    off += 8;
+    uint32_t frames = _audio_read_be32(buf + off);
+    off += 4;
+    off += (flags & 0x02) ? 4 : 0;   /* Bytes. */
+    off += (flags & 0x04) ? 100 : 0; /* TOC. */
+    off += (flags & 0x08) ? 4 : 0;   /* Quality. */
+
+    info.samplerate = samplerates[version][(h[2] >> 2) & 0x03];
+    info.frame_samples = mpeg1 ? 1152 : 576;
+    info.samples = (uint64_t)frames * info.frame_samples;
+    info.enc_delay = 0;
+    info.enc_padding = 0;
+
+    /* Encoder delay and padding are 12 bits each at offset 21 of LAME tag, also written by FFmpeg. */
+    if (off + 24 <= size && (memcmp(buf + off, "LAME", 4) == 0 || memcmp(buf + off, "Lavc", 4) == 0 ||
+                             memcmp(buf + off, "Lavf", 4) == 0))
+    {
+        const uint8_t *p = buf + off + 21;
+        info.enc_delay = ((uint64_t)p[0] << 4) | (p[1] >> 4);
+        info.enc_padding = ((uint64_t)(p[1] & 0x0f) << 8) | p[2];
+    }
+
+    return true;
+}
+
+bool soundsphere::audio_mp3_read_info(const std::string &path, audio_mp3_info_t &info)
+{
+    ev_file_t file;
+    if (ev_file_open(nullptr, &file, nullptr, path.c_str(), EV_FS_O_RDONLY, 0, nullptr) != 0)
+    {
+        return false;
+    }
+
+    uint8_t buf[AUDIO_MP3_PROBE_SIZE];
+    int64_t offset = _audio_mp3_id3v2_size(&file);
+    ssize_t read_sz = ev_file_pread(&file, nullptr, buf, sizeof(buf), offset, nullptr);
+    ev_file_close(&file, nullptr);
+
+    if (read_sz <= 0)
+    {
+        return false;
+    }
+    return _audio_mp3_parse_info(buf, (size_t)read_sz, info);
+}
+
+static bool _audio_decoder_open_flac(soundsphere::audio_decoder_t *dec, const std::string &path)
+{
+#if defined(_WIN32)
+    soundsphere::wstring path_w = soundsphere::utf8_to_wide(path.c_str());
+    dec->flac = drflac_open_file_w(path_w.get(), nullptr);
+#else
+    dec->flac = drflac_open_file(path.c_str(), nullptr);
+#endif
+    if (dec->flac == nullptr)
+    {
+        return false;
+    }
+
+    dec->src_freq = (int)dec->flac->sampleRate;
+    dec->src_channels = (int)dec->flac->channels;
+    dec->src_frames = dec->flac->totalPCMFrameCount != 0 ? dec->flac->totalPCMFrameCount : AUDIO_FRAMES_UNKNOWN;
+    return true;
+}
+
+/**
+ * @brief Trim encoder delay and padding by LAME/Xing header.
+ *
+ * dr_mp3 before 0.7 decodes the header frame as silence and keeps delay and
+ * padding, later versions skip and trim them itself.
+ */
+static void _audio_decoder_trim_mp3(soundsphere::audio_decoder_t *dec, const std::string &path)
+{
+    soundsphere::audio_mp3_info_t info;
+    if (!soundsphere::audio_mp3_read_info(path, info) || info.samplerate != dec->src_freq ||
+        info.samples <= info.enc_delay + info.enc_padding)
+    {
+        return;
+    }
+
+#if DRMP3_VERSION_MAJOR == 0 && DRMP3_VERSION_MINOR < 7
+    uint64_t skip = info.frame_samples + info.enc_delay + AUDIO_MP3_DECODER_DELAY;
+    if (!drmp3_seek_to_pcm_frame(dec->mp3, skip))
+    {
+        drmp3_seek_to_pcm_frame(dec->mp3, 0);
+        return;
+    }
+    dec->src_skip = skip;
+#endif
+    dec->src_frames = info.samples - info.enc_delay - info.enc_padding;
+}
+
+static bool _audio_decoder_open_mp3(soundsphere::audio_decoder_t *dec, const std::string &path)
+{
+    drmp3 *mp3 = new drmp3;
+#if defined(_WIN32)
+    soundsphere::wstring path_w = soundsphere::utf8_to_wide(path.c_str());
+    drmp3_bool32         ret = drmp3_init_file_w(mp3, path_w.get(), nullptr);
+#else
+    drmp3_bool32 ret = drmp3_init_file(mp3, path.c_str(), nullptr);
+#endif
+    if (!ret)
+    {
+        delete mp3;
+        return false;
+    }
+
+    dec->mp3 = mp3;
+    dec->src_freq = (int)mp3->sampleRate;
+    dec->src_channels = (int)mp3->channels;
+    _audio_decoder_trim_mp3(dec, path);
+    return true;
+}
+
+/**
+ * @brief Set up conversion into output format.
+ */
+static bool _audio_decoder_setup(soundsphere::audio_decoder_t *dec)
+{
+    if (dec->src_freq <= 0 || dec->src_channels <= 0)
+    {
+        return false;
+    }
+
+    if (dec->channels != dec->src_channels)
+    {
+        if (SDL_BuildAudioCVT(&dec->cvt, AUDIO_S16SYS, (Uint8)dec->src_channels, dec->src_freq, AUDIO_S16SYS,
+                              (Uint8)dec->channels, dec->src_freq) < 0)
+        {
+            return false;
+        }
+        dec->remix = dec->cvt.needed != 0;
+        dec->mixed.resize((size_t)AUDIO_DECODER_BLOCK * dec->src_channels * sizeof(int16_t) * dec->cvt.len_mult);
+    }
+
+    size_t out_frames = AUDIO_DECODER_BLOCK;
+    if (dec->freq != dec->src_freq)
+    {
+        dec->resampler = new soundsphere::audio_resampler_t(dec->src_freq, dec->freq, dec->channels,
+                                                            soundsphere::AUDIO_RESAMPLE_HIGH);
+        out_frames = std::max(soundsphere::audio_resample_frames(*dec->resampler, AUDIO_DECODER_BLOCK),
+                              soundsphere::audio_resample_frames(*dec->resampler, dec->resampler->taps));
+    }
+    if (dec->remix || dec->resampler != nullptr)
+    {
+        dec->src.resize((size_t)AUDIO_DECODER_BLOCK * dec->src_channels);
+        dec->out.resize(out_frames * dec->channels);
+    }
+
+    dec->frames = dec->src_frames;
+    if (dec->src_frames != AUDIO_FRAMES_UNKNOWN && dec->freq != dec->src_freq)
+    {
+        dec->frames = dec->src_frames * (uint64_t)dec->freq / (uint64_t)dec->src_freq;
+    }
+    return true;
+}
+
+soundsphere::audio_decoder_t *soundsphere::audio_decoder_open(const std::string &path, music_type_t type, int freq,
+                                                              int channels)
+{
+    audio_decoder_t *dec = new audio_decoder_t;
+    bool             ret = false;
+    switch (type)
+    {
+    case MUSIC_FLAC:
+        ret = _audio_decoder_open_flac(dec, path);
+        break;
+    case MUSIC_MP3:
+        ret = _audio_decoder_open_mp3(dec, path);
+        break;
+    default:
+        break;
+    }
+
+    dec->freq = freq > 0 ? freq : dec->src_freq;
+    dec->channels = channels > 0 ? channels : dec->src_channels;
+    if (!ret || !_audio_decoder_setup(dec))
+    {
+        spdlog::error("open decoder for {} failed", path);
+        delete dec;
+        return nullptr;
+    }
+
+    return dec;
+}
+
+void soundsphere::audio_decoder_close(audio_decoder_t *dec)
+{
+    delete dec;
+}
+
+int soundsphere::audio_decoder_freq(const audio_decoder_t *dec)
+{
+    return dec->freq;
+}
+
+int soundsphere::audio_decoder_channels(const audio_decoder_t *dec)
+{
+    return dec->channels;
+}
+
+uint64_t soundsphere::audio_decoder_frames(const audio_decoder_t *dec)
+{
+    return dec->frames;
+}
+
+/**
+ * @brief Decode frames of file, stopping at the trimmed end.
+ */
+static size_t _audio_decoder_read_src(soundsphere::audio_decoder_t *dec, int16_t *pcm, size_t frames)
+{
+    if (dec->src_frames != AUDIO_FRAMES_UNKNOWN)
+    {
+        uint64_t left = dec->src_frames - dec->src_pos;
+        frames = left < frames ? (size_t)left : frames;
+    }
+
+    uint64_t ret = 0;
+    if (frames == 0)
+    {
+        return 0;
+    }
+    else if (dec->flac != nullptr)
+    {
+        ret = drflac_read_pcm_frames_s16(dec->flac, frames, pcm);
+    }
+    else
+    {
+        ret = drmp3_read_pcm_frames_s16(dec->mp3, frames, pcm);
+    }
+
+    dec->src_pos += ret;
+    return (size_t)ret;
+}
+
+/**
+ * @brief Convert the next block of file into #audio_decoder::out.
+ * @return false at the end.
+ */
+static bool _audio_decoder_fill(soundsphere::audio_decoder_t *dec)
+{
+    dec->out_pos = 0;
+    dec->out_len = 0;
+    if (dec->eof)
+    {
+        return false;
+    }
+
+    size_t         n = _audio_decoder_read_src(dec, dec->src.data(), AUDIO_DECODER_BLOCK);
+    const int16_t *pcm = dec->src.data();
+    if (n != 0 && dec->remix)
+    {
+        dec->cvt.buf = dec->mixed.data();
+        dec->cvt.len = (int)(n * dec->src_channels * sizeof(int16_t));
+        memcpy(dec->cvt.buf, pcm, dec->cvt.len);
+        if (SDL_ConvertAudio(&dec->cvt) != 0)
+        {
+            dec->eof = true;
+            return false;
+        }
+        pcm = (const int16_t *)dec->mixed.data();
+    }
+
+    if (dec->resampler == nullptr)
+    {
+        memcpy(dec->out.data(), pcm, n * dec->channels * sizeof(int16_t));
+        dec->out_len = n;
+        dec->eof = n == 0;
+        return n != 0;
+    }
+
+    /* The filter reaches past the last frame, it is flushed at the end. */
+    if (n == 0)
+    {
+        dec->out_len = soundsphere::audio_resample_flush(*dec->resampler, dec->out.data());
+        dec->eof = true;
+        return dec->out_len != 0;
+    }
+    dec->out_len = soundsphere::audio_resample_process(*dec->resampler, pcm, n, dec->out.data());
+    return true;
+}
+
+size_t soundsphere::audio_decoder_read(audio_decoder_t *dec, int16_t *pcm, size_t frames)
+{
+    /* Same format as file, decoded in place. */
+    if (!dec->remix && dec->resampler == nullptr)
+    {
+        return _audio_decoder_read_src(dec, pcm, frames);
+    }
+
+    size_t done = 0;
+    while (done < frames)
+    {
+        if (dec->out_pos == dec->out_len && !_audio_decoder_fill(dec))
+        {
+            break;
+        }
+
+        size_t n = std::min(frames - done, dec->out_len - dec->out_pos);
+        memcpy(pcm + done * dec->channels, dec->out.data() + dec->out_pos * dec->channels,
+               n * dec->channels * sizeof(int16_t));
+        dec->out_pos += n;
+        done += n;
+    }
+    return done;
+}
+
+bool soundsphere::audio_decoder_seek(audio_decoder_t *dec, uint64_t frame)
+{
+    if (dec->frames != AUDIO_FRAMES_UNKNOWN && frame > dec->frames)
+    {
+        frame = dec->frames;
+    }
+
+    /* Resampler starts over at the frame of file output is timed at. */
+    uint64_t src_frame = frame;
+    if (dec->resampler != nullptr)
+    {
+        src_frame = frame * (uint64_t)dec->src_freq / (uint64_t)dec->freq;
+        soundsphere::audio_resample_reset(*dec->resampler);
+    }
+    if (dec->src_frames != AUDIO_FRAMES_UNKNOWN && src_frame > dec->src_frames)
+    {
+        src_frame = dec->src_frames;
+    }
+    dec->out_pos = 0;
+    dec->out_len = 0;
+    dec->eof = false;
+    dec->src_pos = src_frame;
+
+    /* Reads stop at the trimmed end, the file does not have to be there. */
+    if (dec->src_frames != AUDIO_FRAMES_UNKNOWN && src_frame == dec->src_frames)
+    {
+        return true;
+    }
+
+    drmp3_bool32 ret = dec->flac != nullptr ? drflac_seek_to_pcm_frame(dec->flac, dec->src_skip + src_frame)
+                                            : drmp3_seek_to_pcm_frame(dec->mp3, dec->src_skip + src_frame);
+    return ret != 0;
+}
+
+/**
+ * @brief Build seek index of MP3 by frame headers, one point about every
+ * #AUDIO_SEEK_INTERVAL seconds.
+ */
+static soundsphere::AudioSeekIndexPtr _audio_seek_index_build_mp3(const std::string &path)
+{
+    soundsphere::audio_decoder_t *dec = soundsphere::audio_decoder_open(path, soundsphere::MUSIC_MP3, 0, 0);
+    if (dec == nullptr)
+    {
+        return nullptr;
+    }
+
+    uint64_t count = AUDIO_SEEK_POINTS_MAX;
+    if (dec->src_frames != AUDIO_FRAMES_UNKNOWN)
+    {
+        count = std::min(count, dec->src_frames / ((uint64_t)dec->src_freq * AUDIO_SEEK_INTERVAL) + 1);
+    }
+
+    std::vector<drmp3_seek_point> points((size_t)count);
+    drmp3_uint32                  num = (drmp3_uint32)count;
+    drmp3_bool32                  ret = drmp3_calculate_seek_points(dec->mp3, &num, points.data());
+    soundsphere::audio_decoder_close(dec);
+    if (!ret)
+    {
+        return nullptr;
+    }
+
+    std::shared_ptr<soundsphere::audio_seek_index_t> index = std::make_shared<soundsphere::audio_seek_index_t>();
+    index->type = soundsphere::MUSIC_MP3;
+    for (drmp3_uint32 i = 0; i < num; i++)
+    {
+        soundsphere::audio_seek_point_t point;
+        point.frame = points[i].pcmFrameIndex;
+        point.offset = points[i].seekPosInBytes;
+        point.skip = points[i].mp3FramesToDiscard;
+        point.length = points[i].pcmFramesToDiscard;
+        index->points.push_back(point);
+    }
+    return index;
+}
+
+static uint8_t _audio_flac_crc8(const uint8_t *data, size_t size)
+{
+    uint8_t crc = 0;
+    for (size_t i = 0; i < size; i++)
+    {
+        crc ^= data[i];
+        for (int bit = 0; bit < 8; bit++)
+        {
+            crc = (crc & 0x80) ? (uint8_t)((crc << 1) ^ 0x07) : (uint8_t)(crc << 1);
+        }
+    }
+    return crc;
+}
+
+/**
+ * @brief Table of CRC-16 of FLAC frames, polynomial 0x8005.
+ */
+static void _audio_flac_crc16_table(uint16_t table[256])
+{
+    for (int i = 0; i < 256; i++)
+    {
+        uint16_t crc = (uint16_t)(i << 8);
+        for (int bit = 0; bit < 8; bit++)
+        {
+            crc = (crc & 0x8000) ? (uint16_t)((crc << 1) ^ 0x8005) : (uint16_t)(crc << 1);
+        }
+        table[i] = crc;
+    }
+}
+
+/**
+ * @brief Parse FLAC frame header at \p p, with #AUDIO_FLAC_HEADER_MAX bytes readable.
+ * @param[out] number   Frame number if \p variable is false, otherwise sample number.
+ * @param[out] variable Whether block size of stream is variable.
+ * @param[out] block    Frames in the block.
+ * @return Header size, or 0 if it is not a header.
+ */
+static size_t _audio_flac_parse_header(const uint8_t *p, uint64_t &number, bool &variable, uint32_t &block)
+{
+    if (p[0] != 0xff || (p[1] & 0xfe) != 0xf8)
+    {
+        return 0;
+    }
+
+    /* Block size and sample rate are not reserved, channels and sample size are valid. */
+    unsigned bs_code = p[2] >> 4;
+    unsigned sr_code = p[2] & 0x0f;
+    if (bs_code == 0 || sr_code == 0x0f || (p[3] >> 4) > 10 || ((p[3] >> 1) & 0x07) == 3 || (p[3] & 0x01) != 0)
+    {
+        return 0;
+    }
+
+    /* Frame or sample number, coded like UTF-8 in up to 7 bytes. */
+    size_t  pos = 4;
+    uint8_t lead = p[pos++];
+    int     ones = 0;
+    while (ones < 8 && (lead & (0x80 >> ones)) != 0)
+    {
+        ones++;
+    }
+    if (ones == 1 || ones == 8)
+    {
+        return 0;
+    }
+    number = ones == 0 ? lead : (uint64_t)(lead & (0x7f >> ones));
+    for (int i = 1; i < ones; i++)
+    {
+        uint8_t b = p[pos++];
+        if ((b & 0xc0) != 0x80)
+        {
+            return 0;
+        }
+        number = (number << 6) | (b & 0x3f);
+    }
+
+    if (bs_code == 1)
+    {
+        block = 192;
+    }
+    else if (bs_code <= 5)
+    {
+        block = 576u << (bs_code - 2);
+    }
+    else if (bs_code == 6)
+    {
+        block = (uint32_t)p[pos] + 1;
+        pos += 1;
+    }
+    else if (bs_code == 7)
+    {
+        block = (((uint32_t)p[pos] << 8) | p[pos + 1]) + 1;
+        pos += 2;
+    }
+    else
+    {
+        block = 256u << (bs_code - 8);
+    }
+    pos += sr_code == 12 ? 1 : (sr_code == 13 || sr_code == 14) ? 2 : 0;
+
+    if (_audio_flac_crc8(p, pos) != p[pos])
+    {
+        return 0;
+    }
+    variable = (p[1] & 0x01) != 0;
+    return pos + 1;
+}
+
+/**
+ * @brief Build seek index of FLAC without seek table by frame headers, one
+ * point about every #AUDIO_SEEK_INTERVAL seconds.
+ *
+ * A header is only taken where the previous frame ends in time and its CRC-16
+ * checks, so sync codes inside audio data are skipped.
+ */
+static soundsphere::AudioSeekIndexPtr _audio_seek_index_build_flac(const std::string             &path,
+                                                                   const std::function<bool(void)> &cancelled)
+{
+    soundsphere::audio_decoder_t *dec = soundsphere::audio_decoder_open(path, soundsphere::MUSIC_FLAC, 0, 0);
+    if (dec == nullptr)
+    {
+        return nullptr;
+    }
+
+    uint64_t first = dec->flac->firstFLACFramePosInBytes;
+    uint64_t fixed = dec->flac->maxBlockSizeInPCMFrames;
+    uint64_t step = std::max<uint64_t>((uint64_t)dec->src_freq * AUDIO_SEEK_INTERVAL, 1);
+    bool     has_table = dec->flac->seekpointCount != 0;
+    soundsphere::audio_decoder_close(dec);
+
+    std::shared_ptr<soundsphere::audio_seek_index_t> index = std::make_shared<soundsphere::audio_seek_index_t>();
+    index->type = soundsphere::MUSIC_FLAC;
+    if (has_table)
+    {
+        return index;
+    }
+
+    ev_file_t file;
+    if (ev_file_open(nullptr, &file, nullptr, path.c_str(), EV_FS_O_RDONLY, 0, nullptr) != 0)
+    {
+        return nullptr;
+    }
+
+    uint16_t table[256];
+    _audio_flac_crc16_table(table);
+
+    std::vector<uint8_t> buf(AUDIO_SEEK_SCAN_BLOCK + AUDIO_FLAC_HEADER_MAX);
+    uint64_t             offset = first;
+    uint64_t             next = 0; /* First frame of the header expected next. */
+    uint16_t             crc = 0;  /* CRC-16 since the last header, 0 right after a whole frame. */
+    bool                 ok = true;
+    while (ok)
+    {
+        ssize_t read_sz = ev_file_pread(&file, nullptr, buf.data(), buf.size(), (int64_t)offset, nullptr);
+        if (read_sz < 0 || cancelled())
+        {
+            ok = false;
+            break;
+        }
+
+        /* Bytes in the tail are scanned with the next read, when a header there is whole. */
+        size_t end = (size_t)read_sz < buf.size() ? (size_t)read_sz : AUDIO_SEEK_SCAN_BLOCK;
+        for (size_t pos = 0; pos < end; pos++)
+        {
+            const uint8_t *p = buf.data() + pos;
+            uint64_t       number = 0;
+            bool           variable = false;
+            uint32_t       block = 0;
+            if (p[0] == 0xff && (size_t)read_sz - pos >= AUDIO_FLAC_HEADER_MAX &&
+                _audio_flac_parse_header(p, number, variable, block) != 0 &&
+                (variable ? number : number * fixed) == next && (next == 0 || crc == 0))
+            {
+                if (index->points.empty() || next >= index->points.back().frame + step)
+                {
+                    soundsphere::audio_seek_point_t point;
+                    point.frame = next;
+                    point.offset = offset + pos - first;
+                    point.skip = 0;
+                    point.length = (uint16_t)block;
+                    index->points.push_back(point);
+                }
+                next += block;
+                crc = 0;
+            }
+            crc = (uint16_t)((crc << 8) ^ table[(crc >> 8) ^ p[0]]);
+        }
+
+        if ((size_t)read_sz < buf.size())
+        {
+            break;
+        }
+        offset += end;
+    }
+    ev_file_close(&file, nullptr);
+
+    return ok ? index : nullptr;
+}
+
+soundsphere::AudioSeekIndexPtr soundsphere::audio_seek_index_build(const std::string &path, music_type_t type,
+                                                                   const std::function<bool(void)> &cancelled)
+{
+    AudioSeekIndexPtr index;
+    switch (type)
+    {
+    case MUSIC_FLAC:
+        index = _audio_seek_index_build_flac(path, cancelled);
+        break;
+    case MUSIC_MP3:
+        index = _audio_seek_index_build_mp3(path);
+        break;
+    default:
+        break;
+    }
+
+    return cancelled() ? nullptr : index;
+}
+
+void soundsphere::audio_decoder_bind_index(audio_decoder_t *dec, AudioSeekIndexPtr index)
+{
+    if (index.get() == nullptr || index->points.empty() || dec->indexed)
+    {
+        return;
+    }
+
+    const std::vector<audio_seek_point_t> &points = index->points;
+    if (index->type == MUSIC_MP3 && dec->mp3 != nullptr)
+    {
+        dec->mp3_points.resize(points.size());
+        for (size_t i = 0; i < points.size(); i++)
+        {
+            dec->mp3_points[i].seekPosInBytes = points[i].offset;
+            dec->mp3_points[i].pcmFrameIndex = points[i].frame;
+            dec->mp3_points[i].mp3FramesToDiscard = points[i].skip;
+            dec->mp3_points[i].pcmFramesToDiscard = points[i].length;
+        }
+        dec->indexed = drmp3_bind_seek_table(dec->mp3, (drmp3_uint32)points.size(), dec->mp3_points.data()) != 0;
+    }
+    /* Seek table of the file is used as is. */
+    else if (index->type == MUSIC_FLAC && dec->flac != nullptr && dec->flac->seekpointCount == 0)
+    {
+        dec->flac_points.resize(points.size());
+        for (size_t i = 0; i < points.size(); i++)
+        {
+            dec->flac_points[i].firstPCMFrame = points[i].frame;
+            dec->flac_points[i].flacFrameOffset = points[i].offset;
+            dec->flac_points[i].pcmFrameCount = points[i].length;
+        }
+        dec->flac->pSeekpoints = dec->flac_points.data();
+        dec->flac->seekpointCount = (drflac_uint32)points.size();
+        dec->indexed = true;
+    }
+}
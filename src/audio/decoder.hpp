@@ -0,0 +1,155 @@
+#ifndef SOUND_SPHERE_AUDIO_DECODER_HPP
+#define SOUND_SPHERE_AUDIO_DECODER_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+#include "utils/music_tag.hpp"
+
+/**
+ * @brief Length that is not known before the end is reached.
+ */
+#define AUDIO_FRAMES_UNKNOWN UINT64_MAX
+
+namespace soundsphere
+{
+
+/**
+ * @brief Gapless info from LAME/Xing header of MP3.
+ */
+typedef struct audio_mp3_info
+{
+    audio_mp3_info();
+
+    int      samplerate;    /**< Sample rate of file. */
+    uint64_t frame_samples; /**< Samples per frame. */
+    uint64_t samples;       /**< Samples of all frames, including delay and padding. */
+    uint64_t enc_delay;     /**< Samples added by encoder at the beginning. */
+    uint64_t enc_padding;   /**< Samples added by encoder at the end. */
+} audio_mp3_info_t;
+
+/**
+ * @brief Place in a file to start decoding from when seeking.
+ */
+typedef struct audio_seek_point
+{
+    uint64_t frame;  /**< First frame of file decoded from it. */
+    uint64_t offset; /**< Bytes into file for MP3, after the first frame for FLAC. */
+    uint16_t skip;   /**< MP3 frames decoded and dropped to refill bit reservoir, 0 for FLAC. */
+    uint16_t length; /**< PCM frames dropped after them for MP3, frames in the block for FLAC. */
+} audio_seek_point_t;
+
+/**
+ * @brief Seek index of a file, so a seek does not scan it.
+ *
+ * It is empty if the file does not need one, like FLAC with a seek table.
+ */
+typedef struct audio_seek_index
+{
+    audio_seek_index();
+
+    music_type_t                    type;   /**< File format. */
+    std::vector<audio_seek_point_t> points; /**< Points in order of frame. */
+} audio_seek_index_t;
+
+typedef std::shared_ptr<const audio_seek_index_t> AudioSeekIndexPtr;
+
+/**
+ * @brief Decoder of a music file into interleaved S16 PCM.
+ *
+ * Only a block of the file is decoded at a time, so memory does not grow
+ * with its length. MP3 encoder delay and padding are trimmed, frame 0 is the
+ * first frame of audio.
+ */
+typedef struct audio_decoder audio_decoder_t;
+
+/**
+ * @brief Read gapless info of MP3 file.
+ * @param[in] path  File path.
+ * @param[out] info Gapless info.
+ * @return true if file has a LAME/Xing header with frame count.
+ */
+bool audio_mp3_read_info(const std::string &path, audio_mp3_info_t &info);
+
+/**
+ * @brief Build seek index of \p path. Frame headers of the whole file are
+ * read, but no audio is decoded.
+ * @param[in] path      File path.
+ * @param[in] type      File format.
+ * @param[in] cancelled Polled to stop early.
+ * @return Index, or nullptr if failed or cancelled.
+ */
+AudioSeekIndexPtr audio_seek_index_build(const std::string &path, music_type_t type,
+                                         const std::function<bool(void)> &cancelled);
+
+/**
+ * @brief Open \p path for decoding.
+ *
+ * Output is converted to \p freq and \p channels if the file differs. Only
+ * headers are read here.
+ *
+ * @param[in] path      File path.
+ * @param[in] type      File format.
+ * @param[in] freq      Output sample rate, or 0 for that of the file.
+ * @param[in] channels  Output channels, or 0 for those of the file.
+ * @return Decoder, or nullptr if failed.
+ */
+audio_decoder_t *audio_decoder_open(const std::string &path, music_type_t type, int freq, int channels);
+
+/**
+ * @brief Close decoder.
+ * @param[in] dec   Decoder, may be nullptr.
+ */
+void audio_decoder_close(audio_decoder_t *dec);
+
+/**
+ * @brief Output sample rate.
+ * @param[in] dec   Decoder.
+ * @return Sample rate.
+ */
+int audio_decoder_freq(const audio_decoder_t *dec);
+
+/**
+ * @brief Output channels.
+ * @param[in] dec   Decoder.
+ * @return Channels.
+ */
+int audio_decoder_channels(const audio_decoder_t *dec);
+
+/**
+ * @brief Output length.
+ * @param[in] dec   Decoder.
+ * @return Frames, or #AUDIO_FRAMES_UNKNOWN.
+ */
+uint64_t audio_decoder_frames(const audio_decoder_t *dec);
+
+/**
+ * @brief Decode next frames.
+ * @param[in] dec       Decoder.
+ * @param[out] pcm      Output, room for \p frames frames.
+ * @param[in] frames    Frames wanted.
+ * @return Frames decoded, less than \p frames only at the end or on error.
+ */
+size_t audio_decoder_read(audio_decoder_t *dec, int16_t *pcm, size_t frames);
+
+/**
+ * @brief Seek by \p index from now on. Only the first index is taken.
+ * @param[in] dec   Decoder.
+ * @param[in] index Index of the same file, may be nullptr.
+ */
+void audio_decoder_bind_index(audio_decoder_t *dec, AudioSeekIndexPtr index);
+
+/**
+ * @brief Move to \p frame, clamped to the end if length is known.
+ * @param[in] dec       Decoder.
+ * @param[in] frame     Output frame.
+ * @return false if failed, the decoder must not be read then.
+ */
+bool audio_decoder_seek(audio_decoder_t *dec, uint64_t frame);
+
+} // namespace soundsphere
+
+#endif
@@ -0,0 +1,341 @@
+#include <cmath>
+#include <cstring>
+#include "eq.hpp"
+
+#if defined(AUDIO_EQ_SSE2)
+#include <emmintrin.h>
+#endif
+
+/**
+ * @brief Time constant of parameter smoothing, in seconds.
+ */
+#define AUDIO_EQ_SMOOTH_TIME 0.02
+
+/**
+ * @brief Parameters closer than this to target are snapped to it.
+ */
+#define AUDIO_EQ_SNAP 1e-3f
+
+static const double s_audio_eq_pi = 3.14159265358979323846;
+
+/**
+ * @brief Octave centers from 31 Hz to 16 kHz.
+ */
+static const float s_audio_eq_freq[AUDIO_EQ_BANDS] = {
+    31.25f, 62.5f, 125.0f, 250.0f, 500.0f, 1000.0f, 2000.0f, 4000.0f, 8000.0f, 16000.0f,
+};
+
+soundsphere::audio_eq_params::audio_eq_params()
+{
+    preamp_db = 0.0f;
+    for (size_t i = 0; i < AUDIO_EQ_BANDS; i++)
+    {
+        bands[i].freq = s_audio_eq_freq[i];
+        bands[i].gain_db = 0.0f;
+        bands[i].q = 1.41f; /* One octave. */
+    }
+}
+
+void soundsphere::audio_eq_cascade_scalar(float (*buf)[AUDIO_EQ_LANES], size_t frames, int lanes,
+                                          const audio_eq_coef_t *coef, audio_eq_state_t *state, size_t bands)
+{
+    for (size_t b = 0; b < bands; b++)
+    {
+        const audio_eq_coef_t c = coef[b];
+        for (int l = 0; l < lanes; l++)
+        {
+            float z1 = state[b].z1[l], z2 = state[b].z2[l];
+            for (size_t i = 0; i < frames; i++)
+            {
+                float x = buf[i][l];
+                float y = c.b0 * x + z1;
+                z1 = c.b1 * x - c.a1 * y + z2;
+                z2 = c.b2 * x - c.a2 * y;
+                buf[i][l] = y;
+            }
+            state[b].z1[l] = z1;
+            state[b].z2[l] = z2;
+        }
+    }
+}
+
+#if defined(AUDIO_EQ_SSE2)
+
+void soundsphere::audio_eq_cascade_sse2(float (*buf)[AUDIO_EQ_LANES], size_t frames, int lanes,
+                                        const audio_eq_coef_t *coef, audio_eq_state_t *state, size_t bands)
+{
+    (void)lanes;
+    for (size_t b = 0; b < bands; b++)
+    {
+        const __m128 b0 = _mm_set1_ps(coef[b].b0);
+        const __m128 b1 = _mm_set1_ps(coef[b].b1);
+        const __m128 b2 = _mm_set1_ps(coef[b].b2);
+        const __m128 a1 = _mm_set1_ps(coef[b].a1);
+        const __m128 a2 = _mm_set1_ps(coef[b].a2);
+        __m128       z1 = _mm_loadu_ps(state[b].z1);
+        __m128       z2 = _mm_loadu_ps(state[b].z2);
+        for (size_t i = 0; i < frames; i++)
+        {
+            __m128 x = _mm_loadu_ps(buf[i]);
+            __m128 y = _mm_add_ps(_mm_mul_ps(b0, x), z1);
+            z1 = _mm_add_ps(_mm_sub_ps(_mm_mul_ps(b1, x), _mm_mul_ps(a1, y)), z2);
+            z2 = _mm_sub_ps(_mm_mul_ps(b2, x), _mm_mul_ps(a2, y));
+            _mm_storeu_ps(buf[i], y);
+        }
+        _mm_storeu_ps(state[b].z1, z1);
+        _mm_storeu_ps(state[b].z2, z2);
+    }
+}
+
+#endif
+
+soundsphere::audio_eq_cascade_fn soundsphere::audio_eq_cascade(void)
+{
+#if defined(AUDIO_EQ_SSE2)
+    return audio_eq_cascade_sse2;
+#else
+    return audio_eq_cascade_scalar;
+#endif
+}
+
+soundsphere::audio_eq_coef_t soundsphere::audio_eq_peaking(double freq, double gain_db, double q, int rate)
+{
+    double a = std::pow(10.0, gain_db / 40.0);
+    double w0 = 2.0 * s_audio_eq_pi * freq / (double)rate;
+    double alpha = std::sin(w0) / (2.0 * q);
+    double cos_w0 = std::cos(w0);
+    double a0 = 1.0 + alpha / a;
+
+    audio_eq_coef_t coef;
+    coef.b0 = (float)((1.0 + alpha * a) / a0);
+    coef.b1 = (float)((-2.0 * cos_w0) / a0);
+    coef.b2 = (float)((1.0 - alpha * a) / a0);
+    coef.a1 = coef.b1;
+    coef.a2 = (float)((1.0 - alpha / a) / a0);
+    return coef;
+}
+
+soundsphere::audio_eq::audio_eq(int rate, int channels)
+{
+    this->rate = rate;
+    this->channels = channels;
+    cascade = audio_eq_cascade();
+    seq.store(0);
+    enabled.store(false);
+    seen = 0;
+    bypass = true;
+    gain = 1.0f;
+
+    const audio_eq_params_t flat;
+    target[0].store(flat.preamp_db);
+    for (size_t i = 0; i < AUDIO_EQ_BANDS; i++)
+    {
+        target[1 + 3 * i].store(flat.bands[i].freq);
+        target[2 + 3 * i].store(flat.bands[i].gain_db);
+        target[3 + 3 * i].store(flat.bands[i].q);
+        coef[i] = audio_eq_peaking(flat.bands[i].freq, 0.0, flat.bands[i].q, rate);
+    }
+    memset(state, 0, sizeof(state));
+}
+
+void soundsphere::audio_eq_set(audio_eq_t &eq, bool enabled, const audio_eq_params_t &params)
+{
+    uint32_t seq = eq.seq.load(std::memory_order_relaxed);
+    eq.seq.store(seq + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    eq.enabled.store(enabled, std::memory_order_relaxed);
+    eq.target[0].store(params.preamp_db, std::memory_order_relaxed);
+    for (size_t i = 0; i < AUDIO_EQ_BANDS; i++)
+    {
+        eq.target[1 + 3 * i].store(params.bands[i].freq, std::memory_order_relaxed);
+        eq.target[2 + 3 * i].store(params.bands[i].gain_db, std::memory_order_relaxed);
+        eq.target[3 + 3 * i].store(params.bands[i].q, std::memory_order_relaxed);
+    }
+
+    eq.seq.store(seq + 2, std::memory_order_release);
+}
+
+/**
+ * @brief Read target if changed. A torn read is dropped, and read again next time.
+ */
+static void _audio_eq_read_target(soundsphere::audio_eq_t &eq)
+{
+    uint32_t seq = eq.seq.load(std::memory_order_acquire);
+    if (seq == eq.seen || (seq & 1) != 0)
+    {
+        return;
+    }
+
+    soundsphere::audio_eq_params_t want;
+    bool                           enabled = eq.enabled.load(std::memory_order_relaxed);
+    want.preamp_db = eq.target[0].load(std::memory_order_relaxed);
+    for (size_t i = 0; i < AUDIO_EQ_BANDS; i++)
+    {
+        want.bands[i].freq = eq.target[1 + 3 * i].load(std::memory_order_relaxed);
+        want.bands[i].gain_db = eq.target[2 + 3 * i].load(std::memory_order_relaxed);
+        want.bands[i].q = eq.target[3 + 3 * i].load(std::memory_order_relaxed);
+    }
+
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if (eq.seq.load(std::memory_order_relaxed) != seq)
+    {
+        return;
+    }
+
+    /* Off is flat at the same frequencies, so bands only fade their gain. */
+    if (!enabled)
+    {
+        want.preamp_db = 0.0f;
+        for (size_t i = 0; i < AUDIO_EQ_BANDS; i++)
+        {
+            want.bands[i].gain_db = 0.0f;
+        }
+    }
+
+    eq.seen = seq;
+    eq.want = want;
+    eq.bypass = false;
+}
+
+/**
+ * @brief Move \p cur toward \p want.
+ * @return Whether \p cur changed.
+ */
+static bool _audio_eq_approach(float &cur, float want, float alpha)
+{
+    if (cur == want)
+    {
+        return false;
+    }
+
+    float diff = want - cur;
+    cur = std::fabs(diff) < AUDIO_EQ_SNAP ? want : cur + diff * alpha;
+    return true;
+}
+
+/**
+ * @brief Coefficients of band \p i from parameters in effect.
+ */
+static void _audio_eq_update_coef(soundsphere::audio_eq_t &eq, size_t i)
+{
+    const soundsphere::audio_eq_band_t &band = eq.cur.bands[i];
+    const float                         nyquist = (float)eq.rate * 0.49f;
+    float                               freq = band.freq < nyquist ? band.freq : nyquist;
+    eq.coef[i] = soundsphere::audio_eq_peaking(freq, band.gain_db, band.q, eq.rate);
+}
+
+/**
+ * @brief Move parameters one block toward target, and update coefficients.
+ * @return Whether equalizer is flat and settled.
+ */
+static bool _audio_eq_smooth(soundsphere::audio_eq_t &eq)
+{
+    const float alpha = (float)(1.0 - std::exp(-AUDIO_EQ_BLOCK / (eq.rate * AUDIO_EQ_SMOOTH_TIME)));
+
+    bool flat = !_audio_eq_approach(eq.cur.preamp_db, eq.want.preamp_db, alpha) && eq.cur.preamp_db == 0.0f;
+    for (size_t i = 0; i < AUDIO_EQ_BANDS; i++)
+    {
+        soundsphere::audio_eq_band_t       &cur = eq.cur.bands[i];
+        const soundsphere::audio_eq_band_t &want = eq.want.bands[i];
+
+        /* Frequency moves in octaves, as it is heard. */
+        bool changed = false;
+        if (cur.freq != want.freq)
+        {
+            float log_freq = std::log2(cur.freq);
+            float log_want = std::log2(want.freq);
+            _audio_eq_approach(log_freq, log_want, alpha);
+            cur.freq = log_freq == log_want ? want.freq : std::exp2(log_freq);
+            changed = true;
+        }
+        changed = _audio_eq_approach(cur.gain_db, want.gain_db, alpha) || changed;
+        changed = _audio_eq_approach(cur.q, want.q, alpha) || changed;
+        if (changed)
+        {
+            _audio_eq_update_coef(eq, i);
+        }
+        flat = flat && !changed && cur.gain_db == 0.0f;
+    }
+
+    return flat;
+}
+
+void soundsphere::audio_eq_process(audio_eq_t &eq, int16_t *pcm, size_t frames)
+{
+    _audio_eq_read_target(eq);
+    if (eq.bypass || eq.channels > AUDIO_EQ_MAX_CHANNELS)
+    {
+        return;
+    }
+
+    while (frames > 0)
+    {
+        size_t n = frames < AUDIO_EQ_BLOCK ? frames : AUDIO_EQ_BLOCK;
+        bool   flat = _audio_eq_smooth(eq);
+
+        /* Preamp ramps linearly over the block. */
+        float gain = std::pow(10.0f, eq.cur.preamp_db / 20.0f);
+        float step = (gain - eq.gain) / (float)n;
+
+        for (int g = 0; g * AUDIO_EQ_LANES < eq.channels; g++)
+        {
+            int base = g * AUDIO_EQ_LANES;
+            int lanes = eq.channels - base < AUDIO_EQ_LANES ? eq.channels - base : AUDIO_EQ_LANES;
+
+            memset(eq.buf, 0, sizeof(eq.buf));
+            for (size_t i = 0; i < n; i++)
+            {
+                for (int l = 0; l < lanes; l++)
+                {
+                    eq.buf[i][l] = pcm[i * eq.channels + base + l];
+                }
+            }
+
+            eq.cascade(eq.buf, n, lanes, eq.coef, eq.state[g], AUDIO_EQ_BANDS);
+
+            for (size_t i = 0; i < n; i++)
+            {
+                float frame_gain = eq.gain + step * (float)(i + 1);
+                for (int l = 0; l < lanes; l++)
+                {
+                    float v = eq.buf[i][l] * frame_gain;
+                    v = v > 32767.0f ? 32767.0f : (v < -32768.0f ? -32768.0f : v);
+                    pcm[i * eq.channels + base + l] = (int16_t)std::lrint(v);
+                }
+            }
+        }
+
+        eq.gain = gain;
+        pcm += n * eq.channels;
+        frames -= n;
+
+        /* Flat filters pass input through, so it is safe to stop and start from clean state. */
+        if (flat)
+        {
+            eq.bypass = true;
+            memset(eq.state, 0, sizeof(eq.state));
+            return;
+        }
+    }
+}
+
+void soundsphere::audio_eq_reset(audio_eq_t &eq, int rate, int channels)
+{
+    eq.rate = rate;
+    eq.channels = channels;
+
+    /* Nothing was heard at the new format, so jump to target. */
+    _audio_eq_read_target(eq);
+    eq.cur = eq.want;
+    eq.gain = std::pow(10.0f, eq.cur.preamp_db / 20.0f);
+
+    bool flat = eq.cur.preamp_db == 0.0f;
+    for (size_t i = 0; i < AUDIO_EQ_BANDS; i++)
+    {
+        _audio_eq_update_coef(eq, i);
+        flat = flat && eq.cur.bands[i].gain_db == 0.0f;
+    }
+    eq.bypass = flat;
+    memset(eq.state, 0, sizeof(eq.state));
+}
@@ -0,0 +1,179 @@
+#ifndef SOUND_SPHERE_AUDIO_EQ_HPP
+#define SOUND_SPHERE_AUDIO_EQ_HPP
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define AUDIO_EQ_SSE2 1
+#endif
+
+/**
+ * @brief Number of equalizer bands.
+ */
+#define AUDIO_EQ_BANDS 10
+
+/**
+ * @brief Channels filtered together, one per SIMD lane.
+ */
+#define AUDIO_EQ_LANES 4
+
+/**
+ * @brief Channels supported, output with more channels is not equalized.
+ */
+#define AUDIO_EQ_MAX_CHANNELS 8
+
+/**
+ * @brief Frames filtered at a time. Parameters move toward target once per block.
+ */
+#define AUDIO_EQ_BLOCK 64
+
+namespace soundsphere
+{
+
+/**
+ * @brief Biquad coefficients, a0 normalized to 1.
+ */
+typedef struct audio_eq_coef
+{
+    float b0, b1, b2, a1, a2;
+} audio_eq_coef_t;
+
+/**
+ * @brief Transposed direct form II state of one biquad, for each lane.
+ */
+typedef struct audio_eq_state
+{
+    float z1[AUDIO_EQ_LANES];
+    float z2[AUDIO_EQ_LANES];
+} audio_eq_state_t;
+
+/**
+ * @brief Run \p bands cascaded biquads over \p frames frames in place.
+ * @param[in,out] buf   Samples, one lane per channel.
+ * @param[in] frames    Number of frames.
+ * @param[in] lanes     Lanes in use, the others may be filtered or not.
+ * @param[in] coef      Coefficients of each biquad.
+ * @param[in,out] state State of each biquad.
+ * @param[in] bands     Number of biquads.
+ */
+typedef void (*audio_eq_cascade_fn)(float (*buf)[AUDIO_EQ_LANES], size_t frames, int lanes,
+                                    const audio_eq_coef_t *coef, audio_eq_state_t *state, size_t bands);
+
+/**
+ * @brief Portable implementation of #audio_eq_cascade_fn.
+ */
+void audio_eq_cascade_scalar(float (*buf)[AUDIO_EQ_LANES], size_t frames, int lanes, const audio_eq_coef_t *coef,
+                             audio_eq_state_t *state, size_t bands);
+
+#if defined(AUDIO_EQ_SSE2)
+
+/**
+ * @brief SSE2 implementation of #audio_eq_cascade_fn, all lanes at once.
+ */
+void audio_eq_cascade_sse2(float (*buf)[AUDIO_EQ_LANES], size_t frames, int lanes, const audio_eq_coef_t *coef,
+                           audio_eq_state_t *state, size_t bands);
+
+#endif
+
+/**
+ * @brief The fastest implementation.
+ * @return Function.
+ */
+audio_eq_cascade_fn audio_eq_cascade(void);
+
+/**
+ * @brief Peaking filter of RBJ Audio EQ Cookbook.
+ * @param[in] freq      Center frequency, in Hz.
+ * @param[in] gain_db   Gain at center frequency, in dB.
+ * @param[in] q         Quality factor.
+ * @param[in] rate      Sample rate.
+ * @return Coefficients.
+ */
+audio_eq_coef_t audio_eq_peaking(double freq, double gain_db, double q, int rate);
+
+typedef struct audio_eq_band
+{
+    float freq;    /**< Center frequency, in Hz. */
+    float gain_db; /**< Gain, in dB. */
+    float q;       /**< Quality factor. */
+} audio_eq_band_t;
+
+typedef struct audio_eq_params
+{
+    /**
+     * @brief Flat response, bands at octave centers from 31 Hz to 16 kHz.
+     */
+    audio_eq_params();
+
+    float           preamp_db;             /**< Gain before bands, in dB. */
+    audio_eq_band_t bands[AUDIO_EQ_BANDS]; /**< Bands. */
+} audio_eq_params_t;
+
+/**
+ * @brief Equalizer of 16-bit output.
+ *
+ * Parameters are published by one thread and picked up by the audio thread
+ * without locking. The audio thread moves its parameters toward them block
+ * by block, so changes do not click.
+ */
+typedef struct audio_eq
+{
+    audio_eq(int rate, int channels);
+
+    int                 rate;     /**< Sample rate. */
+    int                 channels; /**< Samples per frame. */
+    audio_eq_cascade_fn cascade;  /**< Filter kernel. */
+
+    /*
+     * Target parameters, written by #audio_eq_set() under an odd sequence.
+     */
+
+    std::atomic<uint32_t> seq;                            /**< Odd while being written. */
+    std::atomic<bool>     enabled;                        /**< Whether equalizer is on. */
+    std::atomic<float>    target[1 + 3 * AUDIO_EQ_BANDS]; /**< Preamp, then freq, gain and Q of each band. */
+
+    /*
+     * Fields below are only used by audio thread.
+     */
+
+    uint32_t          seen;   /**< Last sequence read. */
+    audio_eq_params_t want;   /**< Target read from #audio_eq::target. */
+    audio_eq_params_t cur;    /**< Parameters in effect. */
+    bool              bypass; /**< Flat and settled, output is untouched. */
+    float             gain;   /**< Linear preamp gain in effect. */
+
+    audio_eq_coef_t  coef[AUDIO_EQ_BANDS];                                          /**< Coefficients. */
+    audio_eq_state_t state[AUDIO_EQ_MAX_CHANNELS / AUDIO_EQ_LANES][AUDIO_EQ_BANDS]; /**< Filter state. */
+    float            buf[AUDIO_EQ_BLOCK][AUDIO_EQ_LANES];                           /**< Working buffer. */
+} audio_eq_t;
+
+/**
+ * @brief Publish new parameters. Only one thread may call it.
+ * @param[in] eq        Equalizer.
+ * @param[in] enabled   Whether equalizer is on. Off fades to flat.
+ * @param[in] params    Parameters.
+ */
+void audio_eq_set(audio_eq_t &eq, bool enabled, const audio_eq_params_t &params);
+
+/**
+ * @brief Equalize interleaved PCM in place. Lock free, called in audio thread.
+ * @param[in] eq        Equalizer.
+ * @param[in,out] pcm   PCM.
+ * @param[in] frames    Number of frames.
+ */
+void audio_eq_process(audio_eq_t &eq, int16_t *pcm, size_t frames);
+
+/**
+ * @brief Start over at another output format, target takes effect at once.
+ * Audio thread must not be running.
+ * @param[in] eq        Equalizer.
+ * @param[in] rate      Sample rate.
+ * @param[in] channels  Samples per frame.
+ */
+void audio_eq_reset(audio_eq_t &eq, int rate, int channels);
+
+} // namespace soundsphere
+
+#endif
@@ -0,0 +1,395 @@
+#include <algorithm>
+#include <cmath>
+#include <vector>
+#include "loudness.hpp"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define AUDIO_LOUDNESS_SSE2 1
+#endif
+
+/**
+ * @brief Frames deinterleaved at a time for true peak detection.
+ */
+#define AUDIO_LOUDNESS_CHUNK 4096
+
+/**
+ * @brief Taps per phase of the oversampling filter.
+ */
+#define AUDIO_LOUDNESS_TP_TAPS 12
+
+/**
+ * @brief Gating blocks are 400ms, made of 4 sub-blocks of 100ms.
+ */
+#define AUDIO_LOUDNESS_SUB_BLOCKS 4
+
+/**
+ * @brief 4x oversampling interpolation filter of ITU-R BS.1770-4 Annex 2.
+ * Stored transposed, so one row is one tap of all 4 phases.
+ */
+static const float s_audio_tp_coef[AUDIO_LOUDNESS_TP_TAPS][4] = {
+    { 0.0017089843750f,  -0.0291748046875f, -0.0189208984375f, -0.0083007812500f },
+    { 0.0109863281250f,  0.0292968750000f,  0.0330810546875f,  0.0148925781250f  },
+    { -0.0196533203125f, -0.0517578125000f, -0.0582275390625f, -0.0266113281250f },
+    { 0.0332031250000f,  0.0891113281250f,  0.1015625000000f,  0.0476074218750f  },
+    { -0.0594482421875f, -0.1665039062500f, -0.2003173828125f, -0.1022949218750f },
+    { 0.1373291015625f,  0.4650878906250f,  0.7797851562500f,  0.9721679687500f  },
+    { 0.9721679687500f,  0.7797851562500f,  0.4650878906250f,  0.1373291015625f  },
+    { -0.1022949218750f, -0.2003173828125f, -0.1665039062500f, -0.0594482421875f },
+    { 0.0476074218750f,  0.1015625000000f,  0.0891113281250f,  0.0332031250000f  },
+    { -0.0266113281250f, -0.0582275390625f, -0.0517578125000f, -0.0196533203125f },
+    { 0.0148925781250f,  0.0330810546875f,  0.0292968750000f,  0.0109863281250f  },
+    { -0.0083007812500f, -0.0189208984375f, -0.0291748046875f, 0.0017089843750f  },
+};
+
+soundsphere::audio_loudness::audio_loudness()
+{
+    integrated = -HUGE_VAL;
+    power = 0.0;
+    blocks = 0;
+    true_peak = 0.0;
+}
+
+/**
+ * @brief K-weighting coefficients for \p freq, derived from the 48kHz ones of BS.1770.
+ */
+static soundsphere::audio_kweight_t _audio_loudness_kweight(int freq)
+{
+    soundsphere::audio_kweight_t kw;
+    const double                 pi = 3.14159265358979323846;
+
+    double f0 = 1681.974450955533;
+    double gain = 3.999843853973347;
+    double q = 0.7071752369554196;
+    double k = std::tan(pi * f0 / freq);
+    double vh = std::pow(10.0, gain / 20.0);
+    double vb = std::pow(vh, 0.4996667741545416);
+    double a0 = 1.0 + k / q + k * k;
+    kw.shelf.b0 = (vh + vb * k / q + k * k) / a0;
+    kw.shelf.b1 = 2.0 * (k * k - vh) / a0;
+    kw.shelf.b2 = (vh - vb * k / q + k * k) / a0;
+    kw.shelf.a1 = 2.0 * (k * k - 1.0) / a0;
+    kw.shelf.a2 = (1.0 - k / q + k * k) / a0;
+
+    f0 = 38.13547087602444;
+    q = 0.5003270373238773;
+    k = std::tan(pi * f0 / freq);
+    a0 = 1.0 + k / q + k * k;
+    kw.highpass.b0 = 1.0;
+    kw.highpass.b1 = -2.0;
+    kw.highpass.b2 = 1.0;
+    kw.highpass.a1 = 2.0 * (k * k - 1.0) / a0;
+    kw.highpass.a2 = (1.0 - k / q + k * k) / a0;
+
+    return kw;
+}
+
+/**
+ * @brief K-weight \p frames frames and add power of each channel into \p sum.
+ * @param[in,out] z Filter state, 4 per channel.
+ */
+static void _audio_loudness_filter_scalar(const soundsphere::audio_kweight_t &kw, const int16_t *pcm, size_t frames,
+                                          int channels, double *z, double *sum)
+{
+    const soundsphere::audio_biquad_t &s = kw.shelf;
+    const soundsphere::audio_biquad_t &h = kw.highpass;
+
+    for (int c = 0; c < channels; c++)
+    {
+        double *zc = z + c * 4;
+        double  acc = 0.0;
+        for (size_t i = 0; i < frames; i++)
+        {
+            /* Direct form II transposed. */
+            double x = pcm[i * channels + c] / 32768.0;
+            double y = s.b0 * x + zc[0];
+            zc[0] = s.b1 * x - s.a1 * y + zc[1];
+            zc[1] = s.b2 * x - s.a2 * y;
+            double w = h.b0 * y + zc[2];
+            zc[2] = h.b1 * y - h.a1 * w + zc[3];
+            zc[3] = h.b2 * y - h.a2 * w;
+            acc += w * w;
+        }
+        sum[c] += acc;
+    }
+}
+
+#if defined(AUDIO_LOUDNESS_SSE2)
+
+/**
+ * @brief Stereo version of #_audio_loudness_filter_scalar(), with left and
+ * right channel in the two lanes.
+ */
+static void _audio_loudness_filter_stereo_sse2(const soundsphere::audio_kweight_t &kw, const int16_t *pcm,
+                                               size_t frames, double *z, double *sum)
+{
+    const __m128d scale = _mm_set1_pd(1.0 / 32768.0);
+    const __m128d sb0 = _mm_set1_pd(kw.shelf.b0), sb1 = _mm_set1_pd(kw.shelf.b1), sb2 = _mm_set1_pd(kw.shelf.b2);
+    const __m128d sa1 = _mm_set1_pd(kw.shelf.a1), sa2 = _mm_set1_pd(kw.shelf.a2);
+    const __m128d hb0 = _mm_set1_pd(kw.highpass.b0), hb1 = _mm_set1_pd(kw.highpass.b1);
+    const __m128d hb2 = _mm_set1_pd(kw.highpass.b2);
+    const __m128d ha1 = _mm_set1_pd(kw.highpass.a1), ha2 = _mm_set1_pd(kw.highpass.a2);
+
+    /* State is stored per channel, gather it into lanes. */
+    __m128d z0 = _mm_setr_pd(z[0], z[4]);
+    __m128d z1 = _mm_setr_pd(z[1], z[5]);
+    __m128d z2 = _mm_setr_pd(z[2], z[6]);
+    __m128d z3 = _mm_setr_pd(z[3], z[7]);
+    __m128d acc = _mm_setzero_pd();
+
+    for (size_t i = 0; i < frames; i++)
+    {
+        __m128d x = _mm_mul_pd(_mm_setr_pd(pcm[i * 2], pcm[i * 2 + 1]), scale);
+        __m128d y = _mm_add_pd(_mm_mul_pd(sb0, x), z0);
+        z0 = _mm_add_pd(_mm_sub_pd(_mm_mul_pd(sb1, x), _mm_mul_pd(sa1, y)), z1);
+        z1 = _mm_sub_pd(_mm_mul_pd(sb2, x), _mm_mul_pd(sa2, y));
+        __m128d w = _mm_add_pd(_mm_mul_pd(hb0, y), z2);
+        z2 = _mm_add_pd(_mm_sub_pd(_mm_mul_pd(hb1, y), _mm_mul_pd(ha1, w)), z3);
+        z3 = _mm_sub_pd(_mm_mul_pd(hb2, y), _mm_mul_pd(ha2, w));
+        acc = _mm_add_pd(acc, _mm_mul_pd(w, w));
+    }
+
+    double lanes[2];
+    __m128d state[4] = { z0, z1, z2, z3 };
+    for (int k = 0; k < 4; k++)
+    {
+        _mm_storeu_pd(lanes, state[k]);
+        z[k] = lanes[0];
+        z[4 + k] = lanes[1];
+    }
+    _mm_storeu_pd(lanes, acc);
+    sum[0] += lanes[0];
+    sum[1] += lanes[1];
+}
+
+#endif
+
+static void _audio_loudness_filter(const soundsphere::audio_kweight_t &kw, const int16_t *pcm, size_t frames,
+                                   int channels, double *z, double *sum)
+{
+#if defined(AUDIO_LOUDNESS_SSE2)
+    if (channels == 2)
+    {
+        _audio_loudness_filter_stereo_sse2(kw, pcm, frames, z, sum);
+        return;
+    }
+#endif
+    _audio_loudness_filter_scalar(kw, pcm, frames, channels, z, sum);
+}
+
+/**
+ * @brief Peak of 4x oversampled \p buf.
+ * @param[in] buf       Samples, including #AUDIO_LOUDNESS_TP_TAPS - 1 history samples at the beginning.
+ * @param[in] frames    Number of samples after history.
+ */
+static float _audio_loudness_true_peak(const float *buf, size_t frames)
+{
+#if defined(AUDIO_LOUDNESS_SSE2)
+    /* All 4 phases of one output sample in one vector. */
+    const __m128 sign = _mm_set1_ps(-0.0f);
+    __m128       coef[AUDIO_LOUDNESS_TP_TAPS];
+    __m128       peak = _mm_setzero_ps();
+    for (int k = 0; k < AUDIO_LOUDNESS_TP_TAPS; k++)
+    {
+        coef[k] = _mm_loadu_ps(s_audio_tp_coef[k]);
+    }
+
+    for (size_t i = 0; i < frames; i++)
+    {
+        const float *x = buf + i + AUDIO_LOUDNESS_TP_TAPS - 1;
+        __m128       acc = _mm_setzero_ps();
+        for (int k = 0; k < AUDIO_LOUDNESS_TP_TAPS; k++)
+        {
+            acc = _mm_add_ps(acc, _mm_mul_ps(coef[k], _mm_set1_ps(x[-k])));
+        }
+        peak = _mm_max_ps(peak, _mm_andnot_ps(sign, acc));
+    }
+
+    float lanes[4];
+    _mm_storeu_ps(lanes, peak);
+    float ret = lanes[0] > lanes[1] ? lanes[0] : lanes[1];
+    ret = ret > lanes[2] ? ret : lanes[2];
+    return ret > lanes[3] ? ret : lanes[3];
+#else
+    float ret = 0.0f;
+    for (size_t i = 0; i < frames; i++)
+    {
+        const float *x = buf + i + AUDIO_LOUDNESS_TP_TAPS - 1;
+        for (int p = 0; p < 4; p++)
+        {
+            float acc = 0.0f;
+            for (int k = 0; k < AUDIO_LOUDNESS_TP_TAPS; k++)
+            {
+                acc += s_audio_tp_coef[k][p] * x[-k];
+            }
+            acc = std::fabs(acc);
+            ret = acc > ret ? acc : ret;
+        }
+    }
+    return ret;
+#endif
+}
+
+/**
+ * @brief Integrated loudness of sub-block powers, with absolute and relative gate.
+ */
+static void _audio_loudness_gate(const std::vector<double> &subs, soundsphere::audio_loudness_t &result)
+{
+    std::vector<double> blocks;
+    for (size_t i = AUDIO_LOUDNESS_SUB_BLOCKS - 1; i < subs.size(); i++)
+    {
+        double power = 0.0;
+        for (size_t j = 0; j < AUDIO_LOUDNESS_SUB_BLOCKS; j++)
+        {
+            power += subs[i - j];
+        }
+        power /= AUDIO_LOUDNESS_SUB_BLOCKS;
+
+        /* Absolute gate at -70 LUFS. */
+        if (-0.691 + 10.0 * std::log10(power) > -70.0)
+        {
+            blocks.push_back(power);
+        }
+    }
+    if (blocks.empty())
+    {
+        return;
+    }
+
+    double sum = 0.0;
+    for (size_t i = 0; i < blocks.size(); i++)
+    {
+        sum += blocks[i];
+    }
+
+    /* Relative gate at 10 LU below loudness of blocks above absolute gate. */
+    double   threshold = sum / blocks.size() * 0.1;
+    double   gated = 0.0;
+    uint64_t count = 0;
+    for (size_t i = 0; i < blocks.size(); i++)
+    {
+        if (blocks[i] > threshold)
+        {
+            gated += blocks[i];
+            count++;
+        }
+    }
+
+    result.blocks = count;
+    result.power = gated / count;
+    result.integrated = -0.691 + 10.0 * std::log10(result.power);
+}
+
+soundsphere::audio_loudness_meter::audio_loudness_meter(int channels, int freq)
+{
+    this->channels = channels > 0 && freq > 0 ? channels : 0;
+    kw = _audio_loudness_kweight(freq > 0 ? freq : 48000);
+    sub_frames = freq > 0 ? (size_t)freq / 10 : 0;
+    sub_fill = 0;
+    peak = 0.0f;
+
+    /* Channel weights. For 5.1 the LFE is ignored and surrounds are boosted. */
+    weight.assign(this->channels, 1.0);
+    if (this->channels == 6)
+    {
+        weight[3] = 0.0;
+        weight[4] = 1.41;
+        weight[5] = 1.41;
+    }
+    z.assign(this->channels * 4, 0.0);
+    sum.assign(this->channels, 0.0);
+    history.assign(this->channels * (AUDIO_LOUDNESS_TP_TAPS - 1), 0.0f);
+    buf.resize(AUDIO_LOUDNESS_TP_TAPS - 1 + AUDIO_LOUDNESS_CHUNK);
+}
+
+void soundsphere::audio_loudness_feed(audio_loudness_meter_t &meter, const int16_t *pcm, size_t frames)
+{
+    const int channels = meter.channels;
+    if (channels == 0 || meter.sub_frames == 0)
+    {
+        return;
+    }
+
+    /* A sub-block may span calls, its power is summed until complete. */
+    for (size_t pos = 0; pos < frames;)
+    {
+        size_t n = std::min(frames - pos, meter.sub_frames - meter.sub_fill);
+        _audio_loudness_filter(meter.kw, pcm + pos * channels, n, channels, meter.z.data(), meter.sum.data());
+        pos += n;
+        meter.sub_fill += n;
+        if (meter.sub_fill < meter.sub_frames)
+        {
+            continue;
+        }
+
+        double power = 0.0;
+        for (int c = 0; c < channels; c++)
+        {
+            power += meter.weight[c] * meter.sum[c] / meter.sub_frames;
+        }
+        meter.subs.push_back(power);
+        std::fill(meter.sum.begin(), meter.sum.end(), 0.0);
+        meter.sub_fill = 0;
+    }
+
+    /* True peak, one channel at a time with history carried between chunks and calls. */
+    const size_t tail = AUDIO_LOUDNESS_TP_TAPS - 1;
+    for (size_t pos = 0; pos < frames; pos += AUDIO_LOUDNESS_CHUNK)
+    {
+        size_t n = frames - pos < AUDIO_LOUDNESS_CHUNK ? frames - pos : AUDIO_LOUDNESS_CHUNK;
+        for (int c = 0; c < channels; c++)
+        {
+            float *hist = meter.history.data() + c * tail;
+            std::copy(hist, hist + tail, meter.buf.begin());
+            for (size_t i = 0; i < n; i++)
+            {
+                meter.buf[tail + i] = pcm[(pos + i) * channels + c] / 32768.0f;
+            }
+
+            float p = _audio_loudness_true_peak(meter.buf.data(), n);
+            meter.peak = p > meter.peak ? p : meter.peak;
+            std::copy(meter.buf.begin() + n, meter.buf.begin() + n + tail, hist);
+        }
+    }
+}
+
+bool soundsphere::audio_loudness_finish(const audio_loudness_meter_t &meter, audio_loudness_t &result)
+{
+    result = audio_loudness_t();
+    if (meter.channels == 0)
+    {
+        return false;
+    }
+
+    result.true_peak = meter.peak;
+    _audio_loudness_gate(meter.subs, result);
+    return result.blocks != 0;
+}
+
+bool soundsphere::audio_loudness_measure(const int16_t *pcm, size_t frames, int channels, int freq,
+                                         audio_loudness_t &result)
+{
+    audio_loudness_meter_t meter(channels, freq);
+    audio_loudness_feed(meter, pcm, frames);
+    return audio_loudness_finish(meter, result);
+}
+
+soundsphere::audio_loudness_t soundsphere::audio_loudness_merge(const audio_loudness_t *tracks, size_t count)
+{
+    audio_loudness_t ret;
+    double           sum = 0.0;
+
+    for (size_t i = 0; i < count; i++)
+    {
+        sum += tracks[i].power * tracks[i].blocks;
+        ret.blocks += tracks[i].blocks;
+        ret.true_peak = tracks[i].true_peak > ret.true_peak ? tracks[i].true_peak : ret.true_peak;
+    }
+
+    if (ret.blocks != 0)
+    {
+        ret.power = sum / ret.blocks;
+        ret.integrated = -0.691 + 10.0 * std::log10(ret.power);
+    }
+    return ret;
+}
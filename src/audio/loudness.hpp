@@ -0,0 +1,109 @@
+#ifndef SOUND_SPHERE_AUDIO_LOUDNESS_HPP
+#define SOUND_SPHERE_AUDIO_LOUDNESS_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/**
+ * @brief ReplayGain 2.0 reference loudness, in LUFS.
+ */
+#define AUDIO_LOUDNESS_REFERENCE (-18.0)
+
+namespace soundsphere
+{
+
+/**
+ * @brief Loudness of a track or an album, as of ITU-R BS.1770 / EBU R128.
+ */
+typedef struct audio_loudness
+{
+    audio_loudness();
+
+    double   integrated; /**< Integrated loudness, in LUFS. */
+    double   power;      /**< Mean power of gated blocks, #audio_loudness::integrated before log. */
+    uint64_t blocks;     /**< Number of gated blocks. */
+    double   true_peak;  /**< True peak, linear, 1.0 is full scale. */
+} audio_loudness_t;
+
+/**
+ * @brief Biquad coefficients, a0 normalized to 1.
+ */
+typedef struct audio_biquad
+{
+    double b0, b1, b2, a1, a2;
+} audio_biquad_t;
+
+/**
+ * @brief K-weighting filter, a high shelf followed by a high pass.
+ */
+typedef struct audio_kweight
+{
+    audio_biquad_t shelf;
+    audio_biquad_t highpass;
+} audio_kweight_t;
+
+/**
+ * @brief Loudness measured over PCM fed block by block, so a track does not
+ * have to be decoded as a whole.
+ */
+typedef struct audio_loudness_meter
+{
+    /**
+     * @param[in] channels  Samples per frame.
+     * @param[in] freq      Sample rate.
+     */
+    audio_loudness_meter(int channels, int freq);
+
+    int                 channels;   /**< Samples per frame. */
+    audio_kweight_t     kw;         /**< K-weighting coefficients. */
+    size_t              sub_frames; /**< Frames of a 100ms sub-block. */
+    size_t              sub_fill;   /**< Frames filtered into current sub-block. */
+    float               peak;       /**< True peak so far. */
+    std::vector<double> weight;     /**< Weight of each channel. */
+    std::vector<double> z;          /**< Filter state, 4 per channel. */
+    std::vector<double> sum;        /**< Power of current sub-block, per channel. */
+    std::vector<double> subs;       /**< Power of each complete sub-block. */
+    std::vector<float>  history;    /**< Last samples of each channel, for true peak filter. */
+    std::vector<float>  buf;        /**< One channel of a chunk, after its history. */
+} audio_loudness_meter_t;
+
+/**
+ * @brief Feed next interleaved S16 PCM.
+ * @param[in,out] meter Meter.
+ * @param[in] pcm       PCM.
+ * @param[in] frames    Number of frames.
+ */
+void audio_loudness_feed(audio_loudness_meter_t &meter, const int16_t *pcm, size_t frames);
+
+/**
+ * @brief Loudness of all PCM fed. A trailing partial sub-block is ignored.
+ * @param[in] meter     Meter.
+ * @param[out] result   Loudness.
+ * @return false if audio is shorter than one gating block or silent.
+ */
+bool audio_loudness_finish(const audio_loudness_meter_t &meter, audio_loudness_t &result);
+
+/**
+ * @brief Measure loudness of interleaved S16 PCM.
+ * @param[in] pcm       PCM.
+ * @param[in] frames    Number of frames.
+ * @param[in] channels  Samples per frame.
+ * @param[in] freq      Sample rate.
+ * @param[out] result   Loudness.
+ * @return false if audio is shorter than one gating block or silent.
+ */
+bool audio_loudness_measure(const int16_t *pcm, size_t frames, int channels, int freq, audio_loudness_t &result);
+
+/**
+ * @brief Loudness of tracks measured together, approximated from the gated
+ * blocks of each track.
+ * @param[in] tracks    Loudness of tracks.
+ * @param[in] count     Number of tracks.
+ * @return Loudness.
+ */
+audio_loudness_t audio_loudness_merge(const audio_loudness_t *tracks, size_t count);
+
+} // namespace soundsphere
+
+#endif
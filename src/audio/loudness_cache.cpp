@@ -0,0 +1,308 @@
+#include <ev.h>
+#include <nlohmann/json.hpp>
+#include <cmath>
+#include <unordered_map>
+#include <vector>
+#include "config/__init__.hpp"
+#include "utils/binary.hpp"
+#include "utils/path.hpp"
+#include "loudness_cache.hpp"
+
+typedef struct loudness_cache_entry
+{
+    uint64_t                      size;     /**< File size in bytes. */
+    uint64_t                      mtime;    /**< Modification time in seconds. */
+    std::string                   album;    /**< Album key, empty if no album tag. */
+    soundsphere::audio_loudness_t loudness; /**< Track loudness. */
+} loudness_cache_entry_t;
+
+/**
+ * @brief Entries by file path.
+ */
+typedef std::unordered_map<std::string, loudness_cache_entry_t> LoudnessCacheMap;
+
+typedef struct loudness_cache_ctx
+{
+    loudness_cache_ctx();
+    ~loudness_cache_ctx();
+
+    /**
+     * @brief Cache file path.
+     */
+    std::string path;
+
+    /**
+     * @brief Serializes writes of cache file, and protects #loudness_cache_ctx::saved.
+     */
+    ev_mutex_t save_mutex;
+
+    /**
+     * @brief Generation of the snapshot last written.
+     */
+    uint64_t saved;
+
+    /**
+     * @brief Protects everything below.
+     */
+    ev_mutex_t mutex;
+
+    /**
+     * @brief Cached entries.
+     */
+    LoudnessCacheMap entries;
+
+    /**
+     * @brief Changed since last save.
+     */
+    bool dirty;
+
+    /**
+     * @brief Increased every time a snapshot is taken for saving.
+     */
+    uint64_t generation;
+} loudness_cache_ctx_t;
+
+static loudness_cache_ctx_t *s_loudness_cache = nullptr;
+
+loudness_cache_ctx::loudness_cache_ctx()
+{
+    ev_mutex_init(&save_mutex, 0);
+    ev_mutex_init(&mutex, 0);
+    saved = 0;
+    dirty = false;
+    generation = 0;
+}
+
+loudness_cache_ctx::~loudness_cache_ctx()
+{
+    ev_mutex_exit(&mutex);
+    ev_mutex_exit(&save_mutex);
+}
+
+/**
+ * @brief Tracks of one album are in the same directory.
+ */
+static std::string _loudness_cache_album_key(const soundsphere::music_tags_t &music)
+{
+    if (music.info.album.empty())
+    {
+        return std::string();
+    }
+    return soundsphere::dirname(music.path) + "|" + music.info.album;
+}
+
+static bool _loudness_cache_stat(const std::string &path, uint64_t &size, uint64_t &mtime)
+{
+    ev_file_t file;
+    if (ev_file_open(nullptr, &file, nullptr, path.c_str(), EV_FS_O_RDONLY, 0, nullptr) != 0)
+    {
+        return false;
+    }
+
+    ev_fs_stat_t stat;
+    int          ret = ev_file_stat(&file, nullptr, &stat, nullptr);
+    ev_file_close(&file, nullptr);
+    if (ret != 0)
+    {
+        return false;
+    }
+
+    size = stat.st_size;
+    mtime = stat.st_mtim.tv_sec;
+    return true;
+}
+
+static std::string _loudness_cache_string(const nlohmann::json &obj, const char *key)
+{
+    auto it = obj.find(key);
+    return (it != obj.end() && it->is_string()) ? it->get<std::string>() : std::string();
+}
+
+static uint64_t _loudness_cache_uint(const nlohmann::json &obj, const char *key)
+{
+    auto it = obj.find(key);
+    return (it != obj.end() && it->is_number_unsigned()) ? it->get<uint64_t>() : 0;
+}
+
+static double _loudness_cache_number(const nlohmann::json &obj, const char *key, double dflt)
+{
+    auto it = obj.find(key);
+    return (it != obj.end() && it->is_number()) ? it->get<double>() : dflt;
+}
+
+static void _loudness_cache_load(void)
+{
+    ev_fs_req_t req;
+    if (ev_fs_readfile(nullptr, &req, s_loudness_cache->path.c_str(), nullptr) < 0)
+    {
+        return;
+    }
+
+    const ev_buf_t *buf = ev_fs_get_filecontent(&req);
+    nlohmann::json  json = nlohmann::json::parse((char *)buf->data, (char *)buf->data + buf->size, nullptr, false);
+    ev_fs_req_cleanup(&req);
+    if (!json.is_array())
+    {
+        return;
+    }
+
+    /* A hand-edited or corrupted file drops bad entries instead of throwing. */
+    for (auto it = json.begin(); it != json.end(); it++)
+    {
+        if (!it->is_object())
+        {
+            continue;
+        }
+
+        std::string path = _loudness_cache_string(*it, "path");
+        if (path.empty())
+        {
+            continue;
+        }
+
+        loudness_cache_entry_t entry;
+        entry.size = _loudness_cache_uint(*it, "size");
+        entry.mtime = _loudness_cache_uint(*it, "mtime");
+        entry.album = _loudness_cache_string(*it, "album");
+        entry.loudness.integrated = _loudness_cache_number(*it, "integrated", -HUGE_VAL);
+        entry.loudness.power = _loudness_cache_number(*it, "power", 0.0);
+        entry.loudness.blocks = _loudness_cache_uint(*it, "blocks");
+        entry.loudness.true_peak = _loudness_cache_number(*it, "true_peak", 0.0);
+        s_loudness_cache->entries[path] = entry;
+    }
+}
+
+/**
+ * @brief Write \p entries, unless a newer snapshot than \p generation is already written.
+ */
+static void _loudness_cache_save(const LoudnessCacheMap &entries, uint64_t generation)
+{
+    nlohmann::json json = nlohmann::json::array();
+    for (LoudnessCacheMap::const_iterator it = entries.begin(); it != entries.end(); it++)
+    {
+        const loudness_cache_entry_t &entry = it->second;
+        json.push_back({
+            { "path",       it->first                 },
+            { "size",       entry.size                },
+            { "mtime",      entry.mtime               },
+            { "album",      entry.album               },
+            { "integrated", entry.loudness.integrated },
+            { "power",      entry.loudness.power      },
+            { "blocks",     entry.loudness.blocks     },
+            { "true_peak",  entry.loudness.true_peak  },
+        });
+    }
+    std::string data = json.dump();
+
+    ev_mutex_enter(&s_loudness_cache->save_mutex);
+    if (generation > s_loudness_cache->saved)
+    {
+        soundsphere::dump(s_loudness_cache->path.c_str(), data.c_str(), data.size());
+        s_loudness_cache->saved = generation;
+    }
+    ev_mutex_leave(&s_loudness_cache->save_mutex);
+}
+
+void soundsphere::loudness_cache_init(void)
+{
+    s_loudness_cache = new loudness_cache_ctx_t;
+    s_loudness_cache->path = config_dir() + "/loudness.json";
+    _loudness_cache_load();
+}
+
+void soundsphere::loudness_cache_exit(void)
+{
+    loudness_cache_save();
+
+    delete s_loudness_cache;
+    s_loudness_cache = nullptr;
+}
+
+bool soundsphere::loudness_cache_get(const music_tags_t &music, audio_loudness_t &track, audio_loudness_t &album)
+{
+    uint64_t size = 0, mtime = 0;
+    if (s_loudness_cache == nullptr || !_loudness_cache_stat(music.path, size, mtime))
+    {
+        return false;
+    }
+
+    bool hit = false;
+    ev_mutex_enter(&s_loudness_cache->mutex);
+    do
+    {
+        LoudnessCacheMap::iterator it = s_loudness_cache->entries.find(music.path);
+        if (it == s_loudness_cache->entries.end())
+        {
+            break;
+        }
+        if (it->second.size != size || it->second.mtime != mtime)
+        {
+            s_loudness_cache->entries.erase(it);
+            s_loudness_cache->dirty = true;
+            break;
+        }
+
+        hit = true;
+        track = it->second.loudness;
+        album = track;
+
+        std::string key = _loudness_cache_album_key(music);
+        if (key.empty())
+        {
+            break;
+        }
+
+        std::vector<audio_loudness_t> tracks;
+        for (LoudnessCacheMap::iterator e = s_loudness_cache->entries.begin(); e != s_loudness_cache->entries.end();
+             e++)
+        {
+            if (e->second.album == key)
+            {
+                tracks.push_back(e->second.loudness);
+            }
+        }
+        album = audio_loudness_merge(tracks.data(), tracks.size());
+    } while (0);
+    ev_mutex_leave(&s_loudness_cache->mutex);
+
+    return hit;
+}
+
+void soundsphere::loudness_cache_put(const music_tags_t &music, const audio_loudness_t &loudness)
+{
+    loudness_cache_entry_t entry;
+    if (s_loudness_cache == nullptr || !_loudness_cache_stat(music.path, entry.size, entry.mtime))
+    {
+        return;
+    }
+    entry.album = _loudness_cache_album_key(music);
+    entry.loudness = loudness;
+
+    ev_mutex_enter(&s_loudness_cache->mutex);
+    {
+        s_loudness_cache->entries[music.path] = entry;
+        s_loudness_cache->dirty = true;
+    }
+    ev_mutex_leave(&s_loudness_cache->mutex);
+}
+
+void soundsphere::loudness_cache_save(void)
+{
+    LoudnessCacheMap entries;
+    uint64_t         generation = 0;
+
+    /* Only the copy is done with lock held, so lookups from scan workers are not blocked by disk I/O. */
+    ev_mutex_enter(&s_loudness_cache->mutex);
+    if (s_loudness_cache->dirty)
+    {
+        entries = s_loudness_cache->entries;
+        s_loudness_cache->dirty = false;
+        generation = ++s_loudness_cache->generation;
+    }
+    ev_mutex_leave(&s_loudness_cache->mutex);
+
+    if (generation != 0)
+    {
+        _loudness_cache_save(entries, generation);
+    }
+}
@@ -0,0 +1,57 @@
+#ifndef SOUND_SPHERE_AUDIO_LOUDNESS_CACHE_HPP
+#define SOUND_SPHERE_AUDIO_LOUDNESS_CACHE_HPP
+
+#include "utils/music_tag.hpp"
+#include "loudness.hpp"
+
+namespace soundsphere
+{
+
+/**
+ * @brief Initialize loudness cache.
+ * The cache lives in `loudness.json` under the configuration directory.
+ * @note Must be called after #config_init().
+ */
+void loudness_cache_init(void);
+
+/**
+ * @brief Save cache and cleanup.
+ */
+void loudness_cache_exit(void);
+
+/**
+ * @brief Get loudness of \p music.
+ *
+ * An entry is dropped if the file size or modification time changed. Album
+ * loudness is merged from cached tracks with the same album tag in the same
+ * directory, or the same as track loudness if \p music has no album tag.
+ *
+ * @note MT-Safe.
+ * @param[in] music     Music.
+ * @param[out] track    Track loudness.
+ * @param[out] album    Album loudness.
+ * @return true if found.
+ */
+bool loudness_cache_get(const music_tags_t &music, audio_loudness_t &track, audio_loudness_t &album);
+
+/**
+ * @brief Store loudness of \p music.
+ * @note MT-Safe.
+ * @param[in] music     Music.
+ * @param[in] loudness  Track loudness.
+ */
+void loudness_cache_put(const music_tags_t &music, const audio_loudness_t &loudness);
+
+/**
+ * @brief Write cache to disk if changed.
+ *
+ * Entries are copied with lock held, and written without it. A save that
+ * finishes late never overwrites the file of a newer one.
+ *
+ * @note MT-Safe. Blocks on disk I/O.
+ */
+void loudness_cache_save(void);
+
+} // namespace soundsphere
+
+#endif
@@ -0,0 +1,179 @@
+#include <cmath>
+#include <SDL.h>
+#include "mix.hpp"
+
+#if defined(AUDIO_MIX_X86)
+#include <immintrin.h>
+#endif
+
+/*
+ * GCC and Clang only allow intrinsics of an instruction set in functions built
+ * for it. MSVC allows them everywhere.
+ */
+#if defined(_MSC_VER) && !defined(__clang__)
+#define AUDIO_MIX_TARGET(x)
+#else
+#define AUDIO_MIX_TARGET(x) __attribute__((target(x)))
+#endif
+
+static int16_t _audio_mix_saturate(float v)
+{
+    long r = std::lrint(v);
+    r = r < INT16_MIN ? INT16_MIN : r;
+    r = r > INT16_MAX ? INT16_MAX : r;
+    return (int16_t)r;
+}
+
+/**
+ * @brief Mix frames from \p first to \p frames. Gains are calculated from the
+ * first frame of the ramp, so a SIMD version finishing its tail here gets
+ * exactly the gains the scalar version does.
+ */
+static void _audio_mix_ramp_s16_range(int16_t *dst, const int16_t *a, const int16_t *b, size_t first, size_t frames,
+                                      int channels, float ga, float ga_step, float gb, float gb_step)
+{
+    for (size_t f = first; f < frames; f++)
+    {
+        float g1 = ga + (float)f * ga_step;
+        float g2 = gb + (float)f * gb_step;
+        for (int c = 0; c < channels; c++)
+        {
+            size_t i = f * channels + c;
+            dst[i] = _audio_mix_saturate((float)a[i] * g1 + (float)b[i] * g2);
+        }
+    }
+}
+
+void soundsphere::audio_mix_ramp_s16_scalar(int16_t *dst, const int16_t *a, const int16_t *b, size_t frames,
+                                            int channels, float ga, float ga_step, float gb, float gb_step)
+{
+    _audio_mix_ramp_s16_range(dst, a, b, 0, frames, channels, ga, ga_step, gb, gb_step);
+}
+
+#if defined(AUDIO_MIX_X86)
+
+/*
+ * SIMD versions keep the frame index of each lane as float, so gains are
+ * calculated the same way as the scalar version and the output is identical,
+ * tail included. Lanes only map to whole frames if channels divides the vector
+ * width, other layouts go scalar.
+ */
+
+AUDIO_MIX_TARGET("sse2")
+void soundsphere::audio_mix_ramp_s16_sse2(int16_t *dst, const int16_t *a, const int16_t *b, size_t frames,
+                                          int channels, float ga, float ga_step, float gb, float gb_step)
+{
+    const size_t samples = frames * channels;
+    size_t       i = 0;
+
+    if (8 % channels == 0)
+    {
+        float lane[8];
+        for (int k = 0; k < 8; k++)
+        {
+            lane[k] = (float)(k / channels);
+        }
+        __m128 f_lo = _mm_loadu_ps(lane);
+        __m128 f_hi = _mm_loadu_ps(lane + 4);
+        __m128 f_inc = _mm_set1_ps((float)(8 / channels));
+        __m128 va_g = _mm_set1_ps(ga), va_s = _mm_set1_ps(ga_step);
+        __m128 vb_g = _mm_set1_ps(gb), vb_s = _mm_set1_ps(gb_step);
+
+        for (; i + 8 <= samples; i += 8)
+        {
+            __m128i sa = _mm_loadu_si128((const __m128i *)(a + i));
+            __m128i sb = _mm_loadu_si128((const __m128i *)(b + i));
+
+            /* Sign extend to 32 bits. */
+            __m128 a_lo = _mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpacklo_epi16(sa, sa), 16));
+            __m128 a_hi = _mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpackhi_epi16(sa, sa), 16));
+            __m128 b_lo = _mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpacklo_epi16(sb, sb), 16));
+            __m128 b_hi = _mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpackhi_epi16(sb, sb), 16));
+
+            __m128 ga_lo = _mm_add_ps(va_g, _mm_mul_ps(f_lo, va_s));
+            __m128 ga_hi = _mm_add_ps(va_g, _mm_mul_ps(f_hi, va_s));
+            __m128 gb_lo = _mm_add_ps(vb_g, _mm_mul_ps(f_lo, vb_s));
+            __m128 gb_hi = _mm_add_ps(vb_g, _mm_mul_ps(f_hi, vb_s));
+
+            __m128 lo = _mm_add_ps(_mm_mul_ps(a_lo, ga_lo), _mm_mul_ps(b_lo, gb_lo));
+            __m128 hi = _mm_add_ps(_mm_mul_ps(a_hi, ga_hi), _mm_mul_ps(b_hi, gb_hi));
+
+            /* Round to nearest, then pack with saturation. */
+            __m128i r = _mm_packs_epi32(_mm_cvtps_epi32(lo), _mm_cvtps_epi32(hi));
+            _mm_storeu_si128((__m128i *)(dst + i), r);
+
+            f_lo = _mm_add_ps(f_lo, f_inc);
+            f_hi = _mm_add_ps(f_hi, f_inc);
+        }
+    }
+
+    _audio_mix_ramp_s16_range(dst, a, b, i / channels, frames, channels, ga, ga_step, gb, gb_step);
+}
+
+AUDIO_MIX_TARGET("avx2")
+void soundsphere::audio_mix_ramp_s16_avx2(int16_t *dst, const int16_t *a, const int16_t *b, size_t frames,
+                                          int channels, float ga, float ga_step, float gb, float gb_step)
+{
+    const size_t samples = frames * channels;
+    size_t       i = 0;
+
+    if (16 % channels == 0)
+    {
+        float lane[16];
+        for (int k = 0; k < 16; k++)
+        {
+            lane[k] = (float)(k / channels);
+        }
+        __m256 f_lo = _mm256_loadu_ps(lane);
+        __m256 f_hi = _mm256_loadu_ps(lane + 8);
+        __m256 f_inc = _mm256_set1_ps((float)(16 / channels));
+        __m256 va_g = _mm256_set1_ps(ga), va_s = _mm256_set1_ps(ga_step);
+        __m256 vb_g = _mm256_set1_ps(gb), vb_s = _mm256_set1_ps(gb_step);
+
+        for (; i + 16 <= samples; i += 16)
+        {
+            __m256 a_lo = _mm256_cvtepi32_ps(_mm256_cvtepi16_epi32(_mm_loadu_si128((const __m128i *)(a + i))));
+            __m256 a_hi = _mm256_cvtepi32_ps(_mm256_cvtepi16_epi32(_mm_loadu_si128((const __m128i *)(a + i + 8))));
+            __m256 b_lo = _mm256_cvtepi32_ps(_mm256_cvtepi16_epi32(_mm_loadu_si128((const __m128i *)(b + i))));
+            __m256 b_hi = _mm256_cvtepi32_ps(_mm256_cvtepi16_epi32(_mm_loadu_si128((const __m128i *)(b + i + 8))));
+
+            __m256 ga_lo = _mm256_add_ps(va_g, _mm256_mul_ps(f_lo, va_s));
+            __m256 ga_hi = _mm256_add_ps(va_g, _mm256_mul_ps(f_hi, va_s));
+            __m256 gb_lo = _mm256_add_ps(vb_g, _mm256_mul_ps(f_lo, vb_s));
+            __m256 gb_hi = _mm256_add_ps(vb_g, _mm256_mul_ps(f_hi, vb_s));
+
+            __m256 lo = _mm256_add_ps(_mm256_mul_ps(a_lo, ga_lo), _mm256_mul_ps(b_lo, gb_lo));
+            __m256 hi = _mm256_add_ps(_mm256_mul_ps(a_hi, ga_hi), _mm256_mul_ps(b_hi, gb_hi));
+
+            /* Pack works in 128-bit lanes, put the quarters back in order. */
+            __m256i r = _mm256_packs_epi32(_mm256_cvtps_epi32(lo), _mm256_cvtps_epi32(hi));
+            r = _mm256_permute4x64_epi64(r, _MM_SHUFFLE(3, 1, 2, 0));
+            _mm256_storeu_si256((__m256i *)(dst + i), r);
+
+            f_lo = _mm256_add_ps(f_lo, f_inc);
+            f_hi = _mm256_add_ps(f_hi, f_inc);
+        }
+    }
+
+    _audio_mix_ramp_s16_range(dst, a, b, i / channels, frames, channels, ga, ga_step, gb, gb_step);
+}
+
+#endif
+
+soundsphere::audio_mix_ramp_s16_fn soundsphere::audio_mix_ramp_s16(void)
+{
+    static const audio_mix_ramp_s16_fn fn = []() -> audio_mix_ramp_s16_fn {
+#if defined(AUDIO_MIX_X86)
+        if (SDL_HasAVX2())
+        {
+            return audio_mix_ramp_s16_avx2;
+        }
+        if (SDL_HasSSE2())
+        {
+            return audio_mix_ramp_s16_sse2;
+        }
+#endif
+        return audio_mix_ramp_s16_scalar;
+    }();
+    return fn;
+}
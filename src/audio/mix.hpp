@@ -0,0 +1,65 @@
+#ifndef SOUND_SPHERE_AUDIO_MIX_HPP
+#define SOUND_SPHERE_AUDIO_MIX_HPP
+
+#include <cstddef>
+#include <cstdint>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define AUDIO_MIX_X86 1
+#endif
+
+namespace soundsphere
+{
+
+/**
+ * @brief Mix two S16 streams with linear gain ramps, saturating the result.
+ *
+ * For frame i, dst = a * (ga + i * ga_step) + b * (gb + i * gb_step).
+ *
+ * @param[out] dst      Destination, may be the same as \p a or \p b.
+ * @param[in] a         First source.
+ * @param[in] b         Second source.
+ * @param[in] frames    Number of frames.
+ * @param[in] channels  Samples per frame.
+ * @param[in] ga        Gain of \p a at the first frame.
+ * @param[in] ga_step   Gain change of \p a per frame.
+ * @param[in] gb        Gain of \p b at the first frame.
+ * @param[in] gb_step   Gain change of \p b per frame.
+ */
+typedef void (*audio_mix_ramp_s16_fn)(int16_t *dst, const int16_t *a, const int16_t *b, size_t frames, int channels,
+                                      float ga, float ga_step, float gb, float gb_step);
+
+/**
+ * @brief Portable implementation of #audio_mix_ramp_s16_fn.
+ */
+void audio_mix_ramp_s16_scalar(int16_t *dst, const int16_t *a, const int16_t *b, size_t frames, int channels,
+                               float ga, float ga_step, float gb, float gb_step);
+
+#if defined(AUDIO_MIX_X86)
+
+/**
+ * @brief SSE2 implementation of #audio_mix_ramp_s16_fn.
+ * @warning Only call it if SDL_HasSSE2() is true.
+ */
+void audio_mix_ramp_s16_sse2(int16_t *dst, const int16_t *a, const int16_t *b, size_t frames, int channels,
+                             float ga, float ga_step, float gb, float gb_step);
+
+/**
+ * @brief AVX2 implementation of #audio_mix_ramp_s16_fn.
+ * @warning Only call it if SDL_HasAVX2() is true.
+ */
+void audio_mix_ramp_s16_avx2(int16_t *dst, const int16_t *a, const int16_t *b, size_t frames, int channels,
+                             float ga, float ga_step, float gb, float gb_step);
+
+#endif
+
+/**
+ * @brief The fastest implementation supported by CPU.
+ * @note MT-Safe.
+ * @return Function.
+ */
+audio_mix_ramp_s16_fn audio_mix_ramp_s16(void);
+
+} // namespace soundsphere
+
+#endif
@@ -0,0 +1,158 @@
+#include <algorithm>
+#include "peaks.hpp"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define AUDIO_PEAKS_SSE2 1
+#endif
+
+soundsphere::audio_peaks::audio_peaks()
+{
+    frames = 0;
+}
+
+/**
+ * @brief Lowest and highest of \p count samples.
+ */
+static void _audio_peaks_minmax(const int16_t *pcm, size_t count, int16_t &lo, int16_t &hi)
+{
+    size_t i = 0;
+    lo = INT16_MAX;
+    hi = INT16_MIN;
+
+#if defined(AUDIO_PEAKS_SSE2)
+    if (count >= 8)
+    {
+        __m128i vlo = _mm_set1_epi16(INT16_MAX);
+        __m128i vhi = _mm_set1_epi16(INT16_MIN);
+        for (; i + 8 <= count; i += 8)
+        {
+            __m128i v = _mm_loadu_si128((const __m128i *)(pcm + i));
+            vlo = _mm_min_epi16(vlo, v);
+            vhi = _mm_max_epi16(vhi, v);
+        }
+
+        /* Fold lanes in half until one is left. */
+        vlo = _mm_min_epi16(vlo, _mm_srli_si128(vlo, 8));
+        vhi = _mm_max_epi16(vhi, _mm_srli_si128(vhi, 8));
+        vlo = _mm_min_epi16(vlo, _mm_srli_si128(vlo, 4));
+        vhi = _mm_max_epi16(vhi, _mm_srli_si128(vhi, 4));
+        vlo = _mm_min_epi16(vlo, _mm_srli_si128(vlo, 2));
+        vhi = _mm_max_epi16(vhi, _mm_srli_si128(vhi, 2));
+        lo = (int16_t)_mm_extract_epi16(vlo, 0);
+        hi = (int16_t)_mm_extract_epi16(vhi, 0);
+    }
+#endif
+
+    for (; i < count; i++)
+    {
+        lo = std::min(lo, pcm[i]);
+        hi = std::max(hi, pcm[i]);
+    }
+}
+
+/**
+ * @brief Merge \p count peaks into one.
+ */
+static soundsphere::audio_peak_t _audio_peaks_merge(const soundsphere::audio_peak_t *peaks, size_t count)
+{
+    soundsphere::audio_peak_t ret = { INT8_MAX, INT8_MIN };
+    for (size_t i = 0; i < count; i++)
+    {
+        ret.min = std::min(ret.min, peaks[i].min);
+        ret.max = std::max(ret.max, peaks[i].max);
+    }
+    return ret;
+}
+
+void soundsphere::audio_peaks_compute(const int16_t *pcm, size_t frames, int channels, audio_peaks_t &peaks)
+{
+    peaks.frames = 0;
+    peaks.levels.clear();
+    audio_peaks_feed(peaks, pcm, frames, channels);
+    audio_peaks_finish(peaks);
+}
+
+void soundsphere::audio_peaks_feed(audio_peaks_t &peaks, const int16_t *pcm, size_t frames, int channels)
+{
+    if (frames == 0)
+    {
+        return;
+    }
+    if (peaks.levels.empty())
+    {
+        peaks.levels.resize(1);
+    }
+
+    /*
+     * Frames of all channels are contiguous, so a bucket is one run of samples.
+     * The last bucket of the block before may be partial, it is completed first.
+     */
+    AudioPeakVec &level = peaks.levels[0];
+    for (size_t pos = 0; pos < frames;)
+    {
+        size_t  fill = (size_t)(peaks.frames % AUDIO_PEAKS_BASE);
+        size_t  n = std::min<size_t>(frames - pos, AUDIO_PEAKS_BASE - fill);
+        int16_t lo = 0, hi = 0;
+        _audio_peaks_minmax(pcm + pos * channels, n * channels, lo, hi);
+
+        audio_peak_t peak = { (int8_t)(lo >> 8), (int8_t)(hi >> 8) };
+        if (fill == 0)
+        {
+            level.push_back(peak);
+        }
+        else
+        {
+            level.back().min = std::min(level.back().min, peak.min);
+            level.back().max = std::max(level.back().max, peak.max);
+        }
+        peaks.frames += n;
+        pos += n;
+    }
+}
+
+void soundsphere::audio_peaks_finish(audio_peaks_t &peaks)
+{
+    if (peaks.levels.empty())
+    {
+        return;
+    }
+
+    peaks.levels.resize(1);
+    while (peaks.levels.back().size() > AUDIO_PEAKS_MIN)
+    {
+        const AudioPeakVec &prev = peaks.levels.back();
+        AudioPeakVec        next((prev.size() + AUDIO_PEAKS_FACTOR - 1) / AUDIO_PEAKS_FACTOR);
+        for (size_t i = 0; i < next.size(); i++)
+        {
+            size_t beg = i * AUDIO_PEAKS_FACTOR;
+            next[i] = _audio_peaks_merge(&prev[beg], std::min<size_t>(prev.size() - beg, AUDIO_PEAKS_FACTOR));
+        }
+        peaks.levels.push_back(std::move(next));
+    }
+}
+
+void soundsphere::audio_peaks_columns(const audio_peaks_t &peaks, size_t width, AudioPeakVec &out)
+{
+    out.clear();
+    if (peaks.levels.empty() || width == 0)
+    {
+        return;
+    }
+
+    size_t idx = peaks.levels.size() - 1;
+    while (idx > 0 && peaks.levels[idx].size() < width)
+    {
+        idx--;
+    }
+
+    /* The finest level may still be narrower, then columns share peaks. */
+    const AudioPeakVec &level = peaks.levels[idx];
+    out.resize(width);
+    for (size_t x = 0; x < width; x++)
+    {
+        size_t beg = x * level.size() / width;
+        size_t end = std::max((x + 1) * level.size() / width, beg + 1);
+        out[x] = _audio_peaks_merge(&level[beg], end - beg);
+    }
+}
@@ -0,0 +1,95 @@
+#ifndef SOUND_SPHERE_AUDIO_PEAKS_HPP
+#define SOUND_SPHERE_AUDIO_PEAKS_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+/**
+ * @brief Frames summarized by one peak of the finest level.
+ */
+#define AUDIO_PEAKS_BASE 256
+
+/**
+ * @brief Peaks of a level summarized by one peak of the next level.
+ */
+#define AUDIO_PEAKS_FACTOR 4
+
+/**
+ * @brief No coarser level is built once a level has no more peaks than it.
+ */
+#define AUDIO_PEAKS_MIN 256
+
+namespace soundsphere
+{
+
+/**
+ * @brief Lowest and highest sample of a range of frames, over all channels,
+ * in 1/128 of full scale.
+ */
+typedef struct audio_peak
+{
+    int8_t min; /**< Lowest sample. */
+    int8_t max; /**< Highest sample. */
+} audio_peak_t;
+
+typedef std::vector<audio_peak_t> AudioPeakVec;
+
+/**
+ * @brief Waveform of a track at several resolutions.
+ */
+typedef struct audio_peaks
+{
+    audio_peaks();
+
+    /**
+     * @brief Frames summarized.
+     */
+    uint64_t frames;
+
+    /**
+     * @brief Level i has a peak every #AUDIO_PEAKS_BASE * #AUDIO_PEAKS_FACTOR^i frames.
+     */
+    std::vector<AudioPeakVec> levels;
+} audio_peaks_t;
+
+typedef std::shared_ptr<audio_peaks_t> AudioPeaksPtr;
+
+/**
+ * @brief Build all levels of interleaved S16 PCM.
+ * @param[in] pcm       PCM.
+ * @param[in] frames    Number of frames.
+ * @param[in] channels  Samples per frame.
+ * @param[out] peaks    Peaks.
+ */
+void audio_peaks_compute(const int16_t *pcm, size_t frames, int channels, audio_peaks_t &peaks);
+
+/**
+ * @brief Append interleaved S16 PCM to the finest level, for a track decoded
+ * block by block. Call audio_peaks_finish() after the last block.
+ * @param[in,out] peaks Peaks, empty for the first block.
+ * @param[in] pcm       PCM.
+ * @param[in] frames    Number of frames.
+ * @param[in] channels  Samples per frame.
+ */
+void audio_peaks_feed(audio_peaks_t &peaks, const int16_t *pcm, size_t frames, int channels);
+
+/**
+ * @brief Build coarser levels from the finest one.
+ * @param[in,out] peaks Peaks.
+ */
+void audio_peaks_finish(audio_peaks_t &peaks);
+
+/**
+ * @brief Summarize the whole waveform in \p width peaks, from the coarsest
+ * level that still has a peak for each.
+ * @param[in] peaks     Peaks.
+ * @param[in] width     Number of peaks wanted, usually in pixels.
+ * @param[out] out      Peaks, empty if \p peaks is.
+ */
+void audio_peaks_columns(const audio_peaks_t &peaks, size_t width, AudioPeakVec &out);
+
+} // namespace soundsphere
+
+#endif
@@ -0,0 +1,213 @@
+#include <ev.h>
+#include <cstdio>
+#include <cstring>
+#include "config/__init__.hpp"
+#include "utils/binary.hpp"
+#include "peaks_cache.hpp"
+
+/**
+ * @brief File magic, followed by a version.
+ */
+#define PEAKS_CACHE_MAGIC "SSPK"
+
+/**
+ * @brief Increase it whenever layout or meaning of peaks changes.
+ */
+#define PEAKS_CACHE_VERSION 1
+
+/*
+ * File layout, native byte order:
+ *
+ *   magic[4] version:u32 size:u64 mtime:u64 path_len:u32 path[path_len]
+ *   frames:u64 levels:u32 { count:u32 peaks[count] } * levels
+ */
+
+typedef struct peaks_cache_ctx
+{
+    peaks_cache_ctx();
+    ~peaks_cache_ctx();
+
+    /**
+     * @brief Cache directory.
+     */
+    std::string dir;
+
+    /**
+     * @brief Serializes writes, so files of the same track are not written together.
+     */
+    ev_mutex_t mutex;
+} peaks_cache_ctx_t;
+
+static peaks_cache_ctx_t *s_peaks_cache = nullptr;
+
+peaks_cache_ctx::peaks_cache_ctx()
+{
+    ev_mutex_init(&mutex, 0);
+}
+
+peaks_cache_ctx::~peaks_cache_ctx()
+{
+    ev_mutex_exit(&mutex);
+}
+
+static std::string _peaks_cache_path(const soundsphere::music_tags_t &music)
+{
+    char file[32];
+    snprintf(file, sizeof(file), "%016llx.bin", (unsigned long long)music.path_hash);
+    return s_peaks_cache->dir + "/" + file;
+}
+
+static bool _peaks_cache_stat(const std::string &path, uint64_t &size, uint64_t &mtime)
+{
+    ev_file_t file;
+    if (ev_file_open(nullptr, &file, nullptr, path.c_str(), EV_FS_O_RDONLY, 0, nullptr) != 0)
+    {
+        return false;
+    }
+
+    ev_fs_stat_t stat;
+    int          ret = ev_file_stat(&file, nullptr, &stat, nullptr);
+    ev_file_close(&file, nullptr);
+    if (ret != 0)
+    {
+        return false;
+    }
+
+    size = stat.st_size;
+    mtime = stat.st_mtim.tv_sec;
+    return true;
+}
+
+static void _peaks_cache_write(soundsphere::Bin &bin, const void *data, size_t size)
+{
+    const uint8_t *p = (const uint8_t *)data;
+    bin.insert(bin.end(), p, p + size);
+}
+
+/**
+ * @brief Read \p size bytes at \p pos, and move past them.
+ * @return false if there are not enough bytes.
+ */
+static bool _peaks_cache_read(const uint8_t *data, size_t total, size_t &pos, void *dst, size_t size)
+{
+    if (total - pos < size)
+    {
+        return false;
+    }
+    memcpy(dst, data + pos, size);
+    pos += size;
+    return true;
+}
+
+/**
+ * @brief Parse a cache file, checking it belongs to \p path in the given state.
+ */
+static soundsphere::AudioPeaksPtr _peaks_cache_parse(const uint8_t *data, size_t total, const std::string &path,
+                                                     uint64_t size, uint64_t mtime)
+{
+    size_t   pos = 0;
+    char     magic[4];
+    uint32_t version = 0, path_len = 0, levels = 0;
+    uint64_t f_size = 0, f_mtime = 0;
+    if (!_peaks_cache_read(data, total, pos, magic, sizeof(magic)) ||
+        memcmp(magic, PEAKS_CACHE_MAGIC, sizeof(magic)) != 0 ||
+        !_peaks_cache_read(data, total, pos, &version, sizeof(version)) || version != PEAKS_CACHE_VERSION ||
+        !_peaks_cache_read(data, total, pos, &f_size, sizeof(f_size)) || f_size != size ||
+        !_peaks_cache_read(data, total, pos, &f_mtime, sizeof(f_mtime)) || f_mtime != mtime ||
+        !_peaks_cache_read(data, total, pos, &path_len, sizeof(path_len)) || total - pos < path_len ||
+        path.compare(0, std::string::npos, (const char *)data + pos, path_len) != 0)
+    {
+        return nullptr;
+    }
+    pos += path_len;
+
+    soundsphere::AudioPeaksPtr peaks = std::make_shared<soundsphere::audio_peaks_t>();
+    if (!_peaks_cache_read(data, total, pos, &peaks->frames, sizeof(peaks->frames)) ||
+        !_peaks_cache_read(data, total, pos, &levels, sizeof(levels)))
+    {
+        return nullptr;
+    }
+    for (uint32_t i = 0; i < levels; i++)
+    {
+        uint32_t count = 0;
+        if (!_peaks_cache_read(data, total, pos, &count, sizeof(count)) ||
+            (total - pos) / sizeof(soundsphere::audio_peak_t) < count)
+        {
+            return nullptr;
+        }
+        soundsphere::AudioPeakVec level(count);
+        _peaks_cache_read(data, total, pos, level.data(), count * sizeof(soundsphere::audio_peak_t));
+        peaks->levels.push_back(std::move(level));
+    }
+
+    return peaks;
+}
+
+void soundsphere::peaks_cache_init(void)
+{
+    s_peaks_cache = new peaks_cache_ctx_t;
+    s_peaks_cache->dir = config_dir() + "/peaks";
+    ev_fs_mkdir(nullptr, nullptr, s_peaks_cache->dir.c_str(), EV_FS_S_IRWXU, nullptr);
+}
+
+void soundsphere::peaks_cache_exit(void)
+{
+    delete s_peaks_cache;
+    s_peaks_cache = nullptr;
+}
+
+soundsphere::AudioPeaksPtr soundsphere::peaks_cache_get(const music_tags_t &music)
+{
+    uint64_t size = 0, mtime = 0;
+    if (s_peaks_cache == nullptr || !_peaks_cache_stat(music.path, size, mtime))
+    {
+        return nullptr;
+    }
+
+    /* A file being written is cut short, and fails to parse. */
+    ev_fs_req_t req;
+    std::string path = _peaks_cache_path(music);
+    if (ev_fs_readfile(nullptr, &req, path.c_str(), nullptr) < 0)
+    {
+        return nullptr;
+    }
+
+    const ev_buf_t *buf = ev_fs_get_filecontent(&req);
+    AudioPeaksPtr   peaks = _peaks_cache_parse((const uint8_t *)buf->data, buf->size, music.path, size, mtime);
+    ev_fs_req_cleanup(&req);
+
+    return peaks;
+}
+
+void soundsphere::peaks_cache_put(const music_tags_t &music, const audio_peaks_t &peaks)
+{
+    uint64_t size = 0, mtime = 0;
+    if (s_peaks_cache == nullptr || !_peaks_cache_stat(music.path, size, mtime))
+    {
+        return;
+    }
+
+    Bin      bin;
+    uint32_t version = PEAKS_CACHE_VERSION;
+    uint32_t path_len = (uint32_t)music.path.size();
+    uint32_t levels = (uint32_t)peaks.levels.size();
+    _peaks_cache_write(bin, PEAKS_CACHE_MAGIC, 4);
+    _peaks_cache_write(bin, &version, sizeof(version));
+    _peaks_cache_write(bin, &size, sizeof(size));
+    _peaks_cache_write(bin, &mtime, sizeof(mtime));
+    _peaks_cache_write(bin, &path_len, sizeof(path_len));
+    _peaks_cache_write(bin, music.path.data(), path_len);
+    _peaks_cache_write(bin, &peaks.frames, sizeof(peaks.frames));
+    _peaks_cache_write(bin, &levels, sizeof(levels));
+    for (size_t i = 0; i < peaks.levels.size(); i++)
+    {
+        uint32_t count = (uint32_t)peaks.levels[i].size();
+        _peaks_cache_write(bin, &count, sizeof(count));
+        _peaks_cache_write(bin, peaks.levels[i].data(), count * sizeof(audio_peak_t));
+    }
+
+    std::string path = _peaks_cache_path(music);
+    ev_mutex_enter(&s_peaks_cache->mutex);
+    soundsphere::dump(path.c_str(), bin.data(), bin.size());
+    ev_mutex_leave(&s_peaks_cache->mutex);
+}
@@ -0,0 +1,45 @@
+#ifndef SOUND_SPHERE_AUDIO_PEAKS_CACHE_HPP
+#define SOUND_SPHERE_AUDIO_PEAKS_CACHE_HPP
+
+#include "utils/music_tag.hpp"
+#include "peaks.hpp"
+
+namespace soundsphere
+{
+
+/**
+ * @brief Initialize peak cache.
+ * The cache lives in `peaks` under the configuration directory, one binary
+ * file per track named after its path hash.
+ * @note Must be called after #config_init().
+ */
+void peaks_cache_init(void);
+
+/**
+ * @brief Cleanup.
+ */
+void peaks_cache_exit(void);
+
+/**
+ * @brief Get peaks of \p music.
+ *
+ * An entry is ignored if the file size or modification time changed, or it
+ * belongs to another path with the same hash.
+ *
+ * @note MT-Safe.
+ * @param[in] music     Music.
+ * @return Peaks, or nullptr if not found.
+ */
+AudioPeaksPtr peaks_cache_get(const music_tags_t &music);
+
+/**
+ * @brief Store peaks of \p music.
+ * @note MT-Safe.
+ * @param[in] music     Music.
+ * @param[in] peaks     Peaks.
+ */
+void peaks_cache_put(const music_tags_t &music, const audio_peaks_t &peaks);
+
+} // namespace soundsphere
+
+#endif
@@ -0,0 +1,297 @@
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <numeric>
+#include <SDL.h>
+#include "resample.hpp"
+
+#if defined(AUDIO_MIX_X86)
+#include <immintrin.h>
+#endif
+
+/*
+ * GCC and Clang only allow intrinsics of an instruction set in functions built
+ * for it. MSVC allows them everywhere.
+ */
+#if defined(_MSC_VER) && !defined(__clang__)
+#define AUDIO_RESAMPLE_TARGET(x)
+#else
+#define AUDIO_RESAMPLE_TARGET(x) __attribute__((target(x)))
+#endif
+
+/**
+ * @brief Filter design of a quality tier.
+ */
+typedef struct audio_resample_tier
+{
+    size_t taps;   /**< Taps when not downsampling. */
+    double cutoff; /**< Cutoff, relative to the lower Nyquist frequency. */
+    double beta;   /**< Kaiser window shape. */
+} audio_resample_tier_t;
+
+/*
+ * Cutoff is put half a transition band below Nyquist, so images fold back
+ * no higher than Nyquist itself.
+ */
+static const audio_resample_tier_t s_audio_resample_tiers[soundsphere::AUDIO_RESAMPLE_QUALITY_COUNT] = {
+    { 16,  0.80, 5.0  }, /* AUDIO_RESAMPLE_FAST */
+    { 32,  0.86, 7.0  }, /* AUDIO_RESAMPLE_MEDIUM */
+    { 64,  0.91, 9.0  }, /* AUDIO_RESAMPLE_HIGH */
+    { 128, 0.94, 12.0 }, /* AUDIO_RESAMPLE_BEST */
+};
+
+static const double s_audio_resample_pi = 3.14159265358979323846;
+
+float soundsphere::audio_resample_dot_scalar(const float *coef, const float *pcm, size_t taps)
+{
+    float acc = 0.0f;
+    for (size_t i = 0; i < taps; i++)
+    {
+        acc += coef[i] * pcm[i];
+    }
+    return acc;
+}
+
+#if defined(AUDIO_MIX_X86)
+
+AUDIO_RESAMPLE_TARGET("sse2")
+float soundsphere::audio_resample_dot_sse2(const float *coef, const float *pcm, size_t taps)
+{
+    /* Two accumulators, so adds of one wait less on the other. */
+    __m128 acc0 = _mm_setzero_ps();
+    __m128 acc1 = _mm_setzero_ps();
+    for (size_t i = 0; i < taps; i += 8)
+    {
+        acc0 = _mm_add_ps(acc0, _mm_mul_ps(_mm_loadu_ps(coef + i), _mm_loadu_ps(pcm + i)));
+        acc1 = _mm_add_ps(acc1, _mm_mul_ps(_mm_loadu_ps(coef + i + 4), _mm_loadu_ps(pcm + i + 4)));
+    }
+
+    __m128 acc = _mm_add_ps(acc0, acc1);
+    acc = _mm_add_ps(acc, _mm_movehl_ps(acc, acc));
+    acc = _mm_add_ss(acc, _mm_shuffle_ps(acc, acc, _MM_SHUFFLE(1, 1, 1, 1)));
+    return _mm_cvtss_f32(acc);
+}
+
+AUDIO_RESAMPLE_TARGET("avx2")
+float soundsphere::audio_resample_dot_avx2(const float *coef, const float *pcm, size_t taps)
+{
+    __m256 acc0 = _mm256_setzero_ps();
+    __m256 acc1 = _mm256_setzero_ps();
+    size_t i = 0;
+    for (; i + 16 <= taps; i += 16)
+    {
+        acc0 = _mm256_add_ps(acc0, _mm256_mul_ps(_mm256_loadu_ps(coef + i), _mm256_loadu_ps(pcm + i)));
+        acc1 = _mm256_add_ps(acc1, _mm256_mul_ps(_mm256_loadu_ps(coef + i + 8), _mm256_loadu_ps(pcm + i + 8)));
+    }
+    if (i < taps)
+    {
+        acc0 = _mm256_add_ps(acc0, _mm256_mul_ps(_mm256_loadu_ps(coef + i), _mm256_loadu_ps(pcm + i)));
+    }
+
+    __m256 sum = _mm256_add_ps(acc0, acc1);
+    __m128 acc = _mm_add_ps(_mm256_castps256_ps128(sum), _mm256_extractf128_ps(sum, 1));
+    acc = _mm_add_ps(acc, _mm_movehl_ps(acc, acc));
+    acc = _mm_add_ss(acc, _mm_shuffle_ps(acc, acc, _MM_SHUFFLE(1, 1, 1, 1)));
+    return _mm_cvtss_f32(acc);
+}
+
+#endif
+
+soundsphere::audio_resample_dot_fn soundsphere::audio_resample_dot(void)
+{
+    static const audio_resample_dot_fn fn = []() -> audio_resample_dot_fn {
+#if defined(AUDIO_MIX_X86)
+        if (SDL_HasAVX2())
+        {
+            return audio_resample_dot_avx2;
+        }
+        if (SDL_HasSSE2())
+        {
+            return audio_resample_dot_sse2;
+        }
+#endif
+        return audio_resample_dot_scalar;
+    }();
+    return fn;
+}
+
+/**
+ * @brief Modified Bessel function of the first kind, order zero.
+ */
+static double _audio_resample_bessel_i0(double x)
+{
+    double sum = 1.0, term = 1.0;
+    for (int k = 1; k < 64 && term > sum * 1e-17; k++)
+    {
+        double t = x / (2.0 * k);
+        term *= t * t;
+        sum += term;
+    }
+    return sum;
+}
+
+/**
+ * @brief Fill coefficients of every phase from a Kaiser windowed sinc.
+ */
+static void _audio_resample_design(soundsphere::audio_resampler_t &rs, const audio_resample_tier_t &tier)
+{
+    const double ratio = std::min(1.0, (double)rs.out_rate / (double)rs.in_rate);
+    const double cutoff = tier.cutoff * ratio;
+    const double half = (double)rs.taps / 2.0;
+    const double i0_beta = _audio_resample_bessel_i0(tier.beta);
+
+    rs.coef.assign((rs.phases + 1) * rs.taps, 0.0f);
+    for (size_t p = 0; p <= rs.phases; p++)
+    {
+        /* Tap j is input frame pos + j, which is this far before output time. */
+        std::vector<double> row(rs.taps);
+        double              sum = 0.0;
+        for (size_t j = 0; j < rs.taps; j++)
+        {
+            double d = half - 1.0 - (double)j + (double)p / (double)rs.phases;
+            double x = d / half;
+            double w = x * x < 1.0 ? _audio_resample_bessel_i0(tier.beta * std::sqrt(1.0 - x * x)) / i0_beta : 0.0;
+            double a = s_audio_resample_pi * cutoff * d;
+            double s = d == 0.0 ? 1.0 : std::sin(a) / a;
+            row[j] = cutoff * s * w;
+            sum += row[j];
+        }
+
+        /* Unity gain at DC for every phase, so no ripple at phase rate. */
+        for (size_t j = 0; j < rs.taps; j++)
+        {
+            rs.coef[p * rs.taps + j] = (float)(row[j] / sum);
+        }
+    }
+}
+
+soundsphere::audio_resampler::audio_resampler(int in_rate, int out_rate, int channels,
+                                              audio_resample_quality_t quality)
+{
+    const audio_resample_tier_t &tier = s_audio_resample_tiers[quality];
+    this->in_rate = in_rate;
+    this->out_rate = out_rate;
+    this->channels = channels;
+    dot = audio_resample_dot();
+
+    /* Downsampling narrows the filter, it takes more input taps for the same steepness. */
+    double ratio = std::min(1.0, (double)out_rate / (double)in_rate);
+    taps = (size_t)std::ceil((double)tier.taps / ratio);
+    taps = (taps + AUDIO_RESAMPLE_ALIGN - 1) / AUDIO_RESAMPLE_ALIGN * AUDIO_RESAMPLE_ALIGN;
+    taps = std::min<size_t>(taps, AUDIO_RESAMPLE_MAX_TAPS);
+
+    /* Output times fall on out_rate / gcd phases exactly, if not too many. */
+    phases = (size_t)(out_rate / std::gcd(in_rate, out_rate));
+    phases = std::min<size_t>(phases, AUDIO_RESAMPLE_MAX_PHASES);
+    _audio_resample_design(*this, tier);
+
+    cap = taps + AUDIO_RESAMPLE_BLOCK;
+    buf.resize(cap * (size_t)channels);
+    audio_resample_reset(*this);
+}
+
+size_t soundsphere::audio_resample_frames(const audio_resampler_t &rs, size_t frames)
+{
+    return (size_t)((uint64_t)frames * (uint64_t)rs.out_rate / (uint64_t)rs.in_rate) + 1;
+}
+
+/**
+ * @brief Append \p frames frames to input, zeros if \p pcm is nullptr.
+ */
+static void _audio_resample_feed(soundsphere::audio_resampler_t &rs, const int16_t *pcm, size_t frames)
+{
+    for (int c = 0; c < rs.channels; c++)
+    {
+        float *dst = rs.buf.data() + (size_t)c * rs.cap + rs.fill;
+        for (size_t f = 0; f < frames; f++)
+        {
+            dst[f] = pcm != nullptr ? (float)pcm[f * rs.channels + c] : 0.0f;
+        }
+    }
+    rs.fill += frames;
+}
+
+static int16_t _audio_resample_saturate(float v)
+{
+    long r = std::lrint(v);
+    r = r < INT16_MIN ? INT16_MIN : r;
+    r = r > INT16_MAX ? INT16_MAX : r;
+    return (int16_t)r;
+}
+
+/**
+ * @brief Produce every output frame whose taps are in input.
+ */
+static size_t _audio_resample_run(soundsphere::audio_resampler_t &rs, int16_t *out)
+{
+    size_t n = 0;
+    for (; rs.pos + rs.taps <= rs.fill; n++)
+    {
+        size_t       phase = (size_t)((rs.frac * rs.phases + (uint64_t)rs.out_rate / 2) / (uint64_t)rs.out_rate);
+        const float *coef = rs.coef.data() + phase * rs.taps;
+        for (int c = 0; c < rs.channels; c++)
+        {
+            const float *pcm = rs.buf.data() + (size_t)c * rs.cap + rs.pos;
+            out[n * rs.channels + c] = _audio_resample_saturate(rs.dot(coef, pcm, rs.taps));
+        }
+
+        rs.frac += (uint64_t)rs.in_rate;
+        rs.pos += (size_t)(rs.frac / (uint64_t)rs.out_rate);
+        rs.frac %= (uint64_t)rs.out_rate;
+    }
+    return n;
+}
+
+/**
+ * @brief Drop input before #audio_resampler::pos, so there is room for a block.
+ *
+ * Filter is longer than one output step even when downsampling, so
+ * #audio_resampler::pos never passes #audio_resampler::fill.
+ */
+static void _audio_resample_compact(soundsphere::audio_resampler_t &rs)
+{
+    size_t keep = rs.fill - rs.pos;
+    for (int c = 0; c < rs.channels && rs.pos != 0; c++)
+    {
+        float *ch = rs.buf.data() + (size_t)c * rs.cap;
+        memmove(ch, ch + rs.pos, keep * sizeof(float));
+    }
+    rs.fill = keep;
+    rs.pos = 0;
+}
+
+size_t soundsphere::audio_resample_process(audio_resampler_t &rs, const int16_t *pcm, size_t frames, int16_t *out)
+{
+    size_t produced = 0;
+    while (frames > 0)
+    {
+        _audio_resample_compact(rs);
+        size_t n = std::min(frames, rs.cap - rs.fill);
+        _audio_resample_feed(rs, pcm, n);
+        pcm += n * rs.channels;
+        frames -= n;
+
+        produced += _audio_resample_run(rs, out + produced * rs.channels);
+    }
+    return produced;
+}
+
+size_t soundsphere::audio_resample_flush(audio_resampler_t &rs, int16_t *out)
+{
+    /* Half the filter of zeros after the last frame centers a phase on it. */
+    _audio_resample_compact(rs);
+    _audio_resample_feed(rs, nullptr, rs.taps / 2);
+    size_t produced = _audio_resample_run(rs, out);
+
+    audio_resample_reset(rs);
+    return produced;
+}
+
+void soundsphere::audio_resample_reset(audio_resampler_t &rs)
+{
+    /* Half the filter of zeros before the first frame centers a phase on it. */
+    std::fill(rs.buf.begin(), rs.buf.end(), 0.0f);
+    rs.fill = rs.taps / 2 - 1;
+    rs.pos = 0;
+    rs.frac = 0;
+}
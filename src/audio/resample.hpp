@@ -0,0 +1,156 @@
+#ifndef SOUND_SPHERE_AUDIO_RESAMPLE_HPP
+#define SOUND_SPHERE_AUDIO_RESAMPLE_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "mix.hpp"
+
+/**
+ * @brief Taps of every filter phase are a multiple of it, so SIMD needs no tail.
+ */
+#define AUDIO_RESAMPLE_ALIGN 8
+
+/**
+ * @brief Most filter phases. Ratios that need more are rounded to the nearest phase.
+ */
+#define AUDIO_RESAMPLE_MAX_PHASES 1024
+
+/**
+ * @brief Most taps of a phase, reached when downsampling by a large factor.
+ */
+#define AUDIO_RESAMPLE_MAX_TAPS 1024
+
+/**
+ * @brief Input frames converted to float at a time.
+ */
+#define AUDIO_RESAMPLE_BLOCK 1024
+
+namespace soundsphere
+{
+
+/**
+ * @brief Quality tiers, from the cheapest to the most accurate.
+ */
+typedef enum audio_resample_quality
+{
+    AUDIO_RESAMPLE_FAST,   /**< 16 taps, about 55 dB stopband. */
+    AUDIO_RESAMPLE_MEDIUM, /**< 32 taps, about 70 dB stopband. */
+    AUDIO_RESAMPLE_HIGH,   /**< 64 taps, about 90 dB stopband. */
+    AUDIO_RESAMPLE_BEST,   /**< 128 taps, about 115 dB stopband. */
+    AUDIO_RESAMPLE_QUALITY_COUNT,
+} audio_resample_quality_t;
+
+/**
+ * @brief Dot product of one filter phase and input.
+ * @param[in] coef  Coefficients.
+ * @param[in] pcm   Input samples.
+ * @param[in] taps  Number of taps, a multiple of #AUDIO_RESAMPLE_ALIGN.
+ * @return Output sample.
+ */
+typedef float (*audio_resample_dot_fn)(const float *coef, const float *pcm, size_t taps);
+
+/**
+ * @brief Portable implementation of #audio_resample_dot_fn.
+ */
+float audio_resample_dot_scalar(const float *coef, const float *pcm, size_t taps);
+
+#if defined(AUDIO_MIX_X86)
+
+/**
+ * @brief SSE2 implementation of #audio_resample_dot_fn.
+ * @warning Only call it if SDL_HasSSE2() is true.
+ */
+float audio_resample_dot_sse2(const float *coef, const float *pcm, size_t taps);
+
+/**
+ * @brief AVX2 implementation of #audio_resample_dot_fn.
+ * @warning Only call it if SDL_HasAVX2() is true.
+ */
+float audio_resample_dot_avx2(const float *coef, const float *pcm, size_t taps);
+
+#endif
+
+/**
+ * @brief The fastest implementation supported by CPU.
+ * @note MT-Safe.
+ * @return Function.
+ */
+audio_resample_dot_fn audio_resample_dot(void);
+
+/**
+ * @brief Polyphase windowed-sinc resampler of interleaved S16 PCM.
+ *
+ * Output frame k is taken at input time k * in_rate / out_rate, with the
+ * filter centered on it, so output is not delayed against input.
+ */
+typedef struct audio_resampler
+{
+    /**
+     * @param[in] in_rate   Input sample rate.
+     * @param[in] out_rate  Output sample rate.
+     * @param[in] channels  Samples per frame.
+     * @param[in] quality   Quality tier.
+     */
+    audio_resampler(int in_rate, int out_rate, int channels, audio_resample_quality_t quality);
+
+    int in_rate;  /**< Input sample rate. */
+    int out_rate; /**< Output sample rate. */
+    int channels; /**< Samples per frame. */
+
+    size_t                taps;   /**< Taps of a phase. */
+    size_t                phases; /**< Phases between two input frames. */
+    audio_resample_dot_fn dot;    /**< Filter kernel. */
+
+    /**
+     * @brief #audio_resampler::phases + 1 rows of #audio_resampler::taps
+     * coefficients, the last row is the first one shifted by a frame.
+     */
+    std::vector<float> coef;
+
+    /*
+     * Input of each channel as float, #audio_resampler::cap frames apart.
+     */
+
+    std::vector<float> buf;  /**< Input. */
+    size_t             cap;  /**< Capacity of a channel, in frames. */
+    size_t             fill; /**< Frames in #audio_resampler::buf. */
+    size_t             pos;  /**< First frame of the next output. */
+    uint64_t           frac; /**< Time of the next output after #audio_resampler::pos, in 1/out_rate. */
+} audio_resampler_t;
+
+/**
+ * @brief Most output frames produced from \p frames input frames.
+ * @param[in] rs        Resampler.
+ * @param[in] frames    Input frames.
+ * @return Output frames.
+ */
+size_t audio_resample_frames(const audio_resampler_t &rs, size_t frames);
+
+/**
+ * @brief Resample a piece of stream.
+ * @param[in] rs        Resampler.
+ * @param[in] pcm       Input.
+ * @param[in] frames    Input frames.
+ * @param[out] out      Output, room for audio_resample_frames() frames.
+ * @return Output frames.
+ */
+size_t audio_resample_process(audio_resampler_t &rs, const int16_t *pcm, size_t frames, int16_t *out);
+
+/**
+ * @brief Produce output up to the end of input, and start over.
+ * @param[in] rs        Resampler.
+ * @param[out] out      Output, room for audio_resample_frames() of #audio_resampler::taps frames.
+ * @return Output frames.
+ */
+size_t audio_resample_flush(audio_resampler_t &rs, int16_t *out);
+
+/**
+ * @brief Forget input, so a new stream can be resampled.
+ * @param[in] rs        Resampler.
+ */
+void audio_resample_reset(audio_resampler_t &rs);
+
+} // namespace soundsphere
+
+#endif
@@ -0,0 +1,223 @@
+#include <ev.h>
+#include <cstdio>
+#include <cstring>
+#include "config/__init__.hpp"
+#include "utils/binary.hpp"
+#include "seek_index_cache.hpp"
+
+/**
+ * @brief File magic, followed by a version.
+ */
+#define SEEK_INDEX_CACHE_MAGIC "SSSI"
+
+/**
+ * @brief Increase it whenever layout or meaning of points changes, like
+ * dr_mp3 counting frames from another start.
+ */
+#define SEEK_INDEX_CACHE_VERSION 1
+
+/*
+ * File layout, native byte order:
+ *
+ *   magic[4] version:u32 size:u64 mtime:u64 path_len:u32 path[path_len]
+ *   type:u32 count:u32 { frame:u64 offset:u64 skip:u16 length:u16 } * count
+ */
+
+/**
+ * @brief Bytes of a point in file.
+ */
+#define SEEK_INDEX_CACHE_POINT_SIZE 20
+
+typedef struct seek_index_cache_ctx
+{
+    seek_index_cache_ctx();
+    ~seek_index_cache_ctx();
+
+    /**
+     * @brief Cache directory.
+     */
+    std::string dir;
+
+    /**
+     * @brief Serializes writes, so files of the same track are not written together.
+     */
+    ev_mutex_t mutex;
+} seek_index_cache_ctx_t;
+
+static seek_index_cache_ctx_t *s_seek_index_cache = nullptr;
+
+seek_index_cache_ctx::seek_index_cache_ctx()
+{
+    ev_mutex_init(&mutex, 0);
+}
+
+seek_index_cache_ctx::~seek_index_cache_ctx()
+{
+    ev_mutex_exit(&mutex);
+}
+
+static std::string _seek_index_cache_path(const soundsphere::music_tags_t &music)
+{
+    char file[32];
+    snprintf(file, sizeof(file), "%016llx.bin", (unsigned long long)music.path_hash);
+    return s_seek_index_cache->dir + "/" + file;
+}
+
+static bool _seek_index_cache_stat(const std::string &path, uint64_t &size, uint64_t &mtime)
+{
+    ev_file_t file;
+    if (ev_file_open(nullptr, &file, nullptr, path.c_str(), EV_FS_O_RDONLY, 0, nullptr) != 0)
+    {
+        return false;
+    }
+
+    ev_fs_stat_t stat;
+    int          ret = ev_file_stat(&file, nullptr, &stat, nullptr);
+    ev_file_close(&file, nullptr);
+    if (ret != 0)
+    {
+        return false;
+    }
+
+    size = stat.st_size;
+    mtime = stat.st_mtim.tv_sec;
+    return true;
+}
+
+static void _seek_index_cache_write(soundsphere::Bin &bin, const void *data, size_t size)
+{
+    const uint8_t *p = (const uint8_t *)data;
+    bin.insert(bin.end(), p, p + size);
+}
+
+/**
+ * @brief Read \p size bytes at \p pos, and move past them.
+ * @return false if there are not enough bytes.
+ */
+static bool _seek_index_cache_read(const uint8_t *data, size_t total, size_t &pos, void *dst, size_t size)
+{
+    if (total - pos < size)
+    {
+        return false;
+    }
+    memcpy(dst, data + pos, size);
+    pos += size;
+    return true;
+}
+
+/**
+ * @brief Parse a cache file, checking it belongs to \p path in the given state.
+ */
+static soundsphere::AudioSeekIndexPtr _seek_index_cache_parse(const uint8_t *data, size_t total,
+                                                              const std::string &path, uint64_t size, uint64_t mtime)
+{
+    size_t   pos = 0;
+    char     magic[4];
+    uint32_t version = 0, path_len = 0, type = 0, count = 0;
+    uint64_t f_size = 0, f_mtime = 0;
+    if (!_seek_index_cache_read(data, total, pos, magic, sizeof(magic)) ||
+        memcmp(magic, SEEK_INDEX_CACHE_MAGIC, sizeof(magic)) != 0 ||
+        !_seek_index_cache_read(data, total, pos, &version, sizeof(version)) || version != SEEK_INDEX_CACHE_VERSION ||
+        !_seek_index_cache_read(data, total, pos, &f_size, sizeof(f_size)) || f_size != size ||
+        !_seek_index_cache_read(data, total, pos, &f_mtime, sizeof(f_mtime)) || f_mtime != mtime ||
+        !_seek_index_cache_read(data, total, pos, &path_len, sizeof(path_len)) || total - pos < path_len ||
+        path.compare(0, std::string::npos, (const char *)data + pos, path_len) != 0)
+    {
+        return nullptr;
+    }
+    pos += path_len;
+
+    if (!_seek_index_cache_read(data, total, pos, &type, sizeof(type)) ||
+        !_seek_index_cache_read(data, total, pos, &count, sizeof(count)) ||
+        (total - pos) / SEEK_INDEX_CACHE_POINT_SIZE < count)
+    {
+        return nullptr;
+    }
+
+    std::shared_ptr<soundsphere::audio_seek_index_t> index = std::make_shared<soundsphere::audio_seek_index_t>();
+    index->type = (soundsphere::music_type_t)type;
+    index->points.resize(count);
+    for (uint32_t i = 0; i < count; i++)
+    {
+        soundsphere::audio_seek_point_t &point = index->points[i];
+        _seek_index_cache_read(data, total, pos, &point.frame, sizeof(point.frame));
+        _seek_index_cache_read(data, total, pos, &point.offset, sizeof(point.offset));
+        _seek_index_cache_read(data, total, pos, &point.skip, sizeof(point.skip));
+        _seek_index_cache_read(data, total, pos, &point.length, sizeof(point.length));
+    }
+
+    return index;
+}
+
+void soundsphere::seek_index_cache_init(void)
+{
+    s_seek_index_cache = new seek_index_cache_ctx_t;
+    s_seek_index_cache->dir = config_dir() + "/seek";
+    ev_fs_mkdir(nullptr, nullptr, s_seek_index_cache->dir.c_str(), EV_FS_S_IRWXU, nullptr);
+}
+
+void soundsphere::seek_index_cache_exit(void)
+{
+    delete s_seek_index_cache;
+    s_seek_index_cache = nullptr;
+}
+
+soundsphere::AudioSeekIndexPtr soundsphere::seek_index_cache_get(const music_tags_t &music)
+{
+    uint64_t size = 0, mtime = 0;
+    if (s_seek_index_cache == nullptr || !_seek_index_cache_stat(music.path, size, mtime))
+    {
+        return nullptr;
+    }
+
+    /* A file being written is cut short, and fails to parse. */
+    ev_fs_req_t req;
+    std::string path = _seek_index_cache_path(music);
+    if (ev_fs_readfile(nullptr, &req, path.c_str(), nullptr) < 0)
+    {
+        return nullptr;
+    }
+
+    const ev_buf_t   *buf = ev_fs_get_filecontent(&req);
+    AudioSeekIndexPtr index =
+        _seek_index_cache_parse((const uint8_t *)buf->data, buf->size, music.path, size, mtime);
+    ev_fs_req_cleanup(&req);
+
+    return index;
+}
+
+void soundsphere::seek_index_cache_put(const music_tags_t &music, const audio_seek_index_t &index)
+{
+    uint64_t size = 0, mtime = 0;
+    if (s_seek_index_cache == nullptr || !_seek_index_cache_stat(music.path, size, mtime))
+    {
+        return;
+    }
+
+    Bin      bin;
+    uint32_t version = SEEK_INDEX_CACHE_VERSION;
+    uint32_t path_len = (uint32_t)music.path.size();
+    uint32_t type = (uint32_t)index.type;
+    uint32_t count = (uint32_t)index.points.size();
+    _seek_index_cache_write(bin, SEEK_INDEX_CACHE_MAGIC, 4);
+    _seek_index_cache_write(bin, &version, sizeof(version));
+    _seek_index_cache_write(bin, &size, sizeof(size));
+    _seek_index_cache_write(bin, &mtime, sizeof(mtime));
+    _seek_index_cache_write(bin, &path_len, sizeof(path_len));
+    _seek_index_cache_write(bin, music.path.data(), path_len);
+    _seek_index_cache_write(bin, &type, sizeof(type));
+    _seek_index_cache_write(bin, &count, sizeof(count));
+    for (size_t i = 0; i < index.points.size(); i++)
+    {
+        const audio_seek_point_t &point = index.points[i];
+        _seek_index_cache_write(bin, &point.frame, sizeof(point.frame));
+        _seek_index_cache_write(bin, &point.offset, sizeof(point.offset));
+        _seek_index_cache_write(bin, &point.skip, sizeof(point.skip));
+        _seek_index_cache_write(bin, &point.length, sizeof(point.length));
+    }
+
+    std::string path = _seek_index_cache_path(music);
+    ev_mutex_enter(&s_seek_index_cache->mutex);
+    soundsphere::dump(path.c_str(), bin.data(), bin.size());
+    ev_mutex_leave(&s_seek_index_cache->mutex);
+}
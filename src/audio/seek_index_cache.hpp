@@ -0,0 +1,45 @@
+#ifndef SOUND_SPHERE_AUDIO_SEEK_INDEX_CACHE_HPP
+#define SOUND_SPHERE_AUDIO_SEEK_INDEX_CACHE_HPP
+
+#include "utils/music_tag.hpp"
+#include "decoder.hpp"
+
+namespace soundsphere
+{
+
+/**
+ * @brief Initialize seek index cache.
+ * The cache lives in `seek` under the configuration directory, one binary
+ * file per track named after its path hash.
+ * @note Must be called after #config_init().
+ */
+void seek_index_cache_init(void);
+
+/**
+ * @brief Cleanup.
+ */
+void seek_index_cache_exit(void);
+
+/**
+ * @brief Get seek index of \p music.
+ *
+ * An entry is ignored if the file size or modification time changed, or it
+ * belongs to another path with the same hash.
+ *
+ * @note MT-Safe.
+ * @param[in] music     Music.
+ * @return Index, or nullptr if not found.
+ */
+AudioSeekIndexPtr seek_index_cache_get(const music_tags_t &music);
+
+/**
+ * @brief Store seek index of \p music.
+ * @note MT-Safe.
+ * @param[in] music     Music.
+ * @param[in] index     Index.
+ */
+void seek_index_cache_put(const music_tags_t &music, const audio_seek_index_t &index);
+
+} // namespace soundsphere
+
+#endif
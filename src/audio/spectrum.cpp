@@ -0,0 +1,186 @@
+#include <algorithm>
+#include <cmath>
+#include "spectrum.hpp"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define AUDIO_SPECTRUM_SSE2 1
+#endif
+
+/**
+ * @brief Frequency range of bands, in Hz.
+ * @{
+ */
+#define AUDIO_SPECTRUM_LOW  40.0
+#define AUDIO_SPECTRUM_HIGH 16000.0
+/**
+ * @}
+ */
+
+/**
+ * @brief Level reported for silence, in dBFS.
+ */
+#define AUDIO_SPECTRUM_FLOOR (-120.0f)
+
+static const double s_audio_pi = 3.14159265358979323846;
+
+soundsphere::audio_fft::audio_fft(size_t size)
+{
+    this->size = size;
+    bitrev.resize(size);
+    tw_re.resize(size);
+    tw_im.resize(size);
+
+    size_t bits = 0;
+    while (((size_t)1 << bits) < size)
+    {
+        bits++;
+    }
+    for (size_t i = 0; i < size; i++)
+    {
+        size_t r = 0;
+        for (size_t b = 0; b < bits; b++)
+        {
+            r |= ((i >> b) & 1) << (bits - 1 - b);
+        }
+        bitrev[i] = r;
+    }
+
+    for (size_t h = 1; h < size; h <<= 1)
+    {
+        for (size_t j = 0; j < h; j++)
+        {
+            double angle = -s_audio_pi * (double)j / (double)h;
+            tw_re[h + j] = (float)std::cos(angle);
+            tw_im[h + j] = (float)std::sin(angle);
+        }
+    }
+}
+
+/**
+ * @brief Butterflies of one stage, \p h is the span of butterfly.
+ */
+static void _audio_fft_stage_scalar(const soundsphere::audio_fft_t &fft, float *re, float *im, size_t h)
+{
+    const float *wr = fft.tw_re.data() + h;
+    const float *wi = fft.tw_im.data() + h;
+    for (size_t i = 0; i < fft.size; i += 2 * h)
+    {
+        for (size_t k = 0; k < h; k++)
+        {
+            size_t a = i + k, b = a + h;
+            float  vr = re[b] * wr[k] - im[b] * wi[k];
+            float  vi = re[b] * wi[k] + im[b] * wr[k];
+            re[b] = re[a] - vr;
+            im[b] = im[a] - vi;
+            re[a] += vr;
+            im[a] += vi;
+        }
+    }
+}
+
+#if defined(AUDIO_SPECTRUM_SSE2)
+
+/**
+ * @brief Butterflies of one stage, four at a time. \p h must be a multiple of 4.
+ */
+static void _audio_fft_stage_sse2(const soundsphere::audio_fft_t &fft, float *re, float *im, size_t h)
+{
+    const float *tw_re = fft.tw_re.data() + h;
+    const float *tw_im = fft.tw_im.data() + h;
+    for (size_t i = 0; i < fft.size; i += 2 * h)
+    {
+        for (size_t k = 0; k < h; k += 4)
+        {
+            size_t a = i + k, b = a + h;
+            __m128 wr = _mm_loadu_ps(tw_re + k);
+            __m128 wi = _mm_loadu_ps(tw_im + k);
+            __m128 ar = _mm_loadu_ps(re + a);
+            __m128 ai = _mm_loadu_ps(im + a);
+            __m128 br = _mm_loadu_ps(re + b);
+            __m128 bi = _mm_loadu_ps(im + b);
+            __m128 vr = _mm_sub_ps(_mm_mul_ps(br, wr), _mm_mul_ps(bi, wi));
+            __m128 vi = _mm_add_ps(_mm_mul_ps(br, wi), _mm_mul_ps(bi, wr));
+            _mm_storeu_ps(re + a, _mm_add_ps(ar, vr));
+            _mm_storeu_ps(im + a, _mm_add_ps(ai, vi));
+            _mm_storeu_ps(re + b, _mm_sub_ps(ar, vr));
+            _mm_storeu_ps(im + b, _mm_sub_ps(ai, vi));
+        }
+    }
+}
+
+#endif
+
+void soundsphere::audio_fft_forward(const audio_fft_t &fft, float *re, float *im)
+{
+    for (size_t i = 0; i < fft.size; i++)
+    {
+        size_t r = fft.bitrev[i];
+        if (i < r)
+        {
+            std::swap(re[i], re[r]);
+            std::swap(im[i], im[r]);
+        }
+    }
+
+    for (size_t h = 1; h < fft.size; h <<= 1)
+    {
+#if defined(AUDIO_SPECTRUM_SSE2)
+        if (h >= 4)
+        {
+            _audio_fft_stage_sse2(fft, re, im, h);
+            continue;
+        }
+#endif
+        _audio_fft_stage_scalar(fft, re, im, h);
+    }
+}
+
+soundsphere::audio_spectrum::audio_spectrum(size_t size) : fft(size)
+{
+    window.resize(size);
+    re.resize(size);
+    im.resize(size);
+    for (size_t i = 0; i < size; i++)
+    {
+        window[i] = (float)(0.5 - 0.5 * std::cos(2.0 * s_audio_pi * (double)i / (double)size));
+    }
+}
+
+void soundsphere::audio_spectrum_analyze(audio_spectrum_t &spectrum, const float *samples, int freq, float *bands,
+                                         size_t count)
+{
+    const size_t size = spectrum.fft.size;
+    for (size_t i = 0; i < size; i++)
+    {
+        spectrum.re[i] = samples[i] * spectrum.window[i];
+        spectrum.im[i] = 0.0f;
+    }
+    audio_fft_forward(spectrum.fft, spectrum.re.data(), spectrum.im.data());
+
+    /* A full scale sine peaks at size / 4 after Hann window, as half of it goes to the negative frequency. */
+    const double scale = 4.0 / (double)size;
+    const double bin_hz = (double)freq / (double)size;
+    const double high = std::min(AUDIO_SPECTRUM_HIGH, (double)freq / 2.0);
+    const double ratio = std::pow(high / AUDIO_SPECTRUM_LOW, 1.0 / (double)count);
+
+    double f_lo = AUDIO_SPECTRUM_LOW;
+    for (size_t b = 0; b < count; b++)
+    {
+        double f_hi = f_lo * ratio;
+        size_t k_beg = (size_t)(f_lo / bin_hz);
+        size_t k_end = std::max(k_beg + 1, (size_t)std::ceil(f_hi / bin_hz));
+        k_end = std::min(k_end, size / 2 + 1);
+
+        /* Peak of band, so a tone does not get quieter in wide bands. */
+        float power = 0.0f;
+        for (size_t k = k_beg; k < k_end; k++)
+        {
+            power = std::max(power, spectrum.re[k] * spectrum.re[k] + spectrum.im[k] * spectrum.im[k]);
+        }
+
+        double level = power > 0.0f ? 10.0 * std::log10((double)power * scale * scale) : AUDIO_SPECTRUM_FLOOR;
+        bands[b] = std::max((float)level, AUDIO_SPECTRUM_FLOOR);
+        f_lo = f_hi;
+    }
+}
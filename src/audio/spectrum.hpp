@@ -0,0 +1,70 @@
+#ifndef SOUND_SPHERE_AUDIO_SPECTRUM_HPP
+#define SOUND_SPHERE_AUDIO_SPECTRUM_HPP
+
+#include <cstddef>
+#include <vector>
+
+namespace soundsphere
+{
+
+/**
+ * @brief Tables of a complex radix-2 FFT.
+ */
+typedef struct audio_fft
+{
+    /**
+     * @brief Prepare tables.
+     * @param[in] size  Transform size, a power of two, at least 4.
+     */
+    audio_fft(size_t size);
+
+    size_t              size;   /**< Transform size. */
+    std::vector<size_t> bitrev; /**< Bit reversed index. */
+
+    /*
+     * Twiddles of stage with butterfly span h are at [h, 2h), so each stage
+     * reads them contiguously.
+     */
+
+    std::vector<float> tw_re; /**< Real part of twiddles. */
+    std::vector<float> tw_im; /**< Imaginary part of twiddles. */
+} audio_fft_t;
+
+/**
+ * @brief In-place forward FFT of split complex data.
+ * @param[in] fft       Tables.
+ * @param[in,out] re    Real part, #audio_fft::size elements.
+ * @param[in,out] im    Imaginary part, #audio_fft::size elements.
+ */
+void audio_fft_forward(const audio_fft_t &fft, float *re, float *im);
+
+/**
+ * @brief Spectrum analyzer state. Not MT-Safe, use one per thread.
+ */
+typedef struct audio_spectrum
+{
+    /**
+     * @brief Prepare analyzer.
+     * @param[in] size  Samples per analysis, a power of two, at least 4.
+     */
+    audio_spectrum(size_t size);
+
+    audio_fft_t        fft;    /**< FFT tables. */
+    std::vector<float> window; /**< Hann window. */
+    std::vector<float> re;     /**< FFT buffer, real part. */
+    std::vector<float> im;     /**< FFT buffer, imaginary part. */
+} audio_spectrum_t;
+
+/**
+ * @brief Level of log spaced bands from 40 Hz to 16 kHz, or Nyquist frequency if lower.
+ * @param[in] spectrum  Analyzer.
+ * @param[in] samples   Mono samples in [-1, 1], #audio_fft::size of them.
+ * @param[in] freq      Sample rate.
+ * @param[out] bands    Band levels in dBFS, a full scale sine reads 0.
+ * @param[in] count     Number of bands.
+ */
+void audio_spectrum_analyze(audio_spectrum_t &spectrum, const float *samples, int freq, float *bands, size_t count);
+
+} // namespace soundsphere
+
+#endif
@@ -0,0 +1,44 @@
+#include "utils/trace.hpp"
+#include "loudness_cache.hpp"
+#include "seek_index_cache.hpp"
+#include "track.hpp"
+
+soundsphere::audio_track::audio_track()
+{
+    decoder = nullptr;
+    freq = 0;
+    channels = 0;
+    frames = AUDIO_FRAMES_UNKNOWN;
+    duration = 0.0;
+    has_loudness = false;
+}
+
+soundsphere::audio_track::~audio_track()
+{
+    audio_decoder_close(decoder);
+    decoder = nullptr;
+}
+
+soundsphere::AudioTrackPtr soundsphere::audio_track_load(MusicTagPtr music, int freq, int channels)
+{
+    TRACE_ZONE("audio_track_load");
+
+    audio_decoder_t *decoder = audio_decoder_open(music->path, music->info.format, freq, channels);
+    if (decoder == nullptr)
+    {
+        return nullptr;
+    }
+
+    AudioTrackPtr track = std::make_shared<audio_track_t>();
+    track->music = music;
+    track->decoder = decoder;
+    track->freq = freq;
+    track->channels = channels;
+    track->frames = audio_decoder_frames(decoder);
+    track->duration = track->frames != AUDIO_FRAMES_UNKNOWN ? (double)track->frames / (double)freq
+                                                            : music->info.duration;
+    track->has_loudness = loudness_cache_get(*music, track->loudness, track->album_loudness);
+    track->seek_index = seek_index_cache_get(*music);
+
+    return track;
+}
@@ -0,0 +1,73 @@
+#ifndef SOUND_SPHERE_AUDIO_TRACK_HPP
+#define SOUND_SPHERE_AUDIO_TRACK_HPP
+
+#include <memory>
+#include <string>
+#include "utils/music_tag.hpp"
+#include "decoder.hpp"
+#include "loudness.hpp"
+
+namespace soundsphere
+{
+
+/**
+ * @brief Track to play in device format. Audio output decodes it a block at
+ * a time while playing.
+ */
+typedef struct audio_track
+{
+    audio_track();
+    ~audio_track();
+
+    /**
+     * @brief Source of the track.
+     */
+    MusicTagPtr music;
+
+    /**
+     * @brief Decoder opened while loading, at frame 0. Audio output takes it
+     * with its lock held, so the file is not opened again.
+     */
+    audio_decoder_t *decoder;
+
+    int freq;     /**< Sample rate it is decoded to, the device rate when loaded. */
+    int channels; /**< Channels it is decoded to, the device channels when loaded. */
+
+    uint64_t frames;   /**< Frames without encoder delay and padding, or #AUDIO_FRAMES_UNKNOWN. */
+    double   duration; /**< Duration in seconds, from tags if frames are unknown. */
+
+    /**
+     * @brief Seek index, or nullptr until built. Set by std::atomic_store(),
+     * audio output binds it to its decoders on the next seek.
+     */
+    AudioSeekIndexPtr seek_index;
+
+    bool             has_loudness;   /**< Whether loudness is known from loudness cache. */
+    audio_loudness_t loudness;       /**< Track loudness. */
+    audio_loudness_t album_loudness; /**< Album loudness. */
+
+    audio_track(const audio_track &orig) = delete;
+} audio_track_t;
+
+typedef std::shared_ptr<audio_track_t> AudioTrackPtr;
+
+/**
+ * @brief Open \p music for playback in device format, and read its length.
+ * Only headers are read, PCM is decoded by audio output while playing.
+ * It still opens the file, do not call in UI thread.
+ * Loudness and seek index are filled from their caches if built before.
+ *
+ * The device may be reopened in another format meanwhile, audio output
+ * drops the track then.
+ *
+ * @note MT-Safe.
+ * @param[in] music     Music to play.
+ * @param[in] freq      Device sample rate, from audio_spec() of the caller.
+ * @param[in] channels  Device channels, from audio_spec() of the caller.
+ * @return Track, or nullptr if failed.
+ */
+AudioTrackPtr audio_track_load(MusicTagPtr music, int freq, int channels);
+
+} // namespace soundsphere
+
+#endif
@@ -17,6 +17,22 @@ typedef std::function<void(void)> DrawFn;
  */
 typedef std::shared_ptr<void> Texture;
 
+/**
+ * @brief Decoded image.
+ */
+typedef struct backend_image
+{
+    backend_image();
+    ~backend_image();
+
+    unsigned char *pixels;   /**< Pixel data. */
+    int            width;    /**< Width in pixels. */
+    int            height;   /**< Height in pixels. */
+    int            channels; /**< Bytes per pixel. */
+} backend_image_t;
+
+typedef std::shared_ptr<backend_image_t> BackendImagePtr;
+
 /**
  * @brief Initialize backend.
  */
@@ -34,6 +50,23 @@ void backend_exit(void);
  */
 void backend_draw(DrawFn fn);
 
+/**
+ * @brief Decode image from memory.
+ * @note MT-Safe, so that images can be decoded in worker threads.
+ * @param[in] data  The image data.
+ * @param[in] size  The image size.
+ * @return  Decoded image, or nullptr if failed.
+ */
+BackendImagePtr backend_decode_image(const void *data, size_t size);
+
+/**
+ * @brief Upload decoded image as texture.
+ * @note This function must be called from UI thread.
+ * @param[in] image Decoded image.
+ * @return  The texture.
+ */
+Texture backend_create_texture(const BackendImagePtr &image);
+
 /**
  * @brief Load image from memory and return the texture that can be render
  *   directly.
@@ -0,0 +1,144 @@
+#include <ev.h>
+#include <SDL.h>
+#include <imgui.h>
+#include <spdlog/spdlog.h>
+#include <stb_image.h>
+#include "null.hpp"
+
+/**
+ * @brief Null platform and renderer.
+ *
+ * Nothing is shown and no GPU is required. ImGui still builds the full draw
+ * list each frame, so the cost of widgets can be measured on a headless box.
+ * Audio is routed to the SDL dummy driver unless `SDL_AUDIODRIVER` is set.
+ */
+typedef struct backend_null_ctx
+{
+    backend_null_ctx();
+
+    ImVec2 display_size;
+    size_t frames;
+} backend_null_ctx_t;
+
+static backend_null_ctx_t *s_null = nullptr;
+
+backend_null_ctx::backend_null_ctx()
+{
+    display_size = ImVec2(1280, 720);
+    frames = 1;
+}
+
+void soundsphere::backend_null_setup(float width, float height, size_t frames)
+{
+    s_null->display_size = ImVec2(width, height);
+    s_null->frames = frames;
+}
+
+void soundsphere::backend_init(void)
+{
+    s_null = new backend_null_ctx_t;
+
+    /* Environment variable takes precedence over hint. */
+    SDL_SetHint(SDL_HINT_AUDIODRIVER, "dummy");
+    if (SDL_Init(SDL_INIT_AUDIO | SDL_INIT_TIMER) != 0)
+    {
+        spdlog::error("Error: {}", SDL_GetError());
+        exit(EXIT_FAILURE);
+    }
+
+    IMGUI_CHECKVERSION();
+    ImGui::CreateContext();
+
+    ImGuiIO &io = ImGui::GetIO();
+    io.BackendPlatformName = "soundsphere_null";
+    io.BackendRendererName = "soundsphere_null";
+    io.DisplaySize = s_null->display_size;
+}
+
+void soundsphere::backend_exit(void)
+{
+    ImGui::DestroyContext();
+    SDL_Quit();
+
+    delete s_null;
+    s_null = nullptr;
+}
+
+void soundsphere::backend_draw(soundsphere::DrawFn fn)
+{
+    ImGuiIO &io = ImGui::GetIO();
+
+    /* Without renderer the font texture is never uploaded, but it must be built. */
+    if (!io.Fonts->IsBuilt())
+    {
+        io.Fonts->Build();
+    }
+
+    for (size_t i = 0; i < s_null->frames; i++)
+    {
+        io.DisplaySize = s_null->display_size;
+        io.DeltaTime = 1.0f / 60.0f;
+
+        ImGui::NewFrame();
+        fn();
+        ImGui::Render();
+    }
+}
+
+soundsphere::backend_image::backend_image()
+{
+    pixels = nullptr;
+    width = 0;
+    height = 0;
+    channels = 0;
+}
+
+soundsphere::backend_image::~backend_image()
+{
+    if (pixels != nullptr)
+    {
+        stbi_image_free(pixels);
+        pixels = nullptr;
+    }
+}
+
+soundsphere::BackendImagePtr soundsphere::backend_decode_image(const void *data, size_t size)
+{
+    BackendImagePtr image = std::make_shared<backend_image_t>();
+    image->pixels =
+        stbi_load_from_memory((stbi_uc *)data, (int)size, &image->width, &image->height, &image->channels, 0);
+    if (image->pixels == nullptr)
+    {
+        return nullptr;
+    }
+    return image;
+}
+
+soundsphere::Texture soundsphere::backend_create_texture(const BackendImagePtr &image)
+{
+    if (image.get() == nullptr)
+    {
+        return soundsphere::Texture();
+    }
+
+    /* No GPU, the texture keeps decoded pixels alive. */
+    return soundsphere::Texture(image, image->pixels);
+}
+
+soundsphere::Texture soundsphere::backend_load_image(const void *data, size_t size)
+{
+    /* Decode anyway so that the cost of cover loading is still measured. */
+    return backend_create_texture(backend_decode_image(data, size));
+}
+
+soundsphere::Texture soundsphere::backend_load_image_from_file(const char *path)
+{
+    ev_fs_req_t req;
+    ev_fs_readfile(NULL, &req, path, NULL);
+
+    ev_buf_t *buf = ev_fs_get_filecontent(&req);
+    soundsphere::Texture ret = backend_load_image(buf->data, buf->size);
+    ev_fs_req_cleanup(&req);
+
+    return ret;
+}
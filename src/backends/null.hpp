@@ -0,0 +1,22 @@
+#ifndef SOUND_SPHERE_BACKENDS_NULL_HPP
+#define SOUND_SPHERE_BACKENDS_NULL_HPP
+
+#include <cstddef>
+#include "__init__.hpp"
+
+namespace soundsphere
+{
+
+/**
+ * @brief Configure the null backend.
+ * @note Only available when linked with `backends/null.cpp`.
+ * @note Must be called after #backend_init() and before #backend_draw().
+ * @param[in] width     Display width in pixels.
+ * @param[in] height    Display height in pixels.
+ * @param[in] frames    How many frames #backend_draw() runs before return.
+ */
+void backend_null_setup(float width, float height, size_t frames);
+
+} // namespace soundsphere
+
+#endif
@@ -123,29 +123,52 @@ void soundsphere::backend_draw(soundsphere::DrawFn fn)
     }
 }
 
-soundsphere::Texture soundsphere::backend_load_image(const void *data, size_t size)
+soundsphere::backend_image::backend_image()
 {
-    int channels = 0;
-    int img_width = 0;
-    int img_height = 0;
+    pixels = nullptr;
+    width = 0;
+    height = 0;
+    channels = 0;
+}
 
-    unsigned char *img_data = stbi_load_from_memory((stbi_uc *)data, (int)size, &img_width, &img_height, &channels, 0);
-    if (img_data == nullptr)
+soundsphere::backend_image::~backend_image()
+{
+    if (pixels != nullptr)
+    {
+        stbi_image_free(pixels);
+        pixels = nullptr;
+    }
+}
+
+soundsphere::BackendImagePtr soundsphere::backend_decode_image(const void *data, size_t size)
+{
+    BackendImagePtr image = std::make_shared<backend_image_t>();
+    image->pixels =
+        stbi_load_from_memory((stbi_uc *)data, (int)size, &image->width, &image->height, &image->channels, 0);
+    if (image->pixels == nullptr)
+    {
+        return nullptr;
+    }
+    return image;
+}
+
+soundsphere::Texture soundsphere::backend_create_texture(const BackendImagePtr &image)
+{
+    if (image.get() == nullptr)
     {
         return soundsphere::Texture();
     }
 
-    SDL_Surface *surface = SDL_CreateRGBSurfaceFrom(img_data, img_width, img_height, channels * 8, channels * img_width,
-                                                    0x000000ff, 0x0000ff00, 0x00ff0000, 0xff000000);
+    SDL_Surface *surface =
+        SDL_CreateRGBSurfaceFrom(image->pixels, image->width, image->height, image->channels * 8,
+                                 image->channels * image->width, 0x000000ff, 0x0000ff00, 0x00ff0000, 0xff000000);
     if (surface == nullptr)
     {
-        stbi_image_free(img_data);
         return soundsphere::Texture();
     }
 
     SDL_Texture *texture = SDL_CreateTextureFromSurface(s_renderer, surface);
     SDL_FreeSurface(surface);
-    stbi_image_free(img_data);
 
     if (texture == nullptr)
     {
@@ -155,6 +178,11 @@ soundsphere::Texture soundsphere::backend_load_image(const void *data, size_t si
     return soundsphere::Texture(texture, [](SDL_Texture *t) { SDL_DestroyTexture(t); });
 }
 
+soundsphere::Texture soundsphere::backend_load_image(const void *data, size_t size)
+{
+    return backend_create_texture(backend_decode_image(data, size));
+}
+
 soundsphere::Texture soundsphere::backend_load_image_from_file(const char *path)
 {
     ev_fs_req_t req;
@@ -0,0 +1,139 @@
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include "__init__.hpp"
+
+/**
+ * @brief Allocation counter.
+ * Replacing the global allocation functions is allowed by the standard, and only
+ * affects the benchmark binary.
+ */
+static std::atomic<uint64_t> s_bench_alloc_cnt(0);
+
+void *operator new(size_t size)
+{
+    s_bench_alloc_cnt.fetch_add(1, std::memory_order_relaxed);
+    void *p = std::malloc(size != 0 ? size : 1);
+    if (p == nullptr)
+    {
+        throw std::bad_alloc();
+    }
+    return p;
+}
+
+void *operator new[](size_t size)
+{
+    return operator new(size);
+}
+
+void operator delete(void *p) noexcept
+{
+    std::free(p);
+}
+
+void operator delete[](void *p) noexcept
+{
+    std::free(p);
+}
+
+void operator delete(void *p, size_t size) noexcept
+{
+    (void)size;
+    std::free(p);
+}
+
+void operator delete[](void *p, size_t size) noexcept
+{
+    (void)size;
+    std::free(p);
+}
+
+static double _bench_percentile(const std::vector<double> &sorted, double pct)
+{
+    size_t idx = (size_t)(pct * (double)(sorted.size() - 1) + 0.5);
+    return sorted[idx];
+}
+
+soundsphere::bench_stat_t soundsphere::bench_stat(std::vector<double> &samples)
+{
+    bench_stat_t stat;
+    memset(&stat, 0, sizeof(stat));
+
+    stat.count = samples.size();
+    if (samples.empty())
+    {
+        return stat;
+    }
+
+    std::sort(samples.begin(), samples.end());
+
+    double sum = 0;
+    for (size_t i = 0; i < samples.size(); i++)
+    {
+        sum += samples[i];
+    }
+
+    stat.mean = sum / (double)samples.size();
+    stat.p50 = _bench_percentile(samples, 0.50);
+    stat.p90 = _bench_percentile(samples, 0.90);
+    stat.p99 = _bench_percentile(samples, 0.99);
+    stat.max = samples.back();
+
+    return stat;
+}
+
+uint64_t soundsphere::bench_alloc_count(void)
+{
+    return s_bench_alloc_cnt.load(std::memory_order_relaxed);
+}
+
+/**
+ * @brief Find value of option \p name.
+ * @return The value, or nullptr if not found.
+ */
+static const char *_bench_find_opt(int argc, char *argv[], const char *name)
+{
+    size_t name_sz = strlen(name);
+    for (int i = 0; i < argc; i++)
+    {
+        if (strncmp(argv[i], name, name_sz) != 0)
+        {
+            continue;
+        }
+        if (argv[i][name_sz] == '=')
+        {
+            return &argv[i][name_sz + 1];
+        }
+        if (argv[i][name_sz] == '\0' && i + 1 < argc)
+        {
+            return argv[i + 1];
+        }
+    }
+    return nullptr;
+}
+
+int64_t soundsphere::bench_opt_int(int argc, char *argv[], const char *name, int64_t dflt)
+{
+    const char *val = _bench_find_opt(argc, argv, name);
+    return val != nullptr ? strtoll(val, nullptr, 10) : dflt;
+}
+
+std::string soundsphere::bench_opt_str(int argc, char *argv[], const char *name, const char *dflt)
+{
+    const char *val = _bench_find_opt(argc, argv, name);
+    return val != nullptr ? val : dflt;
+}
+
+bool soundsphere::bench_opt_flag(int argc, char *argv[], const char *name)
+{
+    for (int i = 0; i < argc; i++)
+    {
+        if (strcmp(argv[i], name) == 0)
+        {
+            return true;
+        }
+    }
+    return false;
+}
@@ -0,0 +1,102 @@
+#ifndef SOUND_SPHERE_BENCH_INIT_HPP
+#define SOUND_SPHERE_BENCH_INIT_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/* clang-format off */
+#define SOUNDSPHERE_BENCH_TABLE(xx)         \
+    xx(bench_eq)                            \
+    xx(bench_frame)                         \
+    xx(bench_krc)                           \
+    xx(bench_lyric_cache)                   \
+    xx(bench_mix)                           \
+    xx(bench_msg)                           \
+    xx(bench_resample)
+/* clang-format on */
+
+namespace soundsphere
+{
+
+typedef struct bench
+{
+    /**
+     * @brief Suite name, used as the first command line argument.
+     */
+    const char *name;
+
+    /**
+     * @brief One line description, including options.
+     */
+    const char *help;
+
+    /**
+     * @brief Run the suite.
+     * @param[in] argc  Argument count, excluding program name and suite name.
+     * @param[in] argv  Arguments.
+     * @return Process exit code.
+     */
+    int (*entry)(int argc, char *argv[]);
+} bench_t;
+
+#define SOUNDSPHERE_EXPAND_BENCH_MAP_AS_EXTERN(a) extern const bench_t a;
+SOUNDSPHERE_BENCH_TABLE(SOUNDSPHERE_EXPAND_BENCH_MAP_AS_EXTERN)
+#undef SOUNDSPHERE_EXPAND_BENCH_MAP_AS_EXTERN
+
+/**
+ * @brief Summary of a sample set.
+ */
+typedef struct bench_stat
+{
+    size_t count; /**< Number of samples. */
+    double mean;  /**< Mean value. */
+    double p50;   /**< Median. */
+    double p90;   /**< 90th percentile. */
+    double p99;   /**< 99th percentile. */
+    double max;   /**< Maximum value. */
+} bench_stat_t;
+
+/**
+ * @brief Calculate statistics.
+ * @param[in] samples   Samples. The vector is sorted in place.
+ * @return Statistics.
+ */
+bench_stat_t bench_stat(std::vector<double> &samples);
+
+/**
+ * @brief Get the number of `operator new` calls made by this process so far.
+ * @note Allocations from C code (`malloc`, `ev_malloc`) are not counted.
+ * @return Allocation count.
+ */
+uint64_t bench_alloc_count(void);
+
+/**
+ * @brief Get integer option in the form of `--name=value` or `--name value`.
+ * @param[in] argc  Argument count.
+ * @param[in] argv  Arguments.
+ * @param[in] name  Option name, including leading `--`.
+ * @param[in] dflt  Default value.
+ * @return Option value.
+ */
+int64_t bench_opt_int(int argc, char *argv[], const char *name, int64_t dflt);
+
+/**
+ * @brief Get string option in the form of `--name=value` or `--name value`.
+ * @see #bench_opt_int()
+ */
+std::string bench_opt_str(int argc, char *argv[], const char *name, const char *dflt);
+
+/**
+ * @brief Check whether flag \p name exists.
+ * @param[in] argc  Argument count.
+ * @param[in] argv  Arguments.
+ * @param[in] name  Flag name, including leading `--`.
+ * @return boolean.
+ */
+bool bench_opt_flag(int argc, char *argv[], const char *name);
+
+} // namespace soundsphere
+
+#endif
@@ -0,0 +1,166 @@
+#include <ev.h>
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <random>
+#include "audio/eq.hpp"
+#include "__init__.hpp"
+
+typedef struct bench_eq_input
+{
+    int64_t seconds;  /**< Length of audio. */
+    int64_t rate;     /**< Sample rate. */
+    int64_t channels; /**< Channels. */
+    int64_t bands;    /**< Biquads in cascade. */
+} bench_eq_input_t;
+
+/**
+ * @brief Print one report row. Cost is normalized to one band over one second of audio.
+ */
+static void _bench_eq_report(const char *name, const bench_eq_input_t &in, std::vector<double> &samples, size_t bands,
+                             size_t mismatch)
+{
+    soundsphere::bench_stat_t t = soundsphere::bench_stat(samples);
+    double                    us_per_band = t.mean / (double)bands / (double)in.seconds;
+    double                    core = t.mean / ((double)in.seconds * 1e6) * 100.0;
+    printf("%-8s %9.1f %9.1f %9.1f %9.1f %12.2f %9.4f %9zu\n", name, t.mean, t.p50, t.p99, t.max, us_per_band, core,
+           mismatch);
+}
+
+/**
+ * @brief Run cascade \p fn over channel groups of \p input block by block, like the audio thread does.
+ * @param[in] expect    Output of the scalar version, to check \p fn against.
+ */
+static void _bench_eq_kernel(const char *name, soundsphere::audio_eq_cascade_fn fn, const bench_eq_input_t &in,
+                             int64_t iterations, const std::vector<float> &input, std::vector<float> &output,
+                             const std::vector<float> *expect)
+{
+    const size_t frames = (size_t)(in.seconds * in.rate);
+    const size_t groups = (size_t)(in.channels + AUDIO_EQ_LANES - 1) / AUDIO_EQ_LANES;
+
+    std::vector<soundsphere::audio_eq_coef_t> coef((size_t)in.bands);
+    for (size_t b = 0; b < coef.size(); b++)
+    {
+        coef[b] = soundsphere::audio_eq_peaking(31.25 * (double)(1 << (b % 10)), 6.0, 1.41, (int)in.rate);
+    }
+    std::vector<soundsphere::audio_eq_state_t> state(groups * coef.size());
+
+    std::vector<double> samples;
+    samples.reserve((size_t)iterations);
+    for (int64_t i = 0; i < iterations; i++)
+    {
+        output = input;
+        memset(state.data(), 0, state.size() * sizeof(state[0]));
+
+        uint64_t t_beg = ev_hrtime();
+        for (size_t g = 0; g < groups; g++)
+        {
+            float(*buf)[AUDIO_EQ_LANES] = (float(*)[AUDIO_EQ_LANES])(output.data() + g * frames * AUDIO_EQ_LANES);
+            int lanes = (int)std::min<int64_t>(in.channels - (int64_t)g * AUDIO_EQ_LANES, AUDIO_EQ_LANES);
+            for (size_t f = 0; f < frames; f += AUDIO_EQ_BLOCK)
+            {
+                size_t n = std::min<size_t>(frames - f, AUDIO_EQ_BLOCK);
+                fn(buf + f, n, lanes, coef.data(), &state[g * coef.size()], coef.size());
+            }
+        }
+        uint64_t t_end = ev_hrtime();
+
+        samples.push_back((t_end - t_beg) / 1000.0);
+    }
+
+    /* Unused lanes are free for SIMD to filter, only compare channels. */
+    size_t mismatch = 0;
+    for (size_t i = 0; expect != nullptr && i < output.size(); i++)
+    {
+        int64_t channel = (int64_t)(i / (frames * AUDIO_EQ_LANES) * AUDIO_EQ_LANES + i % AUDIO_EQ_LANES);
+        mismatch += channel < in.channels && output[i] != (*expect)[i] ? 1 : 0;
+    }
+    _bench_eq_report(name, in, samples, coef.size(), mismatch);
+}
+
+/**
+ * @brief Run the whole equalizer on 16-bit PCM, including conversion and smoothing.
+ */
+static void _bench_eq_process(const bench_eq_input_t &in, int64_t iterations)
+{
+    const size_t frames = (size_t)(in.seconds * in.rate);
+    if (in.channels > AUDIO_EQ_MAX_CHANNELS)
+    {
+        return;
+    }
+
+    std::vector<int16_t>               input(frames * (size_t)in.channels), pcm;
+    std::mt19937                       rng(0);
+    std::uniform_int_distribution<int> dist(-8192, 8191);
+    for (size_t i = 0; i < input.size(); i++)
+    {
+        input[i] = (int16_t)dist(rng);
+    }
+
+    /* Every band boosted, so none is skipped. Run once to settle smoothing. */
+    std::unique_ptr<soundsphere::audio_eq_t> eq(new soundsphere::audio_eq_t((int)in.rate, (int)in.channels));
+    soundsphere::audio_eq_params_t           params;
+    for (size_t b = 0; b < AUDIO_EQ_BANDS; b++)
+    {
+        params.bands[b].gain_db = 6.0f;
+    }
+    soundsphere::audio_eq_set(*eq, true, params);
+    pcm = input;
+    soundsphere::audio_eq_process(*eq, pcm.data(), frames);
+
+    std::vector<double> samples;
+    samples.reserve((size_t)iterations);
+    for (int64_t i = 0; i < iterations; i++)
+    {
+        pcm = input;
+
+        uint64_t t_beg = ev_hrtime();
+        soundsphere::audio_eq_process(*eq, pcm.data(), frames);
+        uint64_t t_end = ev_hrtime();
+
+        samples.push_back((t_end - t_beg) / 1000.0);
+    }
+    _bench_eq_report("process", in, samples, AUDIO_EQ_BANDS, 0);
+}
+
+static int _bench_eq_entry(int argc, char *argv[])
+{
+    bench_eq_input_t in;
+    in.seconds = soundsphere::bench_opt_int(argc, argv, "--seconds", 1);
+    in.rate = soundsphere::bench_opt_int(argc, argv, "--rate", 48000);
+    in.channels = soundsphere::bench_opt_int(argc, argv, "--channels", 2);
+    in.bands = soundsphere::bench_opt_int(argc, argv, "--bands", AUDIO_EQ_BANDS);
+    int64_t iterations = soundsphere::bench_opt_int(argc, argv, "--iterations", 20);
+
+    /* Channel groups one after another, frames of #AUDIO_EQ_LANES lanes. */
+    const size_t       frames = (size_t)(in.seconds * in.rate);
+    const size_t       groups = (size_t)(in.channels + AUDIO_EQ_LANES - 1) / AUDIO_EQ_LANES;
+    std::vector<float> input(groups * frames * AUDIO_EQ_LANES), expect, output;
+    std::mt19937       rng(0);
+    std::uniform_real_distribution<float> dist(-8192.0f, 8192.0f);
+    for (size_t i = 0; i < input.size(); i++)
+    {
+        input[i] = dist(rng);
+    }
+
+    printf("seconds=%lld rate=%lld channels=%lld bands=%lld iterations=%lld\n\n", (long long)in.seconds,
+           (long long)in.rate, (long long)in.channels, (long long)in.bands, (long long)iterations);
+    printf("%-8s %9s %9s %9s %9s %12s %9s %9s\n", "impl", "mean(us)", "p50(us)", "p99(us)", "max(us)",
+           "us/band/s", "core(%)", "mismatch");
+
+    _bench_eq_kernel("scalar", soundsphere::audio_eq_cascade_scalar, in, iterations, input, expect, nullptr);
+#if defined(AUDIO_EQ_SSE2)
+    _bench_eq_kernel("sse2", soundsphere::audio_eq_cascade_sse2, in, iterations, input, output, &expect);
+#endif
+    _bench_eq_process(in, iterations);
+
+    return 0;
+}
+
+const soundsphere::bench_t soundsphere::bench_eq = {
+    "eq",
+    "Equalizer biquad cascade per band and second of audio, scalar vs SIMD, and the whole 16-bit path. "
+    "--seconds N --rate N --channels N --bands N --iterations N",
+    _bench_eq_entry,
+};
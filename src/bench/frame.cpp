@@ -0,0 +1,326 @@
+#include <ev.h>
+#include <imgui.h>
+#include <curl/curl.h>
+#include <cstdio>
+#include "backends/null.hpp"
+#include "config/__init__.hpp"
+#include "i18n/__init__.h"
+#include "runtime/__init__.hpp"
+#include "runtime/worker.hpp"
+#include "utils/defines.hpp"
+#include "utils/env.hpp"
+#include "utils/string.hpp"
+#include "widgets/__init__.hpp"
+#include "widgets/ui_filter.hpp"
+#include "__init__.hpp"
+
+/**
+ * @brief Scripted phases. Each phase runs the same number of frames.
+ */
+typedef enum bench_frame_phase
+{
+    BENCH_FRAME_PHASE_IDLE,   /**< No input. Playback position still advances. */
+    BENCH_FRAME_PHASE_SCROLL, /**< Mouse wheel over playlist. */
+    BENCH_FRAME_PHASE_FILTER, /**< Filter text changes periodically, plus scrolling. */
+    BENCH_FRAME_PHASE__MAX,
+} bench_frame_phase_t;
+
+static const char *s_bench_frame_phase_names[BENCH_FRAME_PHASE__MAX] = {
+    "idle",
+    "scroll",
+    "filter",
+};
+
+static const char *s_bench_frame_filters[] = {
+    "1", "12", "123", "artist 7", "title 4", "",
+};
+
+typedef struct bench_frame_opt
+{
+    int64_t tracks;     /**< Number of synthetic tracks. */
+    int64_t frames;     /**< Measured frames. */
+    int64_t warmup;     /**< Frames before measurement. */
+    int64_t cover_size; /**< Cover width and height in pixels. */
+    int64_t width;      /**< Display width. */
+    int64_t height;     /**< Display height. */
+    bool    covers;     /**< Attach cover to every track. */
+    bool    lyrics;     /**< Attach lyric to every track. */
+} bench_frame_opt_t;
+
+typedef struct bench_frame_sample
+{
+    std::vector<double> frame_ms;
+    std::vector<double> allocs;
+    std::vector<double> vertices;
+} bench_frame_sample_t;
+
+/**
+ * @brief Build an uncompressed 24-bit BMP so that no image encoder is needed.
+ */
+static soundsphere::Bin _bench_frame_make_cover(int size)
+{
+    const uint32_t row_sz = ((uint32_t)size * 3 + 3) & ~3u;
+    const uint32_t pixel_sz = row_sz * (uint32_t)size;
+    const uint32_t file_sz = 54 + pixel_sz;
+
+    soundsphere::Bin bmp(file_sz, 0);
+    uint8_t         *p = bmp.data();
+
+    auto put_u16 = [](uint8_t *dst, uint32_t v) {
+        dst[0] = (uint8_t)v;
+        dst[1] = (uint8_t)(v >> 8);
+    };
+    auto put_u32 = [](uint8_t *dst, uint32_t v) {
+        dst[0] = (uint8_t)v;
+        dst[1] = (uint8_t)(v >> 8);
+        dst[2] = (uint8_t)(v >> 16);
+        dst[3] = (uint8_t)(v >> 24);
+    };
+
+    p[0] = 'B';
+    p[1] = 'M';
+    put_u32(p + 2, file_sz);
+    put_u32(p + 10, 54);
+    put_u32(p + 14, 40);
+    put_u32(p + 18, (uint32_t)size);
+    put_u32(p + 22, (uint32_t)size);
+    put_u16(p + 26, 1);
+    put_u16(p + 28, 24);
+    put_u32(p + 34, pixel_sz);
+
+    for (int y = 0; y < size; y++)
+    {
+        uint8_t *row = p + 54 + row_sz * (uint32_t)y;
+        for (int x = 0; x < size; x++)
+        {
+            row[x * 3 + 0] = (uint8_t)(x * 255 / size);
+            row[x * 3 + 1] = (uint8_t)(y * 255 / size);
+            row[x * 3 + 2] = (uint8_t)((x ^ y) & 0xff);
+        }
+    }
+
+    return bmp;
+}
+
+/**
+ * @brief Build a five minutes lyric with a translation under every line.
+ */
+static std::string _bench_frame_make_lyric(void)
+{
+    std::string lyric = "[ti:bench]\n[ar:bench]\n";
+    for (int i = 0; i < 150; i++)
+    {
+        int  ms = i * 2000;
+        char ts[16];
+        snprintf(ts, sizeof(ts), "[%02d:%02d.%02d]", ms / 60000, (ms / 1000) % 60, (ms % 1000) / 10);
+
+        /* Original line and its translation share the same timestamp. */
+        lyric += soundsphere::string_format("%sThe quick brown fox jumps over the lazy dog, line %d\n", ts, i);
+        lyric += soundsphere::string_format("%s\xe6\x95\x8f\xe6\x8d\xb7\xe7\x9a\x84\xe7\x8b\x90 %d\n", ts, i);
+    }
+    return lyric;
+}
+
+static soundsphere::MusicTagPtrVecPtr _bench_frame_make_library(const bench_frame_opt_t *opt)
+{
+    soundsphere::MusicTagPtrVecPtr vec = std::make_shared<soundsphere::MusicTagPtrVec>();
+    vec->reserve((size_t)opt->tracks);
+
+    soundsphere::music_tag_image_t cover;
+    cover.mime = "image/bmp";
+    if (opt->covers)
+    {
+        cover.data = _bench_frame_make_cover((int)opt->cover_size);
+    }
+    std::string lyric = opt->lyrics ? _bench_frame_make_lyric() : std::string();
+
+    for (int64_t i = 0; i < opt->tracks; i++)
+    {
+        soundsphere::MusicTagPtr tag = std::make_shared<soundsphere::music_tags_t>();
+        tag->path = soundsphere::string_format("/bench/artist %lld/track %08lld.flac", (long long)(i % 997),
+                                               (long long)i);
+        tag->path_hash = soundsphere::string_hash_djb2(tag->path);
+        tag->valid = true;
+        tag->info.format = soundsphere::MUSIC_FLAC;
+        tag->info.bitrate = 1411;
+        tag->info.samplerate = 44100;
+        tag->info.channel = 2;
+        tag->info.duration = 300.0;
+        tag->info.title = soundsphere::string_format("title %lld", (long long)i);
+        tag->info.artist = soundsphere::string_format("artist %lld", (long long)(i % 997));
+        tag->info.lyric = lyric;
+        tag->info.covers.push_back(cover);
+        vec->push_back(tag);
+    }
+
+    return vec;
+}
+
+/**
+ * @brief Inject input for frame \p idx of \p phase. Input takes effect in the next NewFrame().
+ */
+static void _bench_frame_script(bench_frame_phase_t phase, int64_t idx)
+{
+    ImGuiIO &io = ImGui::GetIO();
+    ImVec2   pos = soundsphere::_layout.playlist.pos;
+    ImVec2   size = soundsphere::_layout.playlist.size;
+
+    /* Simulate playback so that the lyric panel keeps moving. */
+    soundsphere::_G.playbar.music_position += 1.0 / 60.0;
+    if (soundsphere::_G.playbar.music_position >= soundsphere::_G.playbar.music_duration)
+    {
+        soundsphere::_G.playbar.music_position = 0;
+    }
+
+    if (phase == BENCH_FRAME_PHASE_IDLE)
+    {
+        return;
+    }
+
+    if (phase == BENCH_FRAME_PHASE_FILTER && idx % 20 == 0)
+    {
+        const char *filter = s_bench_frame_filters[(idx / 20) % ARRAY_SIZE(s_bench_frame_filters)];
+        soundsphere::widget_fast_req<soundsphere::UiFilterSet>(soundsphere::WIDGET_ID_UI_FILTER, filter);
+    }
+
+    io.AddMousePosEvent(pos.x + size.x * 0.5f, pos.y + size.y * 0.5f);
+    io.AddMouseWheelEvent(0.0f, ((idx / 200) % 2) == 0 ? -3.0f : 3.0f);
+}
+
+static void _bench_frame_draw(void)
+{
+    soundsphere::runtime_loop();
+    soundsphere::widget_draw();
+}
+
+static void _bench_frame_run_one(bench_frame_sample_t *sample)
+{
+    uint64_t alloc_beg = soundsphere::bench_alloc_count();
+    uint64_t time_beg = ev_hrtime();
+
+    soundsphere::backend_draw(_bench_frame_draw);
+
+    uint64_t time_end = ev_hrtime();
+    uint64_t alloc_end = soundsphere::bench_alloc_count();
+
+    if (sample != nullptr)
+    {
+        sample->frame_ms.push_back((time_end - time_beg) / 1000000.0);
+        sample->allocs.push_back((double)(alloc_end - alloc_beg));
+        sample->vertices.push_back((double)ImGui::GetDrawData()->TotalVtxCount);
+    }
+}
+
+static void _bench_frame_report(const char *name, bench_frame_sample_t *sample)
+{
+    soundsphere::bench_stat_t t = soundsphere::bench_stat(sample->frame_ms);
+    soundsphere::bench_stat_t a = soundsphere::bench_stat(sample->allocs);
+    soundsphere::bench_stat_t v = soundsphere::bench_stat(sample->vertices);
+
+    printf("%-8s %7zu %9.3f %9.3f %9.3f %9.3f %9.3f %11.1f %9.0f %9.0f\n", name, t.count, t.mean, t.p50, t.p90,
+           t.p99, t.max, a.mean, a.max, v.mean);
+}
+
+/**
+ * @brief Point configuration at a scratch directory so that the user config is never touched.
+ */
+static void _bench_frame_isolate_config(void)
+{
+    std::string tmp = soundsphere::getenv("TMPDIR");
+    if (tmp.empty())
+    {
+        tmp = "/tmp";
+    }
+    soundsphere::setenv("XDG_CONFIG_HOME", tmp + "/soundsphere_bench");
+    soundsphere::setenv("APPDATA", tmp + "/soundsphere_bench");
+}
+
+static int _bench_frame_entry(int argc, char *argv[])
+{
+    bench_frame_opt_t opt;
+    opt.tracks = soundsphere::bench_opt_int(argc, argv, "--tracks", 10000);
+    opt.frames = soundsphere::bench_opt_int(argc, argv, "--frames", 1800);
+    opt.warmup = soundsphere::bench_opt_int(argc, argv, "--warmup", 60);
+    opt.cover_size = soundsphere::bench_opt_int(argc, argv, "--cover-size", 64);
+    opt.width = soundsphere::bench_opt_int(argc, argv, "--width", 1280);
+    opt.height = soundsphere::bench_opt_int(argc, argv, "--height", 720);
+    opt.covers = soundsphere::bench_opt_flag(argc, argv, "--covers");
+    opt.lyrics = soundsphere::bench_opt_flag(argc, argv, "--lyrics");
+
+    _bench_frame_isolate_config();
+
+    soundsphere::backend_init();
+    soundsphere::backend_null_setup((float)opt.width, (float)opt.height, 1);
+    ImGui::GetIO().IniFilename = nullptr;
+    ImGui::GetIO().Fonts->AddFontDefault();
+    ImGui::GetIO().Fonts->Build();
+
+    curl_global_init(CURL_GLOBAL_ALL);
+    soundsphere::config_init();
+    soundsphere_i18n_init();
+    soundsphere::runtime_init();
+    soundsphere::worker_init();
+    soundsphere::widget_init();
+
+    uint64_t                       build_beg = ev_hrtime();
+    soundsphere::MusicTagPtrVecPtr library = _bench_frame_make_library(&opt);
+    uint64_t                       build_end = ev_hrtime();
+
+    soundsphere::_G.media_list = library;
+    soundsphere::_G.dummy_player.current_music = library->empty() ? soundsphere::MusicTagPtr() : library->front();
+    soundsphere::_G.playbar.music_duration = 300.0;
+    soundsphere::widget_fast_req<soundsphere::UiFilterReset>(soundsphere::WIDGET_ID_UI_FILTER);
+
+    printf("tracks=%lld covers=%d(%lldpx) lyrics=%d display=%lldx%lld frames=%lld warmup=%lld\n",
+           (long long)opt.tracks, (int)opt.covers, (long long)opt.cover_size, (int)opt.lyrics, (long long)opt.width,
+           (long long)opt.height, (long long)opt.frames, (long long)opt.warmup);
+    printf("library build: %.1f ms\n\n", (build_end - build_beg) / 1000000.0);
+
+    for (int64_t i = 0; i < opt.warmup; i++)
+    {
+        _bench_frame_script(BENCH_FRAME_PHASE_IDLE, i);
+        _bench_frame_run_one(nullptr);
+    }
+
+    printf("%-8s %7s %9s %9s %9s %9s %9s %11s %9s %9s\n", "phase", "frames", "mean(ms)", "p50(ms)", "p90(ms)",
+           "p99(ms)", "max(ms)", "alloc/frame", "alloc max", "vertices");
+
+    bench_frame_sample_t all;
+    const int64_t        phase_frames = opt.frames / BENCH_FRAME_PHASE__MAX;
+    for (int phase = 0; phase < BENCH_FRAME_PHASE__MAX; phase++)
+    {
+        bench_frame_sample_t sample;
+        for (int64_t i = 0; i < phase_frames; i++)
+        {
+            _bench_frame_script((bench_frame_phase_t)phase, i);
+            _bench_frame_run_one(&sample);
+        }
+
+        all.frame_ms.insert(all.frame_ms.end(), sample.frame_ms.begin(), sample.frame_ms.end());
+        all.allocs.insert(all.allocs.end(), sample.allocs.begin(), sample.allocs.end());
+        all.vertices.insert(all.vertices.end(), sample.vertices.begin(), sample.vertices.end());
+        _bench_frame_report(s_bench_frame_phase_names[phase], &sample);
+    }
+    _bench_frame_report("all", &all);
+
+    /* Do not let runtime_exit() save the synthetic library into config. */
+    soundsphere::_G.dummy_player.current_music = soundsphere::MusicTagPtr();
+    soundsphere::_G.media_list = std::make_shared<soundsphere::MusicTagPtrVec>();
+
+    soundsphere::worker_stop();
+    soundsphere::widget_exit();
+    soundsphere::worker_exit();
+    soundsphere::runtime_exit();
+    soundsphere_i18n_exit();
+    soundsphere::config_exit();
+    curl_global_cleanup();
+    soundsphere::backend_exit();
+
+    return 0;
+}
+
+const soundsphere::bench_t soundsphere::bench_frame = {
+    "frame",
+    "UI frame cost. --tracks N --frames N --warmup N --covers --cover-size N --lyrics --width N --height N",
+    _bench_frame_entry,
+};
@@ -0,0 +1,230 @@
+#include <ev.h>
+#include <base64.h>
+#include <zlib.h>
+#include <cstdio>
+#include <cstring>
+#include <regex>
+#include "utils/binary.hpp"
+#include "utils/krc.hpp"
+#include "utils/string.hpp"
+#include "utils/time.hpp"
+#include "__init__.hpp"
+
+/**
+ * @brief Build plain KRC text, one word tag per two characters.
+ */
+static std::string _bench_krc_make_text(int lines)
+{
+    std::string text = "[id:$00000000]\n[ar:bench]\n[ti:bench]\n[by:]\n[hash:0]\n[al:]\n[sign:]\n[offset:0]\n";
+    for (int i = 0; i < lines; i++)
+    {
+        int start = i * 3000;
+        text += soundsphere::string_format("[%d,2800]", start);
+        for (int w = 0; w < 10; w++)
+        {
+            text += soundsphere::string_format("<%d,280,0>w%d ", w * 280, w);
+        }
+        text += "\r\n";
+    }
+    return text;
+}
+
+/**
+ * @brief Compress, encrypt and base64 encode \p text, as served by the lyric server.
+ */
+static std::string _bench_krc_encode(const std::string &text)
+{
+    static const uint8_t enckey[] = {
+        0x40, 0x47, 0x61, 0x77, 0x5e, 0x32, 0x74, 0x47, 0x51, 0x36, 0x31, 0x2d, 0xce, 0xd2, 0x6e, 0x69,
+    };
+
+    uLongf           zip_sz = compressBound((uLong)text.size());
+    soundsphere::Bin zip(zip_sz);
+    compress(zip.data(), &zip_sz, (const Bytef *)text.data(), (uLong)text.size());
+    zip.resize(zip_sz);
+
+    soundsphere::Bin krc = { 0x6b, 0x72, 0x63, 0x31 };
+    for (size_t i = 0; i < zip.size(); i++)
+    {
+        krc.push_back(zip[i] ^ enckey[i % sizeof(enckey)]);
+    }
+
+    return base64_encode(krc.data(), krc.size());
+}
+
+/*
+ * The implementation before the streaming decoder, kept as baseline.
+ */
+
+static soundsphere::Bin _bench_krc_legacy_xor(const std::string &data)
+{
+    soundsphere::Bin ret;
+    if (data[0] != 0x6b || data[1] != 0x72 || data[2] != 0x63 || data[3] != 0x31)
+    {
+        return ret;
+    }
+
+    static const uint8_t enckey[] = {
+        0x40, 0x47, 0x61, 0x77, 0x5e, 0x32, 0x74, 0x47, 0x51, 0x36, 0x31, 0x2d, 0xce, 0xd2, 0x6e, 0x69,
+    };
+    for (size_t i = 4; i < data.size(); i++)
+    {
+        uint8_t x = data[i];
+        uint8_t y = enckey[(i - 4) % sizeof(enckey)];
+        uint8_t v = x ^ y;
+        ret.push_back(v);
+    }
+
+    return ret;
+}
+
+static std::string _bench_krc_legacy_uncompress(const soundsphere::Bin &data)
+{
+    std::string unzip_data;
+
+    z_stream stream;
+    memset(&stream, 0, sizeof(stream));
+    stream.next_in = (Bytef *)data.data();
+    stream.avail_in = (uInt)data.size();
+
+    if (inflateInit(&stream) != Z_OK)
+    {
+        return unzip_data;
+    }
+
+    int  result;
+    char buffer[4096];
+
+    do
+    {
+        stream.next_out = (Bytef *)buffer;
+        stream.avail_out = sizeof(buffer);
+
+        result = inflate(&stream, Z_NO_FLUSH);
+        if (result == Z_STREAM_END || result == Z_DATA_ERROR || result == Z_MEM_ERROR)
+        {
+            break;
+        }
+
+        unzip_data.append(buffer, sizeof(buffer) - stream.avail_out);
+    } while (result != Z_STREAM_END);
+
+    inflateEnd(&stream);
+    return unzip_data;
+}
+
+static std::string _bench_krc_legacy_format_time(int time)
+{
+    double duration = (time) / 1000;
+    return soundsphere::time_seconds_to_string(duration);
+}
+
+static std::string _bench_krc_legacy_parse(const std::string &data)
+{
+    std::regex metaRegex("^\\[(\\S+):(\\S+)\\]$");
+    std::regex timestampsRegex("^\\[(\\d+),(\\d+)\\]");
+    std::regex timestamps2Regex("<(\\d+),(\\d+),(\\d+)>([^<]*)");
+
+    soundsphere::StringVec lines = soundsphere::string_split(data, "\n");
+    lines = soundsphere::string_trim_vec(lines);
+
+    std::string lyric;
+    std::smatch matches;
+    for (auto it = lines.begin(); it != lines.end(); it++)
+    {
+        std::string line = *it;
+
+        if (std::regex_search(line, matches, metaRegex))
+        {
+            std::string str = matches[0].str();
+            lyric += str + "\n";
+            continue;
+        }
+
+        if (std::regex_search(line, matches, timestampsRegex))
+        {
+            std::string lyric_line;
+
+            std::string str = matches[1].str();
+            int         startTime = std::stoi(str);
+            str = matches[2].str();
+            int duration = std::stoi(str);
+            lyric_line += "[" + _bench_krc_legacy_format_time(startTime) + "]";
+
+            auto words_begin = std::sregex_iterator(line.begin(), line.end(), timestamps2Regex);
+            for (; words_begin != std::sregex_iterator(); words_begin++)
+            {
+                std::smatch match = *words_begin;
+                int         offset = std::stoi(match[1].str());
+                std::string subword = match[4].str();
+                lyric_line += "<" + _bench_krc_legacy_format_time(startTime + offset) + ">" + subword;
+            }
+
+            lyric_line += "<" + _bench_krc_legacy_format_time(startTime + duration) + ">";
+            lyric += lyric_line + "\n";
+        }
+    }
+
+    return lyric;
+}
+
+static std::string _bench_krc_legacy(const std::string &data)
+{
+    std::string      base64_decode_data = base64_decode(data);
+    soundsphere::Bin zip_data = _bench_krc_legacy_xor(base64_decode_data);
+    std::string      unzip_data = _bench_krc_legacy_uncompress(zip_data);
+    return _bench_krc_legacy_parse(unzip_data);
+}
+
+/**
+ * @brief Run \p fn \p iterations times and print one report row.
+ */
+static void _bench_krc_run(const char *name, std::string (*fn)(const std::string &), const std::string &data,
+                           int64_t iterations)
+{
+    std::vector<double> samples;
+    uint64_t            alloc_beg = soundsphere::bench_alloc_count();
+    size_t              out_sz = 0;
+
+    samples.reserve((size_t)iterations);
+    for (int64_t i = 0; i < iterations; i++)
+    {
+        uint64_t    t_beg = ev_hrtime();
+        std::string lyric = fn(data);
+        uint64_t    t_end = ev_hrtime();
+
+        samples.push_back((t_end - t_beg) / 1000000.0);
+        out_sz = lyric.size();
+    }
+    uint64_t allocs = soundsphere::bench_alloc_count() - alloc_beg;
+
+    soundsphere::bench_stat_t t = soundsphere::bench_stat(samples);
+    double mb_per_s = t.mean > 0 ? (data.size() / 1048576.0) / (t.mean / 1000.0) : 0;
+    printf("%-8s %9.3f %9.3f %9.3f %9.3f %9.1f %11.1f %9zu\n", name, t.mean, t.p50, t.p99, t.max, mb_per_s,
+           (double)allocs / (double)iterations, out_sz);
+}
+
+static int _bench_krc_entry(int argc, char *argv[])
+{
+    int64_t lines = soundsphere::bench_opt_int(argc, argv, "--lines", 100);
+    int64_t iterations = soundsphere::bench_opt_int(argc, argv, "--iterations", 200);
+
+    std::string text = _bench_krc_make_text((int)lines);
+    std::string data = _bench_krc_encode(text);
+
+    printf("lines=%lld krc=%zu bytes text=%zu bytes iterations=%lld\n\n", (long long)lines, data.size(), text.size(),
+           (long long)iterations);
+    printf("%-8s %9s %9s %9s %9s %9s %11s %9s\n", "impl", "mean(ms)", "p50(ms)", "p99(ms)", "max(ms)", "MB/s",
+           "allocs/call", "out");
+
+    _bench_krc_run("legacy", _bench_krc_legacy, data, iterations);
+    _bench_krc_run("stream", soundsphere::krc_to_lyric, data, iterations);
+
+    return 0;
+}
+
+const soundsphere::bench_t soundsphere::bench_krc = {
+    "krc",
+    "KRC to LRC conversion, legacy regex parser vs streaming parser. --lines N --iterations N",
+    _bench_krc_entry,
+};
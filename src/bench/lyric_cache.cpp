@@ -0,0 +1,166 @@
+#include <ev.h>
+#include <cstdio>
+#include <vector>
+#include "config/__init__.hpp"
+#include "utils/env.hpp"
+#include "utils/lyric_cache.hpp"
+#include "utils/string.hpp"
+#include "__init__.hpp"
+
+/*
+ * Every track has one search candidate and one LRC text. A round looks both
+ * up, and stores them on a miss, the way the tag editor uses the cache.
+ */
+
+typedef struct bench_lyric_track
+{
+    std::string                    key;        /**< Cache key. */
+    soundsphere::KugouCandidateVec candidates; /**< Search result. */
+    std::string                    lyric;      /**< LRC text. */
+} bench_lyric_track_t;
+
+typedef std::vector<bench_lyric_track_t> BenchLyricTrackVec;
+
+typedef struct bench_lyric_round
+{
+    double ms;     /**< Time of the round. */
+    size_t hits;   /**< Tracks served from cache with the stored content. */
+    size_t misses; /**< Tracks not in cache, stored then. */
+    size_t wrong;  /**< Tracks served from cache with other content. */
+} bench_lyric_round_t;
+
+static bool _bench_lyric_same(const soundsphere::KugouCandidateVec &a, const soundsphere::KugouCandidateVec &b)
+{
+    if (a.size() != b.size())
+    {
+        return false;
+    }
+    for (size_t i = 0; i < a.size(); i++)
+    {
+        if (a[i].id != b[i].id || a[i].accesskey != b[i].accesskey || a[i].artist != b[i].artist ||
+            a[i].title != b[i].title || a[i].duration != b[i].duration)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * @brief Look up every track once, and store it on a miss.
+ */
+static bench_lyric_round_t _bench_lyric_round(const BenchLyricTrackVec &tracks)
+{
+    bench_lyric_round_t ret = {};
+
+    uint64_t t_beg = ev_hrtime();
+    for (size_t i = 0; i < tracks.size(); i++)
+    {
+        const bench_lyric_track_t     &track = tracks[i];
+        soundsphere::KugouCandidateVec candidates;
+        std::string                    lyric;
+        if (!soundsphere::lyric_cache_get_candidates(track.key, candidates) ||
+            !soundsphere::lyric_cache_get_lyric(track.key, track.candidates[0].id, lyric))
+        {
+            soundsphere::lyric_cache_put_candidates(track.key, track.candidates);
+            soundsphere::lyric_cache_put_lyric(track.key, track.candidates[0].id, track.lyric);
+            ret.misses++;
+        }
+        else if (_bench_lyric_same(candidates, track.candidates) && lyric == track.lyric)
+        {
+            ret.hits++;
+        }
+        else
+        {
+            ret.wrong++;
+        }
+    }
+    ret.ms = (ev_hrtime() - t_beg) / 1000000.0;
+
+    return ret;
+}
+
+static void _bench_lyric_report(const char *name, const bench_lyric_round_t &r)
+{
+    printf("%-8s %9.1f %9zu %9zu %9zu\n", name, r.ms, r.hits, r.misses, r.wrong);
+}
+
+/**
+ * @brief Check that every track of \p r is served as expected.
+ * @param[in] cached    Whether all tracks must come from cache, or all miss.
+ * @return true if passed.
+ */
+static bool _bench_lyric_check(const char *name, const bench_lyric_round_t &r, size_t tracks, bool cached)
+{
+    size_t want_hits = cached ? tracks : 0;
+    if (r.hits == want_hits && r.misses == tracks - want_hits && r.wrong == 0)
+    {
+        return true;
+    }
+
+    fprintf(stderr, "%s: expect %zu hits, %zu misses, 0 wrong\n", name, want_hits, tracks - want_hits);
+    return false;
+}
+
+static int _bench_lyric_cache_entry(int argc, char *argv[])
+{
+    int64_t tracks = soundsphere::bench_opt_int(argc, argv, "--tracks", 500);
+
+    /* A fresh configuration directory, so every run starts with an empty cache. */
+    std::string tmp = soundsphere::getenv("TMPDIR");
+    std::string dir = (tmp.empty() ? std::string("/tmp") : tmp) + "/soundsphere_bench_lyric_cache";
+    ev_fs_remove(nullptr, nullptr, dir.c_str(), 1, nullptr);
+    soundsphere::setenv("XDG_CONFIG_HOME", dir);
+    soundsphere::setenv("APPDATA", dir);
+
+    soundsphere::config_init();
+    soundsphere::lyric_cache_init();
+
+    BenchLyricTrackVec items;
+    for (int64_t i = 0; i < tracks; i++)
+    {
+        soundsphere::kugou_candidate_t candidate;
+        candidate.id = soundsphere::string_format("%lld", (long long)i);
+        candidate.accesskey = soundsphere::string_format("key%lld", (long long)i);
+        candidate.artist = "bench";
+        candidate.title = soundsphere::string_format("track %lld", (long long)i);
+        candidate.duration = 240;
+
+        bench_lyric_track_t track;
+        track.key = soundsphere::lyric_cache_key(candidate.artist, candidate.title, candidate.duration);
+        track.candidates.push_back(candidate);
+        track.lyric = soundsphere::string_format("[00:00.00]bench lyric %lld\n", (long long)i);
+        items.push_back(track);
+    }
+
+    printf("tracks=%lld\n\n", (long long)tracks);
+    printf("%-8s %9s %9s %9s %9s\n", "round", "time(ms)", "hits", "misses", "wrong");
+
+    /* Miss, then hit in memory, then hit after the index is reloaded from disk. */
+    bench_lyric_round_t cold = _bench_lyric_round(items);
+    bench_lyric_round_t warm = _bench_lyric_round(items);
+    soundsphere::lyric_cache_exit();
+    soundsphere::lyric_cache_init();
+    bench_lyric_round_t reload = _bench_lyric_round(items);
+
+    _bench_lyric_report("cold", cold);
+    _bench_lyric_report("warm", warm);
+    _bench_lyric_report("reload", reload);
+
+    bool pass = _bench_lyric_check("cold", cold, items.size(), false);
+    pass = _bench_lyric_check("warm", warm, items.size(), true) && pass;
+    pass = _bench_lyric_check("reload", reload, items.size(), true) && pass;
+
+    soundsphere::lyric_cache_exit();
+    soundsphere::config_exit();
+
+    printf("\n%s\n", pass ? "PASS" : "FAIL");
+    return pass ? 0 : 1;
+}
+
+const soundsphere::bench_t soundsphere::bench_lyric_cache = {
+    "lyric_cache",
+    "Lyric cache lookups: miss, hit, and hit after index reload. Fails if any track is not served as stored. "
+    "--tracks N",
+    _bench_lyric_cache_entry,
+};
@@ -0,0 +1,43 @@
+#include <cstdio>
+#include <cstring>
+#include "utils/defines.hpp"
+#include "__init__.hpp"
+
+/**
+ * @brief Registered benchmark suites.
+ */
+static const soundsphere::bench_t *s_benches[] = {
+#define SOUNDSPHERE_EXPAND_BENCH_MAP_AS_ARRAY(a) &soundsphere::a,
+    SOUNDSPHERE_BENCH_TABLE(SOUNDSPHERE_EXPAND_BENCH_MAP_AS_ARRAY)
+#undef SOUNDSPHERE_EXPAND_BENCH_MAP_AS_ARRAY
+};
+
+static void _bench_usage(const char *prog)
+{
+    printf("Usage: %s <suite> [options]\n\nSuites:\n", prog);
+    for (size_t i = 0; i < ARRAY_SIZE(s_benches); i++)
+    {
+        printf("  %-10s %s\n", s_benches[i]->name, s_benches[i]->help);
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    if (argc < 2)
+    {
+        _bench_usage(argv[0]);
+        return 1;
+    }
+
+    for (size_t i = 0; i < ARRAY_SIZE(s_benches); i++)
+    {
+        if (strcmp(s_benches[i]->name, argv[1]) == 0)
+        {
+            return s_benches[i]->entry(argc - 2, argv + 2);
+        }
+    }
+
+    fprintf(stderr, "unknown suite `%s`\n", argv[1]);
+    _bench_usage(argv[0]);
+    return 1;
+}
@@ -0,0 +1,94 @@
+#include <ev.h>
+#include <SDL.h>
+#include <cstdio>
+#include <random>
+#include "audio/mix.hpp"
+#include "__init__.hpp"
+
+/**
+ * @brief Run \p fn \p iterations times over \p frames frames and print one report row.
+ * @param[in] expect    Output of the scalar version, to check \p fn against.
+ * @return Samples that differ from \p expect.
+ */
+static size_t _bench_mix_run(const char *name, soundsphere::audio_mix_ramp_s16_fn fn, const std::vector<int16_t> &a,
+                           const std::vector<int16_t> &b, int channels, int64_t iterations,
+                           const std::vector<int16_t> &expect)
+{
+    size_t               frames = a.size() / channels;
+    std::vector<int16_t> dst(a.size());
+    std::vector<double>  samples;
+    float                step = 1.0f / (float)frames;
+
+    samples.reserve((size_t)iterations);
+    for (int64_t i = 0; i < iterations; i++)
+    {
+        uint64_t t_beg = ev_hrtime();
+        fn(dst.data(), a.data(), b.data(), frames, channels, 1.0f, -step, 0.0f, step);
+        uint64_t t_end = ev_hrtime();
+
+        samples.push_back((t_end - t_beg) / 1000.0);
+    }
+
+    size_t mismatch = 0;
+    for (size_t i = 0; i < dst.size(); i++)
+    {
+        mismatch += dst[i] != expect[i] ? 1 : 0;
+    }
+
+    soundsphere::bench_stat_t t = soundsphere::bench_stat(samples);
+    double mframes_per_s = t.mean > 0 ? (double)frames / t.mean : 0;
+    printf("%-8s %9.3f %9.3f %9.3f %9.3f %11.1f %9zu\n", name, t.mean, t.p50, t.p99, t.max, mframes_per_s, mismatch);
+    return mismatch;
+}
+
+static int _bench_mix_entry(int argc, char *argv[])
+{
+    /* Odd, so SIMD versions finish with a tail. */
+    int64_t frames = soundsphere::bench_opt_int(argc, argv, "--frames", 4095);
+    int64_t channels = soundsphere::bench_opt_int(argc, argv, "--channels", 2);
+    int64_t iterations = soundsphere::bench_opt_int(argc, argv, "--iterations", 2000);
+
+    /* Full scale noise, so saturation is exercised. */
+    std::vector<int16_t>               a((size_t)(frames * channels)), b((size_t)(frames * channels));
+    std::mt19937                       rng(0);
+    std::uniform_int_distribution<int> dist(INT16_MIN, INT16_MAX);
+    for (size_t i = 0; i < a.size(); i++)
+    {
+        a[i] = (int16_t)dist(rng);
+        b[i] = (int16_t)dist(rng);
+    }
+
+    std::vector<int16_t> expect(a.size());
+    float                step = 1.0f / (float)frames;
+    soundsphere::audio_mix_ramp_s16_scalar(expect.data(), a.data(), b.data(), (size_t)frames, (int)channels, 1.0f,
+                                           -step, 0.0f, step);
+
+    printf("frames=%lld channels=%lld iterations=%lld\n\n", (long long)frames, (long long)channels,
+           (long long)iterations);
+    printf("%-8s %9s %9s %9s %9s %11s %9s\n", "impl", "mean(us)", "p50(us)", "p99(us)", "max(us)", "Mframes/s",
+           "mismatch");
+
+    size_t mismatch =
+        _bench_mix_run("scalar", soundsphere::audio_mix_ramp_s16_scalar, a, b, (int)channels, iterations, expect);
+#if defined(AUDIO_MIX_X86)
+    if (SDL_HasSSE2())
+    {
+        mismatch += _bench_mix_run("sse2", soundsphere::audio_mix_ramp_s16_sse2, a, b, (int)channels, iterations,
+                                   expect);
+    }
+    if (SDL_HasAVX2())
+    {
+        mismatch += _bench_mix_run("avx2", soundsphere::audio_mix_ramp_s16_avx2, a, b, (int)channels, iterations,
+                                   expect);
+    }
+#endif
+
+    /* SIMD versions must be bit exact. */
+    return mismatch != 0 ? 1 : 0;
+}
+
+const soundsphere::bench_t soundsphere::bench_mix = {
+    "mix",
+    "Crossfade mixing kernel, scalar vs SIMD. --frames N --channels N --iterations N",
+    _bench_mix_entry,
+};
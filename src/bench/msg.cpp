@@ -0,0 +1,292 @@
+#include <ev.h>
+#include <atomic>
+#include <cstdio>
+#include <list>
+#include <thread>
+#include "widgets/dummy_player.hpp"
+#include "widgets/msg_queue.hpp"
+#include "__init__.hpp"
+
+using namespace soundsphere;
+
+/**
+ * @brief Message bus under test.
+ */
+typedef struct bench_msg_bus
+{
+    const char *name;
+
+    /**
+     * @brief Build and queue one request from producer thread.
+     * @return 0 if success.
+     */
+    int (*send)(int value);
+
+    /**
+     * @brief Drain queue from consumer thread, as UI does once per frame.
+     * @return The number of messages handled.
+     */
+    size_t (*drain)(int64_t &sum);
+} bench_msg_bus_t;
+
+typedef struct bench_msg_producer
+{
+    const bench_msg_bus_t *bus;      /**< Bus under test. */
+    int64_t                messages; /**< Messages to send. */
+    std::atomic<int>      *running;  /**< Running producers. */
+    std::atomic<int>      *full;     /**< Times queue was full. */
+} bench_msg_producer_t;
+
+/**
+ * @brief Message type of current run.
+ */
+static bool s_bench_msg_slider = false;
+
+/*
+ * The message bus before lock-free queues, kept as baseline: every message and
+ * payload comes from heap, and the queue is a list under a mutex.
+ */
+
+static ev_mutex_t          s_bench_msg_legacy_mutex;
+static std::list<Msg::Ptr> s_bench_msg_legacy_queue;
+
+template <typename T>
+static Msg::Ptr _bench_msg_legacy_make(std::shared_ptr<typename T::Req> req)
+{
+    Msg::RspProxy<T> proxy((typename Msg::RspProxy<T>::Fn()));
+    Msg::Rsp::Fn     proxy_fn = std::bind(&Msg::RspProxy<T>::proxy_cb, proxy, std::placeholders::_1);
+    return std::make_shared<Msg>(WIDGET_ID_DUMMY_PLAYER, msg_traits<T>::ID, req, proxy_fn);
+}
+
+static int _bench_msg_legacy_send(int value)
+{
+    Msg::Ptr msg;
+    if (s_bench_msg_slider)
+    {
+        msg = _bench_msg_legacy_make<DummyPlayerSetVolume>(std::make_shared<DummyPlayerSetVolume::Req>(value));
+    }
+    else
+    {
+        auto mode = (DummyPlayerSetShuffleMode::shuffle_mode)(value % 3);
+        msg = _bench_msg_legacy_make<DummyPlayerSetShuffleMode>(std::make_shared<DummyPlayerSetShuffleMode::Req>(mode));
+    }
+
+    ev_mutex_enter(&s_bench_msg_legacy_mutex);
+    s_bench_msg_legacy_queue.push_back(msg);
+    ev_mutex_leave(&s_bench_msg_legacy_mutex);
+    return 0;
+}
+
+static void _bench_msg_handle(const Msg::Ptr &msg, int64_t &sum)
+{
+    if (s_bench_msg_slider)
+    {
+        sum += msg->get_req<DummyPlayerSetVolume>()->volume;
+    }
+    else
+    {
+        sum += msg->get_req<DummyPlayerSetShuffleMode>()->mode;
+    }
+}
+
+static size_t _bench_msg_legacy_drain(int64_t &sum)
+{
+    size_t   cnt = 0;
+    bool     have_msg;
+    Msg::Ptr msg;
+
+    do
+    {
+        have_msg = false;
+        ev_mutex_enter(&s_bench_msg_legacy_mutex);
+        if (!s_bench_msg_legacy_queue.empty())
+        {
+            have_msg = true;
+            msg = s_bench_msg_legacy_queue.front();
+            s_bench_msg_legacy_queue.pop_front();
+        }
+        ev_mutex_leave(&s_bench_msg_legacy_mutex);
+
+        if (have_msg)
+        {
+            _bench_msg_handle(msg, sum);
+            cnt++;
+        }
+    } while (have_msg);
+
+    return cnt;
+}
+
+/*
+ * Current message bus.
+ */
+
+static MsgQueue *s_bench_msg_queue = nullptr;
+
+static int _bench_msg_ring_send(int value)
+{
+    Msg::Ptr msg;
+    if (s_bench_msg_slider)
+    {
+        msg = widget_make_req<DummyPlayerSetVolume>(WIDGET_ID_DUMMY_PLAYER,
+                                                    Msg::make_req<DummyPlayerSetVolume>(value));
+    }
+    else
+    {
+        auto mode = (DummyPlayerSetShuffleMode::shuffle_mode)(value % 3);
+        msg = widget_make_req<DummyPlayerSetShuffleMode>(WIDGET_ID_DUMMY_PLAYER,
+                                                         Msg::make_req<DummyPlayerSetShuffleMode>(mode));
+    }
+    return s_bench_msg_queue->push(msg);
+}
+
+static size_t _bench_msg_ring_drain(int64_t &sum)
+{
+    size_t cnt = 0;
+    if (!s_bench_msg_queue->take_pending())
+    {
+        return 0;
+    }
+
+    Msg::Ptr msg;
+    while (s_bench_msg_queue->pop(msg))
+    {
+        _bench_msg_handle(msg, sum);
+        cnt++;
+    }
+    return cnt;
+}
+
+static const bench_msg_bus_t s_bench_msg_buses[] = {
+    { "legacy", _bench_msg_legacy_send, _bench_msg_legacy_drain },
+    { "ring",   _bench_msg_ring_send,   _bench_msg_ring_drain   },
+};
+
+static void _bench_msg_producer(void *arg)
+{
+    bench_msg_producer_t *producer = static_cast<bench_msg_producer_t *>(arg);
+    for (int64_t i = 0; i < producer->messages; i++)
+    {
+        while (producer->bus->send((int)(i % 128)) != 0)
+        {
+            (*producer->full)++;
+            std::this_thread::yield();
+        }
+    }
+    (*producer->running)--;
+}
+
+/**
+ * @brief Producers send \p messages each while one consumer drains.
+ */
+static void _bench_msg_run(const bench_msg_bus_t *bus, int producers, int64_t messages)
+{
+    std::atomic<int> running(producers);
+    std::atomic<int> full(0);
+    int64_t          sum = 0;
+    size_t           handled = 0;
+    size_t           drains = 0;
+
+    uint64_t alloc_beg = bench_alloc_count();
+    uint64_t t_beg = ev_hrtime();
+
+    bench_msg_producer_t producer = { bus, messages, &running, &full };
+    ev_os_thread_t      *threads = new ev_os_thread_t[producers];
+    for (int i = 0; i < producers; i++)
+    {
+        ev_thread_init(&threads[i], nullptr, _bench_msg_producer, &producer);
+    }
+
+    for (;;)
+    {
+        bool   done = running.load() == 0;
+        size_t cnt = bus->drain(sum);
+        handled += cnt;
+        drains++;
+        if (done && bus->drain(sum) == 0)
+        {
+            break;
+        }
+
+        /* Like a frame with nothing to do, let producers run. */
+        if (cnt == 0)
+        {
+            std::this_thread::yield();
+        }
+    }
+
+    uint64_t t_end = ev_hrtime();
+    for (int i = 0; i < producers; i++)
+    {
+        ev_thread_exit(&threads[i], EV_INFINITE_TIMEOUT);
+    }
+    delete[] threads;
+    uint64_t allocs = bench_alloc_count() - alloc_beg;
+
+    double sent = (double)producers * (double)messages;
+    double sec = (t_end - t_beg) / 1000000000.0;
+    printf("%-8s %-8s %12.0f %10zu %10zu %11.2f %8d\n", bus->name, s_bench_msg_slider ? "slider" : "plain",
+           sent / sec, handled, drains, (double)allocs / sent, full.load());
+    (void)sum;
+}
+
+/**
+ * @brief Cost of checking all widget queues in a frame without any message.
+ */
+static void _bench_msg_idle(const bench_msg_bus_t *bus, int64_t frames)
+{
+    int64_t  sum = 0;
+    uint64_t t_beg = ev_hrtime();
+    for (int64_t i = 0; i < frames; i++)
+    {
+        /* One request queue per widget, plus response and event queue. */
+        for (int j = 0; j < WIDGET_ID__MAX + 2; j++)
+        {
+            bus->drain(sum);
+        }
+    }
+    uint64_t t_end = ev_hrtime();
+
+    printf("%-8s idle frame: %.1f ns\n", bus->name, (double)(t_end - t_beg) / (double)frames);
+}
+
+static int _bench_msg_entry(int argc, char *argv[])
+{
+    int     producers = (int)bench_opt_int(argc, argv, "--producers", 2);
+    int64_t messages = bench_opt_int(argc, argv, "--messages", 200000);
+    int64_t frames = bench_opt_int(argc, argv, "--frames", 100000);
+
+    ev_mutex_init(&s_bench_msg_legacy_mutex, 0);
+    s_bench_msg_queue = new MsgQueue(256);
+
+    printf("producers=%d messages=%lld per producer\n\n", producers, (long long)messages);
+    printf("%-8s %-8s %12s %10s %10s %11s %8s\n", "impl", "type", "msg/s", "handled", "drains", "allocs/msg",
+           "full");
+
+    for (int slider = 0; slider < 2; slider++)
+    {
+        s_bench_msg_slider = slider != 0;
+        for (size_t i = 0; i < sizeof(s_bench_msg_buses) / sizeof(s_bench_msg_buses[0]); i++)
+        {
+            _bench_msg_run(&s_bench_msg_buses[i], producers, messages);
+        }
+    }
+
+    printf("\n");
+    for (size_t i = 0; i < sizeof(s_bench_msg_buses) / sizeof(s_bench_msg_buses[0]); i++)
+    {
+        _bench_msg_idle(&s_bench_msg_buses[i], frames);
+    }
+
+    delete s_bench_msg_queue;
+    s_bench_msg_queue = nullptr;
+    ev_mutex_exit(&s_bench_msg_legacy_mutex);
+
+    return 0;
+}
+
+const soundsphere::bench_t soundsphere::bench_msg = {
+    "msg",
+    "Widget message bus, legacy mutex list vs lock-free ring. --producers N --messages N --frames N",
+    _bench_msg_entry,
+};
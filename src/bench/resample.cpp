@@ -0,0 +1,147 @@
+#include <ev.h>
+#include <SDL.h>
+#include <cmath>
+#include <cstdio>
+#include <random>
+#include "audio/resample.hpp"
+#include "__init__.hpp"
+
+typedef struct bench_resample_input
+{
+    int64_t seconds;  /**< Length of audio. */
+    int64_t from;     /**< Input sample rate. */
+    int64_t to;       /**< Output sample rate. */
+    int64_t channels; /**< Channels. */
+    int64_t tone;     /**< Frequency of the tone SNR is measured with, in Hz. */
+} bench_resample_input_t;
+
+static const char *s_bench_resample_tiers[soundsphere::AUDIO_RESAMPLE_QUALITY_COUNT] = {
+    "fast",
+    "medium",
+    "high",
+    "best",
+};
+
+/**
+ * @brief Resample all of \p pcm.
+ * @return Output frames.
+ */
+static size_t _bench_resample_all(soundsphere::audio_resampler_t &rs, const std::vector<int16_t> &pcm,
+                                  std::vector<int16_t> &out)
+{
+    size_t frames = pcm.size() / rs.channels;
+    size_t n = soundsphere::audio_resample_process(rs, pcm.data(), frames, out.data());
+    n += soundsphere::audio_resample_flush(rs, out.data() + n * rs.channels);
+    return n;
+}
+
+/**
+ * @brief Signal to noise ratio of a resampled tone against the ideal one at output rate,
+ * away from the edges. 16-bit output bounds it at about 92 dB.
+ */
+static double _bench_resample_snr(soundsphere::audio_resampler_t &rs, const bench_resample_input_t &in)
+{
+    const double         amp = 16384.0;
+    const double         w = 2.0 * 3.14159265358979323846 * (double)in.tone;
+    size_t               frames = (size_t)(in.seconds * in.from);
+    std::vector<int16_t> pcm(frames * rs.channels);
+    for (size_t f = 0; f < frames; f++)
+    {
+        int16_t v = (int16_t)std::lrint(amp * std::sin(w * (double)f / (double)in.from));
+        for (int c = 0; c < rs.channels; c++)
+        {
+            pcm[f * rs.channels + c] = v;
+        }
+    }
+
+    std::vector<int16_t> out(soundsphere::audio_resample_frames(rs, frames + rs.taps) * rs.channels);
+    size_t               n = _bench_resample_all(rs, pcm, out);
+
+    double signal = 0.0, noise = 0.0;
+    for (size_t f = rs.taps; f + rs.taps < n; f++)
+    {
+        double ideal = amp * std::sin(w * (double)f / (double)in.to);
+        double err = (double)out[f * rs.channels] - ideal;
+        signal += ideal * ideal;
+        noise += err * err;
+    }
+    return noise > 0.0 ? 10.0 * std::log10(signal / noise) : INFINITY;
+}
+
+static void _bench_resample_run(const char *impl, soundsphere::audio_resample_dot_fn dot,
+                                const bench_resample_input_t &in, int64_t iterations, const std::vector<int16_t> &pcm)
+{
+    for (int q = 0; q < soundsphere::AUDIO_RESAMPLE_QUALITY_COUNT; q++)
+    {
+        soundsphere::audio_resampler_t rs((int)in.from, (int)in.to, (int)in.channels,
+                                          (soundsphere::audio_resample_quality_t)q);
+        rs.dot = dot;
+
+        size_t               frames = pcm.size() / rs.channels;
+        std::vector<int16_t> out(soundsphere::audio_resample_frames(rs, frames + rs.taps) * rs.channels);
+        std::vector<double>  samples;
+        size_t               produced = 0;
+        samples.reserve((size_t)iterations);
+        for (int64_t i = 0; i < iterations; i++)
+        {
+            uint64_t t_beg = ev_hrtime();
+            produced = _bench_resample_all(rs, pcm, out);
+            uint64_t t_end = ev_hrtime();
+
+            samples.push_back((t_end - t_beg) / 1000.0);
+        }
+
+        soundsphere::bench_stat_t t = soundsphere::bench_stat(samples);
+        double msamples_per_s = t.mean > 0 ? (double)(produced * rs.channels) / t.mean : 0;
+        double core = t.mean / ((double)in.seconds * 1e6) * 100.0;
+        double snr = _bench_resample_snr(rs, in);
+        printf("%-8s %-8s %5zu %9.1f %9.1f %9.1f %9.1f %11.1f %9.4f %9.1f\n", s_bench_resample_tiers[q], impl,
+               rs.taps, t.mean, t.p50, t.p99, t.max, msamples_per_s, core, snr);
+    }
+}
+
+static int _bench_resample_entry(int argc, char *argv[])
+{
+    bench_resample_input_t in;
+    in.seconds = soundsphere::bench_opt_int(argc, argv, "--seconds", 1);
+    in.from = soundsphere::bench_opt_int(argc, argv, "--from", 44100);
+    in.to = soundsphere::bench_opt_int(argc, argv, "--to", 48000);
+    in.channels = soundsphere::bench_opt_int(argc, argv, "--channels", 2);
+    in.tone = soundsphere::bench_opt_int(argc, argv, "--tone", 10000);
+    int64_t iterations = soundsphere::bench_opt_int(argc, argv, "--iterations", 20);
+
+    /* Noise at -12 dBFS, so no output saturates. */
+    std::vector<int16_t>               pcm((size_t)(in.seconds * in.from * in.channels));
+    std::mt19937                       rng(0);
+    std::uniform_int_distribution<int> dist(-8192, 8191);
+    for (size_t i = 0; i < pcm.size(); i++)
+    {
+        pcm[i] = (int16_t)dist(rng);
+    }
+
+    printf("seconds=%lld from=%lld to=%lld channels=%lld tone=%lld iterations=%lld\n\n", (long long)in.seconds,
+           (long long)in.from, (long long)in.to, (long long)in.channels, (long long)in.tone, (long long)iterations);
+    printf("%-8s %-8s %5s %9s %9s %9s %9s %11s %9s %9s\n", "tier", "impl", "taps", "mean(us)", "p50(us)", "p99(us)",
+           "max(us)", "Msamples/s", "core(%)", "snr(dB)");
+
+    _bench_resample_run("scalar", soundsphere::audio_resample_dot_scalar, in, iterations, pcm);
+#if defined(AUDIO_MIX_X86)
+    if (SDL_HasSSE2())
+    {
+        _bench_resample_run("sse2", soundsphere::audio_resample_dot_sse2, in, iterations, pcm);
+    }
+    if (SDL_HasAVX2())
+    {
+        _bench_resample_run("avx2", soundsphere::audio_resample_dot_avx2, in, iterations, pcm);
+    }
+#endif
+
+    return 0;
+}
+
+const soundsphere::bench_t soundsphere::bench_resample = {
+    "resample",
+    "Polyphase resampler throughput per core and SNR of a tone at each quality tier, scalar vs SIMD. "
+    "--seconds N --from N --to N --channels N --tone N --iterations N",
+    _bench_resample_entry,
+};
@@ -74,17 +74,85 @@ config_lyric::config_lyric()
     fore_font_color[1] = 0.0f;
     fore_font_color[2] = 0.0f;
     fore_font_color[3] = 1.0f;
+    cache_size_mb = 16;
+    fetch_connections = 4;
+    fetch_rate_limit = 10;
 }
 
-JSON_SERDE(config_lyric_t, auto_center_time_ms, back_font_color, fore_font_color)
+JSON_SERDE(config_lyric_t, auto_center_time_ms, back_font_color, fore_font_color, cache_size_mb, fetch_connections,
+           fetch_rate_limit)
+
+config_audio::config_audio()
+{
+    buffer_frames = 2048;
+    read_ahead_ms = 1000;
+    crossfade_ms = 0;
+    replaygain = 0;
+    replaygain_preamp_db = 0.0;
+    bit_perfect = false;
+}
+
+JSON_SERDE(config_audio_t, buffer_frames, read_ahead_ms, crossfade_ms, replaygain, replaygain_preamp_db,
+           bit_perfect)
+
+config_eq_band::config_eq_band()
+{
+    freq = 1000.0;
+    gain_db = 0.0;
+    q = 1.41;
+}
+
+JSON_SERDE(config_eq_band_t, freq, gain_db, q)
+
+config_eq_preset::config_eq_preset()
+{
+    preamp_db = 0.0;
+    bands.resize(10);
+    for (size_t i = 0; i < bands.size(); i++)
+    {
+        bands[i].freq = 31.25 * (double)(1 << i);
+    }
+}
+
+JSON_SERDE(config_eq_preset_t, name, preamp_db, bands)
+
+/**
+ * @brief Build a preset from gain of each octave band.
+ */
+static config_eq_preset_t _config_eq_preset(const char *name, double preamp_db, const double (&gains)[10])
+{
+    config_eq_preset_t preset;
+    preset.name = name;
+    preset.preamp_db = preamp_db;
+    for (size_t i = 0; i < preset.bands.size(); i++)
+    {
+        preset.bands[i].gain_db = gains[i];
+    }
+    return preset;
+}
+
+config_eq::config_eq()
+{
+    enabled = false;
+    preset = 0;
+
+    /* Preamp leaves headroom for the loudest band. */
+    presets.push_back(_config_eq_preset("Flat", 0, { 0, 0, 0, 0, 0, 0, 0, 0, 0, 0 }));
+    presets.push_back(_config_eq_preset("Bass Boost", -6, { 6, 6, 4, 2, 0, 0, 0, 0, 0, 0 }));
+    presets.push_back(_config_eq_preset("Treble Boost", -6, { 0, 0, 0, 0, 0, 0, 2, 4, 6, 6 }));
+    presets.push_back(_config_eq_preset("Vocal", -3, { -3, -3, -2, 0, 2, 3, 3, 2, 0, -2 }));
+}
+
+JSON_SERDE(config_eq_t, enabled, preset, presets)
 
 config::config()
 {
     language = _get_locale();
     volume = 50;
+    ui_job_budget_ms = 4;
 }
 
-JSON_SERDE(config_t, language, volume, lyric, songs, proxy)
+JSON_SERDE(config_t, language, volume, lyric, audio, eq, songs, proxy, ui_job_budget_ms)
 
 } // namespace soundsphere
 
@@ -169,3 +237,8 @@ bool soundsphere::config_save(std::string &errinfo)
 
     return true;
 }
+
+std::string soundsphere::config_dir(void)
+{
+    return soundsphere::dirname(s_config_ctx->path);
+}
@@ -24,8 +24,121 @@ typedef struct config_lyric
      * @brief Current shown lyric font color.
      */
     float fore_font_color[4];
+
+    /**
+     * @brief Maximum size of downloaded lyric cache in MiB.
+     */
+    uint64_t cache_size_mb;
+
+    /**
+     * @brief Maximum connections to lyric server when fetching lyrics in batch.
+     */
+    int fetch_connections;
+
+    /**
+     * @brief Maximum lyric requests per second when fetching lyrics in batch.
+     */
+    double fetch_rate_limit;
 } config_lyric_t;
 
+typedef struct config_audio
+{
+    config_audio();
+
+    /**
+     * @brief Output buffer of audio device, in frames. Takes effect on restart.
+     */
+    int buffer_frames;
+
+    /**
+     * @brief Decoded audio buffered ahead of output, in milliseconds. Takes effect on restart.
+     */
+    int read_ahead_ms;
+
+    /**
+     * @brief Crossfade between tracks, in milliseconds. 0 to disable.
+     */
+    int crossfade_ms;
+
+    /**
+     * @brief ReplayGain mode, #soundsphere::audio_replaygain_t.
+     */
+    int replaygain;
+
+    /**
+     * @brief ReplayGain pre-amplification, in dB.
+     */
+    double replaygain_preamp_db;
+
+    /**
+     * @brief Reopen device at the sample rate and channels of each track, so it is not resampled.
+     */
+    bool bit_perfect;
+} config_audio_t;
+
+typedef struct config_eq_band
+{
+    config_eq_band();
+
+    /**
+     * @brief Center frequency, in Hz.
+     */
+    double freq;
+
+    /**
+     * @brief Gain, in dB.
+     */
+    double gain_db;
+
+    /**
+     * @brief Quality factor.
+     */
+    double q;
+} config_eq_band_t;
+
+typedef struct config_eq_preset
+{
+    /**
+     * @brief Flat preset, bands at octave centers from 31 Hz to 16 kHz.
+     */
+    config_eq_preset();
+
+    /**
+     * @brief Preset name.
+     */
+    std::string name;
+
+    /**
+     * @brief Gain before bands, in dB.
+     */
+    double preamp_db;
+
+    /**
+     * @brief Bands, from low to high.
+     */
+    std::vector<config_eq_band_t> bands;
+} config_eq_preset_t;
+
+typedef struct config_eq
+{
+    config_eq();
+
+    /**
+     * @brief Whether equalizer is on.
+     */
+    bool enabled;
+
+    /**
+     * @brief Index of preset in use.
+     */
+    int preset;
+
+    /**
+     * @brief Presets.
+     */
+    std::vector<config_eq_preset_t> presets;
+} config_eq_t;
+
 typedef struct config
 {
     config();
@@ -45,6 +158,16 @@ typedef struct config
      */
     config_lyric_t lyric;
 
+    /**
+     * @brief Audio output.
+     */
+    config_audio_t audio;
+
+    /**
+     * @brief Output equalizer.
+     */
+    config_eq_t eq;
+
     /**
      * @brief Song paths.
      */
@@ -54,6 +177,11 @@ typedef struct config
      * @brief Proxy.
      */
     std::string proxy;
+
+    /**
+     * @brief Time in milliseconds UI may spend on queued jobs per frame. 0 for no limit.
+     */
+    double ui_job_budget_ms;
 } config_t;
 
 /**
@@ -76,6 +204,12 @@ void config_exit(void);
  */
 bool config_save(std::string &errinfo);
 
+/**
+ * @brief Get the directory that holds configuration file.
+ * @return Directory path.
+ */
+std::string config_dir(void);
+
 } // namespace soundsphere
 
 #endif
@@ -8,13 +8,16 @@ extern "C" {
  * @brief i18n strings.
  */
 #define I18N_STRING_TABLE(xx)                                                                                          \
-    xx(add) xx(add_folder) xx(about) xx(about_show_config_info) xx(artist) xx(bit_rate) xx(channel) xx(debug)          \
-        xx(duration) xx(file) xx(generic) xx(help) xx(homepage) xx(lang) xx(localization) xx(lyric)                    \
-            xx(lyric_auto_center_time) xx(lyric_font_back_color) xx(lyric_font_fore_color) xx(name) xx(open)           \
-                xx(open_folder) xx(original_text) xx(path) xx(preferences) xx(proxy) xx(sample_rate) xx(save)          \
-                    xx(search_artist) xx(search_lyric) xx(search_playlist) xx(search_title) xx(settings)               \
-                        xx(tag_editor) xx(tip_lyric_auto_center_time) xx(title) xx(translated_text) xx(translations)   \
-                            xx(version)
+    xx(add) xx(add_folder) xx(about) xx(about_show_config_info) xx(album) xx(artist) xx(audio) xx(bit_perfect)         \
+        xx(bit_rate) xx(cached) xx(channel) xx(crossfade) xx(debug) xx(duration) xx(enabled) xx(equalizer) xx(failed)  \
+            xx(fetch_lyrics) xx(file) xx(generic) xx(help) xx(homepage) xx(lang) xx(localization) xx(lyric)            \
+                xx(lyric_auto_center_time) xx(lyric_font_back_color) xx(lyric_font_fore_color) xx(name) xx(off)        \
+                    xx(open) xx(open_folder) xx(original_text) xx(output) xx(path) xx(preamp) xx(preferences)          \
+                        xx(preset) xx(proxy) xx(remove) xx(replaygain) xx(sample_rate) xx(save) xx(scan_loudness)      \
+                            xx(search_artist) xx(search_lyric) xx(search_playlist) xx(search_title) xx(settings)       \
+                                xx(start) xx(stop) xx(tag_editor) xx(tip_bit_perfect) xx(tip_lyric_auto_center_time)   \
+                                    xx(title) xx(tools) xx(track) xx(tracks_per_second) xx(translated_text)            \
+                                        xx(translations) xx(version) xx(visualizer) xx(write_to_file)
 
 /**
  * @brief i18n locals.
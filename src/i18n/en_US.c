@@ -14,21 +14,48 @@ static soundsphere_i18n_translation_t _soundsphere_i18n_en_us = {
 .about_show_config_info =
 "Show Config/Build Information",
 
+.album =
+"Album",
+
 .artist =
 "Artist",
 
+.audio =
+"Audio",
+
+.bit_perfect =
+"Bit-perfect output",
+
 .bit_rate =
 "Bit rate",
 
+.cached =
+"Cached",
+
 .channel =
 "Channel",
 
+.crossfade =
+"Crossfade (s)",
+
 .debug =
 "Debug",
 
 .duration =
 "Duration",
 
+.enabled =
+"Enabled",
+
+.equalizer =
+"Equalizer",
+
+.failed =
+"Failed",
+
+.fetch_lyrics =
+"Fetch Missing Lyrics",
+
 .file =
 "File",
 
@@ -62,6 +89,9 @@ static soundsphere_i18n_translation_t _soundsphere_i18n_en_us = {
 .name =
 "Name",
 
+.off =
+"Off",
+
 .open =
 "Open",
 
@@ -71,21 +101,39 @@ static soundsphere_i18n_translation_t _soundsphere_i18n_en_us = {
 .original_text =
 "Original Text",
 
+.output =
+"Output",
+
 .path =
 "Path",
 
+.preamp =
+"Pre-amp (dB)",
+
 .preferences =
 "Preferences",
 
+.preset =
+"Preset",
+
 .proxy =
 "Proxy",
 
+.remove =
+"Remove",
+
+.replaygain =
+"ReplayGain",
+
 .sample_rate =
 "Sample rate",
 
 .save =
 "Save",
 
+.scan_loudness =
+"Scan Loudness",
+
 .search_artist =
 "Search Artist",
 
@@ -101,15 +149,33 @@ static soundsphere_i18n_translation_t _soundsphere_i18n_en_us = {
 .settings =
 "Settings",
 
+.start =
+"Start",
+
+.stop =
+"Stop",
+
 .tag_editor =
 "Tag Editor",
 
+.tip_bit_perfect =
+"Reopen audio device at the sample rate and channels of each track, so it is not resampled. Tracks of another format start without gapless or crossfade.",
+
 .tip_lyric_auto_center_time =
 "Time for auto-centering after manual scrolling of lyrics. Unit: seconds.",
 
 .title =
 "Title",
 
+.tools =
+"Tools",
+
+.track =
+"Track",
+
+.tracks_per_second =
+"tracks/s",
+
 .translated_text =
 "Translated Text",
 
@@ -119,6 +185,12 @@ static soundsphere_i18n_translation_t _soundsphere_i18n_en_us = {
 .version =
 "Version",
 
+.visualizer =
+"Visualizer",
+
+.write_to_file =
+"Write to File Tags",
+
 };
 /* clang-format on */
 
@@ -16,21 +16,48 @@ static soundsphere_i18n_translation_t _soundsphere_i18n_zh_CN = {
 .about_show_config_info =
 "显示配置/编译信息",
 
+.album =
+"专辑",
+
 .artist =
 "艺术家",
 
+.audio =
+"音频",
+
+.bit_perfect =
+"无损输出",
+
 .bit_rate =
 "比特率",
 
+.cached =
+"已缓存",
+
 .channel =
 "通道",
 
+.crossfade =
+"淡入淡出 (秒)",
+
 .debug =
 "调试",
 
 .duration =
 "时长",
 
+.enabled =
+"启用",
+
+.equalizer =
+"均衡器",
+
+.failed =
+"失败",
+
+.fetch_lyrics =
+"获取缺失歌词",
+
 .file =
 "文件",
 
@@ -64,6 +91,9 @@ static soundsphere_i18n_translation_t _soundsphere_i18n_zh_CN = {
 .name =
 "名称",
 
+.off =
+"关闭",
+
 .open =
 "打开",
 
@@ -73,21 +103,39 @@ static soundsphere_i18n_translation_t _soundsphere_i18n_zh_CN = {
 .original_text =
 "原文",
 
+.output =
+"输出",
+
 .path =
 "路径",
 
+.preamp =
+"前置增益 (dB)",
+
 .preferences =
 "首选项",
 
+.preset =
+"预设",
+
 .proxy =
 "代理",
 
+.remove =
+"删除",
+
+.replaygain =
+"回放增益",
+
 .sample_rate =
 "采样率",
 
 .save =
 "保存",
 
+.scan_loudness =
+"扫描响度",
+
 .search_artist =
 "搜索艺术家",
 
@@ -103,15 +151,33 @@ static soundsphere_i18n_translation_t _soundsphere_i18n_zh_CN = {
 .settings =
 "设置",
 
+.start =
+"开始",
+
+.stop =
+"停止",
+
 .tag_editor =
 "标签编辑器",
 
+.tip_bit_perfect =
+"按每首歌曲的采样率和声道数重新打开音频设备，避免重采样。切换到不同格式的歌曲时没有无缝衔接和淡入淡出。",
+
 .tip_lyric_auto_center_time =
 "手动滚动歌词后的自动回正时间。单位：秒。",
 
 .title =
 "标题",
 
+.tools =
+"工具",
+
+.track =
+"单曲",
+
+.tracks_per_second =
+"首/秒",
+
 .translated_text =
 "译文",
 
@@ -121,6 +187,12 @@ static soundsphere_i18n_translation_t _soundsphere_i18n_zh_CN = {
 .version =
 "版本",
 
+.visualizer =
+"可视化",
+
+.write_to_file =
+"写入文件标签",
+
 };
 /* clang-format on */
 
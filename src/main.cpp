@@ -15,6 +15,9 @@
 #include <stdio.h>
 #include <IconsFontAwesome6.h>
 #include <curl/curl.h>
+#include "audio/loudness_cache.hpp"
+#include "audio/peaks_cache.hpp"
+#include "audio/seek_index_cache.hpp"
 #include "backends/__init__.hpp"
 #include "config/__init__.hpp"
 #include "fonts/fa_solid_900.h"
@@ -23,7 +26,12 @@
 #include "fonts/NotoSansSC.h"
 #include "i18n/__init__.h"
 #include "runtime/__init__.hpp"
+#include "runtime/worker.hpp"
+#include "utils/curl.hpp"
 #include "utils/defines.hpp"
+#include "utils/lyric_cache.hpp"
+#include "utils/lyric_sidecar.hpp"
+#include "utils/trace.hpp"
 #include "widgets/__init__.hpp"
 
 typedef struct soundsphere_module
@@ -37,16 +45,29 @@ static void _curl_init(void)
     curl_global_init(CURL_GLOBAL_ALL);
 }
 
+static void _module_nop(void)
+{
+}
+
 /**
  * @brief Registered modules.
  * Modules are initialized in order and cleanup in reverse order.
  */
 static soundsphere_module_t s_modules[] = {
-    { soundsphere::config_init,  soundsphere::config_exit  },
-    { soundsphere_i18n_init,     soundsphere_i18n_exit     },
-    { soundsphere::runtime_init, soundsphere::runtime_exit },
-    { soundsphere::widget_init,  soundsphere::widget_exit  },
-    { _curl_init,                curl_global_cleanup       },
+    { soundsphere::config_init,           soundsphere::config_exit           },
+    { soundsphere_i18n_init,              soundsphere_i18n_exit              },
+    { soundsphere::lyric_cache_init,      soundsphere::lyric_cache_exit      },
+    { soundsphere::loudness_cache_init,   soundsphere::loudness_cache_exit   },
+    { soundsphere::peaks_cache_init,      soundsphere::peaks_cache_exit      },
+    { soundsphere::seek_index_cache_init, soundsphere::seek_index_cache_exit },
+    { soundsphere::lyric_sidecar_init,    soundsphere::lyric_sidecar_exit    },
+    { soundsphere::runtime_init,          soundsphere::runtime_exit          },
+    { _curl_init,                         curl_global_cleanup                },
+    { soundsphere::http_init,             soundsphere::http_exit             },
+    { soundsphere::worker_init,           soundsphere::worker_exit           },
+    { soundsphere::widget_init,           soundsphere::widget_exit           },
+    /* Join workers before widgets close the audio device and caches their tasks use. */
+    { _module_nop,                        soundsphere::worker_stop           },
 };
 
 // Main code
@@ -92,7 +113,9 @@ int main(int, char **)
     }
 
     /* Main loop. */
+    TRACE_THREAD_NAME("ui");
     soundsphere::backend_draw([]() {
+        TRACE_ZONE("frame");
         soundsphere::runtime_loop();
         soundsphere::widget_draw();
     });
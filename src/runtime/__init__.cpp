@@ -1,29 +1,150 @@
+#include <ev.h>
 #include <imgui.h>
-#include <queue>
+#include <atomic>
 #include <mutex>
 #include "config/__init__.hpp"
+#include "utils/trace.hpp"
 #include "__init__.hpp"
 
-typedef std::queue<soundsphere::JobDataBase::JobPtr> JobQueue;
+typedef struct runtime_job
+{
+    soundsphere::runtime_job_call call; /**< Type restore function. */
+    soundsphere::runtime_job_fn   fn;   /**< Job callback. */
+    std::shared_ptr<void>         obj;  /**< Job parameter. */
+    struct runtime_job           *next; /**< Next job in list. */
+} runtime_job_t;
 
-soundsphere::runtime_t soundsphere::_G;
+/**
+ * @brief Intrusive FIFO list of jobs.
+ */
+typedef struct runtime_job_list
+{
+    runtime_job_list();
+
+    runtime_job_t *head;
+    runtime_job_t *tail;
+} runtime_job_list_t;
 
 typedef struct runtime_ctx
 {
     runtime_ctx();
+    ~runtime_ctx();
 
-    JobQueue job_queue;
+    /**
+     * @brief Protects #runtime_ctx::submit and #runtime_ctx::free_jobs.
+     */
     std::mutex job_mutex;
+
+    /**
+     * @brief Jobs submitted since last frame.
+     */
+    runtime_job_list_t submit[soundsphere::RUNTIME_LANE__MAX];
+
+    /**
+     * @brief Recycled job nodes.
+     */
+    runtime_job_t *free_jobs;
+
+    /**
+     * @brief Jobs carried over from previous frames. Only accessed by UI thread.
+     */
+    runtime_job_list_t carry[soundsphere::RUNTIME_LANE__MAX];
+
+    /**
+     * @brief Number of jobs not run yet.
+     */
+    std::atomic<size_t> pending;
 } runtime_ctx_t;
 
+soundsphere::runtime_t soundsphere::_G;
+
 static runtime_ctx_t *s_runtime_ctx = nullptr;
 
+runtime_job_list::runtime_job_list()
+{
+    head = nullptr;
+    tail = nullptr;
+}
+
+static void _runtime_job_list_push(runtime_job_list_t *list, runtime_job_t *job)
+{
+    job->next = nullptr;
+    if (list->tail == nullptr)
+    {
+        list->head = job;
+    }
+    else
+    {
+        list->tail->next = job;
+    }
+    list->tail = job;
+}
+
+static void _runtime_job_list_splice(runtime_job_list_t *dst, runtime_job_list_t *src)
+{
+    if (src->head == nullptr)
+    {
+        return;
+    }
+
+    if (dst->tail == nullptr)
+    {
+        dst->head = src->head;
+    }
+    else
+    {
+        dst->tail->next = src->head;
+    }
+    dst->tail = src->tail;
+    src->head = nullptr;
+    src->tail = nullptr;
+}
+
+static runtime_job_t *_runtime_job_list_pop(runtime_job_list_t *list)
+{
+    runtime_job_t *job = list->head;
+    if (job != nullptr)
+    {
+        list->head = job->next;
+        if (list->head == nullptr)
+        {
+            list->tail = nullptr;
+        }
+    }
+    return job;
+}
+
+static void _runtime_job_free_chain(runtime_job_t *job)
+{
+    while (job != nullptr)
+    {
+        runtime_job_t *next = job->next;
+        delete job;
+        job = next;
+    }
+}
+
 runtime_ctx::runtime_ctx()
 {
+    free_jobs = nullptr;
+    pending.store(0);
+}
+
+runtime_ctx::~runtime_ctx()
+{
+    for (int i = 0; i < soundsphere::RUNTIME_LANE__MAX; i++)
+    {
+        _runtime_job_free_chain(submit[i].head);
+        _runtime_job_free_chain(carry[i].head);
+    }
+    _runtime_job_free_chain(free_jobs);
 }
 
 soundsphere::runtime::runtime()
 {
+    dummy_player.output_freq = 0;
+    dummy_player.output_channels = 0;
+
     playlist.selected_id = (uint64_t)-1;
 
     playbar.is_playing = false;
@@ -58,27 +179,86 @@ void soundsphere::runtime_exit(void)
     s_runtime_ctx = nullptr;
 }
 
-void soundsphere::runtime_submit_job(JobDataBase::JobPtr job)
+void soundsphere::runtime_submit_job(runtime_lane_t lane, runtime_job_call call, runtime_job_fn fn,
+                                     std::shared_ptr<void> obj)
 {
+    s_runtime_ctx->pending.fetch_add(1, std::memory_order_relaxed);
+
     std::unique_lock<std::mutex> lock(s_runtime_ctx->job_mutex);
-    s_runtime_ctx->job_queue.emplace(job);
+    runtime_job_t               *job = s_runtime_ctx->free_jobs;
+    if (job != nullptr)
+    {
+        s_runtime_ctx->free_jobs = job->next;
+    }
+    else
+    {
+        /* Pool only grows when more jobs are in flight than ever before. */
+        job = new runtime_job_t;
+    }
+
+    job->call = call;
+    job->fn = fn;
+    job->obj = std::move(obj);
+    _runtime_job_list_push(&s_runtime_ctx->submit[lane], job);
+}
+
+size_t soundsphere::runtime_pending_jobs(void)
+{
+    return s_runtime_ctx->pending.load(std::memory_order_relaxed);
+}
+
+/**
+ * @brief Run one job and put its node into \p done.
+ */
+static void _runtime_run_job(runtime_job_t *job, runtime_job_list_t *done)
+{
+    job->call(job->fn, job->obj);
+    job->obj.reset();
+    s_runtime_ctx->pending.fetch_sub(1, std::memory_order_relaxed);
+    _runtime_job_list_push(done, job);
 }
 
 void soundsphere::runtime_loop(void)
 {
-    for (;;)
+    TRACE_ZONE("runtime_loop");
+
+    /* Take everything submitted in one lock, new jobs are run next frame. */
+    {
+        std::unique_lock<std::mutex> lock(s_runtime_ctx->job_mutex);
+        for (int i = 0; i < RUNTIME_LANE__MAX; i++)
+        {
+            _runtime_job_list_splice(&s_runtime_ctx->carry[i], &s_runtime_ctx->submit[i]);
+        }
+    }
+
+    runtime_job_list_t done;
+    runtime_job_t     *job;
+    while ((job = _runtime_job_list_pop(&s_runtime_ctx->carry[RUNTIME_LANE_PLAYBACK])) != nullptr)
     {
-        JobDataBase::JobPtr job;
+        _runtime_run_job(job, &done);
+    }
+
+    uint64_t budget_ns = (uint64_t)(_config.ui_job_budget_ms * 1000 * 1000);
+    uint64_t start = ev_hrtime();
+    for (int i = RUNTIME_LANE_PLAYBACK + 1; i < RUNTIME_LANE__MAX; i++)
+    {
+        while ((job = _runtime_job_list_pop(&s_runtime_ctx->carry[i])) != nullptr)
         {
-            std::unique_lock<std::mutex> lock(s_runtime_ctx->job_mutex);
-            if (s_runtime_ctx->job_queue.empty())
+            _runtime_run_job(job, &done);
+
+            /* At least one job per frame, so a slow job never stalls the queue. */
+            if (budget_ns != 0 && ev_hrtime() - start >= budget_ns)
             {
-                return;
+                goto finish;
             }
-            job = s_runtime_ctx->job_queue.front();
-            s_runtime_ctx->job_queue.pop();
         }
+    }
 
-        job->call();
+finish:
+    if (done.head != nullptr)
+    {
+        std::unique_lock<std::mutex> lock(s_runtime_ctx->job_mutex);
+        done.tail->next = s_runtime_ctx->free_jobs;
+        s_runtime_ctx->free_jobs = done.head;
     }
 }
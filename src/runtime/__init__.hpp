@@ -1,7 +1,7 @@
 #ifndef SOUND_SPHERE_RUNTIME_INIT_HPP
 #define SOUND_SPHERE_RUNTIME_INIT_HPP
 
-#include <functional>
+#include <memory>
 #include <vector>
 #include "utils/music_tag.hpp"
 
@@ -26,6 +26,16 @@ typedef struct runtime
          * @brief The current playing music.
          */
         MusicTagPtr current_music;
+
+        /**
+         * @brief Sample rate of audio device.
+         */
+        int output_freq;
+
+        /**
+         * @brief Channels of audio device.
+         */
+        int output_channels;
     } dummy_player;
 
     struct
@@ -60,45 +70,32 @@ typedef struct runtime
     } playbar;
 } runtime_t;
 
-class JobDataBase
+/**
+ * @brief UI job lanes, a lane is only run when lanes before it are empty.
+ */
+typedef enum runtime_lane
 {
-public:
-    typedef std::shared_ptr<JobDataBase> JobPtr;
+    RUNTIME_LANE_PLAYBACK, /**< Playback state. Always run in full, regardless of budget. */
+    RUNTIME_LANE_DEFAULT,  /**< Results the user is waiting for. */
+    RUNTIME_LANE_BULK,     /**< Batch results, like library wide lyric fetch. */
+    RUNTIME_LANE__MAX,
+} runtime_lane_t;
 
-public:
-    JobDataBase() {};
-    virtual ~JobDataBase() {};
+/**
+ * @brief Type erased job callback.
+ */
+typedef void (*runtime_job_fn)(void);
 
-public:
-    virtual void call(void) = 0;
-};
+/**
+ * @brief Call \p fn with \p obj restored to its real type.
+ */
+typedef void (*runtime_job_call)(runtime_job_fn fn, std::shared_ptr<void> &obj);
 
 template <typename T>
-class JobData : public JobDataBase
+void runtime_job_call_as(runtime_job_fn fn, std::shared_ptr<void> &obj)
 {
-public:
-    typedef std::shared_ptr<T>          ObjPtr;
-    typedef std::function<void(ObjPtr)> Func;
-
-public:
-    JobData(Func func, ObjPtr obj)
-    {
-        m_func = func;
-        m_obj = obj;
-    }
-
-    virtual ~JobData() {};
-
-public:
-    virtual void call(void)
-    {
-        m_func(m_obj);
-    }
-
-private:
-    Func   m_func;
-    ObjPtr m_obj;
-};
+    reinterpret_cast<void (*)(std::shared_ptr<T>)>(fn)(std::static_pointer_cast<T>(obj));
+}
 
 /**
  * @brief Global runtime.
@@ -122,25 +119,42 @@ void runtime_loop(void);
 
 /**
  * @brief Queue job into loop.
+ * Job nodes are recycled, so no memory is allocated in steady state.
  * @warning You should use #runtime_call_in_ui().
- * @param[in] job   Job object.
+ * @note MT-Safe.
+ * @param[in] lane  Job lane.
+ * @param[in] call  Type restore function.
+ * @param[in] fn    Job callback.
+ * @param[in] obj   Job parameter.
  */
-void runtime_submit_job(JobDataBase::JobPtr job);
+void runtime_submit_job(runtime_lane_t lane, runtime_job_call call, runtime_job_fn fn, std::shared_ptr<void> obj);
 
 /**
  * @brief Submit a job to be called in UI loop.
+ *
+ * Each frame runs jobs until `ui_job_budget_ms` is spent, and the rest wait for
+ * next frame.
+ *
  * @warning Do not do any blocking operations in UI thread.
  * @note It is recommend to only update resources in UI thread.
+ * @note MT-Safe.
  * @param[in] fn    Job callback.
  * @param[in] obj   Job parameter.
+ * @param[in] lane  Job lane.
  */
 template <typename T>
-void runtime_call_in_ui(typename JobData<T>::Func fn, typename JobData<T>::ObjPtr obj)
+void runtime_call_in_ui(void (*fn)(std::shared_ptr<T>), std::shared_ptr<T> obj,
+                        runtime_lane_t lane = RUNTIME_LANE_DEFAULT)
 {
-    JobDataBase::JobPtr ptr = std::make_shared<JobData<T>>(fn, obj);
-    runtime_submit_job(ptr);
+    runtime_submit_job(lane, runtime_job_call_as<T>, reinterpret_cast<runtime_job_fn>(fn), std::move(obj));
 }
 
+/**
+ * @brief Number of jobs waiting for UI loop.
+ * @note MT-Safe.
+ */
+size_t runtime_pending_jobs(void);
+
 } // namespace soundsphere
 
 #endif
@@ -0,0 +1,310 @@
+#include <ev.h>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "utils/trace.hpp"
+#include "__init__.hpp"
+#include "worker.hpp"
+
+/**
+ * @brief Number of workers that only take interactive tasks.
+ * A flood of background tasks never delays what user is waiting for.
+ */
+#define WORKER_INTERACTIVE_RESERVED 1
+
+/**
+ * @brief Range of pool size, the number of CPUs is used if within.
+ * @{
+ */
+#define WORKER_MIN_THREADS 2
+#define WORKER_MAX_THREADS 8
+/**
+ * @}
+ */
+
+typedef enum worker_state
+{
+    WORKER_STATE_PENDING,
+    WORKER_STATE_RUNNING,
+    WORKER_STATE_DONE,
+    WORKER_STATE_CANCELLED,
+} worker_state_t;
+
+struct soundsphere::WorkerTaskInternal
+{
+    WorkerTaskInternal();
+
+    std::atomic<bool>       cancelled; /**< Cancellation token. */
+    worker_state_t          state;     /**< Task state. */
+    std::mutex              mutex;     /**< Protects #WorkerTaskInternal::state. */
+    std::condition_variable cond;      /**< Signaled when finished. */
+};
+
+typedef std::deque<soundsphere::WorkerTask::Ptr> WorkerTaskQueue;
+
+typedef struct worker_thread
+{
+    ev_os_thread_t               thread;
+    size_t                       index;   /**< Index in pool. */
+    soundsphere::WorkerTask::Ptr current; /**< Running task. */
+} worker_thread_t;
+
+typedef std::vector<worker_thread_t *> WorkerThreadVec;
+
+typedef struct worker_ctx
+{
+    worker_ctx();
+
+    WorkerThreadVec threads;
+
+    /**
+     * @brief Protects fields below, and #worker_thread_t::current.
+     */
+    std::mutex              mutex;
+    std::condition_variable cond;
+    WorkerTaskQueue         queues[soundsphere::WORKER_PRIORITY__MAX];
+    bool                    looping;
+} worker_ctx_t;
+
+static worker_ctx_t *s_worker = nullptr;
+
+soundsphere::WorkerTaskInternal::WorkerTaskInternal()
+{
+    cancelled.store(false);
+    state = WORKER_STATE_PENDING;
+}
+
+soundsphere::WorkerTask::WorkerTask()
+{
+    m_iner = new WorkerTaskInternal;
+}
+
+soundsphere::WorkerTask::~WorkerTask()
+{
+    delete m_iner;
+    m_iner = nullptr;
+}
+
+void soundsphere::WorkerTask::cancel()
+{
+    m_iner->cancelled.store(true);
+
+    std::unique_lock<std::mutex> lock(m_iner->mutex);
+    if (m_iner->state == WORKER_STATE_PENDING)
+    {
+        m_iner->state = WORKER_STATE_CANCELLED;
+        m_iner->cond.notify_all();
+    }
+}
+
+bool soundsphere::WorkerTask::cancelled() const
+{
+    return m_iner->cancelled.load(std::memory_order_relaxed);
+}
+
+bool soundsphere::WorkerTask::finished() const
+{
+    std::unique_lock<std::mutex> lock(m_iner->mutex);
+    return m_iner->state == WORKER_STATE_DONE || m_iner->state == WORKER_STATE_CANCELLED;
+}
+
+void soundsphere::WorkerTask::wait()
+{
+    std::unique_lock<std::mutex> lock(m_iner->mutex);
+    m_iner->cond.wait(lock, [this]() {
+        return m_iner->state == WORKER_STATE_DONE || m_iner->state == WORKER_STATE_CANCELLED;
+    });
+}
+
+worker_ctx::worker_ctx()
+{
+    looping = true;
+}
+
+/**
+ * @brief Mark task running.
+ * @return false if task is cancelled before run.
+ */
+static bool _worker_task_begin(soundsphere::WorkerTask *task)
+{
+    std::unique_lock<std::mutex> lock(task->m_iner->mutex);
+    if (task->m_iner->state != WORKER_STATE_PENDING)
+    {
+        return false;
+    }
+    task->m_iner->state = WORKER_STATE_RUNNING;
+    return true;
+}
+
+/**
+ * @brief Mark task finished.
+ * @return true if task is done without cancel.
+ */
+static bool _worker_task_end(soundsphere::WorkerTask *task)
+{
+    std::unique_lock<std::mutex> lock(task->m_iner->mutex);
+    task->m_iner->state = task->cancelled() ? WORKER_STATE_CANCELLED : WORKER_STATE_DONE;
+    task->m_iner->cond.notify_all();
+    return task->m_iner->state == WORKER_STATE_DONE;
+}
+
+static void _worker_complete_ui(soundsphere::WorkerTask::Ptr task)
+{
+    task->complete();
+}
+
+/**
+ * @brief Wait for next task of \p thr.
+ * @return Task, or nullptr if pool is stopping.
+ */
+static soundsphere::WorkerTask::Ptr _worker_pop(worker_thread_t *thr)
+{
+    std::unique_lock<std::mutex> lock(s_worker->mutex);
+    thr->current.reset();
+
+    while (s_worker->looping)
+    {
+        for (int prio = 0; prio < soundsphere::WORKER_PRIORITY__MAX; prio++)
+        {
+            if (prio != soundsphere::WORKER_PRIORITY_INTERACTIVE && thr->index < WORKER_INTERACTIVE_RESERVED)
+            {
+                break;
+            }
+
+            WorkerTaskQueue &queue = s_worker->queues[prio];
+            if (!queue.empty())
+            {
+                thr->current = queue.front();
+                queue.pop_front();
+                return thr->current;
+            }
+        }
+        s_worker->cond.wait(lock);
+    }
+
+    return nullptr;
+}
+
+static void _worker_thread(void *arg)
+{
+    worker_thread_t *thr = static_cast<worker_thread_t *>(arg);
+    TRACE_THREAD_NAME("worker");
+
+    soundsphere::WorkerTask::Ptr task;
+    while ((task = _worker_pop(thr)).get() != nullptr)
+    {
+        if (!_worker_task_begin(task.get()))
+        {
+            continue;
+        }
+
+        task->run();
+        if (_worker_task_end(task.get()))
+        {
+            soundsphere::runtime_call_in_ui<soundsphere::WorkerTask>(_worker_complete_ui, task);
+        }
+    }
+}
+
+void soundsphere::worker_init(void)
+{
+    s_worker = new worker_ctx_t;
+
+    size_t num = std::thread::hardware_concurrency();
+    num = num < WORKER_MIN_THREADS ? WORKER_MIN_THREADS : num;
+    num = num > WORKER_MAX_THREADS ? WORKER_MAX_THREADS : num;
+
+    for (size_t i = 0; i < num; i++)
+    {
+        worker_thread_t *thr = new worker_thread_t;
+        thr->index = i;
+        if (ev_thread_init(&thr->thread, nullptr, _worker_thread, thr) != 0)
+        {
+            delete thr;
+            break;
+        }
+        s_worker->threads.push_back(thr);
+    }
+}
+
+void soundsphere::worker_stop(void)
+{
+    if (s_worker == nullptr)
+    {
+        return;
+    }
+
+    {
+        std::unique_lock<std::mutex> lock(s_worker->mutex);
+        s_worker->looping = false;
+
+        for (int prio = 0; prio < WORKER_PRIORITY__MAX; prio++)
+        {
+            WorkerTaskQueue &queue = s_worker->queues[prio];
+            for (WorkerTaskQueue::iterator it = queue.begin(); it != queue.end(); it++)
+            {
+                (*it)->cancel();
+            }
+            queue.clear();
+        }
+
+        for (WorkerThreadVec::iterator it = s_worker->threads.begin(); it != s_worker->threads.end(); it++)
+        {
+            worker_thread_t *thr = *it;
+            if (thr->current.get() != nullptr)
+            {
+                thr->current->cancel();
+            }
+        }
+    }
+    s_worker->cond.notify_all();
+
+    for (WorkerThreadVec::iterator it = s_worker->threads.begin(); it != s_worker->threads.end(); it++)
+    {
+        worker_thread_t *thr = *it;
+        ev_thread_exit(&thr->thread, EV_INFINITE_TIMEOUT);
+        delete thr;
+    }
+    s_worker->threads.clear();
+}
+
+void soundsphere::worker_exit(void)
+{
+    worker_stop();
+
+    delete s_worker;
+    s_worker = nullptr;
+}
+
+void soundsphere::worker_submit_task(worker_priority_t prio, WorkerTask::Ptr task)
+{
+    if (s_worker == nullptr)
+    {
+        task->cancel();
+        return;
+    }
+
+    {
+        std::unique_lock<std::mutex> lock(s_worker->mutex);
+        if (!s_worker->looping)
+        {
+            lock.unlock();
+            task->cancel();
+            return;
+        }
+        s_worker->queues[prio].push_back(task);
+    }
+
+    /* Reserved workers skip background tasks, so wake all to make sure one takes it. */
+    if (prio == WORKER_PRIORITY_INTERACTIVE)
+    {
+        s_worker->cond.notify_one();
+    }
+    else
+    {
+        s_worker->cond.notify_all();
+    }
+}
@@ -0,0 +1,185 @@
+#ifndef SOUND_SPHERE_RUNTIME_WORKER_HPP
+#define SOUND_SPHERE_RUNTIME_WORKER_HPP
+
+#include <functional>
+#include <memory>
+
+namespace soundsphere
+{
+
+typedef enum worker_priority
+{
+    WORKER_PRIORITY_INTERACTIVE, /**< User is waiting for the result. */
+    WORKER_PRIORITY_BACKGROUND,  /**< Prefetch and maintenance. */
+    WORKER_PRIORITY__MAX,
+} worker_priority_t;
+
+struct WorkerTaskInternal;
+
+/**
+ * @brief Task in worker pool.
+ *
+ * The task is also its own cancellation token: a long job should poll
+ * #WorkerTask::cancelled() and return early.
+ */
+class WorkerTask
+{
+public:
+    typedef std::shared_ptr<WorkerTask> Ptr;
+
+public:
+    WorkerTask();
+    virtual ~WorkerTask();
+
+public:
+    /**
+     * @brief Cancel task.
+     *
+     * A pending task is never run, a running task is asked to stop, and the UI
+     * continuation is never called if cancelled from UI thread.
+     *
+     * @note MT-Safe.
+     */
+    void cancel();
+
+    /**
+     * @brief Whether task is cancelled.
+     * @note MT-Safe.
+     */
+    bool cancelled() const;
+
+    /**
+     * @brief Whether task is done or cancelled, and no longer running.
+     * @note MT-Safe.
+     */
+    bool finished() const;
+
+    /**
+     * @brief Wait until #WorkerTask::finished().
+     * @warning Do not wait for long job in UI thread.
+     */
+    void wait();
+
+public:
+    /**
+     * @brief Job body, called in worker thread.
+     */
+    virtual void run() = 0;
+
+    /**
+     * @brief Continuation, called in UI thread after #WorkerTask::run().
+     */
+    virtual void complete() = 0;
+
+public:
+    WorkerTask(const WorkerTask &orig) = delete;
+
+public:
+    struct WorkerTaskInternal *m_iner;
+};
+
+/**
+ * @brief Task that produces a value of \p T.
+ */
+template <typename T>
+class WorkerFuture : public WorkerTask
+{
+public:
+    typedef std::shared_ptr<WorkerFuture<T>> Ptr;
+
+    /**
+     * @brief Job body. The task is passed in to check for cancellation.
+     */
+    typedef std::function<T(WorkerTask &)> Fn;
+
+    /**
+     * @brief UI continuation, with the result of job.
+     */
+    typedef std::function<void(T &)> Then;
+
+public:
+    WorkerFuture(Fn fn, Then then)
+    {
+        m_fn = fn;
+        m_then = then;
+    }
+
+public:
+    /**
+     * @brief Wait for result.
+     * @return Result of job, or a default value if cancelled before run.
+     */
+    T &get()
+    {
+        wait();
+        return m_result;
+    }
+
+public:
+    virtual void run()
+    {
+        m_result = m_fn(*this);
+        m_fn = nullptr;
+    }
+
+    virtual void complete()
+    {
+        if (m_then && !cancelled())
+        {
+            m_then(m_result);
+        }
+        m_then = nullptr;
+    }
+
+private:
+    Fn   m_fn;
+    Then m_then;
+    T    m_result;
+};
+
+/**
+ * @brief Start worker pool.
+ */
+void worker_init(void);
+
+/**
+ * @brief Cancel all tasks and stop worker threads.
+ * Running tasks are waited for. Tasks submitted after it are cancelled, so
+ * call it before tearing down modules that tasks use.
+ */
+void worker_stop(void);
+
+/**
+ * @brief Stop worker pool if still running, and release it.
+ */
+void worker_exit(void);
+
+/**
+ * @brief Queue task into worker pool.
+ * If the pool is not running, or stopped, the task is cancelled.
+ * @note MT-Safe.
+ * @param[in] prio  Priority.
+ * @param[in] task  Task.
+ */
+void worker_submit_task(worker_priority_t prio, WorkerTask::Ptr task);
+
+/**
+ * @brief Run \p fn in worker pool and \p then in UI thread with its result.
+ * @note MT-Safe.
+ * @param[in] prio  Priority.
+ * @param[in] fn    Job body.
+ * @param[in] then  (Optional) UI continuation.
+ * @return Task handle.
+ */
+template <typename T>
+typename WorkerFuture<T>::Ptr worker_submit(worker_priority_t prio, typename WorkerFuture<T>::Fn fn,
+                                            typename WorkerFuture<T>::Then then = typename WorkerFuture<T>::Then())
+{
+    typename WorkerFuture<T>::Ptr task = std::make_shared<WorkerFuture<T>>(fn, then);
+    worker_submit_task(prio, task);
+    return task;
+}
+
+} // namespace soundsphere
+
+#endif
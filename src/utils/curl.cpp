@@ -1,74 +1,336 @@
+#include <ev.h>
+#include <atomic>
+#include <map>
+#include <set>
+#include <vector>
 #include "config/__init__.hpp"
+#include "runtime/__init__.hpp"
+#include "utils/trace.hpp"
 #include "curl.hpp"
 
-struct soundsphere::EasyCurlInternal
+typedef struct http_request
 {
-    EasyCurlInternal();
-    ~EasyCurlInternal();
+    http_request();
+    ~http_request();
 
-    CURL *curl;
-    std::string body;
-};
+    CURL                        *easy; /**< Easy handle, owned by network thread once queued. */
+    soundsphere::HttpCallback    cb;   /**< Completion callback. */
+    soundsphere::HttpResponsePtr rsp;  /**< Response. */
+} http_request_t;
 
-soundsphere::EasyCurlInternal::EasyCurlInternal()
+typedef std::shared_ptr<http_request_t>   HttpRequestPtr;
+typedef std::map<uint64_t, HttpRequestPtr> HttpRequestMap;
+typedef std::vector<HttpRequestPtr>        HttpRequestVec;
+
+typedef struct http_ctx
+{
+    http_ctx();
+    ~http_ctx();
+
+    CURLM            *multi;                           /**< Multi handle. */
+    CURLSH           *share;                           /**< Shared DNS / TLS / connection cache. */
+    ev_mutex_t        share_locks[CURL_LOCK_DATA_LAST]; /**< Locks for \p share. */
+    ev_os_thread_t    thread;                           /**< Network thread. */
+    std::atomic<bool> looping;                          /**< Network thread is running. */
+
+    ev_mutex_t            mutex;        /**< Protects fields below. */
+    uint64_t              next_id;      /**< Next request ID. */
+    HttpRequestVec        add_queue;    /**< Requests waiting to be added to \p multi. */
+    std::vector<uint64_t> cancel_queue; /**< Requests waiting to be removed from \p multi. */
+    std::set<uint64_t>    pending;      /**< Requests whose callback is not called nor cancelled. */
+
+    HttpRequestMap active; /**< Requests in \p multi. Network thread only. */
+} http_ctx_t;
+
+static http_ctx_t *s_http = nullptr;
+
+http_request::http_request()
+{
+    easy = curl_easy_init();
+    rsp = std::make_shared<soundsphere::http_response_t>();
+}
+
+http_request::~http_request()
+{
+    curl_easy_cleanup(easy);
+}
+
+static void _http_share_lock(CURL *, curl_lock_data data, curl_lock_access, void *userptr)
+{
+    http_ctx_t *ctx = static_cast<http_ctx_t *>(userptr);
+    ev_mutex_enter(&ctx->share_locks[data]);
+}
+
+static void _http_share_unlock(CURL *, curl_lock_data data, void *userptr)
+{
+    http_ctx_t *ctx = static_cast<http_ctx_t *>(userptr);
+    ev_mutex_leave(&ctx->share_locks[data]);
+}
+
+http_ctx::http_ctx()
+{
+    for (size_t i = 0; i < CURL_LOCK_DATA_LAST; i++)
+    {
+        ev_mutex_init(&share_locks[i], 0);
+    }
+    ev_mutex_init(&mutex, 0);
+    thread = EV_OS_THREAD_INVALID;
+    looping = false;
+    next_id = 0;
+
+    share = curl_share_init();
+    curl_share_setopt(share, CURLSHOPT_LOCKFUNC, _http_share_lock);
+    curl_share_setopt(share, CURLSHOPT_UNLOCKFUNC, _http_share_unlock);
+    curl_share_setopt(share, CURLSHOPT_USERDATA, this);
+    curl_share_setopt(share, CURLSHOPT_SHARE, CURL_LOCK_DATA_DNS);
+    curl_share_setopt(share, CURLSHOPT_SHARE, CURL_LOCK_DATA_SSL_SESSION);
+    curl_share_setopt(share, CURLSHOPT_SHARE, CURL_LOCK_DATA_CONNECT);
+
+    multi = curl_multi_init();
+    curl_multi_setopt(multi, CURLMOPT_PIPELINING, (long)CURLPIPE_MULTIPLEX);
+}
+
+http_ctx::~http_ctx()
 {
-    curl = ::curl_easy_init();
+    curl_multi_cleanup(multi);
+    curl_share_cleanup(share);
+
+    ev_mutex_exit(&mutex);
+    for (size_t i = 0; i < CURL_LOCK_DATA_LAST; i++)
+    {
+        ev_mutex_exit(&share_locks[i]);
+    }
 }
 
-soundsphere::EasyCurlInternal::~EasyCurlInternal()
+soundsphere::http_response::http_response()
 {
-    ::curl_easy_cleanup(curl);
+    id = 0;
+    code = CURLE_OK;
+    status = 0;
 }
 
-static size_t WriteCallback(char *ptr, size_t size, size_t nmemb, void *userdata)
+static size_t _http_on_write(char *ptr, size_t size, size_t nmemb, void *userdata)
 {
-    soundsphere::EasyCurl *curl = static_cast<soundsphere::EasyCurl *>(userdata);
-    size_t total_sz = size * nmemb;
-    curl->m_iner->body.append(ptr, total_sz);
+    http_request_t *req = static_cast<http_request_t *>(userdata);
+    size_t          total_sz = size * nmemb;
+    req->rsp->body.append(ptr, total_sz);
     return total_sz;
 }
 
-soundsphere::EasyCurl::EasyCurl()
+static void _http_complete_ui(HttpRequestPtr req)
 {
-    m_iner = new EasyCurlInternal;
-    if (!soundsphere::_config.proxy.empty())
+    if (s_http == nullptr)
     {
-        curl_easy_setopt(m_iner->curl, CURLOPT_PROXY, soundsphere::_config.proxy.c_str());
+        return;
     }
-    curl_easy_setopt(m_iner->curl, CURLOPT_WRITEFUNCTION, WriteCallback);
-    curl_easy_setopt(m_iner->curl, CURLOPT_WRITEDATA, this);
+
+    ev_mutex_enter(&s_http->mutex);
+    size_t erased = s_http->pending.erase(req->rsp->id);
+    ev_mutex_leave(&s_http->mutex);
+
+    /* Cancelled after transfer finished. */
+    if (erased == 0)
+    {
+        return;
+    }
+
+    req->cb(req->rsp);
 }
 
-soundsphere::EasyCurl::~EasyCurl()
+/**
+ * @brief Release easy handle of \p req in network thread.
+ *
+ * The handle is detached from the shared cache here, so a response object held by
+ * a pending UI job never outlives the share handle.
+ */
+static void _http_release(http_ctx_t *ctx, http_request_t *req, bool added)
 {
-    delete m_iner;
+    if (added)
+    {
+        curl_multi_remove_handle(ctx->multi, req->easy);
+    }
+    curl_easy_cleanup(req->easy);
+    req->easy = nullptr;
 }
 
-CURL *soundsphere::EasyCurl::get()
+/**
+ * @brief Move queued requests into multi handle, and remove cancelled ones.
+ */
+static void _http_process_queue(http_ctx_t *ctx)
 {
-    return m_iner->curl;
+    HttpRequestVec        add_queue;
+    std::vector<uint64_t> cancel_queue;
+
+    ev_mutex_enter(&ctx->mutex);
+    add_queue.swap(ctx->add_queue);
+    cancel_queue.swap(ctx->cancel_queue);
+    ev_mutex_leave(&ctx->mutex);
+
+    for (auto it = add_queue.begin(); it != add_queue.end(); it++)
+    {
+        HttpRequestPtr req = *it;
+        ctx->active.insert(std::make_pair(req->rsp->id, req));
+        curl_multi_add_handle(ctx->multi, req->easy);
+    }
+
+    for (auto it = cancel_queue.begin(); it != cancel_queue.end(); it++)
+    {
+        HttpRequestMap::iterator req_it = ctx->active.find(*it);
+        if (req_it == ctx->active.end())
+        {
+            continue;
+        }
+        _http_release(ctx, req_it->second.get(), true);
+        ctx->active.erase(req_it);
+    }
 }
 
-std::string soundsphere::EasyCurl::escape(const std::string &data)
+static void _http_process_done(http_ctx_t *ctx)
 {
-    char *escape_data = curl_easy_escape(m_iner->curl, data.data(), (int)data.size());
-    std::string ret(escape_data);
-    curl_free(escape_data);
-    return ret;
+    CURLMsg *msg;
+    int      msg_left = 0;
+    while ((msg = curl_multi_info_read(ctx->multi, &msg_left)) != nullptr)
+    {
+        if (msg->msg != CURLMSG_DONE)
+        {
+            continue;
+        }
+
+        http_request_t *raw = nullptr;
+        curl_easy_getinfo(msg->easy_handle, CURLINFO_PRIVATE, (char **)&raw);
+
+        HttpRequestMap::iterator it = ctx->active.find(raw->rsp->id);
+        HttpRequestPtr           req = it->second;
+        ctx->active.erase(it);
+
+        req->rsp->code = msg->data.result;
+        curl_easy_getinfo(req->easy, CURLINFO_RESPONSE_CODE, &req->rsp->status);
+        _http_release(ctx, req.get(), true);
+
+        soundsphere::runtime_call_in_ui<http_request_t>(_http_complete_ui, req);
+    }
 }
 
-CURLcode soundsphere::EasyCurl::perform(std::string &body)
+/**
+ * @brief Network thread.
+ *
+ * `curl_multi_poll()` waits on every socket of in-flight transfers and honors the
+ * timeout libcurl asks for, while #http_get() and #http_cancel() interrupt it by
+ * `curl_multi_wakeup()`, so there is no busy polling.
+ */
+static void _http_thread(void *arg)
 {
-    m_iner->body.clear();
+    http_ctx_t *ctx = static_cast<http_ctx_t *>(arg);
+    TRACE_THREAD_NAME("http");
+
+    while (ctx->looping)
+    {
+        _http_process_queue(ctx);
+
+        int running = 0;
+        curl_multi_perform(ctx->multi, &running);
+        _http_process_done(ctx);
+
+        curl_multi_poll(ctx->multi, nullptr, 0, 1000, nullptr);
+    }
+
+    for (auto it = ctx->active.begin(); it != ctx->active.end(); it++)
+    {
+        _http_release(ctx, it->second.get(), true);
+    }
+    ctx->active.clear();
 
-    CURLcode ret = curl_easy_perform(m_iner->curl);
-    if (ret != CURLE_OK)
+    ev_mutex_enter(&ctx->mutex);
+    for (auto it = ctx->add_queue.begin(); it != ctx->add_queue.end(); it++)
     {
-        goto finish;
+        _http_release(ctx, it->get(), false);
     }
+    ctx->add_queue.clear();
+    ev_mutex_leave(&ctx->mutex);
+}
+
+void soundsphere::http_init(void)
+{
+    s_http = new http_ctx_t;
+    s_http->looping = true;
+    ev_thread_init(&s_http->thread, nullptr, _http_thread, s_http);
+}
+
+void soundsphere::http_exit(void)
+{
+    s_http->looping = false;
+    curl_multi_wakeup(s_http->multi);
+    ev_thread_exit(&s_http->thread, EV_INFINITE_TIMEOUT);
 
-    body = m_iner->body;
+    delete s_http;
+    s_http = nullptr;
+}
 
-finish:
-    return ret;
+void soundsphere::http_setup(CURL *easy)
+{
+    if (!soundsphere::_config.proxy.empty())
+    {
+        curl_easy_setopt(easy, CURLOPT_PROXY, soundsphere::_config.proxy.c_str());
+    }
+    if (s_http != nullptr)
+    {
+        curl_easy_setopt(easy, CURLOPT_SHARE, s_http->share);
+    }
+    curl_easy_setopt(easy, CURLOPT_NOSIGNAL, 1L);
+    curl_easy_setopt(easy, CURLOPT_TCP_KEEPALIVE, 1L);
+    curl_easy_setopt(easy, CURLOPT_ACCEPT_ENCODING, "");
+}
+
+uint64_t soundsphere::http_get(const std::string &url, HttpCallback cb)
+{
+    if (s_http == nullptr)
+    {
+        return 0;
+    }
+
+    HttpRequestPtr req = std::make_shared<http_request_t>();
+    if (req->easy == nullptr)
+    {
+        return 0;
+    }
+    req->cb = cb;
+
+    http_setup(req->easy);
+    curl_easy_setopt(req->easy, CURLOPT_URL, url.c_str());
+    curl_easy_setopt(req->easy, CURLOPT_FOLLOWLOCATION, 1L);
+    curl_easy_setopt(req->easy, CURLOPT_WRITEFUNCTION, _http_on_write);
+    curl_easy_setopt(req->easy, CURLOPT_WRITEDATA, req.get());
+    curl_easy_setopt(req->easy, CURLOPT_PRIVATE, req.get());
+
+    ev_mutex_enter(&s_http->mutex);
+    {
+        req->rsp->id = ++s_http->next_id;
+        s_http->pending.insert(req->rsp->id);
+        s_http->add_queue.push_back(req);
+    }
+    ev_mutex_leave(&s_http->mutex);
+
+    curl_multi_wakeup(s_http->multi);
+    return req->rsp->id;
+}
+
+void soundsphere::http_cancel(uint64_t id)
+{
+    if (s_http == nullptr || id == 0)
+    {
+        return;
+    }
+
+    ev_mutex_enter(&s_http->mutex);
+    bool cancel = s_http->pending.erase(id) != 0;
+    if (cancel)
+    {
+        s_http->cancel_queue.push_back(id);
+    }
+    ev_mutex_leave(&s_http->mutex);
+
+    if (cancel)
+    {
+        curl_multi_wakeup(s_http->multi);
+    }
 }
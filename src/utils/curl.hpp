@@ -2,34 +2,76 @@
 #define SOUND_SPHERE_UTILS_CURL_HPP
 
 #include <curl/curl.h>
+#include <cstdint>
+#include <functional>
 #include <memory>
 #include "utils/string.hpp"
 
 namespace soundsphere
 {
 
-struct EasyCurlInternal;
-
-class EasyCurl
+/**
+ * @brief Response of an asynchronous request.
+ */
+typedef struct http_response
 {
-public:
-    typedef std::shared_ptr<EasyCurl> Ptr;
+    http_response();
+
+    uint64_t    id;     /**< Request ID. */
+    CURLcode    code;   /**< Transfer result. */
+    long        status; /**< HTTP status code. 0 if no response received. */
+    std::string body;   /**< Response body. */
+} http_response_t;
+
+typedef std::shared_ptr<http_response_t> HttpResponsePtr;
+
+/**
+ * @brief Completion callback. Always called in UI thread.
+ */
+typedef std::function<void(HttpResponsePtr)> HttpCallback;
+
+/**
+ * @brief Initialize HTTP client.
+ *
+ * All asynchronous requests share one `curl_multi` handle driven by a single
+ * network thread, and every handle shares DNS cache, TLS sessions and
+ * connections.
+ */
+void http_init(void);
 
-public:
-    EasyCurl();
-    virtual ~EasyCurl();
+/**
+ * @brief Cancel all requests and stop network thread.
+ */
+void http_exit(void);
 
-public:
-    CURL *get();
-    std::string escape(const std::string &data);
-    CURLcode perform(std::string &body);
+/**
+ * @brief Apply common options to \p easy.
+ *
+ * This sets proxy and attaches the shared DNS / TLS / connection cache. Use it
+ * for any easy handle that is not created by #http_get().
+ *
+ * @param[in] easy  Easy handle.
+ */
+void http_setup(CURL *easy);
 
-public:
-    EasyCurl(const EasyCurl &orig) = delete;
+/**
+ * @brief Send a GET request without blocking.
+ * @param[in] url   URL.
+ * @param[in] cb    Completion callback, called in UI thread.
+ * @return Request ID, used by #http_cancel(). 0 if failed.
+ */
+uint64_t http_get(const std::string &url, HttpCallback cb);
 
-public:
-    struct EasyCurlInternal *m_iner;
-};
+/**
+ * @brief Cancel a request.
+ *
+ * Once this function returns, the completion callback of \p id is never called.
+ * It is safe to cancel a request that is already finished.
+ *
+ * @note Must be called in UI thread.
+ * @param[in] id    Request ID.
+ */
+void http_cancel(uint64_t id);
 
 } // namespace soundsphere
 
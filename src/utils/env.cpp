@@ -23,3 +23,14 @@ std::string soundsphere::getenv(const std::string &name)
     return env != nullptr ? env : "";
 #endif
 }
+
+int soundsphere::setenv(const std::string &name, const std::string &value)
+{
+#if defined(_WIN32)
+    soundsphere::wstring name_w = soundsphere::utf8_to_wide(name.c_str());
+    soundsphere::wstring value_w = soundsphere::utf8_to_wide(value.c_str());
+    return _wputenv_s(name_w.get(), value_w.get());
+#else
+    return ::setenv(name.c_str(), value.c_str(), 1);
+#endif
+}
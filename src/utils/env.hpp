@@ -13,6 +13,14 @@ namespace soundsphere
  */
 std::string getenv(const std::string &name);
 
+/**
+ * @brief Sets a value in the current environment.
+ * @param[in] name  The name of the environment.
+ * @param[in] value The value.
+ * @return          0 if success, otherwise failure.
+ */
+int setenv(const std::string &name, const std::string &value);
+
 } // namespace soundsphere
 
 #endif
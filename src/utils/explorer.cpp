@@ -1,6 +1,7 @@
 #include <ev.h>
 #include <stdio.h>
 #include "utils/autoptr.hpp"
+#include "utils/lyric_sidecar.hpp"
 #include "explorer.hpp"
 
 #if defined(_WIN32)
@@ -377,6 +378,9 @@ soundsphere::StringVec soundsphere::explorer_scan_folder(const std::string &path
     FilterPatternVec pattern_vec = _filters_to_patterns(filter, filter_sz);
     FileItemVec item_vec = explorer_folder_items(path);
 
+    /* The listing is already here, record sidecar lyrics for free. */
+    lyric_sidecar_index(path, item_vec);
+
     for (size_t i = 0; i < item_vec.size(); i++)
     {
         FileItem &item = item_vec[i];
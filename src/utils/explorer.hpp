@@ -35,6 +35,7 @@ bool explorer_open_folder(std::string &path);
 
 /**
  * @brief Scan give path and return matching files.
+ * Sidecar lyric files in each directory are recorded by #lyric_sidecar_index().
  * @param[in] path      The path to scan.
  * @param[in] filter    List of filter.
  * @param[in] filter_sz The number of filters.
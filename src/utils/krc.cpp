@@ -1,127 +1,389 @@
-#include <base64.h>
-#include <regex>
 #include <zlib.h>
-#include "utils/binary.hpp"
-#include "utils/string.hpp"
-#include "utils/time.hpp"
+#include <cstring>
 #include "krc.hpp"
 
-static soundsphere::Bin _krc_xor(const std::string &data)
+/**
+ * @brief Number of decoded bytes handled in one step.
+ * Must be a multiple of 16 to keep the XOR key aligned.
+ */
+#define KRC_CHUNK_SIZE 4096
+
+/**
+ * @brief Inflate output buffer size for one step.
+ */
+#define KRC_INFLATE_SIZE (KRC_CHUNK_SIZE * 4)
+
+static const uint8_t s_krc_magic[4] = { 0x6b, 0x72, 0x63, 0x31 };
+
+static const uint8_t s_krc_key[16] = {
+    0x40, 0x47, 0x61, 0x77, 0x5e, 0x32, 0x74, 0x47, 0x51, 0x36, 0x31, 0x2d, 0xce, 0xd2, 0x6e, 0x69,
+};
+
+/**
+ * @brief Base64 decode table. Both standard and url-safe alphabet are accepted,
+ * anything else (padding, line breaks) maps to -1 and is skipped.
+ */
+typedef struct krc_b64_table
 {
-    soundsphere::Bin ret;
-    if (data[0] != 0x6b || data[1] != 0x72 || data[2] != 0x63 || data[3] != 0x31)
+    krc_b64_table();
+    int8_t value[256];
+} krc_b64_table_t;
+
+krc_b64_table::krc_b64_table()
+{
+    static const char alphabet[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+    memset(value, -1, sizeof(value));
+    for (int i = 0; i < 64; i++)
     {
-        return ret;
+        value[(uint8_t)alphabet[i]] = (int8_t)i;
     }
+    value['-'] = 62;
+    value['_'] = 63;
+}
+
+typedef struct krc_decoder
+{
+    krc_decoder(std::string &out);
+    ~krc_decoder();
+
+    std::string &out;         /**< Lyric output. */
+    std::string  line;        /**< Incomplete line carried between inflate steps. */
+    z_stream     stream;      /**< Inflate stream. */
+    bool         stream_init; /**< Inflate initialized. */
+    bool         stream_ok;   /**< Inflate initialized and no error so far. */
+    uint32_t     b64_acc;     /**< Base64 bit accumulator. */
+    int          b64_bits;    /**< Valid bits in #krc_decoder::b64_acc. */
+    size_t       raw_pos;     /**< Number of decoded bytes so far, header included. */
+} krc_decoder_t;
 
-    static const uint8_t enckey[] = {
-        0x40, 0x47, 0x61, 0x77, 0x5e, 0x32, 0x74, 0x47, 0x51, 0x36, 0x31, 0x2d, 0xce, 0xd2, 0x6e, 0x69,
-    };
-    for (size_t i = 4; i < data.size(); i++)
+krc_decoder::krc_decoder(std::string &out) : out(out)
+{
+    memset(&stream, 0, sizeof(stream));
+    stream_init = inflateInit(&stream) == Z_OK;
+    stream_ok = stream_init;
+    b64_acc = 0;
+    b64_bits = 0;
+    raw_pos = 0;
+}
+
+krc_decoder::~krc_decoder()
+{
+    if (stream_init)
+    {
+        inflateEnd(&stream);
+    }
+}
+
+/**
+ * @brief XOR \p data with the KRC key. \p phase is the key index of the first byte.
+ * The aligned part is processed 16 bytes at a time, which compilers turn into SIMD.
+ */
+static void _krc_xor(uint8_t *data, size_t size, size_t phase)
+{
+    size_t i = 0;
+    for (; i < size && ((phase + i) & 15) != 0; i++)
     {
-        uint8_t x = data[i];
-        uint8_t y = enckey[(i - 4) % sizeof(enckey)];
-        uint8_t v = x ^ y;
-        ret.push_back(v);
+        data[i] ^= s_krc_key[(phase + i) & 15];
     }
 
-    return ret;
+    uint64_t k0, k1;
+    memcpy(&k0, s_krc_key, 8);
+    memcpy(&k1, s_krc_key + 8, 8);
+    for (; i + 16 <= size; i += 16)
+    {
+        uint64_t v0, v1;
+        memcpy(&v0, data + i, 8);
+        memcpy(&v1, data + i + 8, 8);
+        v0 ^= k0;
+        v1 ^= k1;
+        memcpy(data + i, &v0, 8);
+        memcpy(data + i + 8, &v1, 8);
+    }
+
+    for (; i < size; i++)
+    {
+        data[i] ^= s_krc_key[(phase + i) & 15];
+    }
 }
 
-static std::string _zlib_uncompress(const soundsphere::Bin &data)
+/**
+ * @brief Append \p ms as `mm:ss.xx` wrapped by \p open and \p close.
+ */
+static void _krc_append_time(std::string &out, uint64_t ms, char open, char close)
 {
-    std::string unzip_data;
+    char     buf[32];
+    char    *p = buf + sizeof(buf);
+    uint64_t cs = ms / 10;
+    uint64_t minutes = cs / 6000;
+    unsigned seconds = (unsigned)(cs / 100 % 60);
+    unsigned fraction = (unsigned)(cs % 100);
 
-    z_stream stream;
-    memset(&stream, 0, sizeof(stream));
-    stream.next_in = (Bytef *)data.data();
-    stream.avail_in = (uInt)data.size();
+    *--p = close;
+    *--p = (char)('0' + fraction % 10);
+    *--p = (char)('0' + fraction / 10);
+    *--p = '.';
+    *--p = (char)('0' + seconds % 10);
+    *--p = (char)('0' + seconds / 10);
+    *--p = ':';
+    *--p = (char)('0' + minutes % 10);
+    *--p = (char)('0' + minutes / 10 % 10);
+    for (minutes /= 100; minutes != 0; minutes /= 10)
+    {
+        *--p = (char)('0' + minutes % 10);
+    }
+    *--p = open;
+
+    out.append(p, buf + sizeof(buf));
+}
 
-    if (inflateInit(&stream) != Z_OK)
+/**
+ * @brief Parse unsigned integer.
+ * @return Position after the digits, or nullptr if no digit.
+ */
+static const char *_krc_parse_uint(const char *p, const char *end, uint64_t *out)
+{
+    const char *beg = p;
+    uint64_t    v = 0;
+    for (; p < end && *p >= '0' && *p <= '9'; p++)
     {
-        return unzip_data;
+        v = v * 10 + (uint64_t)(*p - '0');
     }
+    *out = v;
+    return p != beg ? p : nullptr;
+}
 
-    int result;
-    char buffer[4096];
+/**
+ * @brief Parse `<offset,duration,x>` word tag at \p p.
+ * @return Position after the tag, or nullptr if not a word tag.
+ */
+static const char *_krc_parse_word_tag(const char *p, const char *end, uint64_t *offset)
+{
+    uint64_t tmp;
+    if (*p != '<' || (p = _krc_parse_uint(p + 1, end, offset)) == nullptr || p >= end || *p != ',' ||
+        (p = _krc_parse_uint(p + 1, end, &tmp)) == nullptr || p >= end || *p != ',' ||
+        (p = _krc_parse_uint(p + 1, end, &tmp)) == nullptr || p >= end || *p != '>')
+    {
+        return nullptr;
+    }
+    return p + 1;
+}
 
-    do
+/**
+ * @brief Whether `[key:value]` metadata, where neither key nor value contains spaces.
+ */
+static bool _krc_is_meta(const char *beg, const char *end)
+{
+    if (end - beg < 5 || *beg != '[' || end[-1] != ']')
     {
-        stream.next_out = (Bytef *)buffer;
-        stream.avail_out = sizeof(buffer);
+        return false;
+    }
 
-        result = inflate(&stream, Z_NO_FLUSH);
-        if (result == Z_STREAM_END || result == Z_DATA_ERROR || result == Z_MEM_ERROR)
+    const char *colon = nullptr;
+    for (const char *p = beg + 1; p < end - 1; p++)
+    {
+        if (*p == ' ' || *p == '\t')
         {
-            break;
+            return false;
         }
+        if (*p == ':' && colon == nullptr)
+        {
+            colon = p;
+        }
+    }
+    return colon != nullptr && colon > beg + 1 && colon < end - 2;
+}
 
-        unzip_data.append(buffer, sizeof(buffer) - stream.avail_out);
-    } while (result != Z_STREAM_END);
+/**
+ * @brief Convert one KRC line to LRC.
+ *
+ * + `[key:value]` is kept as is.
+ * + `[start,duration]<offset,duration,0>word...` becomes `[mm:ss.xx]<mm:ss.xx>word...<mm:ss.xx>`,
+ *   where the last timestamp is the end of the line.
+ */
+static void _krc_convert_line(std::string &out, const char *beg, const char *end)
+{
+    for (; beg < end && (*beg == ' ' || *beg == '\t' || *beg == '\r'); beg++)
+    {
+    }
+    for (; end > beg && (end[-1] == ' ' || end[-1] == '\t' || end[-1] == '\r'); end--)
+    {
+    }
+    if (beg == end || *beg != '[')
+    {
+        return;
+    }
 
-    inflateEnd(&stream);
-    return unzip_data;
+    uint64_t    start, duration;
+    const char *p = _krc_parse_uint(beg + 1, end, &start);
+    if (p == nullptr || p >= end || *p != ',' || (p = _krc_parse_uint(p + 1, end, &duration)) == nullptr ||
+        p >= end || *p != ']')
+    {
+        if (_krc_is_meta(beg, end))
+        {
+            out.append(beg, end);
+            out.push_back('\n');
+        }
+        return;
+    }
+
+    _krc_append_time(out, start, '[', ']');
+    for (p = p + 1; p < end;)
+    {
+        uint64_t    offset;
+        const char *word = _krc_parse_word_tag(p, end, &offset);
+        if (word == nullptr)
+        {
+            /* Not a tag, skip to next one. */
+            const char *next = (const char *)memchr(p + 1, '<', end - p - 1);
+            p = next != nullptr ? next : end;
+            continue;
+        }
+
+        const char *word_end = (const char *)memchr(word, '<', end - word);
+        word_end = word_end != nullptr ? word_end : end;
+
+        _krc_append_time(out, start + offset, '<', '>');
+        out.append(word, word_end);
+        p = word_end;
+    }
+    _krc_append_time(out, start + duration, '<', '>');
+    out.push_back('\n');
 }
 
-static std::string _format_time(int time)
+/**
+ * @brief Split inflated text into lines. Incomplete tail is kept for the next call.
+ */
+static void _krc_feed_text(krc_decoder_t *decoder, const char *data, size_t size)
 {
-    double duration = (time) / 1000;
-    return soundsphere::time_seconds_to_string(duration);
+    const char *end = data + size;
+    while (data < end)
+    {
+        const char *eol = (const char *)memchr(data, '\n', end - data);
+        if (eol == nullptr)
+        {
+            decoder->line.append(data, end);
+            return;
+        }
+
+        if (decoder->line.empty())
+        {
+            _krc_convert_line(decoder->out, data, eol);
+        }
+        else
+        {
+            decoder->line.append(data, eol);
+            _krc_convert_line(decoder->out, decoder->line.data(), decoder->line.data() + decoder->line.size());
+            decoder->line.clear();
+        }
+        data = eol + 1;
+    }
 }
 
-static std::string _krc_to_lyric(const std::string &data)
+/**
+ * @brief Inflate \p size bytes of compressed data.
+ */
+static void _krc_feed_zip(krc_decoder_t *decoder, uint8_t *data, size_t size)
 {
-    std::regex metaRegex("^\\[(\\S+):(\\S+)\\]$");
-    std::regex timestampsRegex("^\\[(\\d+),(\\d+)\\]");
-    std::regex timestamps2Regex("<(\\d+),(\\d+),(\\d+)>([^<]*)");
+    char buffer[KRC_INFLATE_SIZE];
 
-    soundsphere::StringVec lines = soundsphere::string_split(data, "\n");
-    lines = soundsphere::string_trim_vec(lines);
-
-    std::string lyric;
-    std::smatch matches;
-    for (auto it = lines.begin(); it != lines.end(); it++)
+    decoder->stream.next_in = (Bytef *)data;
+    decoder->stream.avail_in = (uInt)size;
+    while (decoder->stream_ok)
     {
-        std::string line = *it;
+        decoder->stream.next_out = (Bytef *)buffer;
+        decoder->stream.avail_out = sizeof(buffer);
+
+        int ret = inflate(&decoder->stream, Z_NO_FLUSH);
+        _krc_feed_text(decoder, buffer, sizeof(buffer) - decoder->stream.avail_out);
 
-        if (std::regex_search(line, matches, metaRegex))
+        if (ret == Z_STREAM_END)
         {
-            std::string str = matches[0].str();
-            lyric += str + "\n";
-            continue;
+            decoder->stream_ok = false;
+            return;
         }
+        if (ret != Z_OK && ret != Z_BUF_ERROR)
+        {
+            decoder->stream_ok = false;
+            return;
+        }
+        if (decoder->stream.avail_out != 0)
+        {
+            return;
+        }
+    }
+}
 
-        if (std::regex_search(line, matches, timestampsRegex))
+/**
+ * @brief XOR and inflate \p size bytes of decoded data.
+ */
+static void _krc_feed_raw(krc_decoder_t *decoder, uint8_t *data, size_t size)
+{
+    size_t skip = 0;
+    for (; skip < size && decoder->raw_pos < sizeof(s_krc_magic); skip++, decoder->raw_pos++)
+    {
+        if (data[skip] != s_krc_magic[decoder->raw_pos])
         {
-            std::string lyric_line;
-
-            std::string str = matches[1].str();
-            int startTime = std::stoi(str);
-            str = matches[2].str();
-            int duration = std::stoi(str);
-            lyric_line += "[" + _format_time(startTime) + "]";
-
-            auto words_begin = std::sregex_iterator(line.begin(), line.end(), timestamps2Regex);
-            for (; words_begin != std::sregex_iterator(); words_begin++)
-            {
-                std::smatch match = *words_begin;
-                int offset = std::stoi(match[1].str());
-                std::string subword = match[4].str();
-                lyric_line += "<" + _format_time(startTime + offset) + ">" + subword;
-            }
-
-            lyric_line += "<" + _format_time(startTime + duration) + ">";
-            lyric += lyric_line + "\n";
+            decoder->stream_ok = false;
+            return;
         }
     }
 
-    return lyric;
+    size_t phase = decoder->raw_pos - sizeof(s_krc_magic);
+    _krc_xor(data + skip, size - skip, phase);
+    decoder->raw_pos += size - skip;
+
+    _krc_feed_zip(decoder, data + skip, size - skip);
 }
 
 std::string soundsphere::krc_to_lyric(const std::string &data)
 {
-    std::string base64_decode_data = base64_decode(data);
-    soundsphere::Bin zip_data = _krc_xor(base64_decode_data);
-    std::string unzip_data = _zlib_uncompress(zip_data);
-    return _krc_to_lyric(unzip_data);
+    static const krc_b64_table_t table;
+
+    std::string   lyric;
+    krc_decoder_t decoder(lyric);
+    uint8_t       raw[KRC_CHUNK_SIZE];
+    size_t        raw_sz = 0;
+
+    /* Decompressed KRC is usually 3~5 times of the base64 text, and LRC is a bit shorter. */
+    lyric.reserve(data.size() * 3);
+    decoder.line.reserve(256);
+
+    const uint8_t *p = (const uint8_t *)data.data();
+    const uint8_t *end = p + data.size();
+    for (; p < end && decoder.stream_ok; p++)
+    {
+        int8_t v = table.value[*p];
+        if (v < 0)
+        {
+            continue;
+        }
+
+        decoder.b64_acc = (decoder.b64_acc << 6) | (uint32_t)v;
+        decoder.b64_bits += 6;
+        if (decoder.b64_bits < 8)
+        {
+            continue;
+        }
+
+        decoder.b64_bits -= 8;
+        raw[raw_sz++] = (uint8_t)(decoder.b64_acc >> decoder.b64_bits);
+        if (raw_sz == sizeof(raw))
+        {
+            _krc_feed_raw(&decoder, raw, raw_sz);
+            raw_sz = 0;
+        }
+    }
+    if (raw_sz != 0 && decoder.stream_ok)
+    {
+        _krc_feed_raw(&decoder, raw, raw_sz);
+    }
+
+    /* Last line may not end with a line break. */
+    if (!decoder.line.empty())
+    {
+        _krc_convert_line(lyric, decoder.line.data(), decoder.line.data() + decoder.line.size());
+    }
+
+    return lyric;
 }
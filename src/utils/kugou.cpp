@@ -0,0 +1,102 @@
+#include <nlohmann/json.hpp>
+#include "utils/curl.hpp"
+#include "utils/env.hpp"
+#include "utils/krc.hpp"
+#include "utils/trace.hpp"
+#include "kugou.hpp"
+
+soundsphere::kugou_candidate::kugou_candidate()
+{
+    duration = 0;
+}
+
+std::string soundsphere::kugou_base_url(void)
+{
+    std::string url = soundsphere::getenv("SOUNDSPHERE_KUGOU_URL");
+    while (!url.empty() && url.back() == '/')
+    {
+        url.pop_back();
+    }
+    return url.empty() ? "https://lyrics.kugou.com" : url;
+}
+
+static std::string _kugou_escape(const std::string &data)
+{
+    /* The handle is not used by libcurl for escaping. */
+    char       *escape_data = curl_easy_escape(nullptr, data.data(), (int)data.size());
+    std::string ret(escape_data != nullptr ? escape_data : "");
+    curl_free(escape_data);
+    return ret;
+}
+
+static int _kugou_parse_json(const std::string &body, nlohmann::json &rsp, std::string &errinfo)
+{
+    rsp = nlohmann::json::parse(body, nullptr, false);
+    if (rsp.is_discarded() || !rsp.is_object())
+    {
+        errinfo = "invalid response";
+        return -1;
+    }
+    return 0;
+}
+
+std::string soundsphere::kugou_search_url(const std::string &artist, const std::string &title)
+{
+    return kugou_base_url() + "/search?ver=1&man=yes&client=pc&keyword=" + _kugou_escape(artist) + "-" +
+           _kugou_escape(title) + "&hash=";
+}
+
+int soundsphere::kugou_parse_search(const std::string &body, KugouCandidateVec &candidates, std::string &errinfo)
+{
+    nlohmann::json rsp;
+    if (_kugou_parse_json(body, rsp, errinfo) != 0)
+    {
+        return -1;
+    }
+
+    candidates.clear();
+    nlohmann::json &items = rsp["candidates"];
+    for (auto it = items.begin(); it != items.end(); it++)
+    {
+        if (!it->is_object())
+        {
+            continue;
+        }
+
+        kugou_candidate_t item;
+        item.id = it->value("id", "");
+        item.accesskey = it->value("accesskey", "");
+        item.artist = it->value("singer", "");
+        item.title = it->value("song", "");
+        item.duration = it->value("duration", 0.0) / 1000;
+        candidates.push_back(item);
+    }
+
+    return 0;
+}
+
+std::string soundsphere::kugou_download_url(const kugou_candidate_t &candidate)
+{
+    return kugou_base_url() + "/download?ver=1&client=pc&id=" + candidate.id + "&accesskey=" + candidate.accesskey +
+           "&fmt=krc&charset=utf8";
+}
+
+int soundsphere::kugou_parse_download(const std::string &body, std::string &lyric, std::string &errinfo)
+{
+    nlohmann::json rsp;
+    if (_kugou_parse_json(body, rsp, errinfo) != 0)
+    {
+        return -1;
+    }
+
+    std::string content = rsp.value("content", "");
+    if (content.empty())
+    {
+        errinfo = "empty lyric";
+        return -1;
+    }
+
+    TRACE_ZONE("krc_to_lyric");
+    lyric = krc_to_lyric(content);
+    return 0;
+}
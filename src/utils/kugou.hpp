@@ -0,0 +1,71 @@
+#ifndef SOUND_SPHERE_UTILS_KUGOU_HPP
+#define SOUND_SPHERE_UTILS_KUGOU_HPP
+
+#include <string>
+#include <vector>
+
+namespace soundsphere
+{
+
+/**
+ * @brief A lyric candidate returned by search.
+ */
+typedef struct kugou_candidate
+{
+    kugou_candidate();
+
+    std::string id;        /**< Lyric ID. */
+    std::string accesskey; /**< Access key for download. */
+    std::string artist;    /**< Singer. */
+    std::string title;     /**< Song name. */
+    double      duration;  /**< Duration in seconds. */
+} kugou_candidate_t;
+
+typedef std::vector<kugou_candidate_t> KugouCandidateVec;
+
+/**
+ * @brief Get lyric server base URL.
+ *
+ * Defaults to `https://lyrics.kugou.com`. It can be overridden by environment
+ * variable `SOUNDSPHERE_KUGOU_URL`, so a local stand-in server can be used.
+ *
+ * @return Base URL without trailing slash.
+ */
+std::string kugou_base_url(void);
+
+/**
+ * @brief Build search URL.
+ * @param[in] artist    Artist.
+ * @param[in] title     Title.
+ * @return URL.
+ */
+std::string kugou_search_url(const std::string &artist, const std::string &title);
+
+/**
+ * @brief Parse search response.
+ * @param[in] body          Response body.
+ * @param[out] candidates   Search result.
+ * @param[out] errinfo      Error information.
+ * @return 0 if success.
+ */
+int kugou_parse_search(const std::string &body, KugouCandidateVec &candidates, std::string &errinfo);
+
+/**
+ * @brief Build download URL.
+ * @param[in] candidate Search result.
+ * @return URL.
+ */
+std::string kugou_download_url(const kugou_candidate_t &candidate);
+
+/**
+ * @brief Parse download response and convert lyric to LRC.
+ * @param[in] body      Response body.
+ * @param[out] lyric    LRC text.
+ * @param[out] errinfo  Error information.
+ * @return 0 if success.
+ */
+int kugou_parse_download(const std::string &body, std::string &lyric, std::string &errinfo);
+
+} // namespace soundsphere
+
+#endif
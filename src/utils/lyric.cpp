@@ -0,0 +1,389 @@
+#include <algorithm>
+#include <cctype>
+#include <cstdlib>
+#include <cstring>
+#include "lyric.hpp"
+
+/**
+ * @brief Fallback duration for the last word when no end timestamp is given.
+ */
+#define LYRIC_LAST_WORD_DURATION 1.0
+
+soundsphere::lyric_timeline::lyric_timeline()
+{
+    timed = false;
+}
+
+static bool _lyric_is_space(char c)
+{
+    return c == ' ' || c == '\t' || c == '\r' || c == '\n' || c == '\f' || c == '\v';
+}
+
+/**
+ * @brief Parse timestamp between \p beg and \p end (brackets excluded).
+ *
+ * Two fields are `mm:ss`, three fields are `hh:mm:ss`. The last field may
+ * carry a fraction separated by `.`.
+ *
+ * @return true if parsed.
+ */
+static bool _lyric_parse_time(const char *beg, const char *end, double *out)
+{
+    double fields[3] = { 0, 0, 0 };
+    int    field_cnt = 0;
+    double fraction = 0;
+
+    const char *p = beg;
+    while (p < end)
+    {
+        if (!isdigit((unsigned char)*p) || field_cnt >= 3)
+        {
+            return false;
+        }
+
+        double v = 0;
+        for (; p < end && isdigit((unsigned char)*p); p++)
+        {
+            v = v * 10 + (*p - '0');
+        }
+        fields[field_cnt++] = v;
+
+        if (p == end)
+        {
+            break;
+        }
+        if (*p == ':')
+        {
+            p++;
+            continue;
+        }
+        if (*p != '.')
+        {
+            return false;
+        }
+
+        /* Fraction is always the tail. */
+        double scale = 0.1;
+        for (p++; p < end && isdigit((unsigned char)*p); p++)
+        {
+            fraction += (*p - '0') * scale;
+            scale *= 0.1;
+        }
+        if (p != end)
+        {
+            return false;
+        }
+    }
+
+    switch (field_cnt)
+    {
+    case 2:
+        *out = fields[0] * 60 + fields[1] + fraction;
+        return true;
+    case 3:
+        *out = fields[0] * 3600 + fields[1] * 60 + fields[2] + fraction;
+        return true;
+    default:
+        return false;
+    }
+}
+
+/**
+ * @brief Parse `[offset:+/-ms]`.
+ * @return true if it is an offset tag.
+ */
+static bool _lyric_parse_offset(const char *beg, const char *end, double *out)
+{
+    static const char tag[] = "offset:";
+    const size_t      tag_sz = sizeof(tag) - 1;
+    if ((size_t)(end - beg) <= tag_sz || strncmp(beg, tag, tag_sz) != 0)
+    {
+        return false;
+    }
+
+    std::string val(beg + tag_sz, end);
+    *out = strtol(val.c_str(), nullptr, 10) / 1000.0;
+    return true;
+}
+
+/**
+ * @brief Append text of one line to timeline, splitting word timestamps.
+ * @param[in,out] timeline  Timeline.
+ * @param[in] beg           Text begin (line timestamps excluded).
+ * @param[in] end           Text end.
+ * @param[out] line         Line to fill offset, length and words.
+ */
+static void _lyric_append_text(soundsphere::lyric_timeline_t &timeline, const char *beg, const char *end,
+                               soundsphere::lyric_line_t &line)
+{
+    std::string &text = timeline.text;
+    line.offset = (uint32_t)text.size();
+    line.word_beg = (uint32_t)timeline.words.size();
+    line.word_cnt = 0;
+
+    soundsphere::lyric_word_t *word = nullptr;
+    const char                *p = beg;
+    while (p < end)
+    {
+        const char *close = nullptr;
+        double      t = 0;
+        if (*p == '<' && (close = (const char *)memchr(p, '>', end - p)) != nullptr &&
+            _lyric_parse_time(p + 1, close, &t))
+        {
+            if (word != nullptr)
+            {
+                word->length = (uint32_t)text.size() - word->offset;
+                word->end = t;
+            }
+
+            soundsphere::lyric_word_t new_word;
+            new_word.start = t;
+            new_word.end = -1;
+            new_word.offset = (uint32_t)text.size();
+            new_word.length = 0;
+            timeline.words.push_back(new_word);
+            word = &timeline.words.back();
+
+            p = close + 1;
+            continue;
+        }
+
+        /* Copy plain run at once. */
+        const char *run_end = (const char *)memchr(p + 1, '<', end - p - 1);
+        run_end = run_end != nullptr ? run_end : end;
+        text.append(p, run_end);
+        p = run_end;
+    }
+
+    if (word != nullptr)
+    {
+        word->length = (uint32_t)text.size() - word->offset;
+        /* A trailing timestamp only closes the previous word. */
+        if (word->length == 0)
+        {
+            timeline.words.pop_back();
+        }
+    }
+
+    line.word_cnt = (uint32_t)timeline.words.size() - line.word_beg;
+    line.length = (uint32_t)text.size() - line.offset;
+}
+
+/**
+ * @brief Fill #lyric_line_t::end and missing word end times.
+ */
+static void _lyric_fill_end_time(soundsphere::lyric_timeline_t &timeline)
+{
+    soundsphere::LyricLineVec &lines = timeline.lines;
+
+    double next_start = -1;
+    for (size_t i = lines.size(); i > 0; i--)
+    {
+        soundsphere::lyric_line_t &line = lines[i - 1];
+        if (i < lines.size() && lines[i].start > line.start)
+        {
+            next_start = lines[i].start;
+        }
+
+        for (uint32_t w = 0; w < line.word_cnt; w++)
+        {
+            soundsphere::lyric_word_t &word = timeline.words[line.word_beg + w];
+            if (word.end >= 0)
+            {
+                continue;
+            }
+            if (w + 1 < line.word_cnt)
+            {
+                word.end = timeline.words[line.word_beg + w + 1].start;
+            }
+            else
+            {
+                word.end = next_start > word.start ? next_start : word.start + LYRIC_LAST_WORD_DURATION;
+            }
+        }
+
+        if (next_start > line.start)
+        {
+            line.end = next_start;
+        }
+        else if (line.word_cnt != 0)
+        {
+            line.end = timeline.words[line.word_beg + line.word_cnt - 1].end;
+        }
+        else
+        {
+            line.end = line.start;
+        }
+    }
+}
+
+soundsphere::LyricTimelinePtr soundsphere::lyric_compile(const std::string &src)
+{
+    LyricTimelinePtr   ret = std::make_shared<lyric_timeline_t>();
+    lyric_timeline_t  &timeline = *ret;
+    std::vector<double> times;
+    double              offset = 0;
+    double              last_start = 0;
+
+    timeline.text.reserve(src.size());
+
+    const char *data = src.c_str();
+    const char *data_end = data + src.size();
+    while (data < data_end)
+    {
+        const char *line_end = (const char *)memchr(data, '\n', data_end - data);
+        line_end = line_end != nullptr ? line_end : data_end;
+
+        /* Trim. */
+        const char *beg = data;
+        const char *end = line_end;
+        data = line_end + 1;
+        for (; beg < end && _lyric_is_space(*beg); beg++)
+        {
+        }
+        for (; end > beg && _lyric_is_space(end[-1]); end--)
+        {
+        }
+
+        /* Leading timestamps. */
+        times.clear();
+        bool is_tag = false;
+        while (beg < end && *beg == '[')
+        {
+            const char *close = (const char *)memchr(beg, ']', end - beg);
+            double      t = 0;
+            if (close == nullptr)
+            {
+                break;
+            }
+            if (_lyric_parse_time(beg + 1, close, &t))
+            {
+                times.push_back(t);
+                beg = close + 1;
+                continue;
+            }
+            if (times.empty() && isalpha((unsigned char)beg[1]) && memchr(beg, ':', close - beg) != nullptr)
+            {
+                _lyric_parse_offset(beg + 1, close, &offset);
+                is_tag = true;
+            }
+            break;
+        }
+        if (is_tag || (times.empty() && beg == end))
+        {
+            continue;
+        }
+
+        lyric_line_t line;
+        _lyric_append_text(timeline, beg, end, line);
+
+        if (times.empty())
+        {
+            /* Untimed text follows the previous line. */
+            line.start = last_start;
+            line.end = -1;
+            timeline.lines.push_back(line);
+            continue;
+        }
+
+        timeline.timed = true;
+        for (size_t i = 0; i < times.size(); i++)
+        {
+            lyric_line_t dup = line;
+            dup.start = times[i];
+            dup.end = -1;
+
+            /* Repeated lines get their own copy of words, shifted in time. */
+            if (i != 0 && line.word_cnt != 0)
+            {
+                double shift = times[i] - times[0];
+                dup.word_beg = (uint32_t)timeline.words.size();
+                for (uint32_t w = 0; w < line.word_cnt; w++)
+                {
+                    lyric_word_t word = timeline.words[line.word_beg + w];
+                    word.start += shift;
+                    word.end = word.end >= 0 ? word.end + shift : word.end;
+                    timeline.words.push_back(word);
+                }
+            }
+            timeline.lines.push_back(dup);
+        }
+        last_start = times[0];
+    }
+
+    LyricLineVec &lines = timeline.lines;
+    if (offset != 0)
+    {
+        /* Positive offset shows lyric earlier. */
+        for (size_t i = 0; i < lines.size(); i++)
+        {
+            lines[i].start = std::max(0.0, lines[i].start - offset);
+        }
+        for (size_t i = 0; i < timeline.words.size(); i++)
+        {
+            lyric_word_t &word = timeline.words[i];
+            word.start = std::max(0.0, word.start - offset);
+            word.end = word.end >= 0 ? std::max(0.0, word.end - offset) : word.end;
+        }
+    }
+
+    auto cmp = [](const lyric_line_t &a, const lyric_line_t &b) { return a.start < b.start; };
+    if (!std::is_sorted(lines.begin(), lines.end(), cmp))
+    {
+        std::stable_sort(lines.begin(), lines.end(), cmp);
+    }
+    _lyric_fill_end_time(timeline);
+
+    timeline.text.shrink_to_fit();
+    return ret;
+}
+
+void soundsphere::lyric_find_lines(const lyric_timeline_t &timeline, double position, size_t &beg, size_t &end)
+{
+    const LyricLineVec &lines = timeline.lines;
+
+    LyricLineVec::const_iterator it =
+        std::upper_bound(lines.begin(), lines.end(), position,
+                         [](double pos, const lyric_line_t &line) { return pos < line.start; });
+    if (!timeline.timed || it == lines.begin())
+    {
+        beg = end = 0;
+        return;
+    }
+
+    double                       active_start = std::prev(it)->start;
+    LyricLineVec::const_iterator first =
+        std::lower_bound(lines.begin(), it, active_start,
+                         [](const lyric_line_t &line, double pos) { return line.start < pos; });
+
+    beg = first - lines.begin();
+    end = it - lines.begin();
+}
+
+int soundsphere::lyric_find_word(const lyric_timeline_t &timeline, const lyric_line_t &line, double position,
+                                 float &progress)
+{
+    LyricWordVec::const_iterator beg = timeline.words.begin() + line.word_beg;
+    LyricWordVec::const_iterator end = beg + line.word_cnt;
+
+    LyricWordVec::const_iterator it = std::upper_bound(
+        beg, end, position, [](double pos, const lyric_word_t &word) { return pos < word.start; });
+    if (it == beg)
+    {
+        progress = 0.0f;
+        return -1;
+    }
+
+    const lyric_word_t &word = *std::prev(it);
+    double              duration = word.end - word.start;
+    if (duration <= 0 || position >= word.end)
+    {
+        progress = 1.0f;
+    }
+    else
+    {
+        progress = (float)((position - word.start) / duration);
+    }
+
+    return (int)(std::prev(it) - beg);
+}
@@ -0,0 +1,113 @@
+#ifndef SOUND_SPHERE_UTILS_LYRIC_HPP
+#define SOUND_SPHERE_UTILS_LYRIC_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace soundsphere
+{
+
+/**
+ * @brief A timed word (or syllable) in a line.
+ */
+typedef struct lyric_word
+{
+    double   start;  /**< Start time in seconds. */
+    double   end;    /**< End time in seconds. */
+    uint32_t offset; /**< Offset of text in #lyric_timeline_t::text. */
+    uint32_t length; /**< Length of text in bytes. */
+} lyric_word_t;
+
+/**
+ * @brief A lyric line.
+ */
+typedef struct lyric_line
+{
+    double   start;    /**< Start time in seconds. */
+    double   end;      /**< Start time of the next line in seconds, or the last word end time for the last line. */
+    uint32_t offset;   /**< Offset of text in #lyric_timeline_t::text. */
+    uint32_t length;   /**< Length of text in bytes. */
+    uint32_t word_beg; /**< Index of first word in #lyric_timeline_t::words. */
+    uint32_t word_cnt; /**< Number of words. 0 if the line has no word timestamps. */
+} lyric_line_t;
+
+typedef std::vector<lyric_line_t> LyricLineVec;
+typedef std::vector<lyric_word_t> LyricWordVec;
+
+/**
+ * @brief Compiled lyric.
+ *
+ * All text lives in one buffer and lines / words reference it by offset, so a
+ * timeline is three allocations no matter how long the lyric is. Lines are
+ * sorted by start time; words of a line are contiguous and sorted as well.
+ */
+typedef struct lyric_timeline
+{
+    lyric_timeline();
+
+    /**
+     * @brief Whether any line carries a timestamp.
+     */
+    bool timed;
+
+    /**
+     * @brief Text of all lines and words.
+     */
+    std::string text;
+
+    /**
+     * @brief Lines sorted by start time.
+     * A line with several leading timestamps appears once per timestamp.
+     */
+    LyricLineVec lines;
+
+    /**
+     * @brief Words of all lines.
+     */
+    LyricWordVec words;
+} lyric_timeline_t;
+
+typedef std::shared_ptr<lyric_timeline_t> LyricTimelinePtr;
+
+/**
+ * @brief Compile LRC text into timeline.
+ *
+ * Supported syntax:
+ * + `[mm:ss]`, `[mm:ss.xx]`, `[mm:ss.xxx]` and `[hh:mm:ss]` line timestamps,
+ *   any number of them in front of a line.
+ * + `<mm:ss.xx>` word timestamps (enhanced LRC, also produced by #krc_to_lyric()).
+ * + `[offset:+/-ms]` tag. Other ID tags are ignored.
+ * + Lines without timestamp take the start time of the previous line.
+ *
+ * @param[in] src   LRC text.
+ * @return Timeline, never null.
+ */
+LyricTimelinePtr lyric_compile(const std::string &src);
+
+/**
+ * @brief Find the lines that should be highlighted at \p position.
+ * All lines that share the latest start time not after \p position are returned,
+ * which covers original text and its translation.
+ * @param[in] timeline  Timeline.
+ * @param[in] position  Play position in seconds.
+ * @param[out] beg      Index of first line.
+ * @param[out] end      Index after last line. Equals \p beg if nothing to highlight.
+ */
+void lyric_find_lines(const lyric_timeline_t &timeline, double position, size_t &beg, size_t &end);
+
+/**
+ * @brief Find the word that is being sung at \p position.
+ * @param[in] timeline  Timeline.
+ * @param[in] line      Line.
+ * @param[in] position  Play position in seconds.
+ * @param[out] progress Progress of the word in [0, 1].
+ * @return Index of word relative to #lyric_line_t::word_beg, or -1 if no word started yet.
+ */
+int lyric_find_word(const lyric_timeline_t &timeline, const lyric_line_t &line, double position, float &progress);
+
+} // namespace soundsphere
+
+#endif
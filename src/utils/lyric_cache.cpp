@@ -0,0 +1,629 @@
+#include <ev.h>
+#include <nlohmann/json.hpp>
+#include <cctype>
+#include <cmath>
+#include <cstdio>
+#include <list>
+#include <unordered_map>
+#include <vector>
+#include "config/__init__.hpp"
+#include "utils/binary.hpp"
+#include "utils/string.hpp"
+#include "lyric_cache.hpp"
+
+/**
+ * @brief Minimum interval between index saves caused by stores.
+ * The index is always saved on exit, so only a crash loses recent entries.
+ */
+#define LYRIC_CACHE_SAVE_INTERVAL_MS 5000
+
+/**
+ * @brief Locks that entry files are spread over by key hash.
+ */
+#define LYRIC_CACHE_FILE_LOCKS 16
+
+typedef struct lyric_cache_entry
+{
+    std::string key;  /**< Cache key. */
+    std::string file; /**< File name in cache directory. */
+    uint64_t    size; /**< File size in bytes. */
+} lyric_cache_entry_t;
+
+/**
+ * @brief Entries in access order, least recently used first.
+ */
+typedef std::list<lyric_cache_entry_t> LyricCacheList;
+
+typedef std::vector<lyric_cache_entry_t> LyricCacheEntryVec;
+
+typedef std::unordered_map<std::string, LyricCacheList::iterator> LyricCacheIndex;
+
+typedef struct lyric_cache_ctx
+{
+    lyric_cache_ctx();
+    ~lyric_cache_ctx();
+
+    /**
+     * @brief Cache directory.
+     */
+    std::string dir;
+
+    /**
+     * @brief Serialize I/O of entry files by key hash, so a read never sees a
+     * store of the same key half written. Taken before #lyric_cache_ctx::mutex,
+     * and only one at a time.
+     */
+    ev_mutex_t file_locks[LYRIC_CACHE_FILE_LOCKS];
+
+    /**
+     * @brief Serializes index saves, so an older copy is never written last.
+     * Taken before #lyric_cache_ctx::mutex.
+     */
+    ev_mutex_t save_mutex;
+
+    /**
+     * @brief Protects everything below. Only held for bookkeeping, files are
+     * read and written without it.
+     */
+    ev_mutex_t mutex;
+
+    /**
+     * @brief LRU list.
+     */
+    LyricCacheList lru;
+
+    /**
+     * @brief Key to LRU node.
+     */
+    LyricCacheIndex index;
+
+    /**
+     * @brief File name to LRU node, to find the entry a store overwrites.
+     */
+    LyricCacheIndex files;
+
+    /**
+     * @brief Sum of #lyric_cache_entry_t::size.
+     */
+    uint64_t total_size;
+
+    /**
+     * @brief Entries stored, evicted or dropped since last index save.
+     */
+    bool dirty;
+
+    /**
+     * @brief Access order changed by reads since last index save. It alone
+     * does not cause a save before exit.
+     */
+    bool touched;
+
+    /**
+     * @brief Time of last index save, from ev_hrtime().
+     */
+    uint64_t saved_at;
+} lyric_cache_ctx_t;
+
+static lyric_cache_ctx_t *s_lyric_cache = nullptr;
+
+lyric_cache_ctx::lyric_cache_ctx()
+{
+    for (size_t i = 0; i < LYRIC_CACHE_FILE_LOCKS; i++)
+    {
+        ev_mutex_init(&file_locks[i], 0);
+    }
+    ev_mutex_init(&save_mutex, 0);
+    ev_mutex_init(&mutex, 0);
+    total_size = 0;
+    dirty = false;
+    touched = false;
+    saved_at = 0;
+}
+
+lyric_cache_ctx::~lyric_cache_ctx()
+{
+    for (size_t i = 0; i < LYRIC_CACHE_FILE_LOCKS; i++)
+    {
+        ev_mutex_exit(&file_locks[i]);
+    }
+    ev_mutex_exit(&save_mutex);
+    ev_mutex_exit(&mutex);
+}
+
+static std::string _lyric_cache_path(const std::string &file)
+{
+    return s_lyric_cache->dir + "/" + file;
+}
+
+/**
+ * @brief Lock of entry file of \p key. Keys with the same file share it.
+ */
+static ev_mutex_t *_lyric_cache_file_lock(const std::string &key)
+{
+    return &s_lyric_cache->file_locks[soundsphere::string_hash_djb2(key) % LYRIC_CACHE_FILE_LOCKS];
+}
+
+static bool _lyric_cache_read(const std::string &path, std::string &data)
+{
+    ev_fs_req_t req;
+    ssize_t     ret = ev_fs_readfile(nullptr, &req, path.c_str(), nullptr);
+    if (ret < 0)
+    {
+        return false;
+    }
+
+    const ev_buf_t *buf = ev_fs_get_filecontent(&req);
+    data.assign((char *)buf->data, buf->size);
+    ev_fs_req_cleanup(&req);
+
+    return true;
+}
+
+/**
+ * @brief Save index. The list is copied with the lock held, and written without it.
+ */
+static void _lyric_cache_save_index(void)
+{
+    ev_mutex_enter(&s_lyric_cache->save_mutex);
+
+    nlohmann::json json = nlohmann::json::array();
+    ev_mutex_enter(&s_lyric_cache->mutex);
+    for (LyricCacheList::iterator it = s_lyric_cache->lru.begin(); it != s_lyric_cache->lru.end(); it++)
+    {
+        json.push_back({ { "key", it->key }, { "file", it->file }, { "size", it->size } });
+    }
+    s_lyric_cache->dirty = false;
+    s_lyric_cache->touched = false;
+    s_lyric_cache->saved_at = ev_hrtime();
+    ev_mutex_leave(&s_lyric_cache->mutex);
+
+    std::string data = json.dump();
+    std::string path = _lyric_cache_path("index.json");
+    soundsphere::dump(path.c_str(), data.c_str(), data.size());
+
+    ev_mutex_leave(&s_lyric_cache->save_mutex);
+}
+
+/**
+ * @brief Get string field \p name of object \p obj.
+ * @return The value, or empty if missing or not a string.
+ */
+static std::string _lyric_cache_string(const nlohmann::json &obj, const char *name)
+{
+    auto it = obj.find(name);
+    return (it != obj.end() && it->is_string()) ? it->get<std::string>() : std::string();
+}
+
+/**
+ * @brief Get number field \p name of object \p obj.
+ * @return The value, or \p dflt if missing or not a number.
+ */
+template <typename T>
+static T _lyric_cache_number(const nlohmann::json &obj, const char *name, T dflt)
+{
+    auto it = obj.find(name);
+    return (it != obj.end() && it->is_number()) ? it->get<T>() : dflt;
+}
+
+/**
+ * @brief Link \p entry as most recently used.
+ */
+static void _lyric_cache_link(const lyric_cache_entry_t &entry)
+{
+    LyricCacheList::iterator it = s_lyric_cache->lru.insert(s_lyric_cache->lru.end(), entry);
+    s_lyric_cache->index[entry.key] = it;
+    s_lyric_cache->files[entry.file] = it;
+    s_lyric_cache->total_size += entry.size;
+}
+
+/**
+ * @brief Forget \p it, leaving its file in place.
+ */
+static void _lyric_cache_unlink(LyricCacheList::iterator it)
+{
+    s_lyric_cache->total_size -= it->size;
+    s_lyric_cache->index.erase(it->key);
+    s_lyric_cache->files.erase(it->file);
+    s_lyric_cache->lru.erase(it);
+    s_lyric_cache->dirty = true;
+}
+
+static void _lyric_cache_load_index(void)
+{
+    std::string data;
+    if (!_lyric_cache_read(_lyric_cache_path("index.json"), data))
+    {
+        return;
+    }
+
+    nlohmann::json json = nlohmann::json::parse(data, nullptr, false);
+    if (!json.is_array())
+    {
+        return;
+    }
+
+    for (auto it = json.begin(); it != json.end(); it++)
+    {
+        if (!it->is_object())
+        {
+            continue;
+        }
+
+        lyric_cache_entry_t entry;
+        entry.key = _lyric_cache_string(*it, "key");
+        entry.file = _lyric_cache_string(*it, "file");
+        entry.size = _lyric_cache_number<uint64_t>(*it, "size", 0);
+        if (entry.key.empty() || entry.file.empty() || s_lyric_cache->index.count(entry.key) != 0 ||
+            s_lyric_cache->files.count(entry.file) != 0)
+        {
+            continue;
+        }
+
+        _lyric_cache_link(entry);
+    }
+}
+
+static void _lyric_cache_remove_file(const std::string &file)
+{
+    std::string path = _lyric_cache_path(file);
+    ev_fs_remove(nullptr, nullptr, path.c_str(), 0, nullptr);
+}
+
+/**
+ * @brief Forget least recently used entries until the cache fits in configured
+ * size. The most recent entry is always kept. Called with lock held.
+ * @param[out] victims  Entries forgotten, see #_lyric_cache_remove_victims().
+ */
+static void _lyric_cache_evict(LyricCacheEntryVec &victims)
+{
+    uint64_t max_size = (uint64_t)soundsphere::_config.lyric.cache_size_mb * 1024 * 1024;
+    while (s_lyric_cache->total_size > max_size && s_lyric_cache->lru.size() > 1)
+    {
+        victims.push_back(s_lyric_cache->lru.front());
+        _lyric_cache_unlink(s_lyric_cache->lru.begin());
+    }
+}
+
+/**
+ * @brief Remove files of evicted entries, unless stored again meanwhile.
+ * Called without any lock held, as it takes the file lock of each entry.
+ */
+static void _lyric_cache_remove_victims(const LyricCacheEntryVec &victims)
+{
+    for (size_t i = 0; i < victims.size(); i++)
+    {
+        ev_mutex_t *lock = _lyric_cache_file_lock(victims[i].key);
+        ev_mutex_enter(lock);
+
+        ev_mutex_enter(&s_lyric_cache->mutex);
+        bool kept = s_lyric_cache->files.count(victims[i].file) != 0;
+        ev_mutex_leave(&s_lyric_cache->mutex);
+
+        if (!kept)
+        {
+            _lyric_cache_remove_file(victims[i].file);
+        }
+        ev_mutex_leave(lock);
+    }
+}
+
+/**
+ * @brief Forget entry of \p key and remove \p file if the entry still names it.
+ * Called with the file lock of \p key held.
+ */
+static void _lyric_cache_drop(const std::string &key, const std::string &file)
+{
+    ev_mutex_enter(&s_lyric_cache->mutex);
+    LyricCacheIndex::iterator it = s_lyric_cache->index.find(key);
+    bool                      ours = it != s_lyric_cache->index.end() && it->second->file == file;
+    if (ours)
+    {
+        _lyric_cache_unlink(it->second);
+    }
+    ev_mutex_leave(&s_lyric_cache->mutex);
+
+    if (ours)
+    {
+        _lyric_cache_remove_file(file);
+    }
+}
+
+/**
+ * @brief Load entry of \p key. Called with the file lock of \p key held.
+ *
+ * An entry that is not an object of \p key is dropped. Within an entry, a
+ * `lyrics` that is not an object is reset, and a `candidates` that is not an
+ * array is removed, so both read as a miss.
+ *
+ * @return true if found.
+ */
+static bool _lyric_cache_load_entry(const std::string &key, nlohmann::json &json)
+{
+    std::string file;
+    ev_mutex_enter(&s_lyric_cache->mutex);
+    LyricCacheIndex::iterator it = s_lyric_cache->index.find(key);
+    if (it != s_lyric_cache->index.end())
+    {
+        /* Move to most recently used. */
+        file = it->second->file;
+        s_lyric_cache->lru.splice(s_lyric_cache->lru.end(), s_lyric_cache->lru, it->second);
+        s_lyric_cache->touched = true;
+    }
+    ev_mutex_leave(&s_lyric_cache->mutex);
+
+    std::string data;
+    if (file.empty())
+    {
+        return false;
+    }
+    if (!_lyric_cache_read(_lyric_cache_path(file), data))
+    {
+        _lyric_cache_drop(key, file);
+        return false;
+    }
+
+    json = nlohmann::json::parse(data, nullptr, false);
+    if (!json.is_object() || _lyric_cache_string(json, "key") != key)
+    {
+        _lyric_cache_drop(key, file);
+        return false;
+    }
+    if (!json["lyrics"].is_object())
+    {
+        json["lyrics"] = nlohmann::json::object();
+    }
+    if (json.contains("candidates") && !json["candidates"].is_array())
+    {
+        json.erase("candidates");
+    }
+
+    return true;
+}
+
+/**
+ * @brief Write entry of \p key, and link it as most recently used. Called
+ * with the file lock of \p key held.
+ * @param[out] victims  Entries evicted, see #_lyric_cache_remove_victims().
+ * @return true if index is due to be saved.
+ */
+static bool _lyric_cache_store_entry(const std::string &key, const nlohmann::json &json, LyricCacheEntryVec &victims)
+{
+    char file[32];
+    snprintf(file, sizeof(file), "%016llx.json", (unsigned long long)soundsphere::string_hash_djb2(key));
+
+    std::string data = json.dump();
+    std::string path = _lyric_cache_path(file);
+    soundsphere::dump(path.c_str(), data.c_str(), data.size());
+
+    std::string stale;
+    ev_mutex_enter(&s_lyric_cache->mutex);
+    {
+        /* An index from elsewhere may name the file differently, then the old file is dropped. */
+        LyricCacheIndex::iterator it = s_lyric_cache->index.find(key);
+        if (it != s_lyric_cache->index.end())
+        {
+            stale = it->second->file != file ? it->second->file : std::string();
+            _lyric_cache_unlink(it->second);
+        }
+
+        /* Another key with the same hash is overwritten. */
+        it = s_lyric_cache->files.find(file);
+        if (it != s_lyric_cache->files.end())
+        {
+            _lyric_cache_unlink(it->second);
+        }
+
+        lyric_cache_entry_t entry;
+        entry.key = key;
+        entry.file = file;
+        entry.size = data.size();
+        _lyric_cache_link(entry);
+        s_lyric_cache->dirty = true;
+
+        _lyric_cache_evict(victims);
+    }
+    bool save = (ev_hrtime() - s_lyric_cache->saved_at) / 1000000 >= LYRIC_CACHE_SAVE_INTERVAL_MS;
+    ev_mutex_leave(&s_lyric_cache->mutex);
+
+    if (!stale.empty())
+    {
+        _lyric_cache_remove_file(stale);
+    }
+    return save;
+}
+
+/**
+ * @brief Finish a store after the file lock is released. Entry files are
+ * written at once, the index only now and then.
+ */
+static void _lyric_cache_after_store(const LyricCacheEntryVec &victims, bool save)
+{
+    _lyric_cache_remove_victims(victims);
+    if (save)
+    {
+        _lyric_cache_save_index();
+    }
+}
+
+void soundsphere::lyric_cache_init(void)
+{
+    s_lyric_cache = new lyric_cache_ctx_t;
+    s_lyric_cache->dir = config_dir() + "/lyric_cache";
+    ev_fs_mkdir(nullptr, nullptr, s_lyric_cache->dir.c_str(), EV_FS_S_IRWXU, nullptr);
+
+    _lyric_cache_load_index();
+
+    LyricCacheEntryVec victims;
+    ev_mutex_enter(&s_lyric_cache->mutex);
+    _lyric_cache_evict(victims);
+    ev_mutex_leave(&s_lyric_cache->mutex);
+    _lyric_cache_remove_victims(victims);
+}
+
+void soundsphere::lyric_cache_exit(void)
+{
+    /* Access order is only saved here, reads alone do not rewrite the index. */
+    if (s_lyric_cache->dirty || s_lyric_cache->touched)
+    {
+        _lyric_cache_save_index();
+    }
+
+    delete s_lyric_cache;
+    s_lyric_cache = nullptr;
+}
+
+/**
+ * @brief Lower-case ASCII letters and drop ASCII spaces and punctuation.
+ * Non-ASCII bytes are kept as is.
+ */
+static std::string _lyric_cache_normalize(const std::string &str)
+{
+    std::string ret;
+    ret.reserve(str.size());
+    for (size_t i = 0; i < str.size(); i++)
+    {
+        unsigned char c = (unsigned char)str[i];
+        if (c >= 0x80 || isalnum(c))
+        {
+            ret.push_back((char)tolower(c));
+        }
+    }
+    return ret;
+}
+
+std::string soundsphere::lyric_cache_key(const std::string &artist, const std::string &title, double duration)
+{
+    return _lyric_cache_normalize(artist) + "|" + _lyric_cache_normalize(title) + "|" +
+           std::to_string((long long)std::llround(duration));
+}
+
+bool soundsphere::lyric_cache_get_candidates(const std::string &key, KugouCandidateVec &candidates)
+{
+    if (s_lyric_cache == nullptr)
+    {
+        return false;
+    }
+
+    bool        hit = false;
+    ev_mutex_t *lock = _lyric_cache_file_lock(key);
+    ev_mutex_enter(lock);
+    {
+        nlohmann::json json;
+        if (_lyric_cache_load_entry(key, json) && json.contains("candidates"))
+        {
+            nlohmann::json &items = json["candidates"];
+            candidates.clear();
+            for (auto it = items.begin(); it != items.end(); it++)
+            {
+                if (!it->is_object())
+                {
+                    continue;
+                }
+
+                kugou_candidate_t item;
+                item.id = _lyric_cache_string(*it, "id");
+                item.accesskey = _lyric_cache_string(*it, "accesskey");
+                item.artist = _lyric_cache_string(*it, "artist");
+                item.title = _lyric_cache_string(*it, "title");
+                item.duration = _lyric_cache_number<double>(*it, "duration", 0.0);
+                candidates.push_back(item);
+            }
+            hit = true;
+        }
+    }
+    ev_mutex_leave(lock);
+
+    return hit;
+}
+
+void soundsphere::lyric_cache_put_candidates(const std::string &key, const KugouCandidateVec &candidates)
+{
+    if (s_lyric_cache == nullptr)
+    {
+        return;
+    }
+
+    LyricCacheEntryVec victims;
+    bool               save = false;
+    ev_mutex_t        *lock = _lyric_cache_file_lock(key);
+    ev_mutex_enter(lock);
+    {
+        nlohmann::json json;
+        if (!_lyric_cache_load_entry(key, json))
+        {
+            json = { { "key", key }, { "lyrics", nlohmann::json::object() } };
+        }
+
+        nlohmann::json items = nlohmann::json::array();
+        for (auto it = candidates.begin(); it != candidates.end(); it++)
+        {
+            items.push_back({
+                { "id",        it->id        },
+                { "accesskey", it->accesskey },
+                { "artist",    it->artist    },
+                { "title",     it->title     },
+                { "duration",  it->duration  },
+            });
+        }
+        json["candidates"] = items;
+
+        save = _lyric_cache_store_entry(key, json, victims);
+    }
+    ev_mutex_leave(lock);
+
+    _lyric_cache_after_store(victims, save);
+}
+
+bool soundsphere::lyric_cache_get_lyric(const std::string &key, const std::string &id, std::string &lyric)
+{
+    if (s_lyric_cache == nullptr)
+    {
+        return false;
+    }
+
+    bool        hit = false;
+    ev_mutex_t *lock = _lyric_cache_file_lock(key);
+    ev_mutex_enter(lock);
+    {
+        nlohmann::json json;
+        if (_lyric_cache_load_entry(key, json))
+        {
+            const nlohmann::json &lyrics = json["lyrics"];
+            auto                  it = lyrics.find(id);
+            if (it != lyrics.end() && it->is_string())
+            {
+                lyric = it->get<std::string>();
+                hit = true;
+            }
+        }
+    }
+    ev_mutex_leave(lock);
+
+    return hit;
+}
+
+void soundsphere::lyric_cache_put_lyric(const std::string &key, const std::string &id, const std::string &lyric)
+{
+    if (s_lyric_cache == nullptr)
+    {
+        return;
+    }
+
+    LyricCacheEntryVec victims;
+    bool               save = false;
+    ev_mutex_t        *lock = _lyric_cache_file_lock(key);
+    ev_mutex_enter(lock);
+    {
+        nlohmann::json json;
+        if (!_lyric_cache_load_entry(key, json))
+        {
+            json = { { "key", key }, { "lyrics", nlohmann::json::object() } };
+        }
+
+        json["lyrics"][id] = lyric;
+        save = _lyric_cache_store_entry(key, json, victims);
+    }
+    ev_mutex_leave(lock);
+
+    _lyric_cache_after_store(victims, save);
+}
@@ -0,0 +1,73 @@
+#ifndef SOUND_SPHERE_UTILS_LYRIC_CACHE_HPP
+#define SOUND_SPHERE_UTILS_LYRIC_CACHE_HPP
+
+#include <string>
+#include "utils/kugou.hpp"
+
+namespace soundsphere
+{
+
+/**
+ * @brief Initialize lyric cache.
+ * The cache lives in `lyric_cache` under the configuration directory.
+ * @note Must be called after #config_init().
+ */
+void lyric_cache_init(void);
+
+/**
+ * @brief Save cache index and cleanup.
+ */
+void lyric_cache_exit(void);
+
+/**
+ * @brief Build cache key.
+ *
+ * Artist and title are lower-cased with ASCII spaces and punctuation removed,
+ * and duration is rounded to seconds, so small differences in tags still hit.
+ *
+ * @param[in] artist    Artist.
+ * @param[in] title     Title.
+ * @param[in] duration  Duration in seconds.
+ * @return Cache key.
+ */
+std::string lyric_cache_key(const std::string &artist, const std::string &title, double duration);
+
+/**
+ * @brief Get cached search result.
+ * @note Thread safe.
+ * @param[in] key           Cache key.
+ * @param[out] candidates   Search result.
+ * @return true if hit.
+ */
+bool lyric_cache_get_candidates(const std::string &key, KugouCandidateVec &candidates);
+
+/**
+ * @brief Store search result.
+ * @note Thread safe.
+ * @param[in] key           Cache key.
+ * @param[in] candidates    Search result.
+ */
+void lyric_cache_put_candidates(const std::string &key, const KugouCandidateVec &candidates);
+
+/**
+ * @brief Get cached LRC text.
+ * @note Thread safe.
+ * @param[in] key   Cache key.
+ * @param[in] id    Candidate ID.
+ * @param[out] lyric LRC text.
+ * @return true if hit.
+ */
+bool lyric_cache_get_lyric(const std::string &key, const std::string &id, std::string &lyric);
+
+/**
+ * @brief Store LRC text.
+ * @note Thread safe.
+ * @param[in] key   Cache key.
+ * @param[in] id    Candidate ID.
+ * @param[in] lyric LRC text.
+ */
+void lyric_cache_put_lyric(const std::string &key, const std::string &id, const std::string &lyric);
+
+} // namespace soundsphere
+
+#endif
@@ -0,0 +1,513 @@
+#include <ev.h>
+#include <curl/curl.h>
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <deque>
+#include <map>
+#include "utils/curl.hpp"
+#include "utils/kugou.hpp"
+#include "utils/lyric_cache.hpp"
+#include "utils/string.hpp"
+#include "utils/time.hpp"
+#include "utils/trace.hpp"
+#include "lyric_fetch.hpp"
+
+/**
+ * @brief Longest time the fetch thread sleeps in one wait, so stop request and
+ * delayed retries are handled in time even without network activity.
+ */
+#define LYRIC_FETCH_MAX_WAIT_MS 100
+
+typedef enum lyric_fetch_stage
+{
+    LYRIC_FETCH_STAGE_SEARCH,
+    LYRIC_FETCH_STAGE_DOWNLOAD,
+} lyric_fetch_stage_t;
+
+typedef struct lyric_fetch_task
+{
+    lyric_fetch_task();
+
+    soundsphere::lyric_fetch_item_t item;      /**< Track. */
+    std::string                     cache_key; /**< Lyric cache key. */
+    lyric_fetch_stage_t             stage;     /**< Current stage. */
+    soundsphere::kugou_candidate_t  candidate; /**< Selected candidate. Valid in download stage. */
+    int                             attempt;   /**< Retries of current request. */
+    bool                            network;   /**< Whether any request was sent. */
+    std::string                     body;      /**< Response body. */
+} lyric_fetch_task_t;
+
+typedef std::deque<lyric_fetch_task_t *>              LyricFetchTaskQueue;
+typedef std::multimap<uint64_t, lyric_fetch_task_t *> LyricFetchTaskTimer;
+
+struct soundsphere::LyricFetcherInternal
+{
+    LyricFetcherInternal(const LyricFetchItemVec &items, const lyric_fetch_opt_t &opt, LyricFetchCallback cb);
+    ~LyricFetcherInternal();
+
+    lyric_fetch_opt_t   opt;      /**< Options. */
+    LyricFetchCallback  cb;       /**< Result callback. */
+    CURLM              *multi;    /**< Multi handle. Connection pool lives here. */
+    std::vector<CURL *> idle;     /**< Easy handles ready for reuse. */
+    std::vector<CURL *> busy;     /**< Easy handles in flight. */
+    LyricFetchTaskQueue ready;    /**< Tasks waiting for a free slot. */
+    LyricFetchTaskTimer delayed;  /**< Tasks waiting for retry, keyed by due time in milliseconds. */
+    int                 inflight; /**< Requests in flight. */
+    double              tokens;   /**< Rate limit token bucket. */
+    uint64_t            token_ms; /**< Last time #LyricFetcherInternal::tokens was refilled. */
+    ev_os_thread_t      thread;   /**< Fetch thread. */
+
+    std::atomic<bool>   stop_flag;
+    std::atomic<bool>   finished;
+    std::atomic<size_t> total;
+    std::atomic<size_t> done;
+    std::atomic<size_t> failed;
+    std::atomic<size_t> cached;
+    std::atomic<size_t> requests;
+    std::atomic<size_t> retries;
+};
+
+soundsphere::lyric_fetch_item::lyric_fetch_item()
+{
+    path_hash = 0;
+    duration = 0;
+}
+
+soundsphere::lyric_fetch_result::lyric_fetch_result()
+{
+    path_hash = 0;
+    success = false;
+    cached = false;
+}
+
+soundsphere::lyric_fetch_opt::lyric_fetch_opt()
+{
+    max_concurrency = 8;
+    max_host_connections = 4;
+    rate_limit = 10;
+    max_retries = 3;
+    backoff_ms = 500;
+    timeout_ms = 15 * 1000;
+}
+
+lyric_fetch_task::lyric_fetch_task()
+{
+    stage = LYRIC_FETCH_STAGE_SEARCH;
+    attempt = 0;
+    network = false;
+}
+
+soundsphere::LyricFetcherInternal::LyricFetcherInternal(const LyricFetchItemVec &items, const lyric_fetch_opt_t &opt,
+                                                        LyricFetchCallback cb)
+    : opt(opt), cb(cb), stop_flag(false), finished(false), total(items.size()), done(0), failed(0), cached(0),
+      requests(0), retries(0)
+{
+    multi = curl_multi_init();
+    curl_multi_setopt(multi, CURLMOPT_MAX_HOST_CONNECTIONS, (long)opt.max_host_connections);
+    curl_multi_setopt(multi, CURLMOPT_MAX_TOTAL_CONNECTIONS, (long)opt.max_concurrency);
+    curl_multi_setopt(multi, CURLMOPT_MAXCONNECTS, (long)opt.max_concurrency);
+    curl_multi_setopt(multi, CURLMOPT_PIPELINING, (long)CURLPIPE_MULTIPLEX);
+
+    for (auto it = items.begin(); it != items.end(); it++)
+    {
+        lyric_fetch_task_t *task = new lyric_fetch_task_t;
+        task->item = *it;
+        task->cache_key = lyric_cache_key(it->artist, it->title, it->duration);
+        ready.push_back(task);
+    }
+
+    inflight = 0;
+    tokens = 1;
+    token_ms = clock_time_ms();
+    thread = EV_OS_THREAD_INVALID;
+}
+
+soundsphere::LyricFetcherInternal::~LyricFetcherInternal()
+{
+    for (auto it = ready.begin(); it != ready.end(); it++)
+    {
+        delete *it;
+    }
+    for (auto it = delayed.begin(); it != delayed.end(); it++)
+    {
+        delete it->second;
+    }
+    for (auto it = idle.begin(); it != idle.end(); it++)
+    {
+        curl_easy_cleanup(*it);
+    }
+    curl_multi_cleanup(multi);
+}
+
+static size_t _lyric_fetch_on_write(char *ptr, size_t size, size_t nmemb, void *userdata)
+{
+    lyric_fetch_task_t *task = static_cast<lyric_fetch_task_t *>(userdata);
+    size_t              total_sz = size * nmemb;
+    task->body.append(ptr, total_sz);
+    return total_sz;
+}
+
+static void _lyric_fetch_finish(soundsphere::LyricFetcherInternal *iner, lyric_fetch_task_t *task, bool success,
+                                const std::string &lyric, const std::string &errinfo)
+{
+    soundsphere::LyricFetchResultPtr result = std::make_shared<soundsphere::lyric_fetch_result_t>();
+    result->path_hash = task->item.path_hash;
+    result->success = success;
+    result->cached = success && !task->network;
+    result->lyric = lyric;
+    result->errinfo = errinfo;
+    delete task;
+
+    iner->failed += success ? 0 : 1;
+    iner->cached += result->cached ? 1 : 0;
+    iner->done++;
+
+    iner->cb(result);
+}
+
+/**
+ * @brief Pick the candidate with the closest duration.
+ * @return true if found.
+ */
+static bool _lyric_fetch_select(lyric_fetch_task_t *task, const soundsphere::KugouCandidateVec &candidates)
+{
+    const soundsphere::kugou_candidate_t *best = nullptr;
+    double                                best_diff = 0;
+    for (auto it = candidates.begin(); it != candidates.end(); it++)
+    {
+        if (it->id.empty())
+        {
+            continue;
+        }
+
+        double diff = task->item.duration > 0 ? fabs(it->duration - task->item.duration) : 0;
+        if (best == nullptr || diff < best_diff)
+        {
+            best = &*it;
+            best_diff = diff;
+        }
+    }
+
+    if (best == nullptr)
+    {
+        return false;
+    }
+
+    task->candidate = *best;
+    task->stage = LYRIC_FETCH_STAGE_DOWNLOAD;
+    task->attempt = 0;
+    return true;
+}
+
+/**
+ * @brief Try to finish current stage of \p task from lyric cache.
+ * @return true if the task is finished and deleted.
+ */
+static bool _lyric_fetch_try_cache(soundsphere::LyricFetcherInternal *iner, lyric_fetch_task_t *task)
+{
+    if (task->stage == LYRIC_FETCH_STAGE_SEARCH)
+    {
+        soundsphere::KugouCandidateVec candidates;
+        if (!soundsphere::lyric_cache_get_candidates(task->cache_key, candidates))
+        {
+            return false;
+        }
+        if (!_lyric_fetch_select(task, candidates))
+        {
+            _lyric_fetch_finish(iner, task, false, std::string(), "no lyric");
+            return true;
+        }
+    }
+
+    std::string lyric;
+    if (!soundsphere::lyric_cache_get_lyric(task->cache_key, task->candidate.id, lyric))
+    {
+        return false;
+    }
+
+    _lyric_fetch_finish(iner, task, true, lyric, std::string());
+    return true;
+}
+
+/**
+ * @brief Take one token from rate limiter.
+ */
+static bool _lyric_fetch_take_token(soundsphere::LyricFetcherInternal *iner, uint64_t now)
+{
+    if (iner->opt.rate_limit <= 0)
+    {
+        return true;
+    }
+
+    double burst = iner->opt.rate_limit > 1 ? iner->opt.rate_limit : 1;
+    iner->tokens += (double)(now - iner->token_ms) * iner->opt.rate_limit / 1000.0;
+    iner->tokens = iner->tokens > burst ? burst : iner->tokens;
+    iner->token_ms = now;
+
+    if (iner->tokens < 1)
+    {
+        return false;
+    }
+    iner->tokens -= 1;
+    return true;
+}
+
+static void _lyric_fetch_send(soundsphere::LyricFetcherInternal *iner, lyric_fetch_task_t *task)
+{
+    CURL *easy = nullptr;
+    if (!iner->idle.empty())
+    {
+        easy = iner->idle.back();
+        iner->idle.pop_back();
+        /* Reset keeps live connections and caches. */
+        curl_easy_reset(easy);
+    }
+    else
+    {
+        easy = curl_easy_init();
+    }
+
+    std::string url = task->stage == LYRIC_FETCH_STAGE_SEARCH
+                          ? soundsphere::kugou_search_url(task->item.artist, task->item.title)
+                          : soundsphere::kugou_download_url(task->candidate);
+
+    task->body.clear();
+    task->network = true;
+
+    soundsphere::http_setup(easy);
+    curl_easy_setopt(easy, CURLOPT_URL, url.c_str());
+    curl_easy_setopt(easy, CURLOPT_WRITEFUNCTION, _lyric_fetch_on_write);
+    curl_easy_setopt(easy, CURLOPT_WRITEDATA, task);
+    curl_easy_setopt(easy, CURLOPT_PRIVATE, task);
+    curl_easy_setopt(easy, CURLOPT_TIMEOUT_MS, (long)iner->opt.timeout_ms);
+
+    curl_multi_add_handle(iner->multi, easy);
+    iner->busy.push_back(easy);
+    iner->inflight++;
+    iner->requests++;
+}
+
+/**
+ * @brief Start as many tasks as limits allow.
+ */
+static void _lyric_fetch_launch(soundsphere::LyricFetcherInternal *iner, uint64_t now)
+{
+    while (!iner->delayed.empty() && iner->delayed.begin()->first <= now)
+    {
+        iner->ready.push_back(iner->delayed.begin()->second);
+        iner->delayed.erase(iner->delayed.begin());
+    }
+
+    while (!iner->ready.empty() && iner->inflight < iner->opt.max_concurrency)
+    {
+        lyric_fetch_task_t *task = iner->ready.front();
+        if (task->attempt == 0 && _lyric_fetch_try_cache(iner, task))
+        {
+            iner->ready.pop_front();
+            continue;
+        }
+        if (!_lyric_fetch_take_token(iner, now))
+        {
+            return;
+        }
+
+        iner->ready.pop_front();
+        _lyric_fetch_send(iner, task);
+    }
+}
+
+static void _lyric_fetch_retry_or_fail(soundsphere::LyricFetcherInternal *iner, lyric_fetch_task_t *task,
+                                       const std::string &errinfo)
+{
+    if (task->attempt >= iner->opt.max_retries)
+    {
+        _lyric_fetch_finish(iner, task, false, std::string(), errinfo);
+        return;
+    }
+
+    uint64_t delay = iner->opt.backoff_ms << task->attempt;
+    task->attempt++;
+    iner->retries++;
+    iner->delayed.insert(std::make_pair(soundsphere::clock_time_ms() + delay, task));
+}
+
+static void _lyric_fetch_on_response(soundsphere::LyricFetcherInternal *iner, lyric_fetch_task_t *task,
+                                     CURLcode code, long status)
+{
+    if (code != CURLE_OK)
+    {
+        _lyric_fetch_retry_or_fail(iner, task, curl_easy_strerror(code));
+        return;
+    }
+    if (status == 429 || status >= 500)
+    {
+        _lyric_fetch_retry_or_fail(iner, task, soundsphere::string_format("HTTP %ld", status));
+        return;
+    }
+    if (status != 200)
+    {
+        _lyric_fetch_finish(iner, task, false, std::string(), soundsphere::string_format("HTTP %ld", status));
+        return;
+    }
+
+    std::string errinfo;
+    if (task->stage == LYRIC_FETCH_STAGE_SEARCH)
+    {
+        soundsphere::KugouCandidateVec candidates;
+        if (soundsphere::kugou_parse_search(task->body, candidates, errinfo) != 0)
+        {
+            _lyric_fetch_finish(iner, task, false, std::string(), errinfo);
+            return;
+        }
+        soundsphere::lyric_cache_put_candidates(task->cache_key, candidates);
+
+        if (!_lyric_fetch_select(task, candidates))
+        {
+            _lyric_fetch_finish(iner, task, false, std::string(), "no lyric");
+            return;
+        }
+
+        /* Download before starting new tracks, so results come out steadily. */
+        iner->ready.push_front(task);
+        return;
+    }
+
+    std::string lyric;
+    if (soundsphere::kugou_parse_download(task->body, lyric, errinfo) != 0)
+    {
+        _lyric_fetch_finish(iner, task, false, std::string(), errinfo);
+        return;
+    }
+    soundsphere::lyric_cache_put_lyric(task->cache_key, task->candidate.id, lyric);
+    _lyric_fetch_finish(iner, task, true, lyric, std::string());
+}
+
+static void _lyric_fetch_collect(soundsphere::LyricFetcherInternal *iner)
+{
+    CURLMsg *msg;
+    int      msg_left = 0;
+    while ((msg = curl_multi_info_read(iner->multi, &msg_left)) != nullptr)
+    {
+        if (msg->msg != CURLMSG_DONE)
+        {
+            continue;
+        }
+
+        CURL               *easy = msg->easy_handle;
+        CURLcode            code = msg->data.result;
+        lyric_fetch_task_t *task = nullptr;
+        long                status = 0;
+        curl_easy_getinfo(easy, CURLINFO_PRIVATE, (char **)&task);
+        curl_easy_getinfo(easy, CURLINFO_RESPONSE_CODE, &status);
+
+        curl_multi_remove_handle(iner->multi, easy);
+        iner->busy.erase(std::find(iner->busy.begin(), iner->busy.end(), easy));
+        iner->idle.push_back(easy);
+        iner->inflight--;
+
+        _lyric_fetch_on_response(iner, task, code, status);
+    }
+}
+
+/**
+ * @brief How long to wait for network activity.
+ */
+static int _lyric_fetch_wait_ms(soundsphere::LyricFetcherInternal *iner, uint64_t now)
+{
+    uint64_t wait = LYRIC_FETCH_MAX_WAIT_MS;
+    if (!iner->delayed.empty())
+    {
+        uint64_t due = iner->delayed.begin()->first;
+        wait = due > now ? std::min(wait, due - now) : 0;
+    }
+    if (!iner->ready.empty() && iner->inflight < iner->opt.max_concurrency && iner->opt.rate_limit > 0)
+    {
+        uint64_t token_wait = (uint64_t)ceil((1 - iner->tokens) * 1000.0 / iner->opt.rate_limit);
+        wait = std::min(wait, token_wait);
+    }
+    return (int)wait;
+}
+
+static void _lyric_fetch_thread(void *arg)
+{
+    soundsphere::LyricFetcherInternal *iner = static_cast<soundsphere::LyricFetcherInternal *>(arg);
+    TRACE_THREAD_NAME("lyric_fetch");
+
+    while (!iner->stop_flag)
+    {
+        uint64_t now = soundsphere::clock_time_ms();
+        _lyric_fetch_launch(iner, now);
+        if (iner->inflight == 0 && iner->ready.empty() && iner->delayed.empty())
+        {
+            break;
+        }
+
+        int running = 0;
+        curl_multi_perform(iner->multi, &running);
+        _lyric_fetch_collect(iner);
+
+        if (iner->inflight != 0 || !iner->delayed.empty() || !iner->ready.empty())
+        {
+            curl_multi_poll(iner->multi, nullptr, 0, _lyric_fetch_wait_ms(iner, now), nullptr);
+        }
+    }
+
+    /* Drop requests in flight. */
+    for (auto it = iner->busy.begin(); it != iner->busy.end(); it++)
+    {
+        lyric_fetch_task_t *task = nullptr;
+        curl_easy_getinfo(*it, CURLINFO_PRIVATE, (char **)&task);
+        curl_multi_remove_handle(iner->multi, *it);
+        iner->idle.push_back(*it);
+        delete task;
+    }
+    iner->busy.clear();
+    iner->inflight = 0;
+
+    iner->finished = true;
+}
+
+soundsphere::LyricFetcher::LyricFetcher(const LyricFetchItemVec &items, const lyric_fetch_opt_t &opt,
+                                        LyricFetchCallback cb)
+{
+    m_iner = new LyricFetcherInternal(items, opt, cb);
+    if (ev_thread_init(&m_iner->thread, nullptr, _lyric_fetch_thread, m_iner) != 0)
+    {
+        m_iner->thread = EV_OS_THREAD_INVALID;
+        m_iner->finished = true;
+    }
+}
+
+soundsphere::LyricFetcher::~LyricFetcher()
+{
+    stop();
+    if (m_iner->thread != EV_OS_THREAD_INVALID)
+    {
+        ev_thread_exit(&m_iner->thread, EV_INFINITE_TIMEOUT);
+    }
+    delete m_iner;
+}
+
+void soundsphere::LyricFetcher::stop()
+{
+    m_iner->stop_flag = true;
+    curl_multi_wakeup(m_iner->multi);
+}
+
+bool soundsphere::LyricFetcher::finished()
+{
+    return m_iner->finished;
+}
+
+soundsphere::lyric_fetch_progress_t soundsphere::LyricFetcher::progress()
+{
+    lyric_fetch_progress_t progress;
+    progress.total = m_iner->total;
+    progress.finished = m_iner->done;
+    progress.failed = m_iner->failed;
+    progress.cached = m_iner->cached;
+    progress.requests = m_iner->requests;
+    progress.retries = m_iner->retries;
+    return progress;
+}
@@ -0,0 +1,126 @@
+#ifndef SOUND_SPHERE_UTILS_LYRIC_FETCH_HPP
+#define SOUND_SPHERE_UTILS_LYRIC_FETCH_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace soundsphere
+{
+
+/**
+ * @brief A track to fetch lyric for.
+ */
+typedef struct lyric_fetch_item
+{
+    lyric_fetch_item();
+
+    uint64_t    path_hash; /**< Track ID, passed back in result. */
+    std::string artist;    /**< Artist. */
+    std::string title;     /**< Title. */
+    double      duration;  /**< Duration in seconds, used to pick the best candidate. */
+} lyric_fetch_item_t;
+
+typedef std::vector<lyric_fetch_item_t> LyricFetchItemVec;
+
+/**
+ * @brief Result of one track.
+ */
+typedef struct lyric_fetch_result
+{
+    lyric_fetch_result();
+
+    uint64_t    path_hash; /**< Track ID. */
+    bool        success;   /**< Whether lyric is found. */
+    bool        cached;    /**< Served from lyric cache without network. */
+    std::string lyric;     /**< LRC text. */
+    std::string errinfo;   /**< Error information if failed. */
+} lyric_fetch_result_t;
+
+typedef std::shared_ptr<lyric_fetch_result_t> LyricFetchResultPtr;
+
+/**
+ * @brief Result callback. Called on fetch thread as soon as a track finishes.
+ */
+typedef std::function<void(LyricFetchResultPtr)> LyricFetchCallback;
+
+typedef struct lyric_fetch_opt
+{
+    lyric_fetch_opt();
+
+    int      max_concurrency;      /**< Maximum requests in flight. */
+    int      max_host_connections; /**< Maximum connections to one host. */
+    double   rate_limit;           /**< Maximum new requests per second. 0 for no limit. */
+    int      max_retries;          /**< Retries of a failed request. */
+    uint64_t backoff_ms;           /**< Delay before first retry, doubled for each following one. */
+    uint64_t timeout_ms;           /**< Timeout of one request. */
+} lyric_fetch_opt_t;
+
+typedef struct lyric_fetch_progress
+{
+    size_t total;    /**< Number of tracks. */
+    size_t finished; /**< Tracks done, including failed ones. */
+    size_t failed;   /**< Tracks without lyric. */
+    size_t cached;   /**< Tracks served from lyric cache. */
+    size_t requests; /**< HTTP requests sent, including retries. */
+    size_t retries;  /**< Retried HTTP requests. */
+} lyric_fetch_progress_t;
+
+struct LyricFetcherInternal;
+
+/**
+ * @brief Fetch lyrics of many tracks concurrently.
+ *
+ * All requests run on one background thread through `curl_multi`, so connections
+ * to the lyric server are kept alive and reused. For each track the search result
+ * and lyric are looked up in lyric cache first, and network results are written
+ * back to the cache.
+ */
+class LyricFetcher
+{
+public:
+    typedef std::shared_ptr<LyricFetcher> Ptr;
+
+public:
+    /**
+     * @brief Start fetching.
+     * @param[in] items Tracks.
+     * @param[in] opt   Options.
+     * @param[in] cb    Result callback.
+     */
+    LyricFetcher(const LyricFetchItemVec &items, const lyric_fetch_opt_t &opt, LyricFetchCallback cb);
+
+    /**
+     * @brief Stop and wait for fetch thread.
+     */
+    virtual ~LyricFetcher();
+
+public:
+    /**
+     * @brief Ask fetch thread to stop. Tracks not finished yet are dropped.
+     */
+    void stop();
+
+    /**
+     * @brief Whether all tracks are finished or fetch is stopped.
+     */
+    bool finished();
+
+    /**
+     * @brief Get progress.
+     */
+    lyric_fetch_progress_t progress();
+
+public:
+    LyricFetcher(const LyricFetcher &orig) = delete;
+
+public:
+    struct LyricFetcherInternal *m_iner;
+};
+
+} // namespace soundsphere
+
+#endif
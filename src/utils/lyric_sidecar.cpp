@@ -0,0 +1,168 @@
+#include <ev.h>
+#include <cstring>
+#include <unordered_map>
+#include "utils/path.hpp"
+#include "utils/string.hpp"
+#include "lyric_sidecar.hpp"
+
+/**
+ * @brief Sidecar lyrics of one directory, from file stem to lyric file path.
+ */
+typedef std::unordered_map<std::string, std::string> LyricSidecarDir;
+
+typedef std::unordered_map<std::string, LyricSidecarDir> LyricSidecarIndex;
+
+typedef struct lyric_sidecar_ctx
+{
+    lyric_sidecar_ctx();
+    ~lyric_sidecar_ctx();
+
+    ev_mutex_t        mutex; /**< Protects #lyric_sidecar_ctx::index. */
+    LyricSidecarIndex index; /**< Indexed directories, including those without lyric. */
+} lyric_sidecar_ctx_t;
+
+static lyric_sidecar_ctx_t *s_lyric_sidecar = nullptr;
+
+lyric_sidecar_ctx::lyric_sidecar_ctx()
+{
+    ev_mutex_init(&mutex, 0);
+}
+
+lyric_sidecar_ctx::~lyric_sidecar_ctx()
+{
+    ev_mutex_exit(&mutex);
+}
+
+void soundsphere::lyric_sidecar_init(void)
+{
+    s_lyric_sidecar = new lyric_sidecar_ctx_t;
+}
+
+void soundsphere::lyric_sidecar_exit(void)
+{
+    delete s_lyric_sidecar;
+    s_lyric_sidecar = nullptr;
+}
+
+/**
+ * @brief Check for `.lrc` extension, case insensitive.
+ */
+static bool _lyric_sidecar_is_lrc(const std::string &name)
+{
+    static const char *ext = ".lrc";
+    const size_t       ext_len = 4;
+    if (name.size() <= ext_len)
+    {
+        return false;
+    }
+
+    const char *p = name.c_str() + name.size() - ext_len;
+    for (size_t i = 0; i < ext_len; i++)
+    {
+        char c = p[i];
+        if (c >= 'A' && c <= 'Z')
+        {
+            c = c - 'A' + 'a';
+        }
+        if (c != ext[i])
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+void soundsphere::lyric_sidecar_index(const std::string &dir, const FileItemVec &items)
+{
+    if (s_lyric_sidecar == nullptr)
+    {
+        return;
+    }
+
+    LyricSidecarDir lyrics;
+    for (auto it = items.begin(); it != items.end(); it++)
+    {
+        if (it->isfile && _lyric_sidecar_is_lrc(it->name))
+        {
+            lyrics[basename(it->name, false)] = it->path;
+        }
+    }
+
+    ev_mutex_enter(&s_lyric_sidecar->mutex);
+    s_lyric_sidecar->index[dir].swap(lyrics);
+    ev_mutex_leave(&s_lyric_sidecar->mutex);
+}
+
+/**
+ * @brief Lookup in index.
+ * @return true if directory of \p path is indexed.
+ */
+static bool _lyric_sidecar_lookup(const std::string &path, std::string &lyric_path)
+{
+    std::string dir = soundsphere::dirname(path);
+    std::string stem = soundsphere::basename(path, false);
+    bool        indexed = false;
+
+    ev_mutex_enter(&s_lyric_sidecar->mutex);
+    LyricSidecarIndex::iterator dir_it = s_lyric_sidecar->index.find(dir);
+    if (dir_it != s_lyric_sidecar->index.end())
+    {
+        indexed = true;
+        LyricSidecarDir::iterator it = dir_it->second.find(stem);
+        if (it != dir_it->second.end())
+        {
+            lyric_path = it->second;
+        }
+    }
+    ev_mutex_leave(&s_lyric_sidecar->mutex);
+
+    return indexed;
+}
+
+std::string soundsphere::lyric_sidecar_lookup(const std::string &path)
+{
+    std::string lyric_path;
+    if (s_lyric_sidecar != nullptr)
+    {
+        _lyric_sidecar_lookup(path, lyric_path);
+    }
+    return lyric_path;
+}
+
+std::string soundsphere::lyric_sidecar_find(const std::string &path)
+{
+    std::string lyric_path;
+    if (s_lyric_sidecar == nullptr || _lyric_sidecar_lookup(path, lyric_path))
+    {
+        return lyric_path;
+    }
+
+    std::string dir = dirname(path);
+    lyric_sidecar_index(dir, explorer_folder_items(dir));
+    _lyric_sidecar_lookup(path, lyric_path);
+
+    return lyric_path;
+}
+
+bool soundsphere::lyric_sidecar_read(const std::string &path, std::string &lyric)
+{
+    ev_fs_req_t req;
+    ssize_t     ret = ev_fs_readfile(nullptr, &req, path.c_str(), nullptr);
+    if (ret < 0)
+    {
+        return false;
+    }
+
+    const ev_buf_t *buf = ev_fs_get_filecontent(&req);
+    const char     *data = (const char *)buf->data;
+    size_t          size = buf->size;
+    if (size >= 3 && memcmp(data, "\xEF\xBB\xBF", 3) == 0)
+    {
+        data += 3;
+        size -= 3;
+    }
+    lyric.assign(data, size);
+    ev_fs_req_cleanup(&req);
+
+    return true;
+}
@@ -0,0 +1,63 @@
+#ifndef SOUND_SPHERE_UTILS_LYRIC_SIDECAR_HPP
+#define SOUND_SPHERE_UTILS_LYRIC_SIDECAR_HPP
+
+#include <string>
+#include "utils/explorer.hpp"
+
+namespace soundsphere
+{
+
+/**
+ * @brief Initialize sidecar lyric index.
+ *
+ * A sidecar lyric is a `.lrc` file next to the audio file with the same name, like
+ * `song.lrc` for `song.flac`. The index remembers them per directory, filled from
+ * directory listings that are already done by folder scan, so no file is probed
+ * for each track.
+ */
+void lyric_sidecar_init(void);
+
+/**
+ * @brief Cleanup sidecar lyric index.
+ */
+void lyric_sidecar_exit(void);
+
+/**
+ * @brief Record sidecar lyrics in a directory listing.
+ * @note Thread safe.
+ * @param[in] dir   Directory path.
+ * @param[in] items All items in \p dir, as returned by #explorer_folder_items().
+ */
+void lyric_sidecar_index(const std::string &dir, const FileItemVec &items);
+
+/**
+ * @brief Lookup sidecar lyric of \p path in index only.
+ * @note Thread safe. It never touches filesystem.
+ * @param[in] path  Audio file path.
+ * @return Sidecar lyric path, or empty if not found or directory not indexed.
+ */
+std::string lyric_sidecar_lookup(const std::string &path);
+
+/**
+ * @brief Find sidecar lyric of \p path.
+ *
+ * If the directory of \p path is not indexed yet, it is listed once and indexed.
+ *
+ * @note Thread safe. May block on directory listing.
+ * @param[in] path  Audio file path.
+ * @return Sidecar lyric path, or empty if not found.
+ */
+std::string lyric_sidecar_find(const std::string &path);
+
+/**
+ * @brief Read sidecar lyric file.
+ * @note Blocking call.
+ * @param[in] path      Sidecar lyric path.
+ * @param[out] lyric    LRC text, with UTF-8 BOM removed.
+ * @return true if success.
+ */
+bool lyric_sidecar_read(const std::string &path, std::string &lyric);
+
+} // namespace soundsphere
+
+#endif
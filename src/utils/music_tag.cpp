@@ -10,6 +10,7 @@
 #include <taglib/unsynchronizedlyricsframe.h>
 #include <taglib/xiphcomment.h>
 #include "utils/defines.hpp"
+#include "utils/lyric_sidecar.hpp"
 #include "utils/path.hpp"
 #include "utils/string.hpp"
 #include "music_tag.hpp"
@@ -87,6 +88,7 @@ template <typename T> static void _tag_reader_get_properties_common(T *file, sou
 {
     tags.info.title = file->tag()->title().to8Bit(true);
     tags.info.artist = file->tag()->artist().to8Bit(true);
+    tags.info.album = file->tag()->album().to8Bit(true);
     tags.info.bitrate = file->audioProperties()->bitrate();
     tags.info.samplerate = file->audioProperties()->sampleRate();
     tags.info.channel = file->audioProperties()->channels();
@@ -384,6 +386,7 @@ finish_fill_title_if_empty:
         tags.info.title = soundsphere::basename(tags.path, false);
     }
     tags.path_hash = soundsphere::string_hash_djb2(tags.path);
+    tags.lyric_path = soundsphere::lyric_sidecar_lookup(tags.path);
     return tags.valid;
 }
 
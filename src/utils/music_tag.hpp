@@ -70,6 +70,11 @@ typedef struct music_tags_info
      */
     std::string artist;
 
+    /**
+     * @brief Album in UTF-8 encoding.
+     */
+    std::string album;
+
     /**
      * @brief Lyric in UTF-8 encoding.
      */
@@ -109,6 +114,11 @@ typedef struct music_tags
      * @brief Music tags if #valid is true.
      */
     music_tags_info_t info;
+
+    /**
+     * @brief Sidecar lyric file known from folder scan. Empty if unknown.
+     */
+    std::string lyric_path;
 } music_tags_t;
 
 /**
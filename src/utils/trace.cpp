@@ -0,0 +1,338 @@
+#include <ev.h>
+#include <atomic>
+#include <mutex>
+#include <vector>
+#include "string.hpp"
+#include "trace.hpp"
+
+#if defined(SOUNDSPHERE_TRACE)
+
+/**
+ * @brief Number of events each thread can keep. Must be power of 2.
+ */
+#define TRACE_RING_SIZE 16384
+
+/**
+ * @brief Rings of exited threads are only recycled after this many rings exist,
+ * so short-lived import threads still show up in the dump.
+ */
+#define TRACE_RING_RECYCLE_THRESHOLD 64
+
+/**
+ * @brief Event record.
+ * Fields are atomic so that the dumper can read them while the owner thread is
+ * writing. All access is relaxed, ordering is provided by trace_ring::head.
+ */
+typedef struct trace_event
+{
+    std::atomic<const char *> name;
+    std::atomic<uint64_t>     begin; /**< Begin time in nanoseconds. */
+    std::atomic<uint64_t>     end;   /**< End time in nanoseconds. 0 for instant event. */
+} trace_event_t;
+
+/**
+ * @brief Single-producer ring buffer.
+ * Only the owner thread writes, #trace_dump() reads without stopping it.
+ */
+typedef struct trace_ring
+{
+    trace_ring();
+
+    uint64_t                  tid;     /**< Owner thread ID. */
+    std::atomic<const char *> name;    /**< Owner thread name. */
+    std::atomic<uint64_t>     head;    /**< Total number of events ever written. */
+    std::atomic<bool>         retired; /**< Owner thread is gone. */
+    trace_event_t             events[TRACE_RING_SIZE];
+} trace_ring_t;
+
+typedef struct trace_ctx
+{
+    std::mutex                 mutex; /**< Protects #rings. Never taken on record path. */
+    std::vector<trace_ring_t *> rings;
+} trace_ctx_t;
+
+/**
+ * @brief Mark the ring as retired when its owner thread exits.
+ */
+typedef struct trace_ring_holder
+{
+    trace_ring_holder();
+    ~trace_ring_holder();
+
+    trace_ring_t *ring;
+} trace_ring_holder_t;
+
+static thread_local trace_ring_holder_t s_trace_holder;
+
+trace_ring::trace_ring()
+{
+    tid = 0;
+    name = nullptr;
+    head = 0;
+    retired = false;
+}
+
+trace_ring_holder::trace_ring_holder()
+{
+    ring = nullptr;
+}
+
+trace_ring_holder::~trace_ring_holder()
+{
+    if (ring != nullptr)
+    {
+        ring->retired.store(true, std::memory_order_release);
+    }
+}
+
+/**
+ * @brief The registry must outlive every thread_local holder, so it is never freed.
+ */
+static trace_ctx_t *_trace_ctx(void)
+{
+    static trace_ctx_t *ctx = new trace_ctx_t;
+    return ctx;
+}
+
+static trace_ring_t *_trace_register_ring(void)
+{
+    trace_ctx_t                 *ctx = _trace_ctx();
+    std::unique_lock<std::mutex> lock(ctx->mutex);
+
+    trace_ring_t *ring = nullptr;
+    if (ctx->rings.size() >= TRACE_RING_RECYCLE_THRESHOLD)
+    {
+        for (size_t i = 0; i < ctx->rings.size(); i++)
+        {
+            if (ctx->rings[i]->retired.load(std::memory_order_acquire))
+            {
+                ring = ctx->rings[i];
+                break;
+            }
+        }
+    }
+
+    if (ring == nullptr)
+    {
+        ring = new trace_ring_t;
+        ctx->rings.push_back(ring);
+    }
+
+    ring->tid = (uint64_t)ev_thread_id();
+    ring->name.store(nullptr, std::memory_order_relaxed);
+    ring->head.store(0, std::memory_order_relaxed);
+    ring->retired.store(false, std::memory_order_release);
+
+    return ring;
+}
+
+static trace_ring_t *_trace_ring(void)
+{
+    if (s_trace_holder.ring == nullptr)
+    {
+        s_trace_holder.ring = _trace_register_ring();
+    }
+    return s_trace_holder.ring;
+}
+
+static void _trace_record(const char *name, uint64_t begin, uint64_t end)
+{
+    trace_ring_t  *ring = _trace_ring();
+    uint64_t       pos = ring->head.load(std::memory_order_relaxed);
+    trace_event_t *evt = &ring->events[pos & (TRACE_RING_SIZE - 1)];
+
+    evt->name.store(name, std::memory_order_relaxed);
+    evt->begin.store(begin, std::memory_order_relaxed);
+    evt->end.store(end, std::memory_order_relaxed);
+    ring->head.store(pos + 1, std::memory_order_release);
+}
+
+static void _trace_append_escaped(std::string &dst, const char *str)
+{
+    for (; *str != '\0'; str++)
+    {
+        char c = *str;
+        if (c == '"' || c == '\\')
+        {
+            dst.push_back('\\');
+            dst.push_back(c);
+        }
+        else if ((unsigned char)c < 0x20)
+        {
+            dst += soundsphere::string_format("\\u%04x", (unsigned)c);
+        }
+        else
+        {
+            dst.push_back(c);
+        }
+    }
+}
+
+/**
+ * @brief Serialize one ring.
+ * @return Number of events written.
+ */
+static int _trace_dump_ring(std::string &json, trace_ring_t *ring)
+{
+    const uint64_t tid = ring->tid;
+    const char    *thread_name = ring->name.load(std::memory_order_relaxed);
+
+    json += soundsphere::string_format(",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%llu,"
+                                       "\"args\":{\"name\":\"",
+                                       (unsigned long long)tid);
+    if (thread_name != nullptr)
+    {
+        _trace_append_escaped(json, thread_name);
+    }
+    else
+    {
+        json += soundsphere::string_format("thread %llu", (unsigned long long)tid);
+    }
+    json += "\"}}";
+
+    uint64_t head = ring->head.load(std::memory_order_acquire);
+    uint64_t tail = head > TRACE_RING_SIZE ? head - TRACE_RING_SIZE : 0;
+
+    int cnt = 0;
+    for (uint64_t i = tail; i < head; i++)
+    {
+        const trace_event_t *evt = &ring->events[i & (TRACE_RING_SIZE - 1)];
+        const char          *name = evt->name.load(std::memory_order_relaxed);
+        uint64_t             begin = evt->begin.load(std::memory_order_relaxed);
+        uint64_t             end = evt->end.load(std::memory_order_relaxed);
+
+        /* The owner may have lapped us while reading, drop overwritten slots. */
+        uint64_t now_head = ring->head.load(std::memory_order_acquire);
+        if (now_head > TRACE_RING_SIZE && i < now_head - TRACE_RING_SIZE)
+        {
+            continue;
+        }
+
+        json += ",\n{\"name\":\"";
+        _trace_append_escaped(json, name);
+        if (end == 0)
+        {
+            json += soundsphere::string_format("\",\"ph\":\"i\",\"s\":\"t\",\"pid\":1,\"tid\":%llu,\"ts\":%.3f}",
+                                               (unsigned long long)tid, begin / 1000.0);
+        }
+        else
+        {
+            json += soundsphere::string_format("\",\"ph\":\"X\",\"pid\":1,\"tid\":%llu,\"ts\":%.3f,\"dur\":%.3f}",
+                                               (unsigned long long)tid, begin / 1000.0, (end - begin) / 1000.0);
+        }
+        cnt++;
+    }
+
+    return cnt;
+}
+
+bool soundsphere::trace_enabled(void)
+{
+    return true;
+}
+
+void soundsphere::trace_instant(const char *name)
+{
+    _trace_record(name, ev_hrtime(), 0);
+}
+
+void soundsphere::trace_thread_name(const char *name)
+{
+    _trace_ring()->name.store(name, std::memory_order_relaxed);
+}
+
+void soundsphere::trace_complete(const char *name, uint64_t begin, uint64_t end)
+{
+    /* An end time of 0 means instant event, keep zero-length zones visible. */
+    _trace_record(name, begin, end > begin ? end : begin + 1);
+}
+
+int soundsphere::trace_dump(const std::string &path, std::string &errinfo)
+{
+    std::string json = "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n"
+                       "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,\"args\":{\"name\":\"SoundSphere\"}}";
+
+    int          cnt = 0;
+    trace_ctx_t *ctx = _trace_ctx();
+    {
+        std::unique_lock<std::mutex> lock(ctx->mutex);
+        for (size_t i = 0; i < ctx->rings.size(); i++)
+        {
+            cnt += _trace_dump_ring(json, ctx->rings[i]);
+        }
+    }
+    json += "\n]}\n";
+
+    ev_file_t file;
+    int       flags = EV_FS_O_CREAT | EV_FS_O_WRONLY | EV_FS_O_TRUNC;
+    int       ret = ev_file_open(nullptr, &file, nullptr, path.c_str(), flags, EV_FS_S_IRUSR | EV_FS_S_IWUSR, nullptr);
+    if (ret != 0)
+    {
+        errinfo = ev_strerror(ret);
+        return -1;
+    }
+
+    ssize_t write_sz = ev_file_write(&file, nullptr, json.c_str(), json.size(), nullptr);
+    ev_file_close(&file, nullptr);
+    if (write_sz < 0)
+    {
+        errinfo = ev_strerror((int)write_sz);
+        return -1;
+    }
+
+    return cnt;
+}
+
+soundsphere::TraceZone::TraceZone(const char *name)
+{
+    m_name = name;
+    m_begin = ev_hrtime();
+}
+
+soundsphere::TraceZone::~TraceZone()
+{
+    trace_complete(m_name, m_begin, ev_hrtime());
+}
+
+#else
+
+bool soundsphere::trace_enabled(void)
+{
+    return false;
+}
+
+void soundsphere::trace_instant(const char *name)
+{
+    (void)name;
+}
+
+void soundsphere::trace_thread_name(const char *name)
+{
+    (void)name;
+}
+
+void soundsphere::trace_complete(const char *name, uint64_t begin, uint64_t end)
+{
+    (void)name;
+    (void)begin;
+    (void)end;
+}
+
+int soundsphere::trace_dump(const std::string &path, std::string &errinfo)
+{
+    (void)path;
+    errinfo = "tracing is disabled, reconfigure with -DSOUNDSPHERE_ENABLE_TRACE=ON";
+    return -1;
+}
+
+soundsphere::TraceZone::TraceZone(const char *name)
+{
+    m_name = name;
+    m_begin = 0;
+}
+
+soundsphere::TraceZone::~TraceZone()
+{
+}
+
+#endif
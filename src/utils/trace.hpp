@@ -0,0 +1,98 @@
+#ifndef SOUND_SPHERE_UTILS_TRACE_HPP
+#define SOUND_SPHERE_UTILS_TRACE_HPP
+
+#include <cstdint>
+#include <string>
+
+/**
+ * @brief Tracing is controlled by the CMake option `SOUNDSPHERE_ENABLE_TRACE`.
+ *
+ * When the option is off every macro below expands to nothing, so trace zones
+ * can be left in hot paths (UI loop, audio callback) without any cost.
+ */
+#define TRACE_JOIN2(a, b) a##b
+#define TRACE_JOIN(a, b) TRACE_JOIN2(a, b)
+
+#if defined(SOUNDSPHERE_TRACE)
+
+/**
+ * @brief Record a zone that starts here and ends when the enclosing scope exits.
+ * @param[in] name  Zone name. Must be a string literal (only the pointer is stored).
+ */
+#define TRACE_ZONE(name) soundsphere::TraceZone TRACE_JOIN(_trace_zone_, __LINE__)(name)
+
+/**
+ * @brief Record an instant event.
+ * @param[in] name  Event name. Must be a string literal.
+ */
+#define TRACE_INSTANT(name) soundsphere::trace_instant(name)
+
+/**
+ * @brief Set the name of current thread as shown in the trace viewer.
+ * @param[in] name  Thread name. Must be a string literal.
+ */
+#define TRACE_THREAD_NAME(name) soundsphere::trace_thread_name(name)
+
+#else
+
+#define TRACE_ZONE(name)
+#define TRACE_INSTANT(name)
+#define TRACE_THREAD_NAME(name)
+
+#endif
+
+namespace soundsphere
+{
+
+/**
+ * @brief Whether tracing is compiled in.
+ * @return boolean.
+ */
+bool trace_enabled(void);
+
+/**
+ * @brief Record an instant event in current thread.
+ * @param[in] name  Event name. Must be a string literal.
+ */
+void trace_instant(const char *name);
+
+/**
+ * @brief Set the name of current thread.
+ * @param[in] name  Thread name. Must be a string literal.
+ */
+void trace_thread_name(const char *name);
+
+/**
+ * @brief Record a complete event in current thread.
+ * @param[in] name  Zone name. Must be a string literal.
+ * @param[in] begin Begin time in nanoseconds, from `ev_hrtime()`.
+ * @param[in] end   End time in nanoseconds, from `ev_hrtime()`.
+ */
+void trace_complete(const char *name, uint64_t begin, uint64_t end);
+
+/**
+ * @brief Dump all recorded events as Chrome Trace Event JSON.
+ * The file can be opened by Perfetto (https://ui.perfetto.dev) or chrome://tracing.
+ * @param[in] path      File path.
+ * @param[out] errinfo  Error information.
+ * @return Number of dumped events, or negative number on failure.
+ */
+int trace_dump(const std::string &path, std::string &errinfo);
+
+/**
+ * @brief RAII helper used by #TRACE_ZONE().
+ */
+class TraceZone
+{
+public:
+    TraceZone(const char *name);
+    ~TraceZone();
+
+private:
+    const char *m_name;
+    uint64_t    m_begin;
+};
+
+} // namespace soundsphere
+
+#endif
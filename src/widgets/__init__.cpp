@@ -1,25 +1,32 @@
-#include <ev.h>
 #include <imgui.h>
-#include <list>
+#include <spdlog/spdlog.h>
+#include <atomic>
+#include <cerrno>
 #include <vector>
 #include "i18n/__init__.h"
 #include "runtime/__init__.hpp"
+#include "utils/trace.hpp"
 #include "__init__.hpp"
+#include "msg_queue.hpp"
 
-using namespace soundsphere;
+/**
+ * @brief Capacity of each message queue.
+ * All queues are drained every frame, and slider messages are coalesced.
+ */
+#define WIDGET_MSG_QUEUE_SIZE 256
 
-typedef std::list<Msg::Ptr> MsgQueue;
+using namespace soundsphere;
 
 typedef struct widget_item
 {
-    widget_item(widget_id_t id, const widget_t *widget);
+    widget_item(widget_id_t id, const widget_t *widget, const char *name);
     ~widget_item();
 
     widget_id_t     id;
     const widget_t *widget;
+    const char     *name; /**< Widget name, used as trace zone name. */
 
-    ev_mutex_t req_queue_mutex;
-    MsgQueue   req_queue;
+    MsgQueue req_queue;
 } widget_item_t;
 
 typedef std::vector<widget_item_t *> WidgetItemVec;
@@ -31,41 +38,43 @@ typedef struct widget_ctx
 
     WidgetItemVec widgets;
 
-    ev_mutex_t rsp_queue_mutex;
-    MsgQueue   rsp_queue;
-
-    ev_mutex_t evt_queue_mutex;
-    MsgQueue   evt_queue;
+    MsgQueue rsp_queue;
+    MsgQueue evt_queue;
 } widget_ctx_t;
 
+static_assert(WIDGET_ID__MAX <= 32, "subscriber mask too small");
+
 widget_layout_t      soundsphere::_layout;
 static widget_ctx_t *s_widget_ctx = nullptr;
 
-widget_item::widget_item(widget_id_t id, const widget_t *widget)
+/**
+ * @brief Subscribers of each event, as bit mask of widget ID.
+ * Kept out of #widget_ctx_t, so events sent before init or after exit are dropped.
+ */
+static std::atomic<uint32_t> s_widget_subscribers[MSG_ID__MAX];
+
+widget_item::widget_item(widget_id_t id, const widget_t *widget, const char *name)
+    : req_queue(WIDGET_MSG_QUEUE_SIZE)
 {
     this->id = id;
     this->widget = widget;
-    ev_mutex_init(&req_queue_mutex, 0);
+    this->name = name;
 }
 
 widget_item::~widget_item()
 {
-    ev_mutex_exit(&req_queue_mutex);
 }
 
-widget_ctx::widget_ctx()
+widget_ctx::widget_ctx() : rsp_queue(WIDGET_MSG_QUEUE_SIZE), evt_queue(WIDGET_MSG_QUEUE_SIZE)
 {
 #define EXPAND_WIDGET_MAP_AS_VEC(a, b)                                                                                 \
     do                                                                                                                 \
     {                                                                                                                  \
-        widget_item_t *item = new widget_item_t(a, &b);                                                                \
+        widget_item_t *item = new widget_item_t(a, &b, #b);                                                            \
         widgets.push_back(item);                                                                                       \
     } while (0);
     SOUNDSPHERE_WIDGET_TABLE(EXPAND_WIDGET_MAP_AS_VEC);
 #undef EXPAND_WIDGET_MAP_AS_VEC
-
-    ev_mutex_init(&rsp_queue_mutex, 0);
-    ev_mutex_init(&evt_queue_mutex, 0);
 }
 
 widget_ctx::~widget_ctx()
@@ -76,9 +85,6 @@ widget_ctx::~widget_ctx()
         widgets.pop_back();
         delete widget;
     }
-
-    ev_mutex_exit(&evt_queue_mutex);
-    ev_mutex_exit(&rsp_queue_mutex);
 }
 
 Msg::Req::~Req()
@@ -93,13 +99,14 @@ Msg::Evt::~Evt()
 {
 }
 
-Msg::Msg(widget_id_t id, uint64_t msgid, Msg::Req::Ptr req, Msg::Rsp::Fn fn)
+Msg::Msg(widget_id_t id, msg_id_t msgid, Msg::Req::Ptr req, Msg::Rsp::Fn fn)
 {
     this->msg_type = TYPE_REQ;
     this->widget_id = id;
     this->msg_id = msgid;
     this->req = req;
     this->rsp_call = fn;
+    this->coalesce = false;
 }
 
 Msg::Msg(const Msg *req, Rsp::Ptr rsp)
@@ -109,14 +116,16 @@ Msg::Msg(const Msg *req, Rsp::Ptr rsp)
     this->msg_id = req->msg_id;
     this->rsp_call = req->rsp_call;
     this->rsp = rsp;
+    this->coalesce = false;
 }
 
-Msg::Msg(uint64_t msgid, Evt::Ptr evt)
+Msg::Msg(msg_id_t msgid, Evt::Ptr evt)
 {
     this->msg_type = TYPE_EVT;
     this->widget_id = WIDGET_ID__MAX;
     this->msg_id = msgid;
     this->evt = evt;
+    this->coalesce = false;
 }
 
 Msg::~Msg()
@@ -144,14 +153,13 @@ void Msg::Dispatch::dispatch(Msg::Ptr msg)
         return;
     }
 
-    uint64_t            msg_id = msg->msg_id;
-    HandleMap::iterator it = handle_map.find(msg_id);
-    if (it == handle_map.end())
+    msg_id_t msg_id = msg->msg_id;
+    if (msg_id >= MSG_ID__MAX || !handles[msg_id])
     {
         return;
     }
 
-    (it->second)(msg);
+    handles[msg_id](msg);
 }
 
 void Msg::Dispatch::set_mode(Msg::Type type)
@@ -159,6 +167,23 @@ void Msg::Dispatch::set_mode(Msg::Type type)
     this->accept_type = type;
 }
 
+const char *soundsphere::msg_name(msg_id_t id)
+{
+    switch (id)
+    {
+#define EXPAND_MSG_TABLE_AS_NAME(a, b)                                                                                 \
+    case a:                                                                                                            \
+        return #b;
+        SOUNDSPHERE_MSG_TABLE(EXPAND_MSG_TABLE_AS_NAME);
+#undef EXPAND_MSG_TABLE_AS_NAME
+
+    default:
+        break;
+    }
+
+    return "unknown";
+}
+
 static float _widget_get_main_menu_bar_height(void)
 {
     float main_menu_bar_height = 0;
@@ -205,6 +230,11 @@ void soundsphere::widget_exit(void)
         widget->widget->exit();
     }
 
+    for (size_t i = 0; i < MSG_ID__MAX; i++)
+    {
+        s_widget_subscribers[i].store(0, std::memory_order_relaxed);
+    }
+
     delete s_widget_ctx;
     s_widget_ctx = nullptr;
 }
@@ -261,86 +291,67 @@ static void _widget_draw_update_pos_size(void)
 
 static void _soundsphere_process_all_requests(widget_item_t *widget)
 {
-    bool                  have_msg;
-    soundsphere::Msg::Ptr msg;
-
-    do
+    if (!widget->req_queue.take_pending())
     {
-        have_msg = false;
-        ev_mutex_enter(&widget->req_queue_mutex);
-        if (!widget->req_queue.empty())
-        {
-            have_msg = true;
-            msg = widget->req_queue.front();
-            widget->req_queue.pop_front();
-        }
-        ev_mutex_leave(&widget->req_queue_mutex);
+        return;
+    }
 
-        if (have_msg && widget->widget->message != nullptr)
+    soundsphere::Msg::Ptr msg;
+    while (widget->req_queue.pop(msg))
+    {
+        if (widget->widget->message != nullptr)
         {
             widget->widget->message(msg);
         }
-    } while (have_msg == true);
+    }
 }
 
 static void _soundsphere_process_all_response(void)
 {
-    bool     have_msg;
-    Msg::Ptr msg;
-
-    do
+    if (!s_widget_ctx->rsp_queue.take_pending())
     {
-        have_msg = false;
-        ev_mutex_enter(&s_widget_ctx->rsp_queue_mutex);
-        if (!s_widget_ctx->rsp_queue.empty())
-        {
-            have_msg = true;
-            msg = s_widget_ctx->rsp_queue.front();
-            s_widget_ctx->rsp_queue.pop_front();
-        }
-        ev_mutex_leave(&s_widget_ctx->rsp_queue_mutex);
+        return;
+    }
 
-        if (have_msg && msg->rsp_call)
+    Msg::Ptr msg;
+    while (s_widget_ctx->rsp_queue.pop(msg))
+    {
+        if (msg->rsp_call)
         {
             msg->rsp_call(msg->rsp);
         }
-    } while (have_msg == true);
+    }
 }
 
 static void _soundsphere_process_all_events(void)
 {
-    bool     have_msg;
-    Msg::Ptr msg;
+    if (!s_widget_ctx->evt_queue.take_pending())
+    {
+        return;
+    }
 
-    do
+    Msg::Ptr msg;
+    while (s_widget_ctx->evt_queue.pop(msg))
     {
-        have_msg = false;
-        ev_mutex_enter(&s_widget_ctx->evt_queue_mutex);
-        if (!s_widget_ctx->evt_queue.empty())
-        {
-            have_msg = true;
-            msg = s_widget_ctx->evt_queue.front();
-            s_widget_ctx->evt_queue.pop_front();
-        }
-        ev_mutex_leave(&s_widget_ctx->evt_queue_mutex);
+        uint32_t mask = s_widget_subscribers[msg->msg_id].load(std::memory_order_relaxed);
 
-        if (have_msg)
+        WidgetItemVec::iterator it = s_widget_ctx->widgets.begin();
+        for (; it != s_widget_ctx->widgets.end() && mask != 0; it++)
         {
-            WidgetItemVec::iterator it = s_widget_ctx->widgets.begin();
-            for (; it != s_widget_ctx->widgets.end(); it++)
+            widget_item_t *widget = *it;
+            uint32_t       bit = 1u << widget->id;
+            if ((mask & bit) && widget->widget->message != nullptr)
             {
-                widget_item_t *widget = *it;
-                if (widget->widget->message != nullptr)
-                {
-                    widget->widget->message(msg);
-                }
+                mask &= ~bit;
+                widget->widget->message(msg);
             }
         }
-    } while (have_msg == true);
+    }
 }
 
 void soundsphere::widget_draw(void)
 {
+    TRACE_ZONE("widget_draw");
     _widget_draw_update_pos_size();
     _soundsphere_process_all_response();
     _soundsphere_process_all_events();
@@ -349,12 +360,23 @@ void soundsphere::widget_draw(void)
     for (; it != s_widget_ctx->widgets.end(); it++)
     {
         widget_item_t *widget = *it;
+        TRACE_ZONE(widget->name);
 
         _soundsphere_process_all_requests(widget);
         widget->widget->draw();
     }
 }
 
+static int _soundsphere_widget_push(MsgQueue &queue, Msg::Ptr msg)
+{
+    int ret = queue.push(msg);
+    if (ret != 0)
+    {
+        spdlog::warn("message queue full, drop message {}", msg_name(msg->msg_id));
+    }
+    return ret;
+}
+
 static int _soundsphere_widget_send_req(Msg::Ptr msg)
 {
     widget_id_t widget_id = msg->widget_id;
@@ -368,10 +390,7 @@ static int _soundsphere_widget_send_req(Msg::Ptr msg)
             {
                 return -ENOSYS;
             }
-            ev_mutex_enter(&widget->req_queue_mutex);
-            widget->req_queue.push_back(msg);
-            ev_mutex_leave(&widget->req_queue_mutex);
-            return 0;
+            return _soundsphere_widget_push(widget->req_queue, msg);
         }
     }
 
@@ -380,24 +399,26 @@ static int _soundsphere_widget_send_req(Msg::Ptr msg)
 
 static int _soundsphere_widget_send_rsp(Msg::Ptr msg)
 {
-    ev_mutex_enter(&s_widget_ctx->rsp_queue_mutex);
-    {
-        s_widget_ctx->rsp_queue.push_back(msg);
-    }
-    ev_mutex_leave(&s_widget_ctx->rsp_queue_mutex);
-
-    return 0;
+    return _soundsphere_widget_push(s_widget_ctx->rsp_queue, msg);
 }
 
 static int _soundsphere_widget_send_evt(Msg::Ptr msg)
 {
-    ev_mutex_enter(&s_widget_ctx->evt_queue_mutex);
+    return _soundsphere_widget_push(s_widget_ctx->evt_queue, msg);
+}
+
+void soundsphere::widget_subscribe(widget_id_t id, msg_id_t evt)
+{
+    if (id >= WIDGET_ID__MAX || evt >= MSG_ID__MAX)
     {
-        s_widget_ctx->evt_queue.push_back(msg);
+        return;
     }
-    ev_mutex_leave(&s_widget_ctx->evt_queue_mutex);
+    s_widget_subscribers[evt].fetch_or(1u << id, std::memory_order_relaxed);
+}
 
-    return 0;
+bool soundsphere::widget_has_subscriber(msg_id_t evt)
+{
+    return s_widget_subscribers[evt].load(std::memory_order_relaxed) != 0;
 }
 
 int soundsphere::widget_send_msg(Msg::Ptr msg)
@@ -3,13 +3,17 @@
 
 #include <memory>
 #include <functional>
-#include <map>
+#include <type_traits>
 #include "utils/imgui.hpp"
 
 /* clang-format off */
 #define SOUNDSPHERE_WIDGET_TABLE(xx)                            \
     xx(WIDGET_ID_MENUBAR_OPEN,          menubar_open)           \
     xx(WIDGET_ID_MENUBAR_PREFERENCES,   menubar_preferences)    \
+    xx(WIDGET_ID_MENUBAR_LYRIC_FETCH,   menubar_lyric_fetch)    \
+    xx(WIDGET_ID_MENUBAR_LOUDNESS_SCAN, menubar_loudness_scan)  \
+    xx(WIDGET_ID_MENUBAR_VISUALIZER,    menubar_visualizer)     \
+    xx(WIDGET_ID_MENUBAR_EQUALIZER,     menubar_equalizer)      \
     xx(WIDGET_ID_MENUBAR_TRANSLATIONS,  menubar_translations)   \
     xx(WIDGET_ID_MENUBAR_DEBUG,         menubar_debug)          \
     xx(WIDGET_ID_MENUBAR_ABOUT,         menubar_about)          \
@@ -25,12 +29,26 @@
 /* clang-format on */
 
 /**
- * @brief Make message ID.
- * @param[in] widget_id See #widget_id_t.
- * @param[in] msg_id    Message ID in this widget.
- * @return The unique message ID.
+ * @brief All message types.
+ *
+ * Each message type gets its ID from this table, so IDs are unique across widgets
+ * and dense enough to index a handler array. Listing a type twice, or reusing a
+ * name, does not compile.
  */
-#define MAKE_MSGID(widget_id, msg_id) ((uint64_t)((((uint64_t)(widget_id)) << 32) | ((uint32_t)(msg_id))))
+/* clang-format off */
+#define SOUNDSPHERE_MSG_TABLE(xx)                                                   \
+    xx(MSG_ID_DUMMY_PLAYER_RELOAD,              DummyPlayerReload)                  \
+    xx(MSG_ID_DUMMY_PLAYER_PAUSE,               DummyPlayerPause)                   \
+    xx(MSG_ID_DUMMY_PLAYER_NEXT,                DummyPlayerNext)                    \
+    xx(MSG_ID_DUMMY_PLAYER_SET_VOLUME,          DummyPlayerSetVolume)               \
+    xx(MSG_ID_DUMMY_PLAYER_SET_POSITION,        DummyPlayerSetPosition)             \
+    xx(MSG_ID_DUMMY_PLAYER_SET_SHUFFLE_MODE,    DummyPlayerSetShuffleMode)          \
+    xx(MSG_ID_DUMMY_PLAYER_RESUME_OR_PLAY,      DummyPlayerResumeOrPlay)            \
+    xx(MSG_ID_DUMMY_PLAYER_SET_BIT_PERFECT,     DummyPlayerSetBitPerfect)           \
+    xx(MSG_ID_TAG_EDITOR_OPEN,                  TagEditorOpen)                      \
+    xx(MSG_ID_UI_FILTER_RESET,                  UiFilterReset)                      \
+    xx(MSG_ID_UI_FILTER_SET,                    UiFilterSet)
+/* clang-format on */
 
 namespace soundsphere
 {
@@ -43,6 +61,10 @@ typedef enum widget_id
      */
     WIDGET_ID_MENUBAR_OPEN,
     WIDGET_ID_MENUBAR_PREFERENCES,
+    WIDGET_ID_MENUBAR_LYRIC_FETCH,
+    WIDGET_ID_MENUBAR_LOUDNESS_SCAN,
+    WIDGET_ID_MENUBAR_VISUALIZER,
+    WIDGET_ID_MENUBAR_EQUALIZER,
     WIDGET_ID_MENUBAR_TRANSLATIONS,
     WIDGET_ID_MENUBAR_DEBUG,
     WIDGET_ID_MENUBAR_ABOUT,
@@ -82,6 +104,119 @@ typedef enum widget_id
     WIDGET_ID__MAX,
 } widget_id_t;
 
+typedef enum msg_id
+{
+#define SOUNDSPHERE_EXPAND_MSG_TABLE_AS_ENUM(a, b) a,
+    SOUNDSPHERE_MSG_TABLE(SOUNDSPHERE_EXPAND_MSG_TABLE_AS_ENUM)
+#undef SOUNDSPHERE_EXPAND_MSG_TABLE_AS_ENUM
+
+    /**
+     * @brief Max value.
+     */
+    MSG_ID__MAX,
+} msg_id_t;
+
+/**
+ * @brief Message ID of type \p T.
+ *
+ * Only types listed in #SOUNDSPHERE_MSG_TABLE have it, so sending a message that
+ * is not registered is a compile error.
+ */
+template <typename T>
+struct msg_traits;
+
+#define SOUNDSPHERE_EXPAND_MSG_TABLE_AS_TYPE(a, b)                                                                     \
+    struct b;                                                                                                          \
+    template <>                                                                                                        \
+    struct msg_traits<b>                                                                                               \
+    {                                                                                                                  \
+        static constexpr msg_id_t ID = a;                                                                              \
+    };
+SOUNDSPHERE_MSG_TABLE(SOUNDSPHERE_EXPAND_MSG_TABLE_AS_TYPE)
+#undef SOUNDSPHERE_EXPAND_MSG_TABLE_AS_TYPE
+
+/**
+ * @brief Get name of message type.
+ * @param[in] id    Message ID.
+ * @return Type name, or "unknown".
+ */
+const char *msg_name(msg_id_t id);
+
+/**
+ * @brief Allocate message memory from message pool.
+ * @note MT-Safe.
+ * @param[in] size  Size in bytes.
+ * @return Memory block.
+ */
+void *msg_pool_alloc(size_t size);
+
+/**
+ * @brief Release memory allocated by #msg_pool_alloc().
+ * @note MT-Safe.
+ * @param[in] p     Memory block.
+ * @param[in] size  Size passed to #msg_pool_alloc().
+ */
+void msg_pool_free(void *p, size_t size);
+
+/**
+ * @brief Allocator for messages and their payload.
+ * Small blocks are recycled by message pool instead of going through the heap.
+ */
+template <typename T>
+struct MsgAllocator
+{
+    typedef T value_type;
+
+    MsgAllocator() noexcept
+    {
+    }
+
+    template <typename U>
+    MsgAllocator(const MsgAllocator<U> &) noexcept
+    {
+    }
+
+    T *allocate(size_t n)
+    {
+        return static_cast<T *>(msg_pool_alloc(n * sizeof(T)));
+    }
+
+    void deallocate(T *p, size_t n) noexcept
+    {
+        msg_pool_free(p, n * sizeof(T));
+    }
+};
+
+template <typename T, typename U>
+bool operator==(const MsgAllocator<T> &, const MsgAllocator<U> &)
+{
+    return true;
+}
+
+template <typename T, typename U>
+bool operator!=(const MsgAllocator<T> &, const MsgAllocator<U> &)
+{
+    return false;
+}
+
+/**
+ * @brief Whether message \p T is coalesced.
+ *
+ * A message declares `static const bool COALESCE = true;` if only its latest value
+ * matters, like a slider position. While such a request is still queued, a new one
+ * replaces it instead of being queued again, and the response callback of the
+ * replaced request is never called.
+ */
+template <typename T, typename = void>
+struct msg_coalesce : std::false_type
+{
+};
+
+template <typename T>
+struct msg_coalesce<T, std::void_t<decltype(T::COALESCE)>> : std::integral_constant<bool, T::COALESCE>
+{
+};
+
 typedef struct widget_pos_size
 {
     ImVec2 pos;  /**< Position. */
@@ -132,30 +267,6 @@ public:
         virtual ~Evt();
     };
 
-    template <typename T>
-    class ReqProxy
-    {
-    public:
-        typedef std::function<void(std::shared_ptr<typename T::Req>)> Fn;
-
-        ReqProxy(Fn cb)
-        {
-            this->cb = cb;
-        }
-
-        void proxy_cb(std::shared_ptr<Msg::Req> req)
-        {
-            auto obj = std::dynamic_pointer_cast<typename T::Req>(req);
-            if (cb)
-            {
-                cb(obj);
-            }
-        }
-
-    private:
-        Fn cb;
-    };
-
     template <typename T>
     class RspProxy
     {
@@ -167,9 +278,13 @@ public:
             this->cb = cb;
         }
 
+        /**
+         * @brief Response of message \p T.
+         * Only bound to requests of \p T, and #widget_send_rsp() checks the type.
+         */
         void proxy_cb(std::shared_ptr<Msg::Rsp> rsp)
         {
-            auto obj = std::dynamic_pointer_cast<typename T::Rsp>(rsp);
+            auto obj = std::static_pointer_cast<typename T::Rsp>(rsp);
             if (cb)
             {
                 cb(obj);
@@ -182,6 +297,9 @@ public:
 
     class Dispatch
     {
+    public:
+        typedef std::function<void(Msg::Ptr)> MsgFn;
+
     public:
         Dispatch();
         virtual ~Dispatch();
@@ -191,9 +309,9 @@ public:
          * @brief Register event handle.
          */
         template <typename T>
-        void register_handle(std::function<void(Msg::Ptr)> fn)
+        void register_handle(MsgFn fn)
         {
-            handle_map.insert(HandleMap::value_type(T::ID, fn));
+            handles[msg_traits<T>::ID] = fn;
         }
 
         /**
@@ -207,16 +325,14 @@ public:
         void set_mode(Msg::Type type);
 
     private:
-        typedef std::function<void(Msg::Ptr)> MsgFn;
-        typedef std::map<int, MsgFn>          HandleMap;
-        HandleMap                             handle_map;
-        Msg::Type                             accept_type;
+        MsgFn     handles[MSG_ID__MAX]; /**< Handles indexed by message ID. */
+        Msg::Type accept_type;
     };
 
 public:
-    Msg(widget_id_t id, uint64_t msgid, Req::Ptr req, Rsp::Fn fn);
+    Msg(widget_id_t id, msg_id_t msgid, Req::Ptr req, Rsp::Fn fn);
     Msg(const Msg *req, Rsp::Ptr rsp);
-    Msg(uint64_t msgid, Evt::Ptr evt);
+    Msg(msg_id_t msgid, Evt::Ptr evt);
     virtual ~Msg();
 
 public:
@@ -227,58 +343,83 @@ public:
 
     /**
      * @brief Get request payload.
+     * @return Payload, or nullptr if this is not a message of \p T.
      */
     template <typename T>
     std::shared_ptr<typename T::Req> get_req() const
     {
-        return std::dynamic_pointer_cast<typename T::Req>(req);
+        if (msg_id != msg_traits<T>::ID)
+        {
+            return nullptr;
+        }
+        return std::static_pointer_cast<typename T::Req>(req);
     }
 
     /**
      * @brief Get response payload.
+     * @return Payload, or nullptr if this is not a message of \p T.
      */
     template <typename T>
     std::shared_ptr<typename T::Rsp> get_rsp() const
     {
-        return std::dynamic_pointer_cast<typename T::Rsp>(rsp);
+        if (msg_id != msg_traits<T>::ID)
+        {
+            return nullptr;
+        }
+        return std::static_pointer_cast<typename T::Rsp>(rsp);
     }
 
     /**
      * @brief Get event payload.
+     * @return Payload, or nullptr if this is not a message of \p T.
      */
     template <typename T>
     std::shared_ptr<typename T::Evt> get_evt() const
     {
-        return std::dynamic_pointer_cast<typename T::Evt>(evt);
+        if (msg_id != msg_traits<T>::ID)
+        {
+            return nullptr;
+        }
+        return std::static_pointer_cast<typename T::Evt>(evt);
     }
 
 public:
     template <typename T, typename... _Args>
     static std::shared_ptr<typename T::Req> make_req(_Args &&...__args)
     {
-        return std::make_shared<typename T::Req>(std::forward<_Args>(__args)...);
+        return std::allocate_shared<typename T::Req>(MsgAllocator<typename T::Req>(), std::forward<_Args>(__args)...);
     }
 
     template <typename T, typename... _Args>
     static std::shared_ptr<typename T::Rsp> make_rsp(_Args &&...__args)
     {
-        return std::make_shared<typename T::Rsp>(std::forward<_Args>(__args)...);
+        return std::allocate_shared<typename T::Rsp>(MsgAllocator<typename T::Rsp>(), std::forward<_Args>(__args)...);
     }
 
     template <typename T, typename... _Args>
     static std::shared_ptr<typename T::Evt> make_evt(_Args &&...__args)
     {
-        return std::make_shared<typename T::Evt>(std::forward<_Args>(__args)...);
+        return std::allocate_shared<typename T::Evt>(MsgAllocator<typename T::Evt>(), std::forward<_Args>(__args)...);
+    }
+
+    /**
+     * @brief Create message object from message pool.
+     */
+    template <typename... _Args>
+    static Ptr make(_Args &&...__args)
+    {
+        return std::allocate_shared<Msg>(MsgAllocator<Msg>(), std::forward<_Args>(__args)...);
     }
 
 public:
     Type        msg_type;  /**< Message type. */
     widget_id_t widget_id; /**< Widget that receive this message. */
-    uint64_t    msg_id;    /**< Message ID. */
+    msg_id_t    msg_id;    /**< Message ID, also the type tag of payload. */
     Req::Ptr    req;       /**< Request payload. */
     Rsp::Ptr    rsp;       /**< Response payload. */
     Evt::Ptr    evt;       /**< Event payload. */
-    Rsp::Fn     rsp_call;  /**< Proxy response call. */
+    Rsp::Fn     rsp_call;  /**< Proxy response call. Empty if sender does not care about response. */
+    bool        coalesce;  /**< See #msg_coalesce. */
 };
 
 typedef struct widget
@@ -333,6 +474,52 @@ void widget_draw(void);
  */
 int widget_send_msg(Msg::Ptr msg);
 
+/**
+ * @brief Subscribe event.
+ * Events are only delivered to widgets that subscribe them, usually in `init`.
+ * @note MT-Safe.
+ * @param[in] id    Widget that receive the event.
+ * @param[in] evt   Event ID.
+ */
+void widget_subscribe(widget_id_t id, msg_id_t evt);
+
+/**
+ * @brief Subscribe event \p T.
+ * @note MT-Safe.
+ */
+template <typename T>
+void widget_subscribe(widget_id_t id)
+{
+    widget_subscribe(id, msg_traits<T>::ID);
+}
+
+/**
+ * @brief Whether any widget subscribes event.
+ * @note MT-Safe.
+ * @param[in] evt   Event ID.
+ */
+bool widget_has_subscriber(msg_id_t evt);
+
+/**
+ * @brief Build request message.
+ * @note MT-Safe.
+ */
+template <typename T>
+Msg::Ptr widget_make_req(widget_id_t id, std::shared_ptr<typename T::Req> req,
+                         typename Msg::RspProxy<T>::Fn cb = typename Msg::RspProxy<T>::Fn())
+{
+    Msg::Rsp::Fn proxy_fn;
+    if (cb)
+    {
+        Msg::RspProxy<T> proxy(cb);
+        proxy_fn = std::bind(&Msg::RspProxy<T>::proxy_cb, proxy, std::placeholders::_1);
+    }
+
+    Msg::Ptr msg = Msg::make(id, msg_traits<T>::ID, req, proxy_fn);
+    msg->coalesce = msg_coalesce<T>::value;
+    return msg;
+}
+
 /**
  * @brief Send request to widget and wait for response.
  * @note MT-Safe.
@@ -341,10 +528,7 @@ template <typename T>
 int widget_send_req(widget_id_t id, std::shared_ptr<typename T::Req> req,
                     typename Msg::RspProxy<T>::Fn cb = typename Msg::RspProxy<T>::Fn())
 {
-    Msg::RspProxy<T> proxy(cb);
-    Msg::Rsp::Fn     proxy_fn = std::bind(&Msg::RspProxy<T>::proxy_cb, proxy, std::placeholders::_1);
-    Msg::Ptr         msg = std::make_shared<Msg>(id, T::ID, req, proxy_fn);
-    return widget_send_msg(msg);
+    return widget_send_msg(widget_make_req<T>(id, req, cb));
 }
 
 /**
@@ -365,7 +549,13 @@ int widget_fast_req(widget_id_t id, _Args &&...__args)
 template <typename T>
 void widget_send_rsp(Msg::Ptr msg, std::shared_ptr<typename T::Rsp> rsp)
 {
-    Msg::Ptr obj = std::make_shared<Msg>(msg.get(), rsp);
+    /* Response type must match the request, it is cast without check on the other side. */
+    if (!msg->rsp_call || msg->msg_id != msg_traits<T>::ID)
+    {
+        return;
+    }
+
+    Msg::Ptr obj = Msg::make(msg.get(), rsp);
     widget_send_msg(obj);
 }
 
@@ -376,6 +566,12 @@ void widget_send_rsp(Msg::Ptr msg, std::shared_ptr<typename T::Rsp> rsp)
 template <typename T, typename... _Args>
 void widget_fast_rsp(Msg::Ptr msg, _Args &&...__args)
 {
+    /* Nobody waits for response. */
+    if (!msg->rsp_call)
+    {
+        return;
+    }
+
     auto rsp = Msg::make_rsp<T>(std::forward<_Args>(__args)...);
     widget_send_rsp<T>(msg, rsp);
 }
@@ -387,7 +583,12 @@ void widget_fast_rsp(Msg::Ptr msg, _Args &&...__args)
 template <typename T>
 void widget_send_evt(std::shared_ptr<typename T::Evt> evt)
 {
-    Msg::Ptr obj = std::make_shared<Msg>(T::ID, evt);
+    if (!widget_has_subscriber(msg_traits<T>::ID))
+    {
+        return;
+    }
+
+    Msg::Ptr obj = Msg::make(msg_traits<T>::ID, evt);
     widget_send_msg(obj);
 }
 
@@ -398,6 +599,12 @@ void widget_send_evt(std::shared_ptr<typename T::Evt> evt)
 template <typename T, typename... _Args>
 void widget_fast_evt(_Args &&...__args)
 {
+    /* Nobody listens, skip building payload. */
+    if (!widget_has_subscriber(msg_traits<T>::ID))
+    {
+        return;
+    }
+
     auto evt = Msg::make_evt<T>(std::forward<_Args>(__args)...);
     widget_send_evt<T>(evt);
 }
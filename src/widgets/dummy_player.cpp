@@ -1,24 +1,74 @@
 #include <ev.h>
 #include <random>
 #include <algorithm>
+#include <atomic>
+#include <deque>
+#include <mutex>
 #include <SDL_mixer.h>
 #include <spdlog/spdlog.h>
+#include "audio/__init__.hpp"
+#include "audio/seek_index_cache.hpp"
 #include "config/__init__.hpp"
 #include "runtime/__init__.hpp"
+#include "runtime/worker.hpp"
 #include "utils/time.hpp"
+#include "utils/trace.hpp"
 #include "dummy_player.hpp"
+#include "menubar_equalizer.hpp"
 #include "__init__.hpp"
 
+/**
+ * @brief Interval to refresh playback position, in milliseconds.
+ * UI extrapolates position between two refreshes.
+ */
+#define DUMMY_PLAYER_POLL_INTERVAL 250
+
 using namespace soundsphere;
 
+/**
+ * @brief Playback state, published by player thread.
+ */
+typedef struct dummy_player_snapshot
+{
+    MusicTagPtr  current_music;  /**< The current playing music. */
+    bool         is_playing;     /**< Is the audio is playing. */
+    double       music_duration; /**< Music duration, in seconds. */
+    double       music_position; /**< Music position when sampled, in seconds. */
+    uint64_t     sample_time;    /**< When position is sampled, by ev_hrtime(). */
+    audio_spec_t output;         /**< Device format. */
+} dummy_player_snapshot_t;
+
+typedef std::shared_ptr<const dummy_player_snapshot_t> DummyPlayerSnapshotPtr;
+
+/**
+ * @brief Command to player thread.
+ */
+typedef struct dummy_player_cmd
+{
+    dummy_player_cmd();
+
+    Msg::Ptr          msg;         /**< (Optional) Request from UI. */
+    MusicTagPtrVecPtr media_list;  /**< (Optional) Copy of new playlist. */
+    uint64_t          selected_id; /**< Selected item when request is sent. */
+    AudioTrackPtr     preload;     /**< (Optional) Decoded next track. */
+    uint64_t          load_seq;    /**< (Optional) #dummy_player::load_seq of a finished load, or 0. */
+    AudioTrackPtr     loaded;      /**< Track of that load, nullptr if it failed. */
+} dummy_player_cmd_t;
+
+typedef std::deque<dummy_player_cmd_t> DummyPlayerCmdQueue;
+
 typedef struct dummy_player
 {
     dummy_player();
 
+    /*
+     * Fields below are only accessed in player thread after init.
+     */
+
     /**
-     * @brief SDL music instance.
+     * @brief Copy of playlist, so UI is free to modify its own.
      */
-    Mix_Music *music_mix;
+    MusicTagPtrVecPtr media_list;
 
     /**
      * @brief Musics in play order.
@@ -30,17 +80,124 @@ typedef struct dummy_player
      */
     DummyPlayerSetShuffleMode::shuffle_mode shuffle_mode;
 
+    MusicTagPtr current_music;  /**< The current playing music. */
+    bool        is_playing;     /**< Is the audio is playing. */
+    bool        is_paused;      /**< Is the audio paused. */
+    double      music_duration; /**< Music duration, in seconds. */
+    uint64_t    selected_id;    /**< Selected item of the request in process. */
+    uint64_t    advances;       /**< Last seen #audio_status_t::advances. */
+
+    /*
+     * Device format follows each track in bit-perfect mode.
+     */
+
+    bool bit_perfect;   /**< Reopen device at the format of each track. */
+    int  buffer_frames; /**< Output buffer of device, in frames. */
+    int  spec_freq;     /**< Sample rate asked for when device is opened. */
+    int  spec_channels; /**< Channels asked for when device is opened. */
+
+    /**
+     * @brief Music after current one, decoded or being decoded.
+     */
+    MusicTagPtr preload_music;
+
+    /**
+     * @brief Decoding #dummy_player::preload_music, or nullptr if queued.
+     */
+    WorkerTask::Ptr preload_task;
+
+    /*
+     * Track to play is loaded in worker pool, and played when it is done.
+     */
+
+    WorkerTask::Ptr load_task;      /**< Loading #dummy_player::current_music, or nullptr. */
+    uint64_t        load_seq;       /**< Increased for every load, so a superseded one is dropped. */
+    bool            load_crossfade; /**< Crossfade into the track when loaded. */
+    float           load_position;  /**< Position asked for while loading, or negative. */
+
+    /*
+     * Seek index of tracks handed to audio output, built in worker pool.
+     */
+
+    WorkerTask::Ptr index_task;         /**< Index of the track being heard, or nullptr. */
+    WorkerTask::Ptr preload_index_task; /**< Index of the queued track, or nullptr. */
+
     Msg::Dispatch req_dispatcher;
+
+    /*
+     * Player thread.
+     */
+
+    ev_os_thread_t thread;
+    ev_loop_t      loop;
+    ev_async_t     async; /**< Wakeup for commands and end of track. */
+    ev_timer_t     timer; /**< Refresh position while playing. */
+
+    /**
+     * @brief Protects fields below.
+     */
+    std::mutex          mutex;
+    DummyPlayerCmdQueue cmds;
+    bool                looping;
+
+    /**
+     * @brief Latest state, swapped by std::atomic_store().
+     */
+    DummyPlayerSnapshotPtr snapshot;
+
+    /*
+     * Fields below are only accessed in UI thread.
+     */
+
+    MusicTagPtrVecPtr      synced_list; /**< Playlist sent to player thread. */
+    size_t                 synced_size; /**< Size of playlist when sent. */
+    DummyPlayerSnapshotPtr applied;     /**< Snapshot copied into #soundsphere::_G. */
 } dummy_player_t;
 
+/**
+ * @brief Decode next track in worker pool, and hand it to player thread.
+ */
+class DummyPlayerPreload : public WorkerTask
+{
+public:
+    DummyPlayerPreload(MusicTagPtr music, const audio_spec_t &spec);
+
+public:
+    virtual void run();
+    virtual void complete();
+
+private:
+    MusicTagPtr  m_music;
+    audio_spec_t m_spec; /**< Device format when submitted. */
+};
+
+/**
+ * @brief Load the track to play in worker pool, and hand it to player thread.
+ */
+class DummyPlayerLoad : public WorkerTask
+{
+public:
+    DummyPlayerLoad(MusicTagPtr music, const audio_spec_t &spec, uint64_t seq);
+
+public:
+    virtual void run();
+    virtual void complete();
+
+private:
+    MusicTagPtr  m_music;
+    audio_spec_t m_spec; /**< Device format when submitted. */
+    uint64_t     m_seq;
+};
+
 static dummy_player_t *s_player = nullptr;
-const uint64_t         DummyPlayerReload::ID;
-const uint64_t         DummyPlayerPause::ID;
-const uint64_t         DummyPlayerNext::ID;
-const uint64_t         DummyPlayerSetVolume::ID;
-const uint64_t         DummyPlayerSetPosition::ID;
-const uint64_t         DummyPlayerSetShuffleMode::ID;
-const uint64_t         DummyPlayerResumeOrPlay::ID;
+
+static void _dummy_player_push(const dummy_player_cmd_t &cmd);
+
+dummy_player_cmd::dummy_player_cmd()
+{
+    selected_id = (uint64_t)-1;
+    load_seq = 0;
+}
 
 DummyPlayerSetVolume::Req::Req(int volume)
 {
@@ -62,28 +219,228 @@ DummyPlayerSetShuffleMode::Evt::Evt(shuffle_mode mode)
     this->mode = mode;
 }
 
+DummyPlayerSetBitPerfect::Req::Req(bool enabled)
+{
+    this->enabled = enabled;
+}
+
+DummyPlayerPreload::DummyPlayerPreload(MusicTagPtr music, const audio_spec_t &spec)
+{
+    m_music = music;
+    m_spec = spec;
+}
+
+void DummyPlayerPreload::run()
+{
+    AudioTrackPtr track = audio_track_load(m_music, m_spec.freq, m_spec.channels);
+    if (track.get() == nullptr || cancelled())
+    {
+        return;
+    }
+
+    dummy_player_cmd_t cmd;
+    cmd.selected_id = (uint64_t)-1;
+    cmd.preload = track;
+    _dummy_player_push(cmd);
+}
+
+void DummyPlayerPreload::complete()
+{
+}
+
+DummyPlayerLoad::DummyPlayerLoad(MusicTagPtr music, const audio_spec_t &spec, uint64_t seq)
+{
+    m_music = music;
+    m_spec = spec;
+    m_seq = seq;
+}
+
+void DummyPlayerLoad::run()
+{
+    AudioTrackPtr track = audio_track_load(m_music, m_spec.freq, m_spec.channels);
+    if (cancelled())
+    {
+        return;
+    }
+
+    /* A failed load is handed over too, so player moves on. */
+    dummy_player_cmd_t cmd;
+    cmd.selected_id = (uint64_t)-1;
+    cmd.load_seq = m_seq;
+    cmd.loaded = track;
+    _dummy_player_push(cmd);
+}
+
+void DummyPlayerLoad::complete()
+{
+}
+
+/**
+ * @brief Publish playback state to UI.
+ */
+static void _dummy_player_publish(void)
+{
+    audio_status_t status = audio_poll();
+
+    std::shared_ptr<dummy_player_snapshot_t> snapshot = std::make_shared<dummy_player_snapshot_t>();
+    snapshot->current_music = s_player->current_music;
+    snapshot->is_playing = s_player->is_playing;
+    snapshot->music_duration = s_player->music_duration;
+    snapshot->music_position = status.position;
+    snapshot->sample_time = ev_hrtime();
+    snapshot->output = audio_spec();
+
+    std::atomic_store(&s_player->snapshot, DummyPlayerSnapshotPtr(snapshot));
+}
+
 /**
  * @brief Set current playing position.
+ *
+ * The decoder of the track is moved to the frame, in the decode thread. Once
+ * the seek index is built it goes near the frame at once. Before that FLAC
+ * seeks by its seek table or a search, MP3 decodes forward from the start or
+ * the current frame. State is published at once, so a dragged seek bar does
+ * not snap back until the next poll. While the track is loading, it starts
+ * there once loaded.
  */
 static void _dummy_player_set_position(float position)
 {
-    double real_position = soundsphere::_G.playbar.music_duration * position;
-    Mix_SetMusicPosition(real_position);
+    if (s_player->load_task.get() != nullptr)
+    {
+        s_player->load_position = position;
+        return;
+    }
+
+    double real_position = s_player->music_duration * position;
+    audio_seek(real_position);
+    _dummy_player_publish();
+}
+
+static void _dummy_player_cancel_index(WorkerTask::Ptr &task)
+{
+    if (task.get() != nullptr)
+    {
+        task->cancel();
+        task.reset();
+    }
 }
 
-static void _stop_play(void)
+/**
+ * @brief Build seek index of \p track in worker pool if it is not cached, so
+ * seeking in VBR MP3 or FLAC without seek table does not scan the file.
+ * @param[in] track     Track handed to audio output, or nullptr.
+ * @param[in,out] task  Task of the index, the one before is cancelled.
+ */
+static void _dummy_player_index(const AudioTrackPtr &track, WorkerTask::Ptr &task)
+{
+    _dummy_player_cancel_index(task);
+    if (track.get() == nullptr || std::atomic_load(&track->seek_index).get() != nullptr)
+    {
+        return;
+    }
+
+    std::weak_ptr<audio_track_t> weak = track;
+    MusicTagPtr                  music = track->music;
+    task = worker_submit<bool>(WORKER_PRIORITY_BACKGROUND, [weak, music](WorkerTask &self) {
+        AudioSeekIndexPtr index =
+            audio_seek_index_build(music->path, music->info.format, [&self]() { return self.cancelled(); });
+        if (index.get() == nullptr)
+        {
+            return false;
+        }
+        seek_index_cache_put(*music, *index);
+
+        /* Output may still play the track. */
+        AudioTrackPtr owner = weak.lock();
+        if (owner.get() != nullptr)
+        {
+            std::atomic_store(&owner->seek_index, index);
+        }
+        return true;
+    });
+}
+
+static void _dummy_player_cancel_preload(void)
+{
+    if (s_player->preload_task.get() != nullptr)
+    {
+        s_player->preload_task->cancel();
+        s_player->preload_task.reset();
+    }
+    s_player->preload_music.reset();
+    _dummy_player_cancel_index(s_player->preload_index_task);
+}
+
+/**
+ * @brief Device format to play \p obj in.
+ */
+static void _dummy_player_wanted_spec(const MusicTagPtr &obj, int &freq, int &channels)
 {
-    if (s_player->music_mix != NULL)
+    freq = MIX_DEFAULT_FREQUENCY;
+    channels = MIX_DEFAULT_CHANNELS;
+    if (s_player->bit_perfect && obj.get() != nullptr && obj->info.samplerate > 0 && obj->info.channel > 0)
     {
-        Mix_FreeMusic(s_player->music_mix);
-        s_player->music_mix = NULL;
+        freq = obj->info.samplerate;
+        channels = obj->info.channel;
     }
+}
+
+/**
+ * @brief Whether \p obj plays in the format device is opened at, so it can be spliced in.
+ */
+static bool _dummy_player_spec_fits(const MusicTagPtr &obj)
+{
+    int freq = 0, channels = 0;
+    _dummy_player_wanted_spec(obj, freq, channels);
+    return freq == s_player->spec_freq && channels == s_player->spec_channels;
+}
+
+/**
+ * @brief Reopen device in the format of \p obj if it differs. Output is stopped then.
+ * @return true if reopened, tracks decoded before must not be played.
+ */
+static bool _dummy_player_open_spec(const MusicTagPtr &obj)
+{
+    if (_dummy_player_spec_fits(obj))
+    {
+        return false;
+    }
+
+    int freq = 0, channels = 0;
+    _dummy_player_wanted_spec(obj, freq, channels);
+    _dummy_player_cancel_preload();
+    audio_reopen(freq, channels, s_player->buffer_frames);
+
+    /* Remember what was asked for, device may not support it and pick another. */
+    s_player->spec_freq = freq;
+    s_player->spec_channels = channels;
+
+    audio_spec_t spec = audio_spec();
+    spdlog::info("audio device opened at {} Hz, {} channels, {} bits", spec.freq, spec.channels, spec.bits);
+    return true;
+}
+
+static void _dummy_player_cancel_load(void)
+{
+    if (s_player->load_task.get() != nullptr)
+    {
+        s_player->load_task->cancel();
+        s_player->load_task.reset();
+    }
+    s_player->load_position = -1.0f;
+}
 
-    soundsphere::_G.playbar.is_playing = false;
-    soundsphere::_G.playbar.music_position = 0.0;
-    soundsphere::_G.playbar.music_duration = 0.0;
+static void _stop_play(void)
+{
+    audio_stop();
+    _dummy_player_cancel_load();
+    _dummy_player_cancel_preload();
+    _dummy_player_cancel_index(s_player->index_task);
+    ev_timer_stop(&s_player->timer);
 
-    _dummy_player_set_position(0);
+    s_player->is_playing = false;
+    s_player->is_paused = false;
+    s_player->music_duration = 0.0;
 }
 
 static MusicTagPtrVecPtr _shuffle_media(MusicTagPtrVecPtr vec)
@@ -96,21 +453,116 @@ static MusicTagPtrVecPtr _shuffle_media(MusicTagPtrVecPtr vec)
     return ret;
 }
 
+/**
+ * @brief The music after current one in play order.
+ */
+static MusicTagPtr _dummy_player_next_music(void)
+{
+    size_t            idx = 0;
+    MusicTagPtrVecPtr vec = s_player->shuffle_vec;
+
+    if (vec->empty())
+    {
+        return MusicTagPtr();
+    }
+
+    for (; idx < vec->size(); idx++)
+    {
+        MusicTagPtr obj = vec->at(idx);
+        if (obj.get() == s_player->current_music.get())
+        {
+            break;
+        }
+    }
+
+    if (idx >= vec->size())
+    {
+        idx = 0;
+    }
+    else
+    {
+        idx++;
+        if (idx >= vec->size())
+        {
+            idx = 0;
+        }
+    }
+
+    return vec->at(idx);
+}
+
+/**
+ * @brief Whether to crossfade between tracks. Repeat one loops without it.
+ */
+static bool _dummy_player_crossfade(void)
+{
+    return s_player->shuffle_mode != DummyPlayerSetShuffleMode::SHUFFLE_REPEAT;
+}
+
+/**
+ * @brief Make sure the music after current one is queued, or being decoded.
+ */
+static void _dummy_player_preload(void)
+{
+    /* Playing the loaded track drops the queue, it is preloaded after that. */
+    if (s_player->load_task.get() != nullptr)
+    {
+        return;
+    }
+
+    MusicTagPtr obj = s_player->is_playing || s_player->is_paused ? _dummy_player_next_music() : MusicTagPtr();
+    if (obj.get() == s_player->preload_music.get())
+    {
+        return;
+    }
+
+    _dummy_player_cancel_preload();
+    audio_queue(AudioTrackPtr(), false);
+    if (obj.get() == nullptr)
+    {
+        return;
+    }
+    s_player->preload_music = obj;
+
+    /* Device is reopened for it when current one ends, it is decoded then. */
+    if (!_dummy_player_spec_fits(obj))
+    {
+        return;
+    }
+
+    /* Repeat, splice the same track again. */
+    audio_status_t status = audio_poll();
+    if (status.track.get() != nullptr && status.track->music.get() == obj.get())
+    {
+        audio_queue(status.track, _dummy_player_crossfade());
+        return;
+    }
+
+    s_player->preload_task = std::make_shared<DummyPlayerPreload>(obj, audio_spec());
+    worker_submit_task(WORKER_PRIORITY_BACKGROUND, s_player->preload_task);
+}
+
 static void _dummy_player_reshuffle(void)
 {
     switch (s_player->shuffle_mode)
     {
     case DummyPlayerSetShuffleMode::SHUFFLE_ORDER:
-        s_player->shuffle_vec = soundsphere::_G.media_list;
+        s_player->shuffle_vec = s_player->media_list;
         break;
     case DummyPlayerSetShuffleMode::SHUFFLE_REPEAT:
-        s_player->shuffle_vec->clear();
-        s_player->shuffle_vec->push_back(soundsphere::_G.dummy_player.current_music);
+        /* Never clear in place, it may be the playlist. */
+        s_player->shuffle_vec = std::make_shared<MusicTagPtrVec>();
+        if (s_player->current_music.get() != nullptr)
+        {
+            s_player->shuffle_vec->push_back(s_player->current_music);
+        }
         break;
     case DummyPlayerSetShuffleMode::SHUFFLE_RANDOM:
-        s_player->shuffle_vec = _shuffle_media(soundsphere::_G.media_list);
+        s_player->shuffle_vec = _shuffle_media(s_player->media_list);
         break;
     }
+
+    _dummy_player_preload();
 }
 
 static void _soundsphere_dummy_player_reload(void)
@@ -130,8 +582,15 @@ static void _on_reload_req(soundsphere::Msg::Ptr msg)
  */
 static void _soundsphere_dummy_player_pause(void)
 {
-    Mix_PauseMusic();
-    soundsphere::_G.playbar.is_playing = false;
+    if (!s_player->is_playing)
+    {
+        return;
+    }
+
+    audio_pause(true);
+    ev_timer_stop(&s_player->timer);
+    s_player->is_playing = false;
+    s_player->is_paused = true;
 }
 
 static void _on_pause_req(soundsphere::Msg::Ptr msg)
@@ -140,62 +599,122 @@ static void _on_pause_req(soundsphere::Msg::Ptr msg)
     widget_fast_rsp<DummyPlayerPause>(msg);
 }
 
-static void _play(soundsphere::MusicTagPtr obj)
+static void _soundsphere_dummy_player_next(bool skip);
+
+static void _dummy_player_on_timer(ev_timer_t *timer)
 {
-    soundsphere::_G.dummy_player.current_music = obj;
+    (void)timer;
+
+    /* Track failed to decode, or ended before next one is decoded. */
+    if (s_player->is_playing && s_player->load_task.get() == nullptr && audio_poll().track.get() == nullptr)
+    {
+        _soundsphere_dummy_player_next(false);
+    }
 
-    s_player->music_mix = Mix_LoadMUS(obj->path.c_str());
-    Mix_PlayMusic(s_player->music_mix, 1);
+    _dummy_player_publish();
+}
 
-    soundsphere::_G.playbar.is_playing = true;
-    soundsphere::_G.playbar.music_duration = Mix_MusicDuration(s_player->music_mix);
-    soundsphere::_G.playbar.music_position = 0.0;
+static void _dummy_player_start_timer(void)
+{
+    ev_timer_start(&s_player->timer, _dummy_player_on_timer, DUMMY_PLAYER_POLL_INTERVAL, DUMMY_PLAYER_POLL_INTERVAL);
 }
 
 /**
- * @brief Next music.
+ * @brief Start output of \p track of #dummy_player::current_music, keeping
+ * pause and position asked for while it was loading.
+ * @param[in] track     Track, or nullptr if it failed to load.
+ * @param[in] crossfade Fade out the track being heard.
  */
-static void _soundsphere_dummy_player_next(void)
+static void _dummy_player_start(AudioTrackPtr track, bool crossfade)
 {
-    size_t            idx = 0;
-    MusicTagPtrVecPtr vec = s_player->shuffle_vec;
+    audio_play(track, crossfade);
+    _dummy_player_index(track, s_player->index_task);
+    if (s_player->is_paused)
+    {
+        audio_pause(true);
+    }
 
-    _stop_play();
+    s_player->music_duration = track.get() != nullptr ? track->duration : 0.0;
+    if (track.get() != nullptr && s_player->load_position >= 0.0f)
+    {
+        audio_seek(s_player->music_duration * s_player->load_position);
+    }
+    s_player->load_position = -1.0f;
+    _dummy_player_preload();
+}
 
-    if (vec->empty())
+/**
+ * @brief Play \p obj. It is loaded in worker pool if not given, and what is
+ * heard goes on until it is ready.
+ * @param[in] obj   Music.
+ * @param[in] track     (Optional) Decoded \p obj.
+ * @param[in] crossfade Fade out the track being heard.
+ */
+static void _play(soundsphere::MusicTagPtr obj, AudioTrackPtr track, bool crossfade)
+{
+    s_player->current_music = obj;
+    _dummy_player_cancel_load();
+
+    if (_dummy_player_open_spec(obj))
     {
-        return;
+        track.reset();
     }
 
-    for (; idx < vec->size(); idx++)
+    s_player->is_playing = true;
+    s_player->is_paused = false;
+    _dummy_player_start_timer();
+    if (track.get() != nullptr)
     {
-        MusicTagPtr obj = vec->at(idx);
-        if (obj.get() == soundsphere::_G.dummy_player.current_music.get())
-        {
-            break;
-        }
+        _dummy_player_start(track, crossfade);
+        return;
     }
 
-    if (idx >= vec->size())
+    /* The track queued before must not be spliced in meanwhile. */
+    audio_queue(AudioTrackPtr(), false);
+    s_player->music_duration = obj->info.duration;
+    s_player->load_crossfade = crossfade;
+    s_player->load_seq++;
+    s_player->load_task = std::make_shared<DummyPlayerLoad>(obj, audio_spec(), s_player->load_seq);
+    worker_submit_task(WORKER_PRIORITY_INTERACTIVE, s_player->load_task);
+}
+
+/**
+ * @brief Next music.
+ * @param[in] skip  Requested by user, crossfade from what is playing.
+ */
+static void _soundsphere_dummy_player_next(bool skip)
+{
+    MusicTagPtr   obj = _dummy_player_next_music();
+    AudioTrackPtr queued = audio_poll().queued;
+    bool          crossfade = skip && s_player->is_playing && _dummy_player_crossfade();
+
+    if (obj.get() == nullptr || !crossfade)
     {
-        idx = 0;
+        _stop_play();
     }
     else
     {
-        idx++;
-        if (idx >= vec->size())
-        {
-            idx = 0;
-        }
+        /* Keep output running, it fades out under the next one. */
+        _dummy_player_cancel_preload();
+        ev_timer_stop(&s_player->timer);
+    }
+
+    if (obj.get() == nullptr)
+    {
+        return;
     }
 
-    MusicTagPtr obj = vec->at(idx);
-    _play(obj);
+    /* Reuse the decoded one if any. */
+    if (queued.get() != nullptr && queued->music.get() != obj.get())
+    {
+        queued.reset();
+    }
+    _play(obj, queued, crossfade);
 }
 
 static void _on_next_req(Msg::Ptr msg)
 {
-    _soundsphere_dummy_player_next();
+    _soundsphere_dummy_player_next(true);
     widget_fast_rsp<DummyPlayerNext>(msg);
 }
 
@@ -204,8 +723,7 @@ static void _on_next_req(Msg::Ptr msg)
  */
 static void _soundsphere_dummy_player_set_volume(int volume)
 {
-    int real_volume = (int)(((float)volume / 100.0f) * MIX_MAX_VOLUME);
-    Mix_VolumeMusic(real_volume);
+    audio_set_volume(volume);
 }
 
 static void _on_set_volume_req(Msg::Ptr msg)
@@ -239,9 +757,22 @@ static void _on_set_shuffle_mode(Msg::Ptr msg)
     widget_fast_evt<DummyPlayerSetShuffleMode>(req->mode);
 }
 
+static void _on_set_bit_perfect(Msg::Ptr msg)
+{
+    auto req = msg->get_req<DummyPlayerSetBitPerfect>();
+    s_player->bit_perfect = req->enabled;
+
+    /* The queued track may be in another format now. */
+    _dummy_player_cancel_preload();
+    audio_queue(AudioTrackPtr(), false);
+    _dummy_player_preload();
+
+    widget_fast_rsp<DummyPlayerSetBitPerfect>(msg);
+}
+
 static MusicTagPtr _find_audio(uint64_t id)
 {
-    MusicTagPtrVecPtr vec = soundsphere::_G.media_list;
+    MusicTagPtrVecPtr vec = s_player->media_list;
 
     for (size_t i = 0; i < vec->size(); i++)
     {
@@ -258,26 +789,25 @@ static MusicTagPtr _find_audio(uint64_t id)
 static void _dummy_player_resume_or_play(void)
 {
     /* If we have music paused, we resume the music. */
-    if (s_player->music_mix != NULL)
+    if (s_player->is_paused)
     {
-        if (Mix_PausedMusic())
-        {
-            Mix_ResumeMusic();
-            soundsphere::_G.playbar.is_playing = true;
-            return;
-        }
+        audio_pause(false);
+        s_player->is_playing = true;
+        s_player->is_paused = false;
+        _dummy_player_start_timer();
+        return;
     }
 
     _stop_play();
 
     /* Find the song need to play. s*/
-    MusicTagPtr obj = _find_audio(soundsphere::_G.playlist.selected_id);
+    MusicTagPtr obj = _find_audio(s_player->selected_id);
     if (obj.get() == nullptr)
     {
         return;
     }
 
-    _play(obj);
+    _play(obj, AudioTrackPtr(), false);
 
     if (s_player->shuffle_mode == DummyPlayerSetShuffleMode::SHUFFLE_REPEAT)
     {
@@ -293,8 +823,23 @@ static void _on_resume_or_play(Msg::Ptr msg)
 
 dummy_player::dummy_player()
 {
-    music_mix = NULL;
+    media_list = std::make_shared<MusicTagPtrVec>();
+    shuffle_vec = media_list;
     shuffle_mode = DummyPlayerSetShuffleMode::SHUFFLE_ORDER;
+    is_playing = false;
+    is_paused = false;
+    music_duration = 0.0;
+    selected_id = (uint64_t)-1;
+    advances = 0;
+    bit_perfect = false;
+    buffer_frames = 0;
+    spec_freq = 0;
+    spec_channels = 0;
+    load_seq = 0;
+    load_crossfade = false;
+    load_position = -1.0f;
+    looping = true;
+    synced_size = 0;
 
     req_dispatcher.set_mode(Msg::TYPE_REQ);
     req_dispatcher.register_handle<DummyPlayerReload>(_on_reload_req);
@@ -304,6 +849,226 @@ dummy_player::dummy_player()
     req_dispatcher.register_handle<DummyPlayerSetPosition>(_on_set_position);
     req_dispatcher.register_handle<DummyPlayerSetShuffleMode>(_on_set_shuffle_mode);
     req_dispatcher.register_handle<DummyPlayerResumeOrPlay>(_on_resume_or_play);
+    req_dispatcher.register_handle<DummyPlayerSetBitPerfect>(_on_set_bit_perfect);
+}
+
+/**
+ * @brief Runs in SDL audio thread when a track ends.
+ */
+static void _dummy_player_on_track_end(void)
+{
+    ev_async_wakeup(&s_player->async);
+}
+
+/**
+ * @brief Handle command.
+ * @return true if playback state may be changed.
+ */
+static bool _dummy_player_handle_cmd(dummy_player_cmd_t &cmd)
+{
+    if (cmd.media_list.get() != nullptr)
+    {
+        s_player->media_list = cmd.media_list;
+        if (s_player->shuffle_mode == DummyPlayerSetShuffleMode::SHUFFLE_ORDER)
+        {
+            s_player->shuffle_vec = s_player->media_list;
+            _dummy_player_preload();
+        }
+    }
+
+    /* Drop it if another track is played in the meantime. */
+    bool changed = false;
+    if (cmd.load_seq != 0 && s_player->load_task.get() != nullptr && cmd.load_seq == s_player->load_seq)
+    {
+        s_player->load_task.reset();
+        _dummy_player_start(cmd.loaded, s_player->load_crossfade);
+        changed = true;
+    }
+
+    if (cmd.preload.get() != nullptr)
+    {
+        /* Drop it if play order changed in the meantime. */
+        if (s_player->preload_task.get() != nullptr && cmd.preload->music.get() == s_player->preload_music.get())
+        {
+            s_player->preload_task.reset();
+            audio_queue(cmd.preload, _dummy_player_crossfade());
+            _dummy_player_index(cmd.preload, s_player->preload_index_task);
+        }
+    }
+
+    if (cmd.msg.get() != nullptr)
+    {
+        s_player->selected_id = cmd.selected_id;
+        s_player->req_dispatcher.dispatch(cmd.msg);
+        return true;
+    }
+
+    return changed;
+}
+
+/**
+ * @brief Follow output after a track ends.
+ * @return true if playback state is changed.
+ */
+static bool _dummy_player_sync_audio(void)
+{
+    audio_status_t status = audio_poll();
+    if (status.advances != s_player->advances)
+    {
+        s_player->advances = status.advances;
+        if (status.track.get() != nullptr && s_player->load_task.get() == nullptr)
+        {
+            /* The queued track is spliced in, queue the one after. */
+            s_player->current_music = status.track->music;
+            s_player->music_duration = status.track->duration;
+            s_player->preload_music.reset();
+            s_player->preload_task.reset();
+            _dummy_player_cancel_index(s_player->index_task);
+            s_player->index_task = s_player->preload_index_task;
+            s_player->preload_index_task.reset();
+            _dummy_player_preload();
+            return true;
+        }
+    }
+
+    /* Nothing was queued in time, fall back to decode it now. */
+    if (s_player->is_playing && s_player->load_task.get() == nullptr && status.track.get() == nullptr)
+    {
+        _soundsphere_dummy_player_next(false);
+        return true;
+    }
+
+    return false;
+}
+
+/**
+ * @brief Release player thread resources, so the loop can return.
+ */
+static void _dummy_player_close(void)
+{
+    /* The decoding tasks push into player, wait for them. */
+    WorkerTask::Ptr task = s_player->preload_task;
+    WorkerTask::Ptr load = s_player->load_task;
+    _stop_play();
+    if (task.get() != nullptr)
+    {
+        task->wait();
+    }
+    if (load.get() != nullptr)
+    {
+        load->wait();
+    }
+
+    ev_timer_exit(&s_player->timer, nullptr);
+    ev_async_exit(&s_player->async, nullptr);
+}
+
+static void _dummy_player_on_wakeup(ev_async_t *async)
+{
+    (void)async;
+
+    DummyPlayerCmdQueue cmds;
+    bool                looping;
+    {
+        std::unique_lock<std::mutex> lock(s_player->mutex);
+        cmds.swap(s_player->cmds);
+        looping = s_player->looping;
+    }
+
+    if (!looping)
+    {
+        _dummy_player_close();
+        return;
+    }
+
+    bool changed = false;
+    for (DummyPlayerCmdQueue::iterator it = cmds.begin(); it != cmds.end(); it++)
+    {
+        changed = _dummy_player_handle_cmd(*it) || changed;
+    }
+
+    /* Follow track changes as soon as they happen, regardless of UI. */
+    changed = _dummy_player_sync_audio() || changed;
+
+    if (changed)
+    {
+        _dummy_player_publish();
+    }
+}
+
+static void _dummy_player_thread(void *arg)
+{
+    (void)arg;
+    TRACE_THREAD_NAME("player");
+
+    ev_loop_run(&s_player->loop, EV_LOOP_MODE_DEFAULT);
+}
+
+/**
+ * @brief Queue command into player thread.
+ * @note MT-Safe.
+ */
+static void _dummy_player_push(const dummy_player_cmd_t &cmd)
+{
+    {
+        std::unique_lock<std::mutex> lock(s_player->mutex);
+        s_player->cmds.push_back(cmd);
+    }
+    ev_async_wakeup(&s_player->async);
+}
+
+/**
+ * @brief Send a copy of playlist to player thread if it is replaced or resized.
+ */
+static void _dummy_player_sync_list(void)
+{
+    MusicTagPtrVecPtr media_list = soundsphere::_G.media_list;
+    if (media_list == s_player->synced_list && media_list->size() == s_player->synced_size)
+    {
+        return;
+    }
+    s_player->synced_list = media_list;
+    s_player->synced_size = media_list->size();
+
+    dummy_player_cmd_t cmd;
+    cmd.media_list = std::make_shared<MusicTagPtrVec>(*media_list);
+    cmd.selected_id = soundsphere::_G.playlist.selected_id;
+    _dummy_player_push(cmd);
+}
+
+/**
+ * @brief Copy playback state into #soundsphere::_G.
+ */
+static void _dummy_player_apply_snapshot(void)
+{
+    DummyPlayerSnapshotPtr snapshot = std::atomic_load(&s_player->snapshot);
+    if (snapshot.get() == nullptr)
+    {
+        /* Nothing happened yet. */
+        return;
+    }
+
+    if (snapshot != s_player->applied)
+    {
+        s_player->applied = snapshot;
+        soundsphere::_G.dummy_player.current_music = snapshot->current_music;
+        soundsphere::_G.playbar.is_playing = snapshot->is_playing;
+        soundsphere::_G.playbar.music_duration = snapshot->music_duration;
+        soundsphere::_G.playbar.music_position = snapshot->music_position;
+        soundsphere::_G.dummy_player.output_freq = snapshot->output.freq;
+        soundsphere::_G.dummy_player.output_channels = snapshot->output.channels;
+    }
+
+    if (snapshot->is_playing)
+    {
+        double elapsed = (ev_hrtime() - snapshot->sample_time) / 1000000000.0;
+        double position = snapshot->music_position + elapsed;
+        if (snapshot->music_duration > 0.0 && position > snapshot->music_duration)
+        {
+            position = snapshot->music_duration;
+        }
+        soundsphere::_G.playbar.music_position = position;
+    }
 }
 
 static void _dummy_player_init(void)
@@ -320,22 +1085,52 @@ static void _dummy_player_init(void)
         exit(EXIT_FAILURE);
     }
 
-    ret = Mix_OpenAudio(MIX_DEFAULT_FREQUENCY, MIX_DEFAULT_FORMAT, MIX_DEFAULT_CHANNELS, 2048);
+    s_player->bit_perfect = soundsphere::_config.audio.bit_perfect;
+    s_player->buffer_frames = soundsphere::_config.audio.buffer_frames;
+    s_player->spec_freq = MIX_DEFAULT_FREQUENCY;
+    s_player->spec_channels = MIX_DEFAULT_CHANNELS;
+    ret = Mix_OpenAudio(s_player->spec_freq, MIX_DEFAULT_FORMAT, s_player->spec_channels, s_player->buffer_frames);
     if (ret != 0)
     {
         spdlog::critical("Mix_OpenAudio failed.");
         exit(EXIT_FAILURE);
     }
 
+    s_player->synced_list = soundsphere::_G.media_list;
+    s_player->synced_size = soundsphere::_G.media_list->size();
+    s_player->media_list = std::make_shared<MusicTagPtrVec>(*soundsphere::_G.media_list);
+
+    ev_loop_init(&s_player->loop);
+    ev_async_init(&s_player->loop, &s_player->async, _dummy_player_on_wakeup);
+    ev_timer_init(&s_player->loop, &s_player->timer);
+
+    audio_init(_dummy_player_on_track_end, soundsphere::_config.audio.read_ahead_ms);
     _soundsphere_dummy_player_set_volume(soundsphere::_config.volume);
-    _soundsphere_dummy_player_reload();
+    audio_set_crossfade(soundsphere::_config.audio.crossfade_ms);
+    audio_set_replaygain((audio_replaygain_t)soundsphere::_config.audio.replaygain,
+                         soundsphere::_config.audio.replaygain_preamp_db);
+    menubar_equalizer_apply();
+    _dummy_player_reshuffle();
+
+    if (ev_thread_init(&s_player->thread, nullptr, _dummy_player_thread, nullptr) != 0)
+    {
+        spdlog::critical("start player thread failed.");
+        exit(EXIT_FAILURE);
+    }
 }
 
 static void _dummy_player_exit(void)
 {
     if (s_player != nullptr)
     {
-        _stop_play();
+        {
+            std::unique_lock<std::mutex> lock(s_player->mutex);
+            s_player->looping = false;
+        }
+        ev_async_wakeup(&s_player->async);
+        ev_thread_exit(&s_player->thread, EV_INFINITE_TIMEOUT);
+        ev_loop_exit(&s_player->loop);
+        audio_exit();
 
         delete s_player;
         s_player = nullptr;
@@ -346,19 +1141,23 @@ static void _dummy_player_exit(void)
 
 static void _dummy_player_draw(void)
 {
-    if (soundsphere::_G.playbar.is_playing && !Mix_PlayingMusic())
-    {
-        _soundsphere_dummy_player_next();
-    }
-
-    /* Update music position. */
-    soundsphere::_G.playbar.music_position =
-        (s_player->music_mix != NULL) ? Mix_GetMusicPosition(s_player->music_mix) : 0.0;
+    /* Playback runs in player thread, only pick up its state here. */
+    _dummy_player_sync_list();
+    _dummy_player_apply_snapshot();
 }
 
+/**
+ * @brief Forward request to player thread, with the UI state it depends on.
+ */
 static void _dummy_player_message(Msg::Ptr msg)
 {
-    s_player->req_dispatcher.dispatch(msg);
+    /* Make sure a reload sees the new playlist. */
+    _dummy_player_sync_list();
+
+    dummy_player_cmd_t cmd;
+    cmd.msg = msg;
+    cmd.selected_id = soundsphere::_G.playlist.selected_id;
+    _dummy_player_push(cmd);
 }
 
 const soundsphere::widget_t soundsphere::dummy_player = {
@@ -8,8 +8,6 @@ namespace soundsphere
 
 struct DummyPlayerReload
 {
-    static const uint64_t ID = MAKE_MSGID(WIDGET_ID_DUMMY_PLAYER, __LINE__);
-
     struct Req : public Msg::Req
     {
     };
@@ -21,8 +19,6 @@ struct DummyPlayerReload
 
 struct DummyPlayerPause
 {
-    static const uint64_t ID = MAKE_MSGID(WIDGET_ID_DUMMY_PLAYER, __LINE__);
-
     struct Req : public Msg::Req
     {
     };
@@ -34,8 +30,6 @@ struct DummyPlayerPause
 
 struct DummyPlayerNext
 {
-    static const uint64_t ID = MAKE_MSGID(WIDGET_ID_DUMMY_PLAYER, __LINE__);
-
     struct Req : public Msg::Req
     {
     };
@@ -47,7 +41,7 @@ struct DummyPlayerNext
 
 struct DummyPlayerSetVolume
 {
-    static const uint64_t ID = MAKE_MSGID(WIDGET_ID_DUMMY_PLAYER, __LINE__);
+    static const bool COALESCE = true;
 
     struct Req : public Msg::Req
     {
@@ -62,7 +56,7 @@ struct DummyPlayerSetVolume
 
 struct DummyPlayerSetPosition
 {
-    static const uint64_t ID = MAKE_MSGID(WIDGET_ID_DUMMY_PLAYER, __LINE__);
+    static const bool COALESCE = true;
     struct Req : public Msg::Req
     {
         /**
@@ -84,8 +78,6 @@ struct DummyPlayerSetPosition
 
 struct DummyPlayerSetShuffleMode
 {
-    static const uint64_t ID = MAKE_MSGID(WIDGET_ID_DUMMY_PLAYER, __LINE__);
-
     enum shuffle_mode
     {
         SHUFFLE_ORDER,
@@ -110,6 +102,24 @@ struct DummyPlayerSetShuffleMode
     };
 };
 
+/**
+ * @brief Reopen audio device at the format of each track, takes effect from the next track.
+ */
+struct DummyPlayerSetBitPerfect
+{
+    static const bool COALESCE = true;
+
+    struct Req : public Msg::Req
+    {
+        Req(bool enabled);
+        bool enabled;
+    };
+
+    struct Rsp : public Msg::Rsp
+    {
+    };
+};
+
 /**
  * @brief Play or resume audio.
  * If audio is paused, resume the audio.
@@ -118,8 +128,6 @@ struct DummyPlayerSetShuffleMode
  */
 struct DummyPlayerResumeOrPlay
 {
-    static const uint64_t ID = MAKE_MSGID(WIDGET_ID_DUMMY_PLAYER, __LINE__);
-
     struct Req : public Msg::Req
     {
     };
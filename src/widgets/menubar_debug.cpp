@@ -1,4 +1,10 @@
+#include "audio/__init__.hpp"
+#include "config/__init__.hpp"
 #include "i18n/__init__.h"
+#include "runtime/__init__.hpp"
+#include "utils/path.hpp"
+#include "utils/time.hpp"
+#include "utils/trace.hpp"
 #include "__init__.hpp"
 
 typedef struct debug_ctx
@@ -14,6 +20,11 @@ typedef struct debug_ctx
      * @brief Show imgui demo window.
      */
     bool show_imgui_demo;
+
+    /**
+     * @brief Result of last trace dump.
+     */
+    std::string trace_result;
 } debug_ctx_t;
 
 static debug_ctx_t *s_debug_ctx = nullptr;
@@ -35,6 +46,59 @@ static void _menubar_debug_exit(void)
     s_debug_ctx = nullptr;
 }
 
+static void _menubar_debug_dump_trace(void)
+{
+    std::string path = soundsphere::config_dir() + "/trace-" + std::to_string(soundsphere::clock_time_ms()) + ".json";
+
+    std::string errinfo;
+    int         cnt = soundsphere::trace_dump(path, errinfo);
+    if (cnt < 0)
+    {
+        s_debug_ctx->trace_result = errinfo;
+        return;
+    }
+
+    s_debug_ctx->trace_result = soundsphere::string_format("%d events saved to %s", cnt, path.c_str());
+}
+
+static void _menubar_debug_draw_trace(void)
+{
+    ImGui::SeparatorText("Trace");
+    if (!soundsphere::trace_enabled())
+    {
+        ImGui::TextDisabled("Reconfigure with -DSOUNDSPHERE_ENABLE_TRACE=ON to record trace zones.");
+        return;
+    }
+
+    if (ImGui::Button("Dump Chrome Trace"))
+    {
+        _menubar_debug_dump_trace();
+    }
+    ImGui::SameLine();
+    ImGui::TipMark("Open the file in https://ui.perfetto.dev or chrome://tracing");
+
+    if (!s_debug_ctx->trace_result.empty())
+    {
+        ImGui::TextWrapped("%s", s_debug_ctx->trace_result.c_str());
+    }
+}
+
+static void _menubar_debug_draw_runtime(void)
+{
+    ImGui::SeparatorText("Runtime");
+    ImGui::Text("Pending UI jobs: %zu", soundsphere::runtime_pending_jobs());
+    ImGui::InputDouble("UI job budget (ms)", &soundsphere::_config.ui_job_budget_ms, 0.5, 1.0, "%.1f");
+    if (soundsphere::_config.ui_job_budget_ms < 0)
+    {
+        soundsphere::_config.ui_job_budget_ms = 0;
+    }
+
+    soundsphere::audio_stats_t stats = soundsphere::audio_stats();
+    ImGui::SeparatorText("Audio");
+    ImGui::Text("Buffered: %.0f / %.0f ms", stats.buffered * 1000.0, stats.capacity * 1000.0);
+    ImGui::Text("Underruns: %llu", (unsigned long long)stats.underruns);
+}
+
 static void _menubar_debug_draw(void)
 {
     if (ImGui::BeginMainMenuBar())
@@ -59,6 +123,9 @@ static void _menubar_debug_draw(void)
         {
             ImGui::ShowDemoWindow(&s_debug_ctx->show_imgui_demo);
         }
+
+        _menubar_debug_draw_runtime();
+        _menubar_debug_draw_trace();
     }
     ImGui::End();
 }
@@ -0,0 +1,234 @@
+#include <algorithm>
+#include "audio/__init__.hpp"
+#include "config/__init__.hpp"
+#include "i18n/__init__.h"
+#include "menubar_equalizer.hpp"
+#include "__init__.hpp"
+
+/**
+ * @brief Range of band gain and preamp, in dB.
+ */
+#define EQUALIZER_RANGE_DB 12.0
+
+/**
+ * @brief Range of band frequency, in Hz.
+ * @{
+ */
+#define EQUALIZER_FREQ_MIN 20.0
+#define EQUALIZER_FREQ_MAX 20000.0
+/**
+ * @}
+ */
+
+/**
+ * @brief Range of band quality factor.
+ * @{
+ */
+#define EQUALIZER_Q_MIN 0.1
+#define EQUALIZER_Q_MAX 10.0
+/**
+ * @}
+ */
+
+typedef struct equalizer_ctx
+{
+    equalizer_ctx();
+
+    /**
+     * @brief Show equalizer window.
+     */
+    bool show_window;
+} equalizer_ctx_t;
+
+static equalizer_ctx_t *s_equalizer = nullptr;
+
+equalizer_ctx::equalizer_ctx()
+{
+    show_window = false;
+}
+
+/**
+ * @brief Preset in use, fixing the index if configuration was edited by hand.
+ */
+static soundsphere::config_eq_preset_t &_menubar_equalizer_preset(void)
+{
+    soundsphere::config_eq_t &eq = soundsphere::_config.eq;
+    if (eq.presets.empty())
+    {
+        eq.presets.push_back(soundsphere::config_eq_preset_t());
+        eq.presets[0].name = "Flat";
+    }
+    eq.preset = std::clamp(eq.preset, 0, (int)eq.presets.size() - 1);
+    return eq.presets[eq.preset];
+}
+
+void soundsphere::menubar_equalizer_apply(void)
+{
+    const config_eq_preset_t &preset = _menubar_equalizer_preset();
+
+    /* Bands missing from configuration stay flat. */
+    audio_eq_params_t params;
+    params.preamp_db = (float)std::clamp(preset.preamp_db, -EQUALIZER_RANGE_DB, EQUALIZER_RANGE_DB);
+    for (size_t i = 0; i < AUDIO_EQ_BANDS && i < preset.bands.size(); i++)
+    {
+        const config_eq_band_t &band = preset.bands[i];
+        params.bands[i].freq = (float)std::clamp(band.freq, EQUALIZER_FREQ_MIN, EQUALIZER_FREQ_MAX);
+        params.bands[i].gain_db = (float)std::clamp(band.gain_db, -EQUALIZER_RANGE_DB, EQUALIZER_RANGE_DB);
+        params.bands[i].q = (float)std::clamp(band.q, EQUALIZER_Q_MIN, EQUALIZER_Q_MAX);
+    }
+
+    audio_set_eq(_config.eq.enabled, params);
+}
+
+static void _menubar_equalizer_init(void)
+{
+    s_equalizer = new equalizer_ctx_t;
+}
+
+static void _menubar_equalizer_exit(void)
+{
+    delete s_equalizer;
+    s_equalizer = nullptr;
+}
+
+/**
+ * @brief Preset selector, with buttons to copy and delete the preset in use.
+ * @return Whether preset in use changed.
+ */
+static bool _menubar_equalizer_draw_presets(void)
+{
+    soundsphere::config_eq_t &eq = soundsphere::_config.eq;
+    bool                      changed = false;
+
+    if (ImGui::BeginCombo(_T->preset, _menubar_equalizer_preset().name.c_str()))
+    {
+        for (int i = 0; i < (int)eq.presets.size(); i++)
+        {
+            ImGui::PushID(i);
+            if (ImGui::Selectable(eq.presets[i].name.c_str(), i == eq.preset))
+            {
+                eq.preset = i;
+                changed = true;
+            }
+            ImGui::PopID();
+        }
+        ImGui::EndCombo();
+    }
+
+    ImGui::SameLine();
+    if (ImGui::Button(_T->add))
+    {
+        soundsphere::config_eq_preset_t preset = _menubar_equalizer_preset();
+        preset.name += " *";
+        eq.presets.push_back(preset);
+        eq.preset = (int)eq.presets.size() - 1;
+    }
+
+    ImGui::SameLine();
+    ImGui::BeginDisabled(eq.presets.size() <= 1);
+    if (ImGui::Button(_T->remove))
+    {
+        eq.presets.erase(eq.presets.begin() + eq.preset);
+        eq.preset = std::min(eq.preset, (int)eq.presets.size() - 1);
+        changed = true;
+    }
+    ImGui::EndDisabled();
+
+    ImGui::InputText(_T->name, &_menubar_equalizer_preset().name);
+    return changed;
+}
+
+/**
+ * @brief One column per band: gain slider, then frequency and Q.
+ * @return Whether any band changed.
+ */
+static bool _menubar_equalizer_draw_bands(soundsphere::config_eq_preset_t &preset)
+{
+    const double gain_min = -EQUALIZER_RANGE_DB, gain_max = EQUALIZER_RANGE_DB;
+    const double freq_min = EQUALIZER_FREQ_MIN, freq_max = EQUALIZER_FREQ_MAX;
+    const double q_min = EQUALIZER_Q_MIN, q_max = EQUALIZER_Q_MAX;
+    const int    count = (int)std::min(preset.bands.size(), (size_t)AUDIO_EQ_BANDS);
+    bool         changed = false;
+
+    if (count == 0 || !ImGui::BeginTable("equalizer_bands", count, ImGuiTableFlags_SizingStretchSame))
+    {
+        return false;
+    }
+
+    ImGui::TableNextRow();
+    for (int i = 0; i < count; i++)
+    {
+        soundsphere::config_eq_band_t &band = preset.bands[i];
+        ImGui::TableNextColumn();
+        ImGui::PushID(i);
+
+        float  width = ImGui::GetContentRegionAvail().x;
+        ImVec2 size(width, 160.0f);
+        changed = ImGui::VSliderScalar("##gain", size, ImGuiDataType_Double, &band.gain_db, &gain_min, &gain_max,
+                                       "%+.1f") ||
+                  changed;
+
+        ImGui::SetNextItemWidth(width);
+        changed = ImGui::DragScalar("##freq", ImGuiDataType_Double, &band.freq, (float)(band.freq * 0.01), &freq_min,
+                                    &freq_max, "%.0f Hz", ImGuiSliderFlags_Logarithmic) ||
+                  changed;
+
+        ImGui::SetNextItemWidth(width);
+        changed = ImGui::DragScalar("##q", ImGuiDataType_Double, &band.q, 0.01f, &q_min, &q_max, "Q %.2f") || changed;
+
+        ImGui::PopID();
+    }
+    ImGui::EndTable();
+
+    return changed;
+}
+
+static void _menubar_equalizer_draw_window(void)
+{
+    soundsphere::config_eq_t &eq = soundsphere::_config.eq;
+    bool                      changed = ImGui::Checkbox(_T->enabled, &eq.enabled);
+    changed = _menubar_equalizer_draw_presets() || changed;
+
+    soundsphere::config_eq_preset_t &preset = _menubar_equalizer_preset();
+    const double                     preamp_min = -EQUALIZER_RANGE_DB, preamp_max = EQUALIZER_RANGE_DB;
+    changed = ImGui::SliderScalar(_T->preamp, ImGuiDataType_Double, &preset.preamp_db, &preamp_min, &preamp_max,
+                                  "%+.1f dB") ||
+              changed;
+    changed = _menubar_equalizer_draw_bands(preset) || changed;
+
+    if (changed)
+    {
+        soundsphere::menubar_equalizer_apply();
+    }
+}
+
+static void _menubar_equalizer_draw(void)
+{
+    if (ImGui::BeginMainMenuBar())
+    {
+        if (ImGui::BeginMenu(_T->tools))
+        {
+            ImGui::MenuItem(_T->equalizer, nullptr, &s_equalizer->show_window);
+            ImGui::EndMenu();
+        }
+        ImGui::EndMainMenuBar();
+    }
+    if (!s_equalizer->show_window)
+    {
+        return;
+    }
+
+    ImGui::SetNextWindowSize(ImVec2(640, 320), ImGuiCond_FirstUseEver);
+    if (ImGui::Begin(_T->equalizer, &s_equalizer->show_window))
+    {
+        _menubar_equalizer_draw_window();
+    }
+    ImGui::End();
+}
+
+const soundsphere::widget_t soundsphere::menubar_equalizer = {
+    _menubar_equalizer_init,
+    _menubar_equalizer_exit,
+    _menubar_equalizer_draw,
+    nullptr,
+};
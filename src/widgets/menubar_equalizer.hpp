@@ -0,0 +1,15 @@
+#ifndef SOUND_SPHERE_WIDGETS_MENUBAR_EQUALIZER_HPP
+#define SOUND_SPHERE_WIDGETS_MENUBAR_EQUALIZER_HPP
+
+namespace soundsphere
+{
+
+/**
+ * @brief Send equalizer configuration to audio output.
+ * @note Must be called in UI thread, after audio is initialized.
+ */
+void menubar_equalizer_apply(void);
+
+} // namespace soundsphere
+
+#endif
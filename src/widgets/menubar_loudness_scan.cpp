@@ -0,0 +1,305 @@
+#include <ev.h>
+#include <vector>
+#include "audio/decoder.hpp"
+#include "audio/loudness_cache.hpp"
+#include "audio/peaks_cache.hpp"
+#include "i18n/__init__.h"
+#include "runtime/__init__.hpp"
+#include "runtime/worker.hpp"
+#include "utils/string.hpp"
+#include "__init__.hpp"
+
+/**
+ * @brief Frames decoded at a time by a scan.
+ */
+#define LOUDNESS_SCAN_BLOCK 16384
+
+typedef struct loudness_scan_result
+{
+    loudness_scan_result();
+
+    bool     success; /**< Loudness is known. */
+    bool     cached;  /**< Found in loudness cache, not scanned. */
+    uint64_t busy;    /**< Time spent in worker, in nanoseconds. */
+} loudness_scan_result_t;
+
+typedef std::vector<soundsphere::WorkerTask::Ptr> LoudnessScanTaskVec;
+
+typedef struct loudness_scan_ctx
+{
+    loudness_scan_ctx();
+
+    /**
+     * @brief Show scan window.
+     */
+    bool show_window;
+
+    /**
+     * @brief Tasks of current job, one per track.
+     */
+    LoudnessScanTaskVec tasks;
+
+    size_t   total;    /**< Tracks in current job. */
+    size_t   finished; /**< Tracks done. */
+    size_t   cached;   /**< Tracks found in cache. */
+    size_t   failed;   /**< Tracks failed to decode or measure. */
+    size_t   scanned;  /**< Tracks measured. */
+    uint64_t busy;     /**< Sum of time spent in workers, in nanoseconds. */
+    uint64_t t_beg;    /**< Start time of job. */
+    uint64_t t_end;    /**< End time of job, or 0 if running. */
+} loudness_scan_ctx_t;
+
+static loudness_scan_ctx_t *s_loudness_scan = nullptr;
+
+loudness_scan_result::loudness_scan_result()
+{
+    success = false;
+    cached = false;
+    busy = 0;
+}
+
+loudness_scan_ctx::loudness_scan_ctx()
+{
+    show_window = false;
+    total = 0;
+    finished = 0;
+    cached = 0;
+    failed = 0;
+    scanned = 0;
+    busy = 0;
+    t_beg = 0;
+    t_end = 0;
+}
+
+static void _menubar_loudness_scan_init(void)
+{
+    s_loudness_scan = new loudness_scan_ctx_t;
+}
+
+static void _menubar_loudness_scan_cancel(void)
+{
+    for (LoudnessScanTaskVec::iterator it = s_loudness_scan->tasks.begin(); it != s_loudness_scan->tasks.end(); it++)
+    {
+        (*it)->cancel();
+    }
+    s_loudness_scan->tasks.clear();
+}
+
+static void _menubar_loudness_scan_exit(void)
+{
+    _menubar_loudness_scan_cancel();
+
+    delete s_loudness_scan;
+    s_loudness_scan = nullptr;
+}
+
+/**
+ * @brief Decode and measure \p music, and build its waveform peaks from the
+ * same PCM. Called in worker thread.
+ *
+ * The track is decoded block by block in its own format, so memory does not
+ * grow with its length and a cancel takes effect within a block.
+ */
+static loudness_scan_result_t _menubar_loudness_scan_run(soundsphere::WorkerTask &task,
+                                                         soundsphere::MusicTagPtr music)
+{
+    loudness_scan_result_t result;
+    uint64_t               t_beg = ev_hrtime();
+
+    soundsphere::audio_loudness_t track_loudness, album_loudness;
+
+    /* Track is decoded anyway if loudness is missing, peak cache is not read then. */
+    bool has_loudness = soundsphere::loudness_cache_get(*music, track_loudness, album_loudness);
+    bool has_peaks = has_loudness && soundsphere::peaks_cache_get(*music).get() != nullptr;
+    if (has_loudness && has_peaks)
+    {
+        result.success = true;
+        result.cached = true;
+        result.busy = ev_hrtime() - t_beg;
+        return result;
+    }
+
+    soundsphere::audio_decoder_t *dec =
+        task.cancelled() ? nullptr : soundsphere::audio_decoder_open(music->path, music->info.format, 0, 0);
+    if (dec == nullptr)
+    {
+        return result;
+    }
+
+    int                                 channels = soundsphere::audio_decoder_channels(dec);
+    soundsphere::audio_loudness_meter_t meter(channels, soundsphere::audio_decoder_freq(dec));
+    soundsphere::audio_peaks_t          peaks;
+    std::vector<int16_t>                pcm((size_t)LOUDNESS_SCAN_BLOCK * channels);
+    size_t                              frames = LOUDNESS_SCAN_BLOCK;
+    while (frames == LOUDNESS_SCAN_BLOCK && !task.cancelled())
+    {
+        frames = soundsphere::audio_decoder_read(dec, pcm.data(), LOUDNESS_SCAN_BLOCK);
+        if (!has_peaks)
+        {
+            soundsphere::audio_peaks_feed(peaks, pcm.data(), frames, channels);
+        }
+        if (!has_loudness)
+        {
+            soundsphere::audio_loudness_feed(meter, pcm.data(), frames);
+        }
+    }
+    soundsphere::audio_decoder_close(dec);
+
+    if (!task.cancelled())
+    {
+        if (!has_peaks)
+        {
+            soundsphere::audio_peaks_finish(peaks);
+            soundsphere::peaks_cache_put(*music, peaks);
+        }
+
+        if (has_loudness)
+        {
+            result.success = true;
+        }
+        else if (soundsphere::audio_loudness_finish(meter, track_loudness))
+        {
+            soundsphere::loudness_cache_put(*music, track_loudness);
+            result.success = true;
+        }
+    }
+
+    result.busy = ev_hrtime() - t_beg;
+    return result;
+}
+
+/**
+ * @brief Write loudness cache in worker pool.
+ * Not cancelled with the scan, so results are never lost.
+ */
+static void _menubar_loudness_scan_save(void)
+{
+    soundsphere::worker_submit<bool>(soundsphere::WORKER_PRIORITY_BACKGROUND, [](soundsphere::WorkerTask &) {
+        soundsphere::loudness_cache_save();
+        return true;
+    });
+}
+
+static void _menubar_loudness_scan_done(loudness_scan_result_t &result)
+{
+    s_loudness_scan->finished++;
+    s_loudness_scan->busy += result.busy;
+    if (!result.success)
+    {
+        s_loudness_scan->failed++;
+    }
+    else if (result.cached)
+    {
+        s_loudness_scan->cached++;
+    }
+    else
+    {
+        s_loudness_scan->scanned++;
+    }
+
+    if (s_loudness_scan->finished == s_loudness_scan->total)
+    {
+        s_loudness_scan->t_end = ev_hrtime();
+        s_loudness_scan->tasks.clear();
+        _menubar_loudness_scan_save();
+    }
+}
+
+static void _menubar_loudness_scan_start(void)
+{
+    _menubar_loudness_scan_cancel();
+
+    soundsphere::MusicTagPtrVecPtr media_list = soundsphere::_G.media_list;
+    s_loudness_scan->total = media_list->size();
+    s_loudness_scan->finished = 0;
+    s_loudness_scan->cached = 0;
+    s_loudness_scan->failed = 0;
+    s_loudness_scan->scanned = 0;
+    s_loudness_scan->busy = 0;
+    s_loudness_scan->t_beg = ev_hrtime();
+    s_loudness_scan->t_end = s_loudness_scan->total == 0 ? s_loudness_scan->t_beg : 0;
+
+    /* Every worker decodes its own track, background priority keeps UI jobs ahead. */
+    for (auto it = media_list->begin(); it != media_list->end(); it++)
+    {
+        soundsphere::MusicTagPtr music = *it;
+        soundsphere::WorkerTask::Ptr task = soundsphere::worker_submit<loudness_scan_result_t>(
+            soundsphere::WORKER_PRIORITY_BACKGROUND,
+            [music](soundsphere::WorkerTask &self) { return _menubar_loudness_scan_run(self, music); },
+            _menubar_loudness_scan_done);
+        s_loudness_scan->tasks.push_back(task);
+    }
+}
+
+static void _menubar_loudness_scan_stop(void)
+{
+    _menubar_loudness_scan_cancel();
+    s_loudness_scan->t_end = ev_hrtime();
+    _menubar_loudness_scan_save();
+}
+
+static void _menubar_loudness_scan_draw_window(void)
+{
+    bool running = s_loudness_scan->t_beg != 0 && s_loudness_scan->t_end == 0;
+    if (running)
+    {
+        if (ImGui::Button(_T->stop))
+        {
+            _menubar_loudness_scan_stop();
+        }
+    }
+    else if (ImGui::Button(_T->start))
+    {
+        _menubar_loudness_scan_start();
+    }
+
+    if (s_loudness_scan->t_beg == 0)
+    {
+        return;
+    }
+
+    size_t      total = s_loudness_scan->total;
+    size_t      finished = s_loudness_scan->finished;
+    float       fraction = total != 0 ? (float)finished / (float)total : 1.0f;
+    std::string overlay = soundsphere::string_format("%zu / %zu", finished, total);
+    ImGui::ProgressBar(fraction, ImVec2(320, 0), overlay.c_str());
+
+    ImGui::Text("%s: %zu    %s: %zu", _T->cached, s_loudness_scan->cached, _T->failed, s_loudness_scan->failed);
+
+    /* Cached tracks are not counted in speed, they would hide decode cost. */
+    uint64_t now = running ? ev_hrtime() : s_loudness_scan->t_end;
+    double   wall = (double)(now - s_loudness_scan->t_beg) / 1e9;
+    double   speed = wall > 0 ? (double)s_loudness_scan->scanned / wall : 0.0;
+    double   cpu = wall > 0 ? (double)s_loudness_scan->busy / 1e9 / wall * 100.0 : 0.0;
+    ImGui::TextDisabled("%.1f %s    CPU: %.0f%%", speed, _T->tracks_per_second, cpu);
+}
+
+static void _menubar_loudness_scan_draw(void)
+{
+    if (ImGui::BeginMainMenuBar())
+    {
+        if (ImGui::BeginMenu(_T->tools))
+        {
+            ImGui::MenuItem(_T->scan_loudness, nullptr, &s_loudness_scan->show_window);
+            ImGui::EndMenu();
+        }
+        ImGui::EndMainMenuBar();
+    }
+    if (!s_loudness_scan->show_window)
+    {
+        return;
+    }
+
+    if (ImGui::Begin(_T->scan_loudness, &s_loudness_scan->show_window, ImGuiWindowFlags_AlwaysAutoResize))
+    {
+        _menubar_loudness_scan_draw_window();
+    }
+    ImGui::End();
+}
+
+const soundsphere::widget_t soundsphere::menubar_loudness_scan = {
+    _menubar_loudness_scan_init,
+    _menubar_loudness_scan_exit,
+    _menubar_loudness_scan_draw,
+    nullptr,
+};
@@ -0,0 +1,235 @@
+#include <spdlog/spdlog.h>
+#include <map>
+#include "config/__init__.hpp"
+#include "i18n/__init__.h"
+#include "runtime/__init__.hpp"
+#include "runtime/worker.hpp"
+#include "utils/lyric_fetch.hpp"
+#include "utils/music_tag.hpp"
+#include "__init__.hpp"
+
+typedef std::map<uint64_t, soundsphere::MusicTagPtr> LyricFetchTrackMap;
+
+typedef struct lyric_fetch_ctx
+{
+    lyric_fetch_ctx();
+
+    /**
+     * @brief Show fetch window.
+     */
+    bool show_window;
+
+    /**
+     * @brief Write fetched lyric into file tags.
+     */
+    bool write_tags;
+
+    /**
+     * @brief Running or last fetch job.
+     */
+    soundsphere::LyricFetcher::Ptr fetcher;
+
+    /**
+     * @brief Tracks of current job, by path hash.
+     */
+    LyricFetchTrackMap tracks;
+
+    /**
+     * @brief Last error of current job.
+     */
+    std::string last_error;
+} lyric_fetch_ctx_t;
+
+static lyric_fetch_ctx_t *s_lyric_fetch = nullptr;
+
+lyric_fetch_ctx::lyric_fetch_ctx()
+{
+    show_window = false;
+    write_tags = false;
+}
+
+static void _menubar_lyric_fetch_init(void)
+{
+    s_lyric_fetch = new lyric_fetch_ctx_t;
+}
+
+static void _menubar_lyric_fetch_exit(void)
+{
+    /* Wait for fetch thread before results stop being handled. */
+    s_lyric_fetch->fetcher.reset();
+
+    delete s_lyric_fetch;
+    s_lyric_fetch = nullptr;
+}
+
+/**
+ * @brief Write a snapshot of \p tags in worker pool.
+ * Not cancelled on exit, so a write is never lost.
+ */
+static void _menubar_lyric_fetch_write_tag(soundsphere::MusicTagPtr tags)
+{
+    soundsphere::MusicTagPtr snapshot = std::make_shared<soundsphere::music_tags_t>(*tags);
+    soundsphere::worker_submit<std::string>(
+        soundsphere::WORKER_PRIORITY_BACKGROUND,
+        [snapshot](soundsphere::WorkerTask &) {
+            std::string errinfo;
+            soundsphere::music_write_tag(*snapshot, errinfo);
+            return errinfo;
+        },
+        [snapshot](std::string &errinfo) {
+            if (errinfo.empty())
+            {
+                return;
+            }
+            spdlog::error("write tag to {} failed: {}", snapshot->path, errinfo);
+            if (s_lyric_fetch != nullptr)
+            {
+                s_lyric_fetch->last_error = errinfo;
+            }
+        });
+}
+
+static void _menubar_lyric_fetch_on_result_ui(soundsphere::LyricFetchResultPtr result)
+{
+    if (s_lyric_fetch == nullptr)
+    {
+        return;
+    }
+
+    if (!result->success)
+    {
+        s_lyric_fetch->last_error = result->errinfo;
+        return;
+    }
+
+    LyricFetchTrackMap::iterator it = s_lyric_fetch->tracks.find(result->path_hash);
+    if (it == s_lyric_fetch->tracks.end())
+    {
+        return;
+    }
+
+    soundsphere::MusicTagPtr tags = it->second;
+    s_lyric_fetch->tracks.erase(it);
+    if (!tags->info.lyric.empty())
+    {
+        /* Filled by user in the meantime. */
+        return;
+    }
+
+    tags->info.lyric = result->lyric;
+    if (s_lyric_fetch->write_tags)
+    {
+        _menubar_lyric_fetch_write_tag(tags);
+    }
+}
+
+static void _menubar_lyric_fetch_on_result(soundsphere::LyricFetchResultPtr result)
+{
+    soundsphere::runtime_call_in_ui<soundsphere::lyric_fetch_result_t>(_menubar_lyric_fetch_on_result_ui, result,
+                                                                       soundsphere::RUNTIME_LANE_BULK);
+}
+
+static void _menubar_lyric_fetch_start(void)
+{
+    soundsphere::LyricFetchItemVec items;
+    s_lyric_fetch->tracks.clear();
+    s_lyric_fetch->last_error.clear();
+
+    soundsphere::MusicTagPtrVecPtr media_list = soundsphere::_G.media_list;
+    for (auto it = media_list->begin(); it != media_list->end(); it++)
+    {
+        soundsphere::MusicTagPtr tags = *it;
+        if (!tags->info.lyric.empty() || !tags->lyric_path.empty() || tags->info.title.empty())
+        {
+            continue;
+        }
+        if (!s_lyric_fetch->tracks.insert(std::make_pair(tags->path_hash, tags)).second)
+        {
+            continue;
+        }
+
+        soundsphere::lyric_fetch_item_t item;
+        item.path_hash = tags->path_hash;
+        item.artist = tags->info.artist;
+        item.title = tags->info.title;
+        item.duration = tags->info.duration;
+        items.push_back(item);
+    }
+
+    soundsphere::lyric_fetch_opt_t opt;
+    opt.max_host_connections = soundsphere::_config.lyric.fetch_connections;
+    opt.rate_limit = soundsphere::_config.lyric.fetch_rate_limit;
+
+    /* Release previous job before starting a new one. */
+    s_lyric_fetch->fetcher.reset();
+    s_lyric_fetch->fetcher = std::make_shared<soundsphere::LyricFetcher>(items, opt, _menubar_lyric_fetch_on_result);
+}
+
+static void _menubar_lyric_fetch_draw_window(void)
+{
+    soundsphere::LyricFetcher::Ptr fetcher = s_lyric_fetch->fetcher;
+    bool                           running = fetcher.get() != nullptr && !fetcher->finished();
+
+    if (running)
+    {
+        if (ImGui::Button(_T->stop))
+        {
+            fetcher->stop();
+        }
+    }
+    else
+    {
+        ImGui::Checkbox(_T->write_to_file, &s_lyric_fetch->write_tags);
+        if (ImGui::Button(_T->start))
+        {
+            _menubar_lyric_fetch_start();
+        }
+    }
+
+    if (fetcher.get() == nullptr)
+    {
+        return;
+    }
+
+    soundsphere::lyric_fetch_progress_t progress = fetcher->progress();
+    float fraction = progress.total != 0 ? (float)progress.finished / (float)progress.total : 1.0f;
+    std::string overlay = soundsphere::string_format("%zu / %zu", progress.finished, progress.total);
+    ImGui::ProgressBar(fraction, ImVec2(320, 0), overlay.c_str());
+
+    ImGui::Text("%s: %zu    %s: %zu", _T->cached, progress.cached, _T->failed, progress.failed);
+    ImGui::TextDisabled("HTTP: %zu (+%zu)", progress.requests, progress.retries);
+    if (!s_lyric_fetch->last_error.empty())
+    {
+        ImGui::TextDisabled("%s", s_lyric_fetch->last_error.c_str());
+    }
+}
+
+static void _menubar_lyric_fetch_draw(void)
+{
+    if (ImGui::BeginMainMenuBar())
+    {
+        if (ImGui::BeginMenu(_T->tools))
+        {
+            ImGui::MenuItem(_T->fetch_lyrics, nullptr, &s_lyric_fetch->show_window);
+            ImGui::EndMenu();
+        }
+        ImGui::EndMainMenuBar();
+    }
+    if (!s_lyric_fetch->show_window)
+    {
+        return;
+    }
+
+    if (ImGui::Begin(_T->fetch_lyrics, &s_lyric_fetch->show_window, ImGuiWindowFlags_AlwaysAutoResize))
+    {
+        _menubar_lyric_fetch_draw_window();
+    }
+    ImGui::End();
+}
+
+const soundsphere::widget_t soundsphere::menubar_lyric_fetch = {
+    _menubar_lyric_fetch_init,
+    _menubar_lyric_fetch_exit,
+    _menubar_lyric_fetch_draw,
+    nullptr,
+};
@@ -1,22 +1,35 @@
-#include <ev.h>
 #include <string>
+#include <vector>
 #include "i18n/__init__.h"
 #include "runtime/__init__.hpp"
+#include "runtime/worker.hpp"
 #include "utils/binary.hpp"
 #include "utils/explorer.hpp"
 #include "utils/string.hpp"
+#include "utils/trace.hpp"
 #include "__init__.hpp"
 #include "ui_filter.hpp"
 #include "dummy_player.hpp"
 
 using namespace soundsphere;
 
+typedef WorkerFuture<StringVec> OpenDialogTask;
+typedef std::vector<WorkerTask::Ptr> WorkerTaskVec;
+
 typedef struct menubar_open_ctx
 {
     menubar_open_ctx();
     virtual ~menubar_open_ctx();
 
-    ev_os_thread_t open_thread;
+    /**
+     * @brief File dialog, only one is shown at a time.
+     */
+    OpenDialogTask::Ptr dialog_task;
+
+    /**
+     * @brief Imports that scan folder and read tags, several can run at once.
+     */
+    WorkerTaskVec import_tasks;
 } menubar_open_ctx_t;
 
 static menubar_open_ctx_t *s_menubar_open_ctx = nullptr;
@@ -27,15 +40,17 @@ static const char *s_filters[] = {
 
 menubar_open_ctx::menubar_open_ctx()
 {
-    open_thread = EV_OS_THREAD_INVALID;
 }
 
 menubar_open_ctx::~menubar_open_ctx()
 {
-    if (open_thread != EV_OS_THREAD_INVALID)
+    if (dialog_task.get() != nullptr)
+    {
+        dialog_task->cancel();
+    }
+    for (WorkerTaskVec::iterator it = import_tasks.begin(); it != import_tasks.end(); it++)
     {
-        ev_thread_exit(&open_thread, EV_INFINITE_TIMEOUT);
-        open_thread = EV_OS_THREAD_INVALID;
+        (*it)->cancel();
     }
 }
 
@@ -61,79 +76,122 @@ static void _handle_open_files_on_ui(soundsphere::MusicTagPtrVecPtr vec)
     widget_fast_req<DummyPlayerReload>(WIDGET_ID_DUMMY_PLAYER);
 }
 
-static void _handle_open_files(const soundsphere::StringVec &paths)
-{
-    soundsphere::MusicTagPtrVecPtr vec = soundsphere::music_read_tag_v(paths);
-    soundsphere::runtime_call_in_ui<soundsphere::MusicTagPtrVec>(_handle_open_files_on_ui, vec);
-}
-
-static void _start_open_files_thread(void *arg)
+static void _handle_add_files_on_ui(MusicTagPtrVecPtr vec)
 {
-    (void)arg;
+    MusicTagPtrVecPtr songs = soundsphere::_G.media_list;
+    songs->insert(songs->end(), vec->begin(), vec->end());
 
-    soundsphere::StringVec paths;
-    if (!soundsphere::explorer_open_files(paths, s_filters, IM_ARRAYSIZE(s_filters)))
-    {
-        return;
-    }
+    soundsphere::remove_duplicate<MusicTagPtr, uint64_t>(*songs.get(),
+                                                         [](const MusicTagPtr &p) { return p->path_hash; });
 
-    _handle_open_files(paths);
+    widget_fast_req<UiFilterReset>(WIDGET_ID_UI_FILTER);
 }
 
-static void _start_open_folder_thread(void *arg)
+/**
+ * @brief Show file dialog.
+ * @return Selected files, or the selected folder.
+ */
+static StringVec _menubar_open_dialog(bool folder)
 {
-    (void)arg;
+    StringVec paths;
+    if (!folder)
+    {
+        explorer_open_files(paths, s_filters, IM_ARRAYSIZE(s_filters));
+        return paths;
+    }
 
     std::string path;
-    if (!soundsphere::explorer_open_folder(path))
+    if (explorer_open_folder(path))
     {
-        return;
+        paths.push_back(path);
     }
-
-    soundsphere::StringVec paths = soundsphere::explorer_scan_folder(path, s_filters, IM_ARRAYSIZE(s_filters));
-    _handle_open_files(paths);
+    return paths;
 }
 
-static void _handle_add_files_on_ui(MusicTagPtrVecPtr vec)
+/**
+ * @brief Scan folder and read tags, stop early if \p task is cancelled.
+ */
+static MusicTagPtrVecPtr _menubar_open_import(WorkerTask &task, bool folder, const StringVec &paths)
 {
-    MusicTagPtrVecPtr songs = soundsphere::_G.media_list;
-    songs->insert(songs->end(), vec->begin(), vec->end());
+    StringVec files;
+    if (folder)
+    {
+        TRACE_ZONE("explorer_scan_folder");
+        files = explorer_scan_folder(paths[0], s_filters, IM_ARRAYSIZE(s_filters));
+    }
+    else
+    {
+        files = paths;
+    }
 
-    soundsphere::remove_duplicate<MusicTagPtr, uint64_t>(*songs.get(),
-                                                         [](const MusicTagPtr &p) { return p->path_hash; });
+    TRACE_ZONE("music_read_tag_v");
+    MusicTagPtrVecPtr vec = std::make_shared<MusicTagPtrVec>();
+    for (size_t i = 0; i < files.size() && !task.cancelled(); i++)
+    {
+        MusicTagPtr obj = std::make_shared<music_tags_t>();
+        obj->path = files[i];
 
-    widget_fast_req<UiFilterReset>(WIDGET_ID_UI_FILTER);
-}
+        music_read_tag(*obj);
+        vec->push_back(obj);
+    }
 
-static void _handle_add_files(const StringVec &paths)
-{
-    MusicTagPtrVecPtr vec = music_read_tag_v(paths);
-    runtime_call_in_ui<MusicTagPtrVec>(_handle_add_files_on_ui, vec);
+    return vec;
 }
 
-static void _start_add_file_thread(void *arg)
+static void _menubar_open_start_import(bool folder, bool replace, const StringVec &paths)
 {
-    (void)arg;
-    StringVec paths;
-    if (!explorer_open_files(paths, s_filters, IM_ARRAYSIZE(s_filters)))
+    if (paths.empty())
     {
         return;
     }
-    _handle_add_files(paths);
+
+    /* A new playlist replaces whatever earlier imports would produce. */
+    if (replace)
+    {
+        WorkerTaskVec::iterator it = s_menubar_open_ctx->import_tasks.begin();
+        for (; it != s_menubar_open_ctx->import_tasks.end(); it++)
+        {
+            (*it)->cancel();
+        }
+        s_menubar_open_ctx->import_tasks.clear();
+    }
+
+    WorkerTask::Ptr task = worker_submit<MusicTagPtrVecPtr>(
+        WORKER_PRIORITY_BACKGROUND,
+        [folder, paths](WorkerTask &token) { return _menubar_open_import(token, folder, paths); },
+        [replace](MusicTagPtrVecPtr &vec) {
+            if (replace)
+            {
+                _handle_open_files_on_ui(vec);
+            }
+            else
+            {
+                _handle_add_files_on_ui(vec);
+            }
+        });
+    s_menubar_open_ctx->import_tasks.push_back(task);
 }
 
-static void _start_add_folder_thread(void *arg)
+static void _menubar_open_start(bool folder, bool replace)
 {
-    (void)arg;
+    s_menubar_open_ctx->dialog_task = worker_submit<StringVec>(
+        WORKER_PRIORITY_INTERACTIVE, [folder](WorkerTask &) { return _menubar_open_dialog(folder); },
+        [folder, replace](StringVec &paths) { _menubar_open_start_import(folder, replace, paths); });
+}
 
-    std::string path;
-    if (!soundsphere::explorer_open_folder(path))
+/**
+ * @brief Forget finished imports.
+ */
+static void _menubar_open_reap(void)
+{
+    WorkerTaskVec &tasks = s_menubar_open_ctx->import_tasks;
+    for (size_t i = tasks.size(); i > 0; i--)
     {
-        return;
+        if (tasks[i - 1]->finished())
+        {
+            tasks.erase(tasks.begin() + (i - 1));
+        }
     }
-
-    soundsphere::StringVec paths = soundsphere::explorer_scan_folder(path, s_filters, IM_ARRAYSIZE(s_filters));
-    _handle_add_files(paths);
 }
 
 static void _menubar_open_draw(void)
@@ -142,22 +200,23 @@ static void _menubar_open_draw(void)
     {
         if (ImGui::BeginMenu(_T->file))
         {
-            bool enabled = (s_menubar_open_ctx->open_thread == EV_OS_THREAD_INVALID);
+            OpenDialogTask::Ptr dialog = s_menubar_open_ctx->dialog_task;
+            bool                enabled = dialog.get() == nullptr || dialog->finished();
             if (ImGui::MenuItem(_T->open, nullptr, nullptr, enabled))
             {
-                ev_thread_init(&s_menubar_open_ctx->open_thread, NULL, _start_open_files_thread, NULL);
+                _menubar_open_start(false, true);
             }
             if (ImGui::MenuItem(_T->open_folder, nullptr, nullptr, enabled))
             {
-                ev_thread_init(&s_menubar_open_ctx->open_thread, NULL, _start_open_folder_thread, NULL);
+                _menubar_open_start(true, true);
             }
             if (ImGui::MenuItem(_T->add, nullptr, nullptr, enabled))
             {
-                ev_thread_init(&s_menubar_open_ctx->open_thread, nullptr, _start_add_file_thread, nullptr);
+                _menubar_open_start(false, false);
             }
             if (ImGui::MenuItem(_T->add_folder, nullptr, nullptr, enabled))
             {
-                ev_thread_init(&s_menubar_open_ctx->open_thread, nullptr, _start_add_folder_thread, nullptr);
+                _menubar_open_start(true, false);
             }
             ImGui::EndMenu();
         }
@@ -165,12 +224,9 @@ static void _menubar_open_draw(void)
         ImGui::EndMainMenuBar();
     }
 
-    if (s_menubar_open_ctx->open_thread != EV_OS_THREAD_INVALID)
+    if (!s_menubar_open_ctx->import_tasks.empty())
     {
-        if (ev_thread_exit(&s_menubar_open_ctx->open_thread, 0) == 0)
-        {
-            s_menubar_open_ctx->open_thread = EV_OS_THREAD_INVALID;
-        }
+        _menubar_open_reap();
     }
 }
 
@@ -1,7 +1,9 @@
 #include <imgui.h>
+#include "audio/__init__.hpp"
 #include "config/__init__.hpp"
 #include "i18n/__init__.h"
 #include "runtime/__init__.hpp"
+#include "dummy_player.hpp"
 #include "__init__.hpp"
 
 typedef struct preference_tab
@@ -96,6 +98,54 @@ static void _widget_preference_draw_lyric(void)
     _widget_preferences_draw_lyric_color();
 }
 
+///////////////////////////////////////////////////////////////////////////////
+// Preference tab: Audio
+///////////////////////////////////////////////////////////////////////////////
+
+static void _widget_preferences_draw_audio_crossfade(void)
+{
+    float       seconds = soundsphere::_config.audio.crossfade_ms / 1000.0f;
+    const char *label = _T->crossfade;
+    if (ImGui::SliderFloat(label, &seconds, 0.0f, 12.0f, "%.1f"))
+    {
+        soundsphere::_config.audio.crossfade_ms = (int)(seconds * 1000.0f);
+        soundsphere::audio_set_crossfade(soundsphere::_config.audio.crossfade_ms);
+    }
+}
+
+static void _widget_preferences_draw_audio_replaygain(void)
+{
+    const char *items[] = { _T->off, _T->track, _T->album };
+    int        *mode = &soundsphere::_config.audio.replaygain;
+    double     *preamp = &soundsphere::_config.audio.replaygain_preamp_db;
+
+    bool changed = ImGui::Combo(_T->replaygain, mode, items, IM_ARRAYSIZE(items));
+    changed = ImGui::InputDouble(_T->preamp, preamp, 0.5, 1.0, "%.1f") || changed;
+    if (changed)
+    {
+        soundsphere::audio_set_replaygain((soundsphere::audio_replaygain_t)*mode, *preamp);
+    }
+}
+
+static void _widget_preferences_draw_audio_bit_perfect(void)
+{
+    bool *bit_perfect = &soundsphere::_config.audio.bit_perfect;
+    if (ImGui::Checkbox(_T->bit_perfect, bit_perfect))
+    {
+        soundsphere::widget_fast_req<soundsphere::DummyPlayerSetBitPerfect>(soundsphere::WIDGET_ID_DUMMY_PLAYER,
+                                                                            *bit_perfect);
+    }
+    ImGui::SameLine();
+    ImGui::TipMark(_T->tip_bit_perfect);
+}
+
+static void _widget_preference_draw_audio(void)
+{
+    _widget_preferences_draw_audio_crossfade();
+    _widget_preferences_draw_audio_replaygain();
+    _widget_preferences_draw_audio_bit_perfect();
+}
+
 preferences_ctx::preferences_ctx()
 {
     show_window = false;
@@ -135,6 +185,7 @@ static void _widget_preferences_draw(void)
     const preference_tab_t tabs[] = {
         { _T->generic, _widget_preference_draw_generic },
         { _T->lyric,   _widget_preference_draw_lyric   },
+        { _T->audio,   _widget_preference_draw_audio   },
     };
 
     /* Show window. */
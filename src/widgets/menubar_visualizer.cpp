@@ -0,0 +1,238 @@
+#include <algorithm>
+#include <vector>
+#include "audio/__init__.hpp"
+#include "audio/spectrum.hpp"
+#include "i18n/__init__.h"
+#include "runtime/__init__.hpp"
+#include "runtime/worker.hpp"
+#include "utils/time.hpp"
+#include "__init__.hpp"
+
+/**
+ * @brief Samples per analysis, about 46 ms at 44.1 kHz.
+ */
+#define VISUALIZER_FFT_SIZE 2048
+
+/**
+ * @brief Number of spectrum bars.
+ */
+#define VISUALIZER_BANDS 48
+
+/**
+ * @brief Minimum time between two analyses, in milliseconds, so at most 50 Hz.
+ */
+#define VISUALIZER_INTERVAL_MS 20
+
+/**
+ * @brief Level range shown, in dBFS.
+ */
+#define VISUALIZER_RANGE_DB 72.0f
+
+/**
+ * @brief Fall speed of bars, in dB per second.
+ */
+#define VISUALIZER_FALL_DB 48.0f
+
+typedef struct visualizer_frame
+{
+    /**
+     * @brief Band levels in dBFS, empty if output is not available.
+     */
+    std::vector<float> bands;
+} visualizer_frame_t;
+
+typedef std::shared_ptr<visualizer_frame_t> VisualizerFramePtr;
+
+typedef struct visualizer_ctx
+{
+    visualizer_ctx();
+    ~visualizer_ctx();
+
+    /**
+     * @brief Show visualizer window.
+     */
+    bool show_window;
+
+    /**
+     * @brief Analyzer, only used by the task in flight.
+     */
+    soundsphere::audio_spectrum_t *spectrum;
+
+    /**
+     * @brief Analysis in flight, at most one.
+     */
+    soundsphere::WorkerTask::Ptr task;
+
+    /**
+     * @brief Time of last analysis, in milliseconds.
+     */
+    uint64_t last_submit;
+
+    /**
+     * @brief Time of last draw, in milliseconds.
+     */
+    uint64_t last_draw;
+
+    /**
+     * @brief Latest frame from worker.
+     */
+    VisualizerFramePtr frame;
+
+    /**
+     * @brief Levels shown, rising at once and falling by #VISUALIZER_FALL_DB.
+     */
+    std::vector<float> levels;
+} visualizer_ctx_t;
+
+static visualizer_ctx_t *s_visualizer = nullptr;
+
+visualizer_ctx::visualizer_ctx()
+{
+    show_window = false;
+    spectrum = new soundsphere::audio_spectrum_t(VISUALIZER_FFT_SIZE);
+    last_submit = 0;
+    last_draw = 0;
+    levels.resize(VISUALIZER_BANDS, -VISUALIZER_RANGE_DB);
+}
+
+visualizer_ctx::~visualizer_ctx()
+{
+    delete spectrum;
+}
+
+static void _menubar_visualizer_init(void)
+{
+    s_visualizer = new visualizer_ctx_t;
+}
+
+static void _menubar_visualizer_exit(void)
+{
+    /* The task uses analyzer, wait for it. */
+    if (s_visualizer->task.get() != nullptr)
+    {
+        s_visualizer->task->cancel();
+        s_visualizer->task->wait();
+        s_visualizer->task.reset();
+    }
+
+    delete s_visualizer;
+    s_visualizer = nullptr;
+}
+
+/**
+ * @brief Read output tap and analyze it, called in worker thread.
+ */
+static VisualizerFramePtr _menubar_visualizer_analyze(soundsphere::audio_spectrum_t *spectrum)
+{
+    VisualizerFramePtr frame = std::make_shared<visualizer_frame_t>();
+    float              samples[VISUALIZER_FFT_SIZE];
+    int                freq = soundsphere::audio_tap_read(samples, VISUALIZER_FFT_SIZE);
+    if (freq == 0)
+    {
+        return frame;
+    }
+
+    frame->bands.resize(VISUALIZER_BANDS);
+    soundsphere::audio_spectrum_analyze(*spectrum, samples, freq, frame->bands.data(), VISUALIZER_BANDS);
+    return frame;
+}
+
+/**
+ * @brief Start next analysis if the last one is done and it is time for it.
+ */
+static void _menubar_visualizer_schedule(uint64_t now)
+{
+    if (s_visualizer->task.get() != nullptr && !s_visualizer->task->finished())
+    {
+        return;
+    }
+    if (!soundsphere::_G.playbar.is_playing || now - s_visualizer->last_submit < VISUALIZER_INTERVAL_MS)
+    {
+        return;
+    }
+
+    s_visualizer->last_submit = now;
+    soundsphere::audio_spectrum_t *spectrum = s_visualizer->spectrum;
+    s_visualizer->task = soundsphere::worker_submit<VisualizerFramePtr>(
+        soundsphere::WORKER_PRIORITY_INTERACTIVE,
+        [spectrum](soundsphere::WorkerTask &) { return _menubar_visualizer_analyze(spectrum); },
+        [](VisualizerFramePtr &frame) { s_visualizer->frame = frame; });
+}
+
+/**
+ * @brief Move shown levels toward the latest frame.
+ */
+static void _menubar_visualizer_update(uint64_t now)
+{
+    float fall = VISUALIZER_FALL_DB * (float)(now - s_visualizer->last_draw) / 1000.0f;
+    s_visualizer->last_draw = now;
+
+    VisualizerFramePtr frame = s_visualizer->frame;
+    bool               has_frame = frame.get() != nullptr && !frame->bands.empty();
+    has_frame = has_frame && soundsphere::_G.playbar.is_playing;
+    for (size_t i = 0; i < VISUALIZER_BANDS; i++)
+    {
+        float target = has_frame ? frame->bands[i] : -VISUALIZER_RANGE_DB;
+        float level = std::max(s_visualizer->levels[i] - fall, target);
+        s_visualizer->levels[i] = std::max(level, -VISUALIZER_RANGE_DB);
+    }
+}
+
+static void _menubar_visualizer_draw_bars(void)
+{
+    ImVec2 pos = ImGui::GetCursorScreenPos();
+    ImVec2 size = ImGui::GetContentRegionAvail();
+    if (size.x <= 0 || size.y <= 0)
+    {
+        return;
+    }
+
+    ImDrawList *draw_list = ImGui::GetWindowDrawList();
+    ImU32       color = ImGui::GetColorU32(ImGuiCol_PlotHistogram);
+    float       width = size.x / VISUALIZER_BANDS;
+    float       gap = width > 4.0f ? 1.0f : 0.0f;
+    for (size_t i = 0; i < VISUALIZER_BANDS; i++)
+    {
+        float  value = 1.0f + s_visualizer->levels[i] / VISUALIZER_RANGE_DB;
+        float  height = size.y * value;
+        ImVec2 p_min(pos.x + width * i + gap, pos.y + size.y - height);
+        ImVec2 p_max(pos.x + width * (i + 1) - gap, pos.y + size.y);
+        draw_list->AddRectFilled(p_min, p_max, color);
+    }
+    ImGui::Dummy(size);
+}
+
+static void _menubar_visualizer_draw(void)
+{
+    if (ImGui::BeginMainMenuBar())
+    {
+        if (ImGui::BeginMenu(_T->tools))
+        {
+            ImGui::MenuItem(_T->visualizer, nullptr, &s_visualizer->show_window);
+            ImGui::EndMenu();
+        }
+        ImGui::EndMainMenuBar();
+    }
+    if (!s_visualizer->show_window)
+    {
+        return;
+    }
+
+    uint64_t now = soundsphere::clock_time_ms();
+    _menubar_visualizer_schedule(now);
+    _menubar_visualizer_update(now);
+
+    ImGui::SetNextWindowSize(ImVec2(480, 200), ImGuiCond_FirstUseEver);
+    if (ImGui::Begin(_T->visualizer, &s_visualizer->show_window))
+    {
+        _menubar_visualizer_draw_bars();
+    }
+    ImGui::End();
+}
+
+const soundsphere::widget_t soundsphere::menubar_visualizer = {
+    _menubar_visualizer_init,
+    _menubar_visualizer_exit,
+    _menubar_visualizer_draw,
+    nullptr,
+};
@@ -0,0 +1,332 @@
+#include <cerrno>
+#include <cstdint>
+#include <new>
+#include <thread>
+#include <vector>
+#include "msg_queue.hpp"
+
+/**
+ * @brief Block sizes of message pool. Larger blocks go to heap directly.
+ */
+static const size_t s_msg_pool_sizes[] = { 64, 128, 256, 512 };
+
+/**
+ * @brief Number of blocks allocated at once when a size class runs out.
+ */
+#define MSG_POOL_CHUNK_BLOCKS 64
+
+#define MSG_POOL_CLASSES (sizeof(s_msg_pool_sizes) / sizeof(s_msg_pool_sizes[0]))
+
+typedef struct msg_pool_block
+{
+    struct msg_pool_block *next;
+} msg_pool_block_t;
+
+typedef struct msg_pool_class
+{
+    msg_pool_class();
+    ~msg_pool_class();
+
+    std::atomic_flag    lock;      /**< Protects fields below. */
+    msg_pool_block_t   *free_list; /**< Free blocks. */
+    std::vector<void *> chunks;    /**< Memory owned by this class. */
+} msg_pool_class_t;
+
+static msg_pool_class_t s_msg_pool[MSG_POOL_CLASSES];
+
+static void _msg_spin_lock(std::atomic_flag *lock)
+{
+    while (lock->test_and_set(std::memory_order_acquire))
+    {
+        std::this_thread::yield();
+    }
+}
+
+static void _msg_spin_unlock(std::atomic_flag *lock)
+{
+    lock->clear(std::memory_order_release);
+}
+
+msg_pool_class::msg_pool_class()
+{
+    lock.clear();
+    free_list = nullptr;
+}
+
+msg_pool_class::~msg_pool_class()
+{
+    for (size_t i = 0; i < chunks.size(); i++)
+    {
+        ::operator delete(chunks[i]);
+    }
+}
+
+static int _msg_pool_class(size_t size)
+{
+    for (size_t i = 0; i < MSG_POOL_CLASSES; i++)
+    {
+        if (size <= s_msg_pool_sizes[i])
+        {
+            return (int)i;
+        }
+    }
+    return -1;
+}
+
+void *soundsphere::msg_pool_alloc(size_t size)
+{
+    int idx = _msg_pool_class(size);
+    if (idx < 0)
+    {
+        return ::operator new(size);
+    }
+
+    msg_pool_class_t *pool = &s_msg_pool[idx];
+    _msg_spin_lock(&pool->lock);
+    msg_pool_block_t *block = pool->free_list;
+    if (block != nullptr)
+    {
+        pool->free_list = block->next;
+    }
+    _msg_spin_unlock(&pool->lock);
+
+    if (block != nullptr)
+    {
+        return block;
+    }
+
+    /* Refill outside of the lock, then keep the first block for caller. */
+    size_t block_sz = s_msg_pool_sizes[idx];
+    char  *chunk = static_cast<char *>(::operator new(block_sz * MSG_POOL_CHUNK_BLOCKS));
+
+    msg_pool_block_t *head = nullptr;
+    for (size_t i = MSG_POOL_CHUNK_BLOCKS - 1; i > 0; i--)
+    {
+        msg_pool_block_t *b = reinterpret_cast<msg_pool_block_t *>(chunk + i * block_sz);
+        b->next = head;
+        head = b;
+    }
+    msg_pool_block_t *tail = reinterpret_cast<msg_pool_block_t *>(chunk + (MSG_POOL_CHUNK_BLOCKS - 1) * block_sz);
+
+    _msg_spin_lock(&pool->lock);
+    pool->chunks.push_back(chunk);
+    tail->next = pool->free_list;
+    pool->free_list = head;
+    _msg_spin_unlock(&pool->lock);
+
+    return chunk;
+}
+
+void soundsphere::msg_pool_free(void *p, size_t size)
+{
+    int idx = _msg_pool_class(size);
+    if (idx < 0)
+    {
+        ::operator delete(p);
+        return;
+    }
+
+    msg_pool_class_t *pool = &s_msg_pool[idx];
+    msg_pool_block_t *block = static_cast<msg_pool_block_t *>(p);
+
+    _msg_spin_lock(&pool->lock);
+    block->next = pool->free_list;
+    pool->free_list = block;
+    _msg_spin_unlock(&pool->lock);
+}
+
+static size_t _msg_queue_round_capacity(size_t capacity)
+{
+    size_t v = 2 * MSG_QUEUE_COALESCE_SLOTS;
+    while (v < capacity)
+    {
+        v <<= 1;
+    }
+    return v;
+}
+
+soundsphere::MsgQueue::MsgQueue(size_t capacity)
+{
+    capacity = _msg_queue_round_capacity(capacity);
+    m_cells = new Cell[capacity];
+    m_mask = capacity - 1;
+    for (size_t i = 0; i < capacity; i++)
+    {
+        m_cells[i].seq.store(i, std::memory_order_relaxed);
+        m_cells[i].slot = -1;
+    }
+    for (size_t i = 0; i < MSG_QUEUE_COALESCE_SLOTS; i++)
+    {
+        m_slots[i].msg_id.store(MSG_ID__MAX, std::memory_order_relaxed);
+        m_slots[i].lock.clear();
+    }
+    m_pending.store(false, std::memory_order_relaxed);
+    m_enqueue_pos.store(0, std::memory_order_relaxed);
+    m_dequeue_pos = 0;
+}
+
+soundsphere::MsgQueue::~MsgQueue()
+{
+    delete[] m_cells;
+}
+
+/**
+ * @brief Vyukov's bounded queue, enqueue side.
+ *
+ * A message that is not a token only takes a cell if #MSG_QUEUE_COALESCE_SLOTS
+ * cells after it are free as well. There is at most one token per slot in the
+ * queue, so a token always finds a cell.
+ */
+int soundsphere::MsgQueue::_enqueue(Msg::Ptr &msg, int slot)
+{
+    Cell  *cell;
+    size_t pos = m_enqueue_pos.load(std::memory_order_relaxed);
+    for (;;)
+    {
+        cell = &m_cells[pos & m_mask];
+        size_t   seq = cell->seq.load(std::memory_order_acquire);
+        intptr_t dif = (intptr_t)seq - (intptr_t)pos;
+        if (dif == 0)
+        {
+            /* Other messages leave cells to tokens, freed in order, so checking the last one is enough. */
+            size_t   reserve = pos + MSG_QUEUE_COALESCE_SLOTS;
+            size_t   rseq = slot < 0 ? m_cells[reserve & m_mask].seq.load(std::memory_order_acquire) : reserve;
+            intptr_t rdif = (intptr_t)rseq - (intptr_t)reserve;
+            if (rdif < 0)
+            {
+                return -ENOBUFS;
+            }
+            else if (rdif > 0)
+            {
+                pos = m_enqueue_pos.load(std::memory_order_relaxed);
+            }
+            else if (m_enqueue_pos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+            {
+                break;
+            }
+        }
+        else if (dif < 0)
+        {
+            return -ENOBUFS;
+        }
+        else
+        {
+            pos = m_enqueue_pos.load(std::memory_order_relaxed);
+        }
+    }
+
+    cell->msg = std::move(msg);
+    cell->slot = slot;
+    cell->seq.store(pos + 1, std::memory_order_release);
+
+    /*
+     * Skip the write if already set, so producers do not bounce the line. The
+     * fence pairs with the one in take_pending(): either the consumer pops this
+     * cell after clearing the flag, or the flag is seen cleared here and set.
+     */
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (!m_pending.load(std::memory_order_relaxed))
+    {
+        m_pending.store(true, std::memory_order_release);
+    }
+    return 0;
+}
+
+soundsphere::MsgQueue::Slot *soundsphere::MsgQueue::_find_slot(int msg_id, int &idx)
+{
+    for (int i = 0; i < MSG_QUEUE_COALESCE_SLOTS; i++)
+    {
+        Slot *slot = &m_slots[i];
+        int   id = slot->msg_id.load(std::memory_order_acquire);
+        if (id == MSG_ID__MAX)
+        {
+            /* On failure id is updated to the winner, which may be us. */
+            slot->msg_id.compare_exchange_strong(id, msg_id, std::memory_order_acq_rel);
+            id = slot->msg_id.load(std::memory_order_acquire);
+        }
+        if (id == msg_id)
+        {
+            idx = i;
+            return slot;
+        }
+    }
+    return nullptr;
+}
+
+int soundsphere::MsgQueue::_push_coalesce(Msg::Ptr &msg)
+{
+    int   idx = -1;
+    Slot *slot = _find_slot(msg->msg_id, idx);
+    if (slot == nullptr)
+    {
+        return _enqueue(msg, -1);
+    }
+
+    _msg_spin_lock(&slot->lock);
+    bool queued = slot->msg.get() != nullptr;
+    slot->msg.swap(msg);
+    _msg_spin_unlock(&slot->lock);
+
+    /* A token is already waiting for the consumer, replaced message is released here. */
+    if (queued)
+    {
+        return 0;
+    }
+
+    /* Cells are reserved for tokens, so it does not fail. */
+    Msg::Ptr token;
+    return _enqueue(token, idx);
+}
+
+int soundsphere::MsgQueue::push(Msg::Ptr msg)
+{
+    if (msg->coalesce)
+    {
+        return _push_coalesce(msg);
+    }
+    return _enqueue(msg, -1);
+}
+
+bool soundsphere::MsgQueue::pop(Msg::Ptr &msg)
+{
+    for (;;)
+    {
+        Cell  *cell = &m_cells[m_dequeue_pos & m_mask];
+        size_t seq = cell->seq.load(std::memory_order_acquire);
+        if ((intptr_t)seq - (intptr_t)(m_dequeue_pos + 1) < 0)
+        {
+            return false;
+        }
+
+        int slot = cell->slot;
+        msg = std::move(cell->msg);
+        cell->seq.store(m_dequeue_pos + m_mask + 1, std::memory_order_release);
+        m_dequeue_pos++;
+
+        if (slot >= 0)
+        {
+            Slot *s = &m_slots[slot];
+            _msg_spin_lock(&s->lock);
+            msg.swap(s->msg);
+            _msg_spin_unlock(&s->lock);
+        }
+
+        if (msg.get() != nullptr)
+        {
+            return true;
+        }
+    }
+}
+
+bool soundsphere::MsgQueue::take_pending()
+{
+    if (!m_pending.load(std::memory_order_relaxed))
+    {
+        return false;
+    }
+    bool pending = m_pending.exchange(false, std::memory_order_acquire);
+
+    /* Pairs with the fence in _enqueue(), see there. */
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    return pending;
+}
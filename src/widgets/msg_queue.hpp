@@ -0,0 +1,98 @@
+#ifndef SOUND_SPHERE_WIDGETS_MSG_QUEUE_HPP
+#define SOUND_SPHERE_WIDGETS_MSG_QUEUE_HPP
+
+#include <atomic>
+#include <cstdint>
+#include "__init__.hpp"
+
+/**
+ * @brief Maximum number of coalesced message types per queue.
+ */
+#define MSG_QUEUE_COALESCE_SLOTS 4
+
+namespace soundsphere
+{
+
+/**
+ * @brief Bounded multi-producer single-consumer message queue.
+ *
+ * Producers push without lock. The consumer checks #MsgQueue::take_pending()
+ * first, so an empty queue costs one atomic load per frame.
+ *
+ * Messages with #Msg::coalesce set are parked in a per-ID slot, and only a token is
+ * queued. A newer message replaces the parked one, so the consumer only sees the
+ * latest value, in the position of the first one. A cell is reserved for the
+ * token of each slot, so a coalesced message is never dropped once it has a slot.
+ */
+class MsgQueue
+{
+public:
+    /**
+     * @brief Create queue.
+     * @param[in] capacity  Capacity, rounded up to power of 2 and at least
+     *                      2 * #MSG_QUEUE_COALESCE_SLOTS, including the cells
+     *                      reserved for tokens.
+     */
+    MsgQueue(size_t capacity);
+    virtual ~MsgQueue();
+
+public:
+    /**
+     * @brief Push message.
+     * @note MT-Safe.
+     * @param[in] msg   Message.
+     * @return 0 if success, -ENOBUFS if queue is full.
+     */
+    int push(Msg::Ptr msg);
+
+    /**
+     * @brief Pop message.
+     * @note Consumer only.
+     * @param[out] msg  Message.
+     * @return true if success, false if queue is empty.
+     */
+    bool pop(Msg::Ptr &msg);
+
+    /**
+     * @brief Check and clear pending flag.
+     * @note Consumer only. Call it before popping messages.
+     * @return true if messages were pushed since last call.
+     */
+    bool take_pending();
+
+public:
+    MsgQueue(const MsgQueue &orig) = delete;
+
+private:
+    struct Cell
+    {
+        std::atomic<size_t> seq;  /**< Sequence number. */
+        Msg::Ptr            msg;  /**< Message, null for coalesce token. */
+        int                 slot; /**< Coalesce slot of token. */
+    };
+
+    struct Slot
+    {
+        std::atomic<int> msg_id; /**< Message ID bound to this slot, #MSG_ID__MAX if free. */
+        std::atomic_flag lock;   /**< Protects #Slot::msg. */
+        Msg::Ptr         msg;    /**< Latest message, null if consumed. */
+    };
+
+    int   _enqueue(Msg::Ptr &msg, int slot);
+    int   _push_coalesce(Msg::Ptr &msg);
+    Slot *_find_slot(int msg_id, int &idx);
+
+private:
+    Cell  *m_cells;                          /**< Ring buffer. */
+    size_t m_mask;                           /**< Capacity minus 1. */
+    Slot   m_slots[MSG_QUEUE_COALESCE_SLOTS]; /**< Coalesce slots. */
+
+    /* Keep fields written by different threads in different cache lines. */
+    alignas(64) std::atomic<size_t> m_enqueue_pos; /**< Producer position. */
+    alignas(64) std::atomic<bool> m_pending;       /**< Pushed since last #take_pending(). */
+    alignas(64) size_t m_dequeue_pos;              /**< Consumer position. */
+};
+
+} // namespace soundsphere
+
+#endif
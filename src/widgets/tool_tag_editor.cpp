@@ -1,13 +1,14 @@
-#include <ev.h>
 #include <spdlog/spdlog.h>
-#include <nlohmann/json.hpp>
 #include "config/__init__.hpp"
 #include "i18n/__init__.h"
 #include "runtime/__init__.hpp"
+#include "runtime/worker.hpp"
 #include "utils/curl.hpp"
-#include "utils/krc.hpp"
+#include "utils/kugou.hpp"
+#include "utils/lyric_cache.hpp"
 #include "utils/music_tag.hpp"
 #include "utils/time.hpp"
+#include "utils/trace.hpp"
 #include "__init__.hpp"
 #include "tool_tag_editor.hpp"
 
@@ -15,22 +16,20 @@ using namespace soundsphere;
 
 typedef struct lyric_search_item
 {
-    std::string id;
-    std::string title;
-    std::string artist;
-    std::string accesskey;
-    std::string duration;
-    std::string lyric;
+    kugou_candidate_t candidate;
+    std::string       cache_key;
+    std::string       duration;
+    std::string       lyric;
 } lyric_search_item_t;
 
-typedef std::shared_ptr<lyric_search_item_t> LyricSearchPtr;
-typedef std::vector<lyric_search_item_t>     LyricSearchItemVec;
-typedef std::shared_ptr<LyricSearchItemVec>  LyricSearchItemVecPtr;
+typedef std::vector<lyric_search_item_t>    LyricSearchItemVec;
+typedef std::shared_ptr<LyricSearchItemVec> LyricSearchItemVecPtr;
+typedef std::shared_ptr<KugouCandidateVec>  KugouCandidateVecPtr;
+typedef std::shared_ptr<std::string>        LyricPtr;
 
 typedef struct tag_editor_ctx
 {
     tag_editor_ctx();
-    ~tag_editor_ctx();
 
     /**
      * @brief Whether window is opened.
@@ -48,9 +47,29 @@ typedef struct tag_editor_ctx
     MusicTagPtr tags;
 
     /**
-     * @brief Working thread.
+     * @brief Reading tags of the file to open.
      */
-    ev_os_thread_t thread;
+    WorkerFuture<MusicTagPtr>::Ptr open_task;
+
+    /**
+     * @brief In-flight lyric search request.
+     */
+    uint64_t search_req;
+
+    /**
+     * @brief Looking up cache for, or parsing, search result.
+     */
+    WorkerFuture<KugouCandidateVecPtr>::Ptr search_task;
+
+    /**
+     * @brief In-flight lyric download request.
+     */
+    uint64_t download_req;
+
+    /**
+     * @brief Looking up cache for, or parsing, downloaded lyric.
+     */
+    WorkerFuture<LyricPtr>::Ptr download_task;
 
     /**
      * @brief The search result of lyric.
@@ -63,16 +82,43 @@ typedef struct tag_editor_ctx
 } tag_editor_ctx_t;
 
 static tag_editor_ctx_t *s_tag_editor = nullptr;
-const uint64_t           TagEditorOpen::ID;
 
 TagEditorOpen::Req::Req(const std::string &path)
 {
     this->path = path;
 }
 
+/**
+ * @brief Cancel in-flight requests, so their result never reach a closed editor.
+ */
+static void _tool_tageditor_cancel(void)
+{
+    if (s_tag_editor->open_task.get() != nullptr)
+    {
+        s_tag_editor->open_task->cancel();
+        s_tag_editor->open_task.reset();
+    }
+    if (s_tag_editor->search_task.get() != nullptr)
+    {
+        s_tag_editor->search_task->cancel();
+        s_tag_editor->search_task.reset();
+    }
+    if (s_tag_editor->download_task.get() != nullptr)
+    {
+        s_tag_editor->download_task->cancel();
+        s_tag_editor->download_task.reset();
+    }
+    http_cancel(s_tag_editor->search_req);
+    s_tag_editor->search_req = 0;
+    http_cancel(s_tag_editor->download_req);
+    s_tag_editor->download_req = 0;
+}
+
 static void _tool_tageditor_close(void)
 {
+    _tool_tageditor_cancel();
     s_tag_editor->tags = std::make_shared<music_tags_t>();
+    s_tag_editor->lyric_search_ret.reset();
 }
 
 /**
@@ -82,14 +128,38 @@ static void _tag_editor_open(const std::string &path)
 {
     _tool_tageditor_close();
 
-    MusicTagPtr tags = std::make_shared<music_tags_t>();
-    tags->path = path;
-
-    music_read_tag(*tags);
+    s_tag_editor->open_task = worker_submit<MusicTagPtr>(
+        WORKER_PRIORITY_INTERACTIVE,
+        [path](WorkerTask &) {
+            MusicTagPtr tags = std::make_shared<music_tags_t>();
+            tags->path = path;
+            music_read_tag(*tags);
+            return tags;
+        },
+        [](MusicTagPtr &tags) {
+            s_tag_editor->open_task.reset();
+            s_tag_editor->tags = tags;
+            s_tag_editor->window_open = true;
+            s_tag_editor->selected_row = -1;
+        });
+}
 
-    s_tag_editor->tags = tags;
-    s_tag_editor->window_open = true;
-    s_tag_editor->selected_row = -1;
+/**
+ * @brief Write a snapshot of edited tags in worker pool.
+ * Not cancelled on close, so a save is never lost.
+ */
+static void _tool_tageditor_save(void)
+{
+    MusicTagPtr tags = std::make_shared<music_tags_t>(*s_tag_editor->tags);
+    worker_submit<bool>(WORKER_PRIORITY_INTERACTIVE, [tags](WorkerTask &) {
+        std::string errinfo;
+        if (!music_write_tag(*tags, errinfo))
+        {
+            spdlog::error("write tag to {} failed: {}", tags->path, errinfo);
+            return false;
+        }
+        return true;
+    });
 }
 
 static void _on_open_music_file(Msg::Ptr msg)
@@ -102,22 +172,14 @@ tag_editor_ctx::tag_editor_ctx()
 {
     window_open = false;
     default_window_sz = ImVec2(640, 400);
-    thread = EV_OS_THREAD_INVALID;
+    search_req = 0;
+    download_req = 0;
     selected_row = -1;
 
     req_dispatcher.set_mode(Msg::TYPE_REQ);
     req_dispatcher.register_handle<TagEditorOpen>(_on_open_music_file);
 }
 
-tag_editor_ctx::~tag_editor_ctx()
-{
-    if (thread != EV_OS_THREAD_INVALID)
-    {
-        ev_thread_exit(&thread, EV_INFINITE_TIMEOUT);
-        thread = EV_OS_THREAD_INVALID;
-    }
-}
-
 static void _tool_tageditor_init(void)
 {
     s_tag_editor = new tag_editor_ctx_t;
@@ -126,109 +188,194 @@ static void _tool_tageditor_init(void)
 
 static void _tool_tageditor_exit(void)
 {
+    _tool_tageditor_cancel();
     delete s_tag_editor;
     s_tag_editor = nullptr;
 }
 
-static void _update_lyric_search_result_ui(LyricSearchItemVecPtr vec)
-{
-    s_tag_editor->lyric_search_ret = vec;
-}
-
-static void _fill_lyric_result_ui(LyricSearchPtr item)
+static void _fill_lyric_result(const std::string &id, const std::string &lyric)
 {
     LyricSearchItemVecPtr vec = s_tag_editor->lyric_search_ret;
     for (auto it = vec->begin(); it != vec->end(); it++)
     {
-        if (it->id == item->id)
+        if (it->candidate.id == id)
         {
-            it->lyric = item->lyric;
-            s_tag_editor->tags->info.lyric = item->lyric;
+            it->lyric = lyric;
+            s_tag_editor->tags->info.lyric = lyric;
             return;
         }
     }
 }
 
-static void _lyric_search_thread(void *arg)
+static void _update_lyric_search_result(const std::string &key, const KugouCandidateVec &candidates)
 {
-    (void)arg;
+    LyricSearchItemVecPtr vec = std::make_shared<LyricSearchItemVec>();
+    for (auto it = candidates.begin(); it != candidates.end(); it++)
+    {
+        lyric_search_item_t item;
+        item.candidate = *it;
+        item.cache_key = key;
+        item.duration = time_seconds_to_string(it->duration);
+        vec->push_back(item);
+    }
 
-    EasyCurl::Ptr curl = std::make_shared<EasyCurl>();
+    s_tag_editor->lyric_search_ret = vec;
+    s_tag_editor->selected_row = -1;
+}
 
-    std::string artist = curl->escape(s_tag_editor->tags->info.artist);
-    std::string title = curl->escape(s_tag_editor->tags->info.title);
-    std::string url =
-        "https://lyrics.kugou.com/search?ver=1&man=yes&client=pc&keyword=" + artist + "-" + title + "&hash=";
-    curl_easy_setopt(curl->get(), CURLOPT_URL, url.c_str());
+/**
+ * @brief Check transfer result.
+ * @return true if \p rsp contains a valid body.
+ */
+static bool _check_response(const char *what, const http_response_t &rsp)
+{
+    if (rsp.code != CURLE_OK)
+    {
+        spdlog::error("lyric {} failed: {}", what, curl_easy_strerror(rsp.code));
+        return false;
+    }
+    if (rsp.status != 200)
+    {
+        spdlog::error("lyric {} failed: HTTP {}", what, rsp.status);
+        return false;
+    }
+    return true;
+}
 
-    std::string body;
-    CURLcode    ret = curl->perform(body);
-    if (ret != CURLE_OK)
+/**
+ * @brief Parse search result and store it in cache, in worker pool.
+ */
+static void _on_lyric_search_done(const std::string &key, HttpResponsePtr rsp)
+{
+    s_tag_editor->search_req = 0;
+    if (!_check_response("search", *rsp))
     {
-        const char *errinfo = curl_easy_strerror(ret);
-        spdlog::error("curl_easy_perform() failed: {}", errinfo);
         return;
     }
 
-    LyricSearchItemVecPtr vec = std::make_shared<LyricSearchItemVec>();
+    s_tag_editor->search_task = worker_submit<KugouCandidateVecPtr>(
+        WORKER_PRIORITY_INTERACTIVE,
+        [key, rsp](WorkerTask &) {
+            std::string          errinfo;
+            KugouCandidateVecPtr candidates = std::make_shared<KugouCandidateVec>();
+            if (kugou_parse_search(rsp->body, *candidates, errinfo) != 0)
+            {
+                spdlog::error("lyric search failed: {}", errinfo);
+                return KugouCandidateVecPtr();
+            }
 
-    nlohmann::json  rsp = nlohmann::json::parse(body);
-    nlohmann::json &candidates = rsp["candidates"];
-    for (auto it = candidates.begin(); it != candidates.end(); it++)
+            lyric_cache_put_candidates(key, *candidates);
+            return candidates;
+        },
+        [key](KugouCandidateVecPtr &candidates) {
+            s_tag_editor->search_task.reset();
+            if (candidates.get() != nullptr)
+            {
+                _update_lyric_search_result(key, *candidates);
+            }
+        });
+}
+
+/**
+ * @brief Look up cache in worker pool, and only search online on miss.
+ */
+static void _search_lyric(void)
+{
+    if (s_tag_editor->search_req != 0 || s_tag_editor->search_task.get() != nullptr)
     {
-        lyric_search_item_t item;
-        item.id = (*it)["id"].get<std::string>();
-        item.accesskey = (*it)["accesskey"].get<std::string>();
-        item.artist = (*it)["singer"].get<std::string>();
-        item.title = (*it)["song"].get<std::string>();
-        double duration = (*it)["duration"].get<double>() / 1000;
-        item.duration = time_seconds_to_string(duration);
-        vec->push_back(item);
+        return;
     }
 
-    runtime_call_in_ui<LyricSearchItemVec>(_update_lyric_search_result_ui, vec);
+    std::string artist = s_tag_editor->tags->info.artist;
+    std::string title = s_tag_editor->tags->info.title;
+    std::string key = lyric_cache_key(artist, title, s_tag_editor->tags->info.duration);
+    std::string url = kugou_search_url(artist, title);
+
+    s_tag_editor->search_task = worker_submit<KugouCandidateVecPtr>(
+        WORKER_PRIORITY_INTERACTIVE,
+        [key](WorkerTask &) {
+            KugouCandidateVecPtr candidates = std::make_shared<KugouCandidateVec>();
+            return lyric_cache_get_candidates(key, *candidates) ? candidates : KugouCandidateVecPtr();
+        },
+        [key, url](KugouCandidateVecPtr &candidates) {
+            s_tag_editor->search_task.reset();
+            if (candidates.get() != nullptr)
+            {
+                _update_lyric_search_result(key, *candidates);
+                return;
+            }
+
+            s_tag_editor->search_req =
+                http_get(url, [key](HttpResponsePtr rsp) { _on_lyric_search_done(key, rsp); });
+        });
 }
 
-static void _lyric_download_thread(void *arg)
+/**
+ * @brief Convert downloaded lyric and store it in cache, in worker pool.
+ */
+static void _on_lyric_download_done(const lyric_search_item_t &item, HttpResponsePtr rsp)
 {
-    lyric_search_item_t *info = static_cast<lyric_search_item_t *>(arg);
-    LyricSearchPtr       item = std::make_shared<lyric_search_item_t>(*info);
-    delete info;
-
-    EasyCurl::Ptr curl = std::make_shared<EasyCurl>();
-    std::string   url = "https://lyrics.kugou.com/download?ver=1&client=pc&id=" + item->id +
-                      "&accesskey=" + item->accesskey + "&fmt=krc&charset=utf8";
-    curl_easy_setopt(curl->get(), CURLOPT_URL, url.c_str());
-
-    std::string body;
-    CURLcode    ret = curl->perform(body);
-    if (ret != CURLE_OK)
+    s_tag_editor->download_req = 0;
+    if (!_check_response("download", *rsp))
     {
         return;
     }
 
-    nlohmann::json rsp = nlohmann::json::parse(body);
-    std::string    lyric = rsp["content"];
-    item->lyric = krc_to_lyric(lyric);
+    s_tag_editor->download_task = worker_submit<LyricPtr>(
+        WORKER_PRIORITY_INTERACTIVE,
+        [item, rsp](WorkerTask &) {
+            std::string errinfo;
+            LyricPtr    lyric = std::make_shared<std::string>();
+            {
+                TRACE_ZONE("lyric_download_parse");
+                if (kugou_parse_download(rsp->body, *lyric, errinfo) != 0)
+                {
+                    spdlog::error("lyric download failed: {}", errinfo);
+                    return LyricPtr();
+                }
+            }
 
-    runtime_call_in_ui<lyric_search_item_t>(_fill_lyric_result_ui, item);
+            lyric_cache_put_lyric(item.cache_key, item.candidate.id, *lyric);
+            return lyric;
+        },
+        [item](LyricPtr &lyric) {
+            s_tag_editor->download_task.reset();
+            if (lyric.get() != nullptr)
+            {
+                _fill_lyric_result(item.candidate.id, *lyric);
+            }
+        });
 }
 
+/**
+ * @brief Look up cache in worker pool, and only download on miss.
+ */
 static void _download_lyric(const lyric_search_item_t &info)
 {
-    if (s_tag_editor->thread != EV_OS_THREAD_INVALID)
+    if (s_tag_editor->download_req != 0 || s_tag_editor->download_task.get() != nullptr)
     {
         return;
     }
 
-    lyric_search_item_t *new_item = new lyric_search_item_t;
-    *new_item = info;
+    lyric_search_item_t item = info;
+    std::string         url = kugou_download_url(info.candidate);
+    s_tag_editor->download_task = worker_submit<LyricPtr>(
+        WORKER_PRIORITY_INTERACTIVE,
+        [item](WorkerTask &) {
+            LyricPtr lyric = std::make_shared<std::string>();
+            return lyric_cache_get_lyric(item.cache_key, item.candidate.id, *lyric) ? lyric : LyricPtr();
+        },
+        [item, url](LyricPtr &lyric) {
+            s_tag_editor->download_task.reset();
+            if (lyric.get() != nullptr)
+            {
+                _fill_lyric_result(item.candidate.id, *lyric);
+                return;
+            }
 
-    int ret = ev_thread_init(&s_tag_editor->thread, nullptr, _lyric_download_thread, new_item);
-    if (ret != 0)
-    {
-        delete new_item;
-    }
+            s_tag_editor->download_req =
+                http_get(url, [item](HttpResponsePtr rsp) { _on_lyric_download_done(item, rsp); });
+        });
 }
 
 static void _show_lyric_table(const LyricSearchItemVec *lyrics)
@@ -247,12 +394,12 @@ static void _show_lyric_table(const LyricSearchItemVec *lyrics)
             for (int row_n = clipper.DisplayStart; row_n < clipper.DisplayEnd; row_n++)
             {
                 const lyric_search_item_t &item = lyrics->at(row_n);
-                ImGui::PushID(item.id.c_str());
+                ImGui::PushID(item.candidate.id.c_str());
                 ImGui::TableNextRow();
                 {
                     ImGui::TableSetColumnIndex(0);
                     bool selected = row_n == s_tag_editor->selected_row;
-                    if (ImGui::Selectable(item.title.c_str(), &selected, ImGuiSelectableFlags_SpanAllColumns))
+                    if (ImGui::Selectable(item.candidate.title.c_str(), &selected, ImGuiSelectableFlags_SpanAllColumns))
                     {
                         s_tag_editor->selected_row = row_n;
                     }
@@ -262,7 +409,7 @@ static void _show_lyric_table(const LyricSearchItemVec *lyrics)
                     }
 
                     ImGui::TableSetColumnIndex(1);
-                    ImGui::Text("%s", item.artist.c_str());
+                    ImGui::Text("%s", item.candidate.artist.c_str());
 
                     ImGui::TableSetColumnIndex(2);
                     ImGui::Text("%s", item.duration.c_str());
@@ -302,32 +449,24 @@ static void _tool_tageditor_draw_editor(void)
     }
     ImGui::PopItemWidth();
 
-    bool disabled = s_tag_editor->thread != EV_OS_THREAD_INVALID;
+    bool disabled = s_tag_editor->search_req != 0 || s_tag_editor->search_task.get() != nullptr;
     if (disabled)
     {
         ImGui::BeginDisabled();
     }
     if (ImGui::Button(_T->search_lyric))
     {
-        ev_thread_init(&s_tag_editor->thread, nullptr, _lyric_search_thread, nullptr);
+        _search_lyric();
     }
     if (disabled)
     {
         ImGui::EndDisabled();
     }
-    if (s_tag_editor->thread != EV_OS_THREAD_INVALID)
-    {
-        if (ev_thread_exit(&s_tag_editor->thread, 0) == 0)
-        {
-            s_tag_editor->thread = EV_OS_THREAD_INVALID;
-        }
-    }
 
     ImGui::SameLine();
     if (ImGui::Button(_T->save))
     {
-        std::string errinfo;
-        music_write_tag(*s_tag_editor->tags, errinfo);
+        _tool_tageditor_save();
     }
 
     ImGui::EndGroup();
@@ -358,6 +497,12 @@ static void _tool_tageditor_draw(void)
             _tool_tageditor_draw_editor();
         }
         ImGui::End();
+
+        /* Window closed by user. */
+        if (!s_tag_editor->window_open)
+        {
+            _tool_tageditor_cancel();
+        }
     }
 }
 
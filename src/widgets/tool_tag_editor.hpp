@@ -9,8 +9,6 @@ namespace soundsphere
 
 struct TagEditorOpen
 {
-    const static uint64_t ID = MAKE_MSGID(WIDGET_ID_TOOL_TAG_EDITOR, __LINE__);
-
     struct Req : public Msg::Req
     {
         Req(const std::string &path);
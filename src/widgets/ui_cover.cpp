@@ -3,6 +3,7 @@
 #include "assets/icon.h"
 #include "backends/__init__.hpp"
 #include "runtime/__init__.hpp"
+#include "runtime/worker.hpp"
 #include "__init__.hpp"
 
 typedef struct cover_ctx
@@ -23,6 +24,11 @@ typedef struct cover_ctx
      * @brief The id of playing music.
      */
     uint64_t last_show_item_id;
+
+    /**
+     * @brief Cover decode task of #cover_ctx::last_show_item_id.
+     */
+    soundsphere::WorkerFuture<soundsphere::BackendImagePtr>::Ptr decode_task;
 } cover_ctx_t;
 
 static cover_ctx_t *s_cover_ctx = nullptr;
@@ -40,10 +46,45 @@ static void _ui_cover_init(void)
 
 static void _ui_cover_exit(void)
 {
+    if (s_cover_ctx->decode_task.get() != nullptr)
+    {
+        s_cover_ctx->decode_task->cancel();
+    }
+
     delete s_cover_ctx;
     s_cover_ctx = nullptr;
 }
 
+/**
+ * @brief Decode cover of \p music in worker pool.
+ * The previous cover is shown until the new one is ready.
+ */
+static void _ui_cover_decode(const soundsphere::MusicTagPtr &music)
+{
+    if (s_cover_ctx->decode_task.get() != nullptr)
+    {
+        s_cover_ctx->decode_task->cancel();
+        s_cover_ctx->decode_task.reset();
+    }
+
+    if (music->info.covers[0].data.size() == 0)
+    {
+        s_cover_ctx->last_cover = s_cover_ctx->default_cover;
+        return;
+    }
+
+    s_cover_ctx->decode_task = soundsphere::worker_submit<soundsphere::BackendImagePtr>(
+        soundsphere::WORKER_PRIORITY_INTERACTIVE,
+        [music](soundsphere::WorkerTask &) {
+            soundsphere::music_tag_image_t *cover_data = &music->info.covers[0];
+            return soundsphere::backend_decode_image(cover_data->data.data(), cover_data->data.size());
+        },
+        [](soundsphere::BackendImagePtr &image) {
+            soundsphere::Texture texture = soundsphere::backend_create_texture(image);
+            s_cover_ctx->last_cover = texture.get() != nullptr ? texture : s_cover_ctx->default_cover;
+        });
+}
+
 static void _ui_cover_draw_cover(const ImVec2 &display_sz)
 {
     soundsphere::MusicTagPtr music = soundsphere::_G.dummy_player.current_music;
@@ -58,19 +99,16 @@ static void _ui_cover_draw_cover(const ImVec2 &display_sz)
     if (s_cover_ctx->last_show_item_id != music->path_hash)
     {
         s_cover_ctx->last_show_item_id = music->path_hash;
-
-        soundsphere::music_tag_image_t *cover_data = &music->info.covers[0];
-        if (cover_data->data.size() != 0)
-        {
-            s_cover_ctx->last_cover = soundsphere::backend_load_image(cover_data->data.data(), cover_data->data.size());
-        }
-        else
-        {
-            s_cover_ctx->last_cover = s_cover_ctx->default_cover;
-        }
+        _ui_cover_decode(music);
     }
 
-    ImGui::Image(s_cover_ctx->last_cover.get(), display_sz);
+    /* The first cover may still be decoding. */
+    soundsphere::Texture cover = s_cover_ctx->last_cover;
+    if (cover.get() == nullptr)
+    {
+        cover = s_cover_ctx->default_cover;
+    }
+    ImGui::Image(cover.get(), display_sz);
 }
 
 static void _ui_cover_draw(void)
@@ -2,6 +2,7 @@
 #include <IconsFontAwesome6.h>
 #include <algorithm>
 #include <iterator>
+#include <cstdio>
 #include "i18n/__init__.h"
 #include "runtime/__init__.hpp"
 #include "ui_filter.hpp"
@@ -31,7 +32,11 @@ typedef struct ui_filter_ctx
 } ui_filter_ctx_t;
 
 static ui_filter_ctx_t *s_filter = nullptr;
-const uint64_t          UiFilterReset::ID;
+
+UiFilterSet::Req::Req(const std::string &filter)
+{
+    this->filter = filter;
+}
 
 static std::string toLower(const std::string &str)
 {
@@ -100,6 +105,14 @@ static void _on_ui_filter_reset_req(Msg::Ptr msg)
     widget_fast_rsp<UiFilterReset>(msg);
 }
 
+static void _on_ui_filter_set_req(Msg::Ptr msg)
+{
+    auto req = msg->get_req<UiFilterSet>();
+    snprintf(s_filter->filter, sizeof(s_filter->filter), "%s", req->filter.c_str());
+    _do_filter();
+    widget_fast_rsp<UiFilterSet>(msg);
+}
+
 ui_filter_ctx::ui_filter_ctx()
 {
     filter[0] = '\0';
@@ -108,6 +121,7 @@ ui_filter_ctx::ui_filter_ctx()
 
     req_dispatcher.set_mode(Msg::TYPE_REQ);
     req_dispatcher.register_handle<UiFilterReset>(_on_ui_filter_reset_req);
+    req_dispatcher.register_handle<UiFilterSet>(_on_ui_filter_set_req);
 }
 
 static void _ui_filter_init(void)
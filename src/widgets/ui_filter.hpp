@@ -1,6 +1,7 @@
 #ifndef SOUND_SPHERE_WIDGETS_UI_FILTER_HPP
 #define SOUND_SPHERE_WIDGETS_UI_FILTER_HPP
 
+#include <string>
 #include "__init__.hpp"
 
 namespace soundsphere
@@ -8,10 +9,24 @@ namespace soundsphere
 
 struct UiFilterReset
 {
-    const static uint64_t ID = MAKE_MSGID(WIDGET_ID_UI_FILTER, __LINE__);
+    struct Req : public Msg::Req
+    {
+    };
 
+    struct Rsp : public Msg::Rsp
+    {
+    };
+};
+
+/**
+ * @brief Replace filter text and refresh the playlist.
+ */
+struct UiFilterSet
+{
     struct Req : public Msg::Req
     {
+        Req(const std::string &filter);
+        std::string filter;
     };
 
     struct Rsp : public Msg::Rsp
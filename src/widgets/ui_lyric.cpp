@@ -1,17 +1,35 @@
 #include <imgui.h>
-#include <map>
+#include <algorithm>
+#include <vector>
 #include "config/__init__.hpp"
 #include "runtime/__init__.hpp"
-#include "utils/string.hpp"
+#include "runtime/worker.hpp"
+#include "utils/lyric.hpp"
+#include "utils/lyric_sidecar.hpp"
 #include "utils/time.hpp"
+#include "utils/trace.hpp"
 #include "__init__.hpp"
 
 /**
- * @brief Lyric.
- * The key is the lyric sentence time position in seconds.
- * The value is the lyric sentence;
+ * @brief Cached horizontal span of a word, relative to line begin.
  */
-typedef std::map<double, std::string> Lyric;
+typedef struct lyric_word_span
+{
+    float beg; /**< Negative if not measured yet. */
+    float end;
+} lyric_word_span_t;
+
+/**
+ * @brief Background compile job.
+ */
+typedef struct lyric_compile_job
+{
+    std::string path;       /**< Audio path, to find sidecar lyric. */
+    std::string lyric_path; /**< Sidecar lyric from folder scan. */
+    std::string lyric;      /**< Embedded lyric. Sidecar is loaded if empty. */
+} lyric_compile_job_t;
+
+typedef soundsphere::WorkerFuture<soundsphere::LyricTimelinePtr> LyricCompileTask;
 
 typedef struct lyric_ctx
 {
@@ -23,9 +41,34 @@ typedef struct lyric_ctx
     uint64_t path_hash;
 
     /**
-     * @brief Lyric.
+     * @brief Compiled lyric of #lyric_ctx::path_hash, null if not ready.
+     */
+    soundsphere::LyricTimelinePtr timeline;
+
+    /**
+     * @brief Compile task of #lyric_ctx::path_hash.
      */
-    Lyric lyric;
+    LyricCompileTask::Ptr compile_task;
+
+    /**
+     * @brief Cached text width of each line in pixels, negative if not measured yet.
+     */
+    std::vector<float> line_width;
+
+    /**
+     * @brief Cached span of each word.
+     */
+    std::vector<lyric_word_span_t> word_span;
+
+    /**
+     * @brief The font that widths are measured with.
+     */
+    ImFont *width_font;
+
+    /**
+     * @brief The font size that widths are measured with.
+     */
+    float width_font_size;
 
     /**
      * @brief The lyric scroll position
@@ -48,6 +91,8 @@ static lyric_ctx_t *s_lyric = nullptr;
 lyric_ctx::lyric_ctx()
 {
     path_hash = (uint64_t)-1;
+    width_font = nullptr;
+    width_font_size = 0.0f;
     lyric_scroll_y = 0.0f;
     last_scroll_y = 0.0f;
     last_user_scroll_time = 0;
@@ -60,99 +105,73 @@ static void _ui_lyric_init(void)
 
 static void _ui_lyric_exit(void)
 {
+    if (s_lyric->compile_task.get() != nullptr)
+    {
+        s_lyric->compile_task->cancel();
+    }
+
     delete s_lyric;
     s_lyric = nullptr;
 }
 
 /**
- * + [12:45.78]
- * + [12:45.789]
+ * @brief Drop all cached widths.
  */
-static double _split_lyric(std::string &dst, const std::string &str)
+static void _lyric_reset_width_cache(void)
 {
-    if (!(str[0] == '[' && isdigit(str[1]) && isdigit(str[2]) && str[3] == ':' && isdigit(str[4]) && isdigit(str[5]) &&
-          str[6] == '.' && isdigit(str[7]) && isdigit(str[8])))
-    {
-        dst = str;
-        return 0;
-    }
-
-    double minute = std::stod(str.substr(1, 2));
-    double seconds = std::stod(str.substr(4, 2));
-    double millisecond = 0;
+    const soundsphere::lyric_timeline_t *timeline = s_lyric->timeline.get();
+    size_t                               line_cnt = timeline != nullptr ? timeline->lines.size() : 0;
+    size_t                               word_cnt = timeline != nullptr ? timeline->words.size() : 0;
 
-    if (str[9] == ']')
-    {
-        millisecond = std::stod(str.substr(7, 2));
-        dst = str.substr(10);
-        return minute * 60 + seconds + millisecond / 1000;
-    }
-
-    if (!isdigit(str[9]) || str[10] != ']')
-    {
-        dst = str;
-        return false;
-    }
-
-    millisecond = std::stod(str.substr(7, 3));
-    dst = str.substr(11);
-    return minute * 60 + seconds + millisecond / 1000;
+    lyric_word_span_t span = { -1.0f, -1.0f };
+    s_lyric->line_width.assign(line_cnt, -1.0f);
+    s_lyric->word_span.assign(word_cnt, span);
 }
 
-static void _strip_lyric(std::string &lyric)
+static void _lyric_compile_done_ui(soundsphere::LyricTimelinePtr &timeline)
 {
-    size_t start = 0;
+    s_lyric->timeline = timeline;
+    _lyric_reset_width_cache();
+}
 
-    while (start < lyric.size())
+static soundsphere::LyricTimelinePtr _lyric_compile(lyric_compile_job_t *job)
+{
+    if (job->lyric.empty())
     {
-        size_t pos = lyric.find("<", start);
-        if (pos == std::string::npos)
+        TRACE_ZONE("lyric_sidecar");
+        std::string lyric_path = job->lyric_path;
+        if (lyric_path.empty())
         {
-            break;
+            lyric_path = soundsphere::lyric_sidecar_find(job->path);
         }
-
-        if (isdigit(lyric[pos + 1]) && isdigit(lyric[pos + 2]) && lyric[pos + 3] == ':' && isdigit(lyric[pos + 4]) &&
-            isdigit(lyric[pos + 5]) && lyric[pos + 6] == '.' && isdigit(lyric[pos + 7]) && isdigit(lyric[pos + 8]))
+        if (!lyric_path.empty())
         {
-            if (lyric[pos + 9] == '>')
-            {
-                lyric.erase(pos, 10);
-                start = pos;
-                continue;
-            }
-
-            if (isdigit(lyric[pos + 9]) && lyric[pos + 10] == '>')
-            {
-                lyric.erase(pos, 11);
-                start = pos;
-                continue;
-            }
-
-            start = pos + 9;
-            continue;
+            soundsphere::lyric_sidecar_read(lyric_path, job->lyric);
         }
-
-        start++;
     }
+
+    TRACE_ZONE("lyric_compile");
+    return soundsphere::lyric_compile(job->lyric);
 }
 
-static Lyric _compile_lyric(const std::string &src)
+/**
+ * @brief Compile lyric of the new track, result of previous track is dropped.
+ */
+static void _lyric_schedule_compile(const soundsphere::MusicTagPtr &obj)
 {
-    Lyric lyric;
-    soundsphere::StringVec raw_lines = soundsphere::string_split(src, "\n");
-    soundsphere::StringVec lines = soundsphere::string_trim_vec(raw_lines);
-
-    soundsphere::StringVec::iterator it = lines.begin();
-    for (; it != lines.end(); it++)
+    if (s_lyric->compile_task.get() != nullptr)
     {
-        std::string sentence;
-        double position = _split_lyric(sentence, *it);
-        _strip_lyric(sentence);
-
-        lyric.insert(Lyric::value_type(position, sentence));
+        s_lyric->compile_task->cancel();
     }
 
-    return lyric;
+    std::shared_ptr<lyric_compile_job_t> job = std::make_shared<lyric_compile_job_t>();
+    job->path = obj->path;
+    job->lyric_path = obj->lyric_path;
+    job->lyric = obj->info.lyric;
+
+    s_lyric->compile_task = soundsphere::worker_submit<soundsphere::LyricTimelinePtr>(
+        soundsphere::WORKER_PRIORITY_INTERACTIVE,
+        [job](soundsphere::WorkerTask &) { return _lyric_compile(job.get()); }, _lyric_compile_done_ui);
 }
 
 static void _scroll_here(void)
@@ -205,47 +224,142 @@ static void _auto_scroll(void)
     _scroll_here();
 }
 
-static void _show_lyric(const Lyric &lyric, double playing_position)
+/**
+ * @brief Drop cached widths if font changed.
+ */
+static void _lyric_check_width_cache(void)
+{
+    ImFont *font = ImGui::GetFont();
+    float   font_size = ImGui::GetFontSize();
+    if (font == s_lyric->width_font && font_size == s_lyric->width_font_size)
+    {
+        return;
+    }
+
+    s_lyric->width_font = font;
+    s_lyric->width_font_size = font_size;
+    _lyric_reset_width_cache();
+}
+
+/**
+ * @brief Get text width of line \p idx. Only visible lines are ever measured.
+ */
+static float _lyric_line_width(const soundsphere::lyric_timeline_t &timeline, size_t idx)
+{
+    float &width = s_lyric->line_width[idx];
+    if (width < 0.0f)
+    {
+        const soundsphere::lyric_line_t &line = timeline.lines[idx];
+        const char                      *beg = timeline.text.c_str() + line.offset;
+        width = ImGui::CalcTextSize(beg, beg + line.length).x;
+    }
+    return width;
+}
+
+/**
+ * @brief Get span of word \p idx in \p line. Only words of active lines are ever measured.
+ */
+static const lyric_word_span_t &_lyric_word_span(const soundsphere::lyric_timeline_t &timeline,
+                                                 const soundsphere::lyric_line_t &line, size_t idx)
+{
+    lyric_word_span_t &span = s_lyric->word_span[idx];
+    if (span.beg < 0.0f)
+    {
+        const soundsphere::lyric_word_t &word = timeline.words[idx];
+        const char                      *text = timeline.text.c_str();
+        span.beg = ImGui::CalcTextSize(text + line.offset, text + word.offset).x;
+        span.end = ImGui::CalcTextSize(text + line.offset, text + word.offset + word.length).x;
+    }
+    return span;
+}
+
+/**
+ * @brief Width of \p line that should be highlighted at \p playing_position.
+ */
+static float _lyric_highlight_width(const soundsphere::lyric_timeline_t &timeline, size_t idx,
+                                    double playing_position)
+{
+    const soundsphere::lyric_line_t &line = timeline.lines[idx];
+    if (line.word_cnt == 0)
+    {
+        return _lyric_line_width(timeline, idx);
+    }
+
+    float progress = 0.0f;
+    int   word_idx = soundsphere::lyric_find_word(timeline, line, playing_position, progress);
+    if (word_idx < 0)
+    {
+        return 0.0f;
+    }
+
+    const lyric_word_span_t &span = _lyric_word_span(timeline, line, line.word_beg + word_idx);
+    if ((uint32_t)word_idx + 1 == line.word_cnt && progress >= 1.0f)
+    {
+        return _lyric_line_width(timeline, idx);
+    }
+    return span.beg + (span.end - span.beg) * progress;
+}
+
+static void _show_lyric(const soundsphere::lyric_timeline_t &timeline, double playing_position)
 {
     ImVec4 fore_color(soundsphere::_config.lyric.fore_font_color[0], soundsphere::_config.lyric.fore_font_color[1],
                       soundsphere::_config.lyric.fore_font_color[2], soundsphere::_config.lyric.fore_font_color[3]);
     ImVec4 back_color(soundsphere::_config.lyric.back_font_color[0], soundsphere::_config.lyric.back_font_color[1],
                       soundsphere::_config.lyric.back_font_color[2], soundsphere::_config.lyric.back_font_color[3]);
 
-    Lyric::const_iterator it = lyric.begin();
-    for (; it != lyric.end(); it++)
+    _lyric_check_width_cache();
+
+    size_t active_beg, active_end;
+    soundsphere::lyric_find_lines(timeline, playing_position, active_beg, active_end);
+
+    const float  window_width = ImGui::GetWindowSize().x;
+    const float  line_height = ImGui::GetTextLineHeight();
+    const char  *text = timeline.text.c_str();
+    const ImU32  fore_color_u32 = ImGui::GetColorU32(fore_color);
+    ImDrawList  *draw_list = ImGui::GetWindowDrawList();
+
+    ImGuiListClipper clipper;
+    clipper.Begin((int)timeline.lines.size(), ImGui::GetTextLineHeightWithSpacing());
+    if (active_beg != active_end)
     {
-        double music_position = it->first;
-        const std::string &sentence = it->second;
+        /* Always submit the active lines so that auto scroll can reach them. */
+        clipper.IncludeItemsByIndex((int)active_beg, (int)active_end);
+    }
 
-        /* Lyric not played. */
-        if (music_position > playing_position)
+    ImGui::PushStyleColor(ImGuiCol_Text, back_color);
+    while (clipper.Step())
+    {
+        for (int row_n = clipper.DisplayStart; row_n < clipper.DisplayEnd; row_n++)
         {
-            ImGui::TextColoredCenter(back_color, "%s", sentence.c_str());
-            continue;
-        }
+            const soundsphere::lyric_line_t &line = timeline.lines[row_n];
+            const bool  is_active = (size_t)row_n >= active_beg && (size_t)row_n < active_end;
+            const char *sentence = text + line.offset;
 
-        /* If it is the last lyric, just highlight it. */
-        if (it == std::prev(lyric.end()))
-        {
-            ImGui::TextColoredCenter(fore_color, "%s", sentence.c_str());
-            _auto_scroll();
-            continue;
-        }
+            ImGui::SetCursorPosX((window_width - _lyric_line_width(timeline, row_n)) * 0.5f);
+            ImVec2 pos = ImGui::GetCursorScreenPos();
+            ImGui::TextUnformatted(sentence, sentence + line.length);
 
-        /* Get next lyric position */
-        double next_position = std::next(it)->first;
+            if (!is_active)
+            {
+                continue;
+            }
 
-        /* If current playing position is in range, highlight this lyric. */
-        if (music_position < playing_position && playing_position < next_position)
-        {
-            ImGui::TextColoredCenter(fore_color, "%s", sentence.c_str());
-            _auto_scroll();
-            continue;
-        }
+            /* Paint the sung part over the line. */
+            float width = _lyric_highlight_width(timeline, row_n, playing_position);
+            if (width > 0.0f)
+            {
+                draw_list->PushClipRect(pos, ImVec2(pos.x + width, pos.y + line_height), true);
+                draw_list->AddText(pos, fore_color_u32, sentence, sentence + line.length);
+                draw_list->PopClipRect();
+            }
 
-        ImGui::TextColoredCenter(back_color, "%s", sentence.c_str());
+            if ((size_t)row_n == active_beg)
+            {
+                _auto_scroll();
+            }
+        }
     }
+    ImGui::PopStyleColor();
 }
 
 static void _ui_lyric_draw(void)
@@ -267,10 +381,15 @@ static void _ui_lyric_draw(void)
         if (s_lyric->path_hash != obj->path_hash)
         {
             s_lyric->path_hash = obj->path_hash;
-            s_lyric->lyric = _compile_lyric(obj->info.lyric);
+            s_lyric->timeline.reset();
+            _lyric_reset_width_cache();
+            _lyric_schedule_compile(obj);
         }
 
-        _show_lyric(s_lyric->lyric, soundsphere::_G.playbar.music_position);
+        if (s_lyric->timeline.get() != nullptr)
+        {
+            _show_lyric(*s_lyric->timeline, soundsphere::_G.playbar.music_position);
+        }
     }
 
 finish:
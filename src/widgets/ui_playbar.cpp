@@ -1,13 +1,23 @@
 #include <IconsFontAwesome6.h>
 #include <spdlog/spdlog.h>
+#include <algorithm>
+#include <vector>
+#include "audio/decoder.hpp"
+#include "audio/peaks_cache.hpp"
 #include "config/__init__.hpp"
 #include "runtime/__init__.hpp"
+#include "runtime/worker.hpp"
 #include "utils/time.hpp"
 #include "__init__.hpp"
 #include "dummy_player.hpp"
 
 using namespace soundsphere;
 
+/**
+ * @brief Frames decoded at a time while building a waveform.
+ */
+#define PLAYBAR_PEAKS_BLOCK 16384
+
 typedef struct playbar_ctx
 {
     playbar_ctx();
@@ -15,6 +25,32 @@ typedef struct playbar_ctx
 
     DummyPlayerSetShuffleMode::shuffle_mode shuffle_mode;
     Msg::Dispatch evt_dispatcher;
+
+    /**
+     * @brief Music #playbar_ctx::peaks belongs to.
+     */
+    MusicTagPtr peaks_music;
+
+    /**
+     * @brief Waveform of #playbar_ctx::peaks_music, or nullptr if not ready.
+     */
+    AudioPeaksPtr peaks;
+
+    /**
+     * @brief Loads or builds #playbar_ctx::peaks.
+     */
+    WorkerFuture<AudioPeaksPtr>::Ptr peaks_task;
+
+    /**
+     * @brief #playbar_ctx::peaks summarized for the width last drawn at, one peak per pixel.
+     */
+    AudioPeakVec columns;
+
+    /**
+     * @brief Width #playbar_ctx::columns is summarized for, 0 if not yet.
+     * Kept apart from the size of columns, which is 0 for a silent track.
+     */
+    size_t columns_width;
 } playbar_ctx_t;
 
 static playbar_ctx_t *s_playbar_ctx = nullptr;
@@ -28,6 +64,7 @@ static void _on_shuffle_mode_event(Msg::Ptr msg)
 playbar_ctx::playbar_ctx()
 {
     shuffle_mode = DummyPlayerSetShuffleMode::SHUFFLE_ORDER;
+    columns_width = 0;
     evt_dispatcher.set_mode(Msg::TYPE_EVT);
     evt_dispatcher.register_handle<DummyPlayerSetShuffleMode>(_on_shuffle_mode_event);
 }
@@ -39,10 +76,16 @@ playbar_ctx::~playbar_ctx()
 static void _widget_playbar_init(void)
 {
     s_playbar_ctx = new playbar_ctx_t;
+    widget_subscribe<DummyPlayerSetShuffleMode>(WIDGET_ID_UI_PLAYBAR);
 }
 
 static void _widget_playbar_exit(void)
 {
+    if (s_playbar_ctx->peaks_task.get() != nullptr)
+    {
+        s_playbar_ctx->peaks_task->cancel();
+    }
+
     delete s_playbar_ctx;
     s_playbar_ctx = nullptr;
 }
@@ -115,37 +158,160 @@ static void _widget_playbar_draw_shuffle_btn(void)
     }
 }
 
+/**
+ * @brief Peaks of \p music from peak cache, or built by decoding it block by
+ * block in its own format, and cache them. Called in worker thread.
+ */
+static AudioPeaksPtr _widget_playbar_build_peaks(WorkerTask &task, MusicTagPtr music)
+{
+    AudioPeaksPtr peaks = peaks_cache_get(*music);
+    if (peaks.get() != nullptr || task.cancelled())
+    {
+        return peaks;
+    }
+
+    audio_decoder_t *dec = audio_decoder_open(music->path, music->info.format, 0, 0);
+    if (dec == nullptr)
+    {
+        return nullptr;
+    }
+
+    int                  channels = audio_decoder_channels(dec);
+    std::vector<int16_t> pcm((size_t)PLAYBAR_PEAKS_BLOCK * channels);
+    size_t               frames = PLAYBAR_PEAKS_BLOCK;
+    peaks = std::make_shared<audio_peaks_t>();
+    while (frames == PLAYBAR_PEAKS_BLOCK && !task.cancelled())
+    {
+        frames = audio_decoder_read(dec, pcm.data(), PLAYBAR_PEAKS_BLOCK);
+        audio_peaks_feed(*peaks, pcm.data(), frames, channels);
+    }
+    audio_decoder_close(dec);
+    if (task.cancelled())
+    {
+        return nullptr;
+    }
+
+    audio_peaks_finish(*peaks);
+    peaks_cache_put(*music, *peaks);
+    return peaks;
+}
+
+/**
+ * @brief Start loading waveform if the playing music changed.
+ * The slider is shown until it is ready.
+ */
+static void _widget_playbar_update_peaks(void)
+{
+    MusicTagPtr music = soundsphere::_G.dummy_player.current_music;
+    if (music.get() == s_playbar_ctx->peaks_music.get())
+    {
+        return;
+    }
+
+    if (s_playbar_ctx->peaks_task.get() != nullptr)
+    {
+        s_playbar_ctx->peaks_task->cancel();
+        s_playbar_ctx->peaks_task.reset();
+    }
+    s_playbar_ctx->peaks_music = music;
+    s_playbar_ctx->peaks.reset();
+    s_playbar_ctx->columns.clear();
+    s_playbar_ctx->columns_width = 0;
+    if (music.get() == nullptr)
+    {
+        return;
+    }
+
+    s_playbar_ctx->peaks_task = worker_submit<AudioPeaksPtr>(
+        WORKER_PRIORITY_BACKGROUND, [music](WorkerTask &self) { return _widget_playbar_build_peaks(self, music); },
+        [](AudioPeaksPtr &peaks) {
+            s_playbar_ctx->peaks = peaks;
+            s_playbar_ctx->columns.clear();
+            s_playbar_ctx->columns_width = 0;
+        });
+}
+
+/**
+ * @brief Waveform seek bar, played part in histogram color.
+ * @param[in,out] position  Position, in range of [0, 1].
+ * @return Whether position is changed by user.
+ */
+static bool _widget_playbar_draw_waveform(float *position)
+{
+    ImVec2 pos = ImGui::GetCursorScreenPos();
+    ImVec2 size(ImGui::CalcItemWidth(), ImGui::GetFrameHeight());
+    if (size.x < 1.0f)
+    {
+        return false;
+    }
+
+    bool changed = false;
+    ImGui::InvisibleButton("##playbar_slider", size);
+    if (ImGui::IsItemActive())
+    {
+        float value = std::clamp((ImGui::GetMousePos().x - pos.x) / size.x, 0.0f, 1.0f);
+        changed = value != *position;
+        *position = value;
+    }
+
+    /* Only summarized again when width changes. */
+    size_t width = (size_t)size.x;
+    if (s_playbar_ctx->columns_width != width)
+    {
+        audio_peaks_columns(*s_playbar_ctx->peaks, width, s_playbar_ctx->columns);
+        s_playbar_ctx->columns_width = width;
+    }
+
+    ImDrawList *draw_list = ImGui::GetWindowDrawList();
+    ImU32       played = ImGui::GetColorU32(ImGuiCol_PlotHistogram);
+    ImU32       remain = ImGui::GetColorU32(ImGuiCol_PlotLines);
+    float       mid = pos.y + size.y * 0.5f;
+    float       half = size.y * 0.5f - ImGui::GetStyle().FramePadding.y * 0.5f;
+    size_t      head = (size_t)(*position * (float)width);
+    draw_list->AddRectFilled(pos, ImVec2(pos.x + size.x, pos.y + size.y), ImGui::GetColorU32(ImGuiCol_FrameBg),
+                             ImGui::GetStyle().FrameRounding);
+    for (size_t x = 0; x < s_playbar_ctx->columns.size(); x++)
+    {
+        const audio_peak_t &peak = s_playbar_ctx->columns[x];
+        float               top = mid - (float)(peak.max + 1) / 128.0f * half;
+        float               bottom = std::max(mid - (float)peak.min / 128.0f * half, top + 1.0f);
+        draw_list->AddRectFilled(ImVec2(pos.x + (float)x, top), ImVec2(pos.x + (float)x + 1.0f, bottom),
+                                 x < head ? played : remain);
+    }
+    draw_list->AddLine(ImVec2(pos.x + (float)head, pos.y), ImVec2(pos.x + (float)head, pos.y + size.y),
+                       ImGui::GetColorU32(ImGuiCol_SliderGrab));
+
+    return changed;
+}
+
 static void _widget_playbar_draw_processbar(void)
 {
-    static uint64_t last_click_time = 0;
+    _widget_playbar_update_peaks();
 
     float position_percentage =
         (soundsphere::_G.playbar.music_duration == 0.0)
             ? 0.0f
             : (float)(soundsphere::_G.playbar.music_position / soundsphere::_G.playbar.music_duration);
-    if (!ImGui::SliderFloat("##playbar_slider", &position_percentage, 0, 1, "", ImGuiSliderFlags_NoInput))
+    bool changed = false;
+    if (s_playbar_ctx->peaks.get() != nullptr)
+    {
+        changed = _widget_playbar_draw_waveform(&position_percentage);
+    }
+    else
+    {
+        changed = ImGui::SliderFloat("##playbar_slider", &position_percentage, 0, 1, "", ImGuiSliderFlags_NoInput);
+    }
+    if (!changed)
     {
         return;
     }
 
     /*
-     * Use jitter timeout to avoid user long press process bar.
-     *
-     * If user long press process bar, this function is called in FPS frequency,
-     * AKA 30 / 60 / 120hz.
-     *
-     * If the FPS is 30, it means the interval between function calls is approximately
-     * 34 milliseconds, so the jitter timeout is 34 milliseconds.
-     *
-     * The lower FPS, the higher the jitter value is. Here 100ms should be enough.
+     * Seeking only moves the decoder of the playing track, and the request
+     * is coalesced by message queue, so every change while dragging is sent
+     * and the player applies the latest one.
      */
-    uint64_t now_time = soundsphere::clock_time_ms();
-    if (now_time - last_click_time > 100)
-    {
-        widget_fast_req<DummyPlayerSetPosition>(WIDGET_ID_DUMMY_PLAYER, position_percentage);
-    }
-
-    last_click_time = now_time;
+    widget_fast_req<DummyPlayerSetPosition>(WIDGET_ID_DUMMY_PLAYER, position_percentage);
 }
 
 static void _widget_playbar_draw(void)
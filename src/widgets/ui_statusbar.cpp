@@ -1,4 +1,5 @@
 #include <imgui.h>
+#include "i18n/__init__.h"
 #include "runtime/__init__.hpp"
 #include "utils/time.hpp"
 #include "__init__.hpp"
@@ -84,9 +85,11 @@ static void _widget_statusbar_draw(void)
         soundsphere::time_seconds_to_string(timebuf_pos, sizeof(timebuf_pos), soundsphere::_G.playbar.music_position);
         soundsphere::time_seconds_to_string(timebuf_len, sizeof(timebuf_len), soundsphere::_G.playbar.music_duration);
 
-        ImGui::Text("%s | %d kbps | %d Hz | %d Channel | %s / %s", type != NULL ? type : "---",
-                    s_statusbar_ctx->bitrate, s_statusbar_ctx->samplerate, s_statusbar_ctx->channels, timebuf_pos,
-                    timebuf_len);
+        /* Differs from the track if it is resampled. */
+        ImGui::Text("%s | %d kbps | %d Hz | %d Channel | %s: %d Hz, %d Channel | %s / %s", type != NULL ? type : "---",
+                    s_statusbar_ctx->bitrate, s_statusbar_ctx->samplerate, s_statusbar_ctx->channels, _T->output,
+                    soundsphere::_G.dummy_player.output_freq, soundsphere::_G.dummy_player.output_channels,
+                    timebuf_pos, timebuf_len);
     }
     ImGui::End();
 }
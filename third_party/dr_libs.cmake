@@ -0,0 +1,8 @@
+# dr_flac and dr_mp3 are single headers, their implementation is compiled
+# into src/audio/decoder.cpp.
+find_path(DR_LIBS_INCLUDE_DIRS dr_flac.h
+    HINTS ${CMAKE_CURRENT_SOURCE_DIR}/third_party/dr_libs
+)
+if (NOT DR_LIBS_INCLUDE_DIRS)
+    message(FATAL_ERROR "dr_flac.h not found. Clone https://github.com/mackron/dr_libs and set DR_LIBS_INCLUDE_DIRS to it.")
+endif ()
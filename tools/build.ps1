@@ -257,6 +257,17 @@ cmake --build . --config Release
 cmake --install .
 Pop-Location
 
+###############################################################################
+# dr_libs
+###############################################################################
+$drLibsUrl = "https://github.com/mackron/dr_libs.git"
+$drLibsUncompressDir = "$downloadDir/dr_libs"
+if (-Not (Test-Path "$drLibsUncompressDir")) {
+    Push-Location -Path "$downloadDir"
+    & git clone --depth 1 "$drLibsUrl"
+    Pop-Location
+}
+
 ###############################################################################
 # SoundSphere
 ###############################################################################
@@ -272,6 +283,7 @@ cmake `
     -DSDL2_DIR="$sdl2InstallDir/cmake" `
     -DSDL2_mixer_DIR="$SDLMixerInstallDir/cmake" `
     -DCURL_DIR="$curlInstallDir/lib/cmake/CURL" `
+    -DDR_LIBS_INCLUDE_DIRS="$drLibsUncompressDir" `
     "$projectDir"
 cmake --build . --config Release
 Remove-Item Env:\FREETYPE_DIR
@@ -242,6 +242,15 @@ if [ $? -ne 0 ]; then
     exit 1
 fi
 
+###############################################################################
+# dr_libs
+###############################################################################
+dr_libs_url="https://github.com/mackron/dr_libs.git"
+dr_libs_uncompress_dir="$download_dir/dr_libs"
+if [ ! -d "$dr_libs_uncompress_dir" ]; then
+    (cd $download_dir && git clone --depth 1 $dr_libs_url)
+fi
+
 ###############################################################################
 # SoundSphere
 ###############################################################################
@@ -258,6 +267,7 @@ fi
         -DSDL2_mixer_DIR=$sdl_mixer_install_dir/lib/cmake/SDL2_mixer \
         -DCMAKE_MODULE_PATH=$sdl_mixer_install_dir/lib/cmake/SDL2_mixer \
         -DCURL_DIR=$curl_install_dir/lib/cmake/CURL \
+        -DDR_LIBS_INCLUDE_DIRS=$dr_libs_uncompress_dir \
         -DZLIB_ROOT=$zlib_install_dir \
         -DZLIB_USE_STATIC_LIBS=ON \
         $project_dir && \